@@ -41,6 +41,12 @@ enum sample_format {
 	SAMPLE_FORMAT_S24_P32,
 
 	SAMPLE_FORMAT_S32,
+
+	/**
+	 * 32 bit floating point samples in the host's format.  The
+	 * range is -1.0f to +1.0f.
+	 */
+	SAMPLE_FORMAT_FLOAT,
 };
 
 /**
@@ -164,6 +170,7 @@ audio_valid_sample_format(enum sample_format format)
 	case SAMPLE_FORMAT_S24:
 	case SAMPLE_FORMAT_S24_P32:
 	case SAMPLE_FORMAT_S32:
+	case SAMPLE_FORMAT_FLOAT:
 		return true;
 
 	case SAMPLE_FORMAT_UNDEFINED:
@@ -246,6 +253,7 @@ static inline unsigned audio_format_sample_size(const struct audio_format *af)
 
 	case SAMPLE_FORMAT_S24_P32:
 	case SAMPLE_FORMAT_S32:
+	case SAMPLE_FORMAT_FLOAT:
 		return 4;
 
 	case SAMPLE_FORMAT_UNDEFINED:
@@ -21,50 +21,125 @@
 #include "buffer.h"
 #include "chunk.h"
 #include "poison.h"
+#include "lockfree.h"
 
 #include <glib.h>
 
 #include <assert.h>
 
 struct music_buffer {
-	struct music_chunk *chunks;
+	/**
+	 * The memory area holding all chunks.  Each chunk occupies
+	 * #chunk_stride bytes, because the size of its data buffer
+	 * is chosen at runtime.
+	 */
+	char *chunks;
 	unsigned num_chunks;
 
+	/** the capacity of each chunk's data buffer */
+	size_t chunk_size;
+
+	/** the distance between two chunks in #chunks */
+	size_t chunk_stride;
+
+#if MUSIC_PIPE_LOCKFREE
+	/**
+	 * The head of the list of available chunks: the lower
+	 * #index_bits contain the index of the first chunk plus one
+	 * (0 means the list is empty), and the remaining bits are a
+	 * modification counter which protects the compare-and-swap
+	 * against the ABA problem.  Only accessed with atomic
+	 * operations.
+	 */
+	volatile gint available;
+
+	/** the number of bits used for the chunk index */
+	unsigned index_bits;
+#else
 	struct music_chunk *available;
 
 	/** a mutex which protects #available */
 	GMutex *mutex;
+#endif
 
 #ifndef NDEBUG
-	unsigned num_allocated;
+	volatile gint num_allocated;
 #endif
 };
 
+static inline struct music_chunk *
+buffer_chunk(const struct music_buffer *buffer, unsigned i)
+{
+	assert(i < buffer->num_chunks);
+
+	return (struct music_chunk *)(buffer->chunks +
+				      i * buffer->chunk_stride);
+}
+
+#if MUSIC_PIPE_LOCKFREE
+
+static inline guint32
+available_make(const struct music_buffer *buffer, guint32 old,
+	       const struct music_chunk *chunk)
+{
+	guint32 serial = (old >> buffer->index_bits) + 1;
+	guint32 index = chunk != NULL
+		? ((const char *)chunk - buffer->chunks) / buffer->chunk_stride + 1
+		: 0;
+
+	return (serial << buffer->index_bits) | index;
+}
+
+static inline struct music_chunk *
+available_chunk(const struct music_buffer *buffer, guint32 value)
+{
+	guint32 index = value & ((1u << buffer->index_bits) - 1);
+
+	return index > 0 ? buffer_chunk(buffer, index - 1) : NULL;
+}
+
+#endif
+
 struct music_buffer *
-music_buffer_new(unsigned num_chunks)
+music_buffer_new(unsigned num_chunks, size_t chunk_size)
 {
 	struct music_buffer *buffer;
 	struct music_chunk *chunk;
 
 	assert(num_chunks > 0);
+	assert(chunk_size > 0);
 
 	buffer = g_new(struct music_buffer, 1);
 
-	buffer->chunks = g_new(struct music_chunk, num_chunks);
+	buffer->chunk_size = chunk_size;
+	/* keep the chunk headers and the PCM data aligned */
+	buffer->chunk_stride = (sizeof(struct music_chunk) + chunk_size + 15)
+		& ~(size_t)15;
+
+	buffer->chunks = g_malloc(num_chunks * buffer->chunk_stride);
 	buffer->num_chunks = num_chunks;
 
-	chunk = buffer->available = buffer->chunks;
-	poison_undefined(chunk, sizeof(*chunk));
+	chunk = buffer_chunk(buffer, 0);
+	poison_undefined(chunk, buffer->chunk_stride);
 
 	for (unsigned i = 1; i < num_chunks; ++i) {
-		chunk->next = &buffer->chunks[i];
+		chunk->next = buffer_chunk(buffer, i);
 		chunk = chunk->next;
-		poison_undefined(chunk, sizeof(*chunk));
+		poison_undefined(chunk, buffer->chunk_stride);
 	}
 
 	chunk->next = NULL;
 
+#if MUSIC_PIPE_LOCKFREE
+	/* leave at least 8 bits for the modification counter */
+	buffer->index_bits = g_bit_storage(num_chunks);
+	assert(buffer->index_bits <= 24);
+
+	buffer->available = 1;
+#else
+	buffer->available = buffer_chunk(buffer, 0);
 	buffer->mutex = g_mutex_new();
+#endif
 
 #ifndef NDEBUG
 	buffer->num_allocated = 0;
@@ -80,7 +155,9 @@ music_buffer_free(struct music_buffer *buffer)
 	assert(buffer->num_chunks > 0);
 	assert(buffer->num_allocated == 0);
 
+#if !MUSIC_PIPE_LOCKFREE
 	g_mutex_free(buffer->mutex);
+#endif
 	g_free(buffer->chunks);
 	g_free(buffer);
 }
@@ -91,24 +168,54 @@ music_buffer_size(const struct music_buffer *buffer)
 	return buffer->num_chunks;
 }
 
+size_t
+music_buffer_chunk_size(const struct music_buffer *buffer)
+{
+	return buffer->chunk_size;
+}
+
 struct music_chunk *
 music_buffer_allocate(struct music_buffer *buffer)
 {
 	struct music_chunk *chunk;
 
+#if MUSIC_PIPE_LOCKFREE
+	guint32 old;
+
+	do {
+		old = g_atomic_int_get(&buffer->available);
+		chunk = available_chunk(buffer, old);
+		if (chunk == NULL)
+			return NULL;
+
+		/* chunk->next may be stale if another thread has
+		   allocated this chunk meanwhile; the modification
+		   counter makes the following compare-and-swap fail
+		   in that case */
+	} while (!g_atomic_int_compare_and_exchange(&buffer->available, old,
+						    available_make(buffer, old,
+								   chunk->next)));
+
+	music_chunk_init(chunk, buffer->chunk_size);
+#else
 	g_mutex_lock(buffer->mutex);
 
 	chunk = buffer->available;
 	if (chunk != NULL) {
 		buffer->available = chunk->next;
-		music_chunk_init(chunk);
+		music_chunk_init(chunk, buffer->chunk_size);
+	}
+
+	g_mutex_unlock(buffer->mutex);
+
+	if (chunk == NULL)
+		return NULL;
+#endif
 
 #ifndef NDEBUG
-		++buffer->num_allocated;
+	g_atomic_int_inc(&buffer->num_allocated);
 #endif
-	}
 
-	g_mutex_unlock(buffer->mutex);
 	return chunk;
 }
 
@@ -121,17 +228,28 @@ music_buffer_return(struct music_buffer *buffer, struct music_chunk *chunk)
 	if (chunk->other != NULL)
 		music_buffer_return(buffer, chunk->other);
 
-	g_mutex_lock(buffer->mutex);
-
 	music_chunk_free(chunk);
-	poison_undefined(chunk, sizeof(*chunk));
+	poison_undefined(chunk, buffer->chunk_stride);
+
+#if MUSIC_PIPE_LOCKFREE
+	guint32 old;
+
+	do {
+		old = g_atomic_int_get(&buffer->available);
+		chunk->next = available_chunk(buffer, old);
+	} while (!g_atomic_int_compare_and_exchange(&buffer->available, old,
+						    available_make(buffer, old,
+								   chunk)));
+#else
+	g_mutex_lock(buffer->mutex);
 
 	chunk->next = buffer->available;
 	buffer->available = chunk;
 
-#ifndef NDEBUG
-	--buffer->num_allocated;
+	g_mutex_unlock(buffer->mutex);
 #endif
 
-	g_mutex_unlock(buffer->mutex);
+#ifndef NDEBUG
+	g_atomic_int_add(&buffer->num_allocated, -1);
+#endif
 }
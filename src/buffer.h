@@ -20,6 +20,8 @@
 #ifndef MPD_MUSIC_BUFFER_H
 #define MPD_MUSIC_BUFFER_H
 
+#include <stddef.h>
+
 /**
  * An allocator for #music_chunk objects.
  */
@@ -30,9 +32,11 @@ struct music_buffer;
  *
  * @param num_chunks the number of #music_chunk reserved in this
  * buffer
+ * @param chunk_size the capacity of each chunk's data buffer in
+ * bytes
  */
 struct music_buffer *
-music_buffer_new(unsigned num_chunks);
+music_buffer_new(unsigned num_chunks, size_t chunk_size);
 
 /**
  * Frees the #music_buffer object
@@ -48,6 +52,13 @@ music_buffer_free(struct music_buffer *buffer);
 unsigned
 music_buffer_size(const struct music_buffer *buffer);
 
+/**
+ * Returns the capacity of each chunk's data buffer, as passed to
+ * music_buffer_new().
+ */
+size_t
+music_buffer_chunk_size(const struct music_buffer *buffer);
+
 /**
  * Allocates a chunk from the buffer.  When it is not used anymore,
  * call music_buffer_return().
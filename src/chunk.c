@@ -22,13 +22,16 @@
 #include "audio_format.h"
 #include "tag.h"
 
+#include <glib.h>
+
 #include <assert.h>
 
 void
-music_chunk_init(struct music_chunk *chunk)
+music_chunk_init(struct music_chunk *chunk, size_t capacity)
 {
 	chunk->other = NULL;
 	chunk->length = 0;
+	chunk->capacity = capacity;
 	chunk->tag = NULL;
 	chunk->replay_gain_serial = 0;
 }
@@ -54,6 +57,17 @@ music_chunk_check_format(const struct music_chunk *chunk,
 }
 #endif
 
+size_t
+music_chunk_fill_size(size_t capacity,
+		      const struct audio_format *audio_format)
+{
+	const size_t frame_size = audio_format_frame_size(audio_format);
+
+	assert(capacity >= frame_size);
+
+	return capacity - capacity % frame_size;
+}
+
 void *
 music_chunk_write(struct music_chunk *chunk,
 		  const struct audio_format *audio_format,
@@ -61,7 +75,7 @@ music_chunk_write(struct music_chunk *chunk,
 		  size_t *max_length_r)
 {
 	const size_t frame_size = audio_format_frame_size(audio_format);
-	size_t num_frames;
+	size_t fill_size, num_frames;
 
 	assert(music_chunk_check_format(chunk, audio_format));
 	assert(chunk->length == 0 || audio_format_valid(&chunk->audio_format));
@@ -74,7 +88,11 @@ music_chunk_write(struct music_chunk *chunk,
 		chunk->times = data_time;
 	}
 
-	num_frames = (sizeof(chunk->data) - chunk->length) / frame_size;
+	fill_size = music_chunk_fill_size(chunk->capacity, audio_format);
+	if (chunk->length >= fill_size)
+		return NULL;
+
+	num_frames = (fill_size - chunk->length) / frame_size;
 	if (num_frames == 0)
 		return NULL;
 
@@ -93,10 +111,11 @@ music_chunk_expand(struct music_chunk *chunk,
 	const size_t frame_size = audio_format_frame_size(audio_format);
 
 	assert(chunk != NULL);
-	assert(chunk->length + length <= sizeof(chunk->data));
+	assert(chunk->length + length <= chunk->capacity);
 	assert(audio_format_equals(&chunk->audio_format, audio_format));
 
 	chunk->length += length;
 
-	return chunk->length + frame_size > sizeof(chunk->data);
+	return chunk->length + frame_size >
+		music_chunk_fill_size(chunk->capacity, audio_format);
 }
@@ -31,6 +31,9 @@
 #include <stddef.h>
 
 enum {
+	/**
+	 * The default capacity of a chunk.
+	 */
 	CHUNK_SIZE = 4096,
 };
 
@@ -57,7 +60,13 @@ struct music_chunk {
 	float mix_ratio;
 
 	/** number of bytes stored in this chunk */
-	uint16_t length;
+	uint32_t length;
+
+	/**
+	 * The capacity of the #data buffer.  This is configured at
+	 * runtime, see music_buffer_new().
+	 */
+	uint32_t capacity;
 
 	/** current bit rate of the source file */
 	uint16_t bit_rate;
@@ -86,16 +95,20 @@ struct music_chunk {
 	 */
 	unsigned replay_gain_serial;
 
-	/** the data (probably PCM) */
-	char data[CHUNK_SIZE];
-
 #ifndef NDEBUG
 	struct audio_format audio_format;
 #endif
+
+	/**
+	 * The data (probably PCM).  This buffer has #capacity
+	 * bytes; it is allocated by the #music_buffer together with
+	 * the chunk.
+	 */
+	char data[];
 };
 
 void
-music_chunk_init(struct music_chunk *chunk);
+music_chunk_init(struct music_chunk *chunk, size_t capacity);
 
 void
 music_chunk_free(struct music_chunk *chunk);
@@ -116,6 +129,21 @@ music_chunk_check_format(const struct music_chunk *chunk,
 			 const struct audio_format *audio_format);
 #endif
 
+/**
+ * Determines how many bytes of the specified audio format a chunk
+ * should be filled with: its whole capacity, rounded down to whole
+ * frames.  Chunks are always filled completely, so the
+ * "audio_buffer_size" setting describes the same duration regardless
+ * of the chunk size.
+ *
+ * @param capacity the capacity of the chunk's data buffer
+ * @param audio_format the audio format of the chunk's data
+ * @return the number of bytes, a multiple of the frame size
+ */
+size_t
+music_chunk_fill_size(size_t capacity,
+		      const struct audio_format *audio_format);
+
 /**
  * Prepares appending to the music chunk.  Returns a buffer where you
  * may write into.  After you are finished, call music_chunk_expand().
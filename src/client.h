@@ -45,6 +45,11 @@ unsigned client_get_permission(const struct client *client);
 
 void client_set_permission(struct client *client, unsigned permission);
 
+/**
+ * Write a block of data to the client.
+ */
+void client_write(struct client *client, const char *buffer, size_t buflen);
+
 /**
  * Write a C string to the client.
  */
@@ -61,15 +66,59 @@ void client_vprintf(struct client *client, const char *fmt, va_list args);
 G_GNUC_PRINTF(2, 3) void client_printf(struct client *client, const char *fmt, ...);
 
 /**
- * Adds the specified idle flags to all clients and immediately sends
- * notifications to all waiting clients.
+ * Enables or disables the compact response format (see
+ * client_compact.c) on this connection.
+ */
+void client_set_compact(struct client *client, bool compact);
+
+/**
+ * Starts a record: in compact mode, all fields until
+ * client_record_end() are sent as one length-prefixed block.  In
+ * text mode, this does nothing.
+ */
+void client_record_begin(struct client *client);
+
+/**
+ * Is a record being built, i.e. has client_record_begin() been called
+ * in compact mode?
+ */
+bool client_is_recording(const struct client *client);
+
+/**
+ * Sends one "name: value" field, or adds it to the current record.
+ *
+ * @param shared true if the value is likely to occur again in this
+ * response (e.g. a tag value); it is then sent only once, and
+ * referenced by later records
+ */
+void client_record_field(struct client *client, const char *name,
+			 const char *value, bool shared);
+
+/**
+ * Finishes the record started by client_record_begin(), and sends
+ * it.
+ */
+void client_record_end(struct client *client);
+
+/**
+ * Called at the end of a response ("OK" or "ACK"): the strings sent
+ * so far are forgotten, and later records must not refer to them.
+ */
+void client_record_reset(struct client *client);
+
+/**
+ * Adds the specified idle flags to all clients and sends
+ * notifications to the waiting clients which have subscribed to
+ * them.  A client receives at most one notification per
+ * "idle_min_interval"; more are delayed and combined.
  */
 void client_manager_idle_add(unsigned flags);
 
 /**
  * Checks whether the client has pending idle flags.  If yes, they are
- * sent immediately and "true" is returned".  If no, it puts the
- * client into waiting mode and returns false.
+ * sent immediately and "true" is returned".  If no (or if the
+ * response is delayed by the rate limit), it puts the client into
+ * waiting mode and returns false.
  */
 bool client_idle_wait(struct client *client, unsigned flags);
 
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The compact response format, enabled per connection with the
+ * "compact" command.  Each song is sent as one record:
+ *
+ *   record: LENGTH\n
+ *   (LENGTH bytes)\n
+ *
+ * The payload is a sequence of names and values.  Each string starts
+ * with an unsigned LEB128 number X: 0 is followed by the length
+ * (LEB128) and the bytes of the string; 1 is the same, but the
+ * string is also appended to the string table; X >= 2 refers to the
+ * string table entry X-2.  Names and tag values are put into the
+ * string table, so an artist or album which occurs in many songs is
+ * sent only once per response.  The table is cleared at the end of
+ * each response.
+ */
+
+#include "config.h"
+#include "client_internal.h"
+
+#include <assert.h>
+
+enum {
+	/** the maximum number of strings in the string table; more
+	    strings are sent inline */
+	CLIENT_RECORD_MAX_STRINGS = 65536,
+};
+
+enum {
+	RECORD_STRING_INLINE = 0,
+	RECORD_STRING_NEW = 1,
+	RECORD_STRING_REF = 2,
+};
+
+void
+client_set_compact(struct client *client, bool compact)
+{
+	assert(!client->recording);
+
+	client->compact = compact;
+	client_record_reset(client);
+}
+
+static void
+record_append_number(GString *record, size_t value)
+{
+	do {
+		unsigned char byte = value & 0x7f;
+
+		value >>= 7;
+		if (value != 0)
+			byte |= 0x80;
+
+		g_string_append_c(record, byte);
+	} while (value != 0);
+}
+
+static void
+record_append_string(struct client *client, const char *value, bool shared)
+{
+	GString *record = client->record;
+	size_t length = strlen(value);
+	unsigned type = RECORD_STRING_INLINE;
+
+	if (shared) {
+		GHashTable *table = client->record_strings;
+		gpointer index;
+
+		if (table == NULL)
+			table = client->record_strings =
+				g_hash_table_new_full(g_str_hash, g_str_equal,
+						      g_free, NULL);
+
+		if (g_hash_table_lookup_extended(table, value, NULL, &index)) {
+			record_append_number(record, RECORD_STRING_REF +
+					     GPOINTER_TO_UINT(index));
+			return;
+		}
+
+		if (g_hash_table_size(table) < CLIENT_RECORD_MAX_STRINGS) {
+			g_hash_table_insert(table, g_strdup(value),
+					    GUINT_TO_POINTER(g_hash_table_size(table)));
+			type = RECORD_STRING_NEW;
+		}
+	}
+
+	record_append_number(record, type);
+	record_append_number(record, length);
+	g_string_append_len(record, value, length);
+}
+
+void
+client_record_begin(struct client *client)
+{
+	assert(!client->recording);
+
+	if (!client->compact)
+		return;
+
+	if (client->record == NULL)
+		client->record = g_string_sized_new(256);
+	else
+		g_string_truncate(client->record, 0);
+
+	client->recording = true;
+}
+
+bool
+client_is_recording(const struct client *client)
+{
+	return client->recording;
+}
+
+void
+client_record_field(struct client *client, const char *name,
+		    const char *value, bool shared)
+{
+	if (!client->recording) {
+		client_printf(client, "%s: %s\n", name, value);
+		return;
+	}
+
+	record_append_string(client, name, true);
+	record_append_string(client, value, shared);
+}
+
+void
+client_record_end(struct client *client)
+{
+	GString *record = client->record;
+
+	if (!client->recording)
+		return;
+
+	client->recording = false;
+
+	client_printf(client, "record: %lu\n", (unsigned long)record->len);
+	client_write(client, record->str, record->len);
+	client_puts(client, "\n");
+}
+
+void
+client_record_reset(struct client *client)
+{
+	if (client->record_strings != NULL)
+		g_hash_table_remove_all(client->record_strings);
+}
+
+void
+client_record_deinit(struct client *client)
+{
+	if (client->record != NULL)
+		g_string_free(client->record, true);
+
+	if (client->record_strings != NULL)
+		g_hash_table_destroy(client->record_strings);
+}
@@ -23,6 +23,43 @@
 
 #include <assert.h>
 
+guint
+client_add_watch(struct client *client, GIOCondition condition,
+		 GIOFunc func)
+{
+	GSource *source;
+	guint id;
+
+	assert(client->channel != NULL);
+
+	source = g_io_create_watch(client->channel, condition);
+	/* the watch calls a GIOFunc; casting via a generic function
+	   pointer (like GLib's G_SOURCE_FUNC()) keeps
+	   -Wcast-function-type quiet */
+	g_source_set_callback(source, (GSourceFunc)(void (*)(void))func,
+			      client, NULL);
+	id = g_source_attach(source, client_thread_context(client->thread));
+	g_source_unref(source);
+
+	return id;
+}
+
+void
+client_remove_watch(struct client *client)
+{
+	GSource *source;
+
+	if (client->source_id == 0)
+		return;
+
+	source = g_main_context_find_source_by_id
+		(client_thread_context(client->thread), client->source_id);
+	if (source != NULL)
+		g_source_destroy(source);
+
+	client->source_id = 0;
+}
+
 static gboolean
 client_out_event(G_GNUC_UNUSED GIOChannel *source, GIOCondition condition,
 		 gpointer data)
@@ -37,20 +74,26 @@ client_out_event(G_GNUC_UNUSED GIOChannel *source, GIOCondition condition,
 	}
 
 	client_write_deferred(client);
+	client_query_drained(client);
 
 	if (client_is_expired(client)) {
+		if (client_is_busy(client))
+			/* the query worker or the main thread still
+			   uses the client; client_query_finish() or
+			   client_thread_finish() closes it */
+			return false;
+
 		client_close(client);
 		return false;
 	}
 
 	g_timer_start(client->last_activity);
 
-	if (g_queue_is_empty(client->deferred_send)) {
-		/* done sending deferred buffers exist: schedule
-		   read */
-		client->source_id = g_io_add_watch(client->channel,
-						   G_IO_IN|G_IO_ERR|G_IO_HUP,
-						   client_in_event, client);
+	if (client->deferred_head == NULL) {
+		/* done sending deferred buffers: process the
+		   input received meanwhile and schedule read */
+		client->source_id = 0;
+		client_resume(client);
 		return false;
 	}
 
@@ -95,14 +138,78 @@ client_in_event(G_GNUC_UNUSED GIOChannel *source, GIOCondition condition,
 		return false;
 	}
 
-	if (!g_queue_is_empty(client->deferred_send)) {
+	if (client->call != NULL) {
+		/* the main thread executes the commands;
+		   client_thread_finish() resumes */
+		client->source_id = 0;
+		client_thread_dispatch(client);
+		return false;
+	}
+
+	if (client->deferred_head != NULL) {
 		/* deferred buffers exist: schedule write */
-		client->source_id = g_io_add_watch(client->channel,
-						   G_IO_OUT|G_IO_ERR|G_IO_HUP,
-						   client_out_event, client);
+		client->source_id = client_add_watch(client,
+						     G_IO_OUT|G_IO_ERR|G_IO_HUP,
+						     client_out_event);
+		return false;
+	}
+
+	if (client->query != NULL) {
+		/* don't read more input until the query worker is
+		   done; client_query_finish() resumes */
+		client->source_id = 0;
 		return false;
 	}
 
 	/* read more */
 	return true;
 }
+
+void
+client_schedule_io(struct client *client)
+{
+	assert(!client_is_expired(client));
+	assert(client->source_id == 0);
+
+	if (client->call != NULL)
+		client_thread_dispatch(client);
+	else if (client->deferred_head != NULL)
+		client->source_id = client_add_watch(client,
+						     G_IO_OUT|G_IO_ERR|G_IO_HUP,
+						     client_out_event);
+	else if (client->query == NULL)
+		client->source_id = client_add_watch(client,
+						     G_IO_IN|G_IO_ERR|G_IO_HUP,
+						     client_in_event);
+}
+
+void
+client_resume(struct client *client)
+{
+	enum command_return ret;
+
+	assert(client->source_id == 0);
+
+	ret = client_process_input(client);
+	switch (ret) {
+	case COMMAND_RETURN_OK:
+	case COMMAND_RETURN_ERROR:
+		break;
+
+	case COMMAND_RETURN_KILL:
+		client_close(client);
+		g_main_loop_quit(main_loop);
+		return;
+
+	case COMMAND_RETURN_CLOSE:
+		client_close(client);
+		return;
+	}
+
+	if (client_is_expired(client)) {
+		client_close(client);
+		return;
+	}
+
+	client_schedule_io(client);
+}
@@ -25,25 +25,36 @@ static guint expire_source_id;
 void
 client_set_expired(struct client *client)
 {
-	if (!client_is_expired(client))
-		client_schedule_expire();
-
-	if (client->source_id != 0) {
-		g_source_remove(client->source_id);
-		client->source_id = 0;
+	if (!client_is_expired(client)) {
+		if (client->thread != NULL)
+			client_thread_schedule_expire(client->thread);
+		else
+			client_schedule_expire();
 	}
 
+	/* wake up the query worker, which may be waiting for this
+	   client to read its output */
+	client_query_cancel(client);
+
+	client_remove_watch(client);
+
 	if (client->channel != NULL) {
 		g_io_channel_unref(client->channel);
 		client->channel = NULL;
 	}
 }
 
-static void
-client_check_expired_callback(gpointer data, G_GNUC_UNUSED gpointer user_data)
+void
+client_check_expired(gpointer data, G_GNUC_UNUSED gpointer user_data)
 {
 	struct client *client = data;
 
+	if (client_is_busy(client))
+		/* can't close the client while a query worker or
+		   the main thread is using it; client_query_finish()
+		   and client_thread_finish() check again */
+		return;
+
 	if (client_is_expired(client)) {
 		g_debug("[%u] expired", client->num);
 		client_close(client);
@@ -59,7 +70,7 @@ client_check_expired_callback(gpointer data, G_GNUC_UNUSED gpointer user_data)
 static void
 client_manager_expire(void)
 {
-	client_list_foreach(client_check_expired_callback, NULL);
+	client_list_foreach(client_check_expired, NULL);
 }
 
 /**
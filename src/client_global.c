@@ -50,6 +50,11 @@ void client_manager_init(void)
 		config_get_positive(CONF_MAX_OUTPUT_BUFFER_SIZE,
 				    CLIENT_MAX_OUTPUT_BUFFER_SIZE_DEFAULT / 1024)
 		* 1024;
+
+	client_page_pool_init();
+	client_idle_global_init();
+	client_query_global_init();
+	client_thread_global_init();
 }
 
 static void client_close_all(void)
@@ -65,9 +70,18 @@ static void client_close_all(void)
 
 void client_manager_deinit(void)
 {
+	/* the query workers may deliver output to the I/O threads
+	   until they are finished */
+	client_thread_global_stop();
+	client_query_global_finish();
+	client_thread_global_finish();
+
 	client_close_all();
 
 	client_max_connections = 0;
 
 	client_deinit_expire();
+
+	client_idle_global_finish();
+	client_page_pool_deinit();
 }
@@ -17,26 +17,170 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+/*
+ * Delivers idle events to the clients.  Each thread which owns
+ * clients (the main thread, and the I/O threads, see
+ * client_thread.c) has a #client_idle_group.  Only the clients which
+ * are waiting in "idle" mode are visited, via one list per event;
+ * the events for all other clients are tracked with serial numbers,
+ * so their pending events are found when they enter "idle".
+ *
+ * A client receives at most one "idle" response per
+ * #idle_min_interval; more responses are delayed with a timer, and
+ * the events which occur meanwhile are combined.
+ */
+
 #include "config.h"
 #include "client_internal.h"
 #include "idle.h"
+#include "conf.h"
 
 #include <assert.h>
 
+enum {
+	DEFAULT_IDLE_MIN_INTERVAL_MS = 100,
+};
+
+/** the clients owned by the main thread */
+static struct client_idle_group idle_main_group;
+
+/** the minimum time between two "idle" responses to a client [s] */
+static double idle_min_interval;
+
+/** the clock for #client.idle_notified */
+static GTimer *idle_clock;
+
+void
+client_idle_global_init(void)
+{
+	assert(idle_get_names()[IDLE_NUM_EVENTS] == NULL);
+
+	idle_min_interval = config_get_unsigned(CONF_IDLE_MIN_INTERVAL,
+						DEFAULT_IDLE_MIN_INTERVAL_MS)
+		/ 1000.0;
+	idle_clock = g_timer_new();
+}
+
+void
+client_idle_global_finish(void)
+{
+	g_timer_destroy(idle_clock);
+}
+
+static struct client_idle_group *
+client_idle_group(struct client *client)
+{
+	return client->thread != NULL
+		? client_thread_idle_group(client->thread)
+		: &idle_main_group;
+}
+
+void
+client_idle_init(struct client *client)
+{
+	const struct client_idle_group *group = client_idle_group(client);
+
+	/* no events are pending on a new client */
+	for (unsigned i = 0; i < IDLE_NUM_EVENTS; ++i) {
+		client->idle_serials[i] = group->serials[i];
+		client->idle_links[i] = NULL;
+	}
+
+	client->idle_source_id = 0;
+	client->idle_notified = -1;
+}
+
+/**
+ * Returns the events which occurred since the client's last "idle"
+ * response.
+ */
+static unsigned
+client_idle_pending(struct client *client)
+{
+	const struct client_idle_group *group = client_idle_group(client);
+	unsigned flags = 0;
+
+	for (unsigned i = 0; i < IDLE_NUM_EVENTS; ++i)
+		if (client->idle_serials[i] != group->serials[i])
+			flags |= 1 << i;
+
+	return flags;
+}
+
+static void
+client_idle_subscribe(struct client *client)
+{
+	struct client_idle_group *group = client_idle_group(client);
+
+	for (unsigned i = 0; i < IDLE_NUM_EVENTS; ++i) {
+		if ((client->idle_subscriptions & (1 << i)) == 0)
+			continue;
+
+		assert(client->idle_links[i] == NULL);
+
+		group->waiters[i] = g_list_prepend(group->waiters[i], client);
+		client->idle_links[i] = group->waiters[i];
+	}
+}
+
+static void
+client_idle_unsubscribe(struct client *client)
+{
+	struct client_idle_group *group = client_idle_group(client);
+
+	for (unsigned i = 0; i < IDLE_NUM_EVENTS; ++i) {
+		if (client->idle_links[i] == NULL)
+			continue;
+
+		group->waiters[i] = g_list_delete_link(group->waiters[i],
+						       client->idle_links[i]);
+		client->idle_links[i] = NULL;
+	}
+}
+
+static void
+client_idle_cancel_timer(struct client *client)
+{
+	GSource *source;
+
+	if (client->idle_source_id == 0)
+		return;
+
+	source = g_main_context_find_source_by_id
+		(client_thread_context(client->thread),
+		 client->idle_source_id);
+	if (source != NULL)
+		g_source_destroy(source);
+
+	client->idle_source_id = 0;
+}
+
+void
+client_idle_deinit(struct client *client)
+{
+	client_idle_unsubscribe(client);
+	client_idle_cancel_timer(client);
+}
+
 /**
  * Send "idle" response to this client.
  */
 static void
 client_idle_notify(struct client *client)
 {
+	const struct client_idle_group *group = client_idle_group(client);
 	unsigned flags, i;
 	const char *const* idle_names;
 
 	assert(client->idle_waiting);
-	assert(client->idle_flags != 0);
+	assert(client->idle_source_id == 0);
 
-	flags = client->idle_flags;
-	client->idle_flags = 0;
+	flags = client_idle_pending(client);
+	assert(flags != 0);
+
+	client_idle_unsubscribe(client);
+	for (i = 0; i < IDLE_NUM_EVENTS; ++i)
+		client->idle_serials[i] = group->serials[i];
 	client->idle_waiting = false;
 
 	idle_names = idle_get_names();
@@ -48,30 +192,106 @@ client_idle_notify(struct client *client)
 
 	client_puts(client, "OK\n");
 	g_timer_start(client->last_activity);
+	client->idle_notified = g_timer_elapsed(idle_clock, NULL);
 }
 
-static void
-client_idle_callback(gpointer data, gpointer user_data)
+static gboolean
+client_idle_timer(gpointer data)
 {
 	struct client *client = data;
-	unsigned flags = GPOINTER_TO_UINT(user_data);
 
-	if (client_is_expired(client))
-		return;
+	client->idle_source_id = 0;
 
-	client->idle_flags |= flags;
-	if (client->idle_waiting
-	    && (client->idle_flags & client->idle_subscriptions)) {
+	if (!client_is_expired(client)) {
 		client_idle_notify(client);
 		client_write_output(client);
 	}
+
+	return false;
+}
+
+/**
+ * Sends the "idle" response, or schedules it if the last response
+ * was sent less than #idle_min_interval ago.  Either way, the client
+ * is removed from the waiter lists.
+ */
+static void
+client_idle_send(struct client *client)
+{
+	double delay;
+
+	client_idle_unsubscribe(client);
+
+	if (client->idle_source_id != 0)
+		/* already scheduled */
+		return;
+
+	delay = client->idle_notified >= 0
+		? client->idle_notified + idle_min_interval -
+		g_timer_elapsed(idle_clock, NULL)
+		: 0;
+	if (delay > 0) {
+		GSource *source = g_timeout_source_new(delay * 1000 + 1);
+
+		g_source_set_callback(source, client_idle_timer, client, NULL);
+		client->idle_source_id =
+			g_source_attach(source,
+					client_thread_context(client->thread));
+		g_source_unref(source);
+		return;
+	}
+
+	client_idle_notify(client);
+}
+
+void
+client_idle_group_dispatch(struct client_idle_group *group, unsigned flags)
+{
+	assert(flags != 0);
+
+	for (unsigned i = 0; i < IDLE_NUM_EVENTS; ++i)
+		if (flags & (1 << i))
+			++group->serials[i];
+
+	for (unsigned i = 0; i < IDLE_NUM_EVENTS; ++i) {
+		if ((flags & (1 << i)) == 0)
+			continue;
+
+		/* each client is removed from all lists when it is
+		   notified (or expired) */
+		while (group->waiters[i] != NULL) {
+			struct client *client = group->waiters[i]->data;
+
+			assert(client->idle_waiting);
+
+			if (client_is_expired(client)) {
+				client_idle_unsubscribe(client);
+				continue;
+			}
+
+			client_idle_send(client);
+			client_write_output(client);
+		}
+	}
 }
 
 void client_manager_idle_add(unsigned flags)
 {
 	assert(flags != 0);
 
-	client_list_foreach(client_idle_callback, GUINT_TO_POINTER(flags));
+	client_idle_group_dispatch(&idle_main_group, flags);
+	client_thread_idle_add(flags);
+}
+
+void
+client_idle_check(struct client *client)
+{
+	assert(client->idle_waiting);
+
+	if (client_idle_pending(client) & client->idle_subscriptions)
+		client_idle_send(client);
+	else
+		client_idle_subscribe(client);
 }
 
 bool client_idle_wait(struct client *client, unsigned flags)
@@ -81,9 +301,30 @@ bool client_idle_wait(struct client *client, unsigned flags)
 	client->idle_waiting = true;
 	client->idle_subscriptions = flags;
 
-	if (client->idle_flags & client->idle_subscriptions) {
-		client_idle_notify(client);
-		return true;
-	} else
+	if (client->call != NULL)
+		/* the main thread executes this command on behalf of
+		   an I/O thread, which owns the idle state;
+		   client_thread_finish() checks */
 		return false;
+
+	client_idle_check(client);
+	return !client->idle_waiting;
+}
+
+void
+client_idle_leave(struct client *client)
+{
+	assert(client->idle_waiting);
+
+	client_idle_cancel_timer(client);
+
+	if (client_idle_pending(client) & client->idle_subscriptions)
+		/* a delayed response: send it now */
+		client_idle_notify(client);
+	else {
+		/* send empty idle response and leave idle mode */
+		client_idle_unsubscribe(client);
+		client->idle_waiting = false;
+		command_success(client);
+	}
 }
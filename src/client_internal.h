@@ -22,19 +22,58 @@
 
 #include "client.h"
 #include "command.h"
+#include "database.h"
+#include "idle.h"
+
+#include <string.h>
 
 #undef G_LOG_DOMAIN
 #define G_LOG_DOMAIN "client"
 
-struct deferred_buffer {
-	size_t size;
-	char data[sizeof(long)];
+enum {
+	/** the payload size of a #client_page */
+	CLIENT_PAGE_SIZE = 16384,
+};
+
+/**
+ * A fixed-size buffer in the chain of output which could not be sent
+ * to a slow client yet.  Unused pages are kept in a pool for reuse.
+ */
+struct client_page {
+	struct client_page *next;
+
+	/** the range of #data which has not been sent yet */
+	size_t start, end;
+
+	char data[CLIENT_PAGE_SIZE];
+};
+
+/**
+ * The idle event state of the clients owned by one thread: the main
+ * thread, or one of the I/O threads (see client_thread.c).
+ */
+struct client_idle_group {
+	/** counts the events delivered to this group, per event */
+	unsigned serials[IDLE_NUM_EVENTS];
+
+	/**
+	 * The clients which are waiting in "idle" mode, one list per
+	 * event they have subscribed to.  Only these are visited when
+	 * an event is delivered.
+	 */
+	GList *waiters[IDLE_NUM_EVENTS];
 };
 
 struct client {
 	GIOChannel *channel;
 	guint source_id;
 
+	/**
+	 * The I/O thread which owns this client (see
+	 * client_thread.c), or NULL if the main thread owns it.
+	 */
+	struct client_thread *thread;
+
 	/** the buffer for reading lines from the #channel */
 	struct fifo_buffer *input;
 
@@ -43,16 +82,39 @@ struct client {
 	/** the uid of the client process, or -1 if unknown */
 	int uid;
 
+	/** has the client enabled the compact response format? */
+	bool compact;
+
+	/** is a record being built?  See client_record_begin() */
+	bool recording;
+
+	/** the payload of the current record, reused for all
+	    records */
+	GString *record;
+
+	/**
+	 * The shared strings sent in the current response, mapped to
+	 * their index.  Created on demand, cleared by
+	 * client_record_reset().
+	 */
+	GHashTable *record_strings;
+
 	/**
 	 * How long since the last activity from this client?
 	 */
 	GTimer *last_activity;
 
-	GSList *cmd_list;	/* for when in list mode */
+	/**
+	 * The command lines received in list mode (see
+	 * cmd_list_append()); the buffer is reused for the next
+	 * command list.
+	 */
+	GString *cmd_list;
 	int cmd_list_OK;	/* print OK after each command execution */
-	size_t cmd_list_size;	/* mem cmd_list consumes */
-	GQueue *deferred_send;	/* for output if client is slow */
-	size_t deferred_bytes;	/* mem deferred_send consumes */
+	/** the chain of output which could not be sent yet, for
+	    slow clients */
+	struct client_page *deferred_head, *deferred_tail;
+	size_t deferred_bytes;	/* bytes in the deferred chain */
 	unsigned int num;	/* client number */
 
 	char send_buf[16384];
@@ -61,12 +123,44 @@ struct client {
 	/** is this client waiting for an "idle" response? */
 	bool idle_waiting;
 
-	/** idle flags pending on this client, to be sent as soon as
-	    the client enters "idle" */
-	unsigned idle_flags;
+	/**
+	 * The #client_idle_group.serials values which this client
+	 * has seen.  Events whose serial differs are pending on this
+	 * client, to be sent as soon as it enters "idle".
+	 */
+	unsigned idle_serials[IDLE_NUM_EVENTS];
+
+	/**
+	 * This client's links in the #client_idle_group.waiters
+	 * lists, while it is waiting for the subscribed events.
+	 */
+	GList *idle_links[IDLE_NUM_EVENTS];
+
+	/** the timer which sends a delayed "idle" response, or 0 */
+	guint idle_source_id;
+
+	/** when was the last "idle" response sent?  Negative if
+	    never; see client_idle_now() */
+	double idle_notified;
 
 	/** idle flags that the client wants to receive */
 	unsigned idle_subscriptions;
+
+	/**
+	 * The database query which is being executed by a worker
+	 * thread on behalf of this client, or NULL.  While it is
+	 * set, no more input is processed, the client cannot be
+	 * closed, and the worker owns #send_buf.
+	 */
+	struct client_query *query;
+
+	/**
+	 * The commands which are being executed by the main thread
+	 * on behalf of this client's I/O thread, or NULL.  While it
+	 * is set, the main thread owns the client: the I/O thread
+	 * does not touch it and has no watch on its socket.
+	 */
+	struct client_call *call;
 };
 
 extern unsigned int client_max_connections;
@@ -95,19 +189,81 @@ client_list_remove(struct client *client);
 void
 client_close(struct client *client);
 
+/**
+ * Is the client waiting for a query worker or for the main thread?
+ * No more input is processed meanwhile.
+ */
+static inline bool
+client_is_busy(const struct client *client)
+{
+	return client->query != NULL || client->call != NULL;
+}
+
+/**
+ * Obtains the database read lock if the client is owned by an I/O
+ * thread, which (unlike the main thread) must hold it while it
+ * executes commands.
+ */
 static inline void
-new_cmd_list_ptr(struct client *client, const char *s)
+client_lock_db(const struct client *client)
 {
-	client->cmd_list = g_slist_prepend(client->cmd_list, g_strdup(s));
+	if (client->thread != NULL)
+		db_lock_read();
 }
 
 static inline void
-free_cmd_list(GSList *list)
+client_unlock_db(const struct client *client)
 {
-	for (GSList *tmp = list; tmp != NULL; tmp = g_slist_next(tmp))
-		g_free(tmp->data);
+	if (client->thread != NULL)
+		db_unlock_read();
+}
 
-	g_slist_free(list);
+/*
+ * A command list is a #GString which contains the command lines,
+ * each terminated by a null byte, in one contiguous buffer.
+ */
+
+static inline void
+cmd_list_append(GString *list, const char *line)
+{
+	g_string_append_len(list, line, strlen(line) + 1);
+}
+
+/**
+ * Creates a command list which contains just one line.
+ */
+static inline GString *
+cmd_list_new_single(const char *line)
+{
+	GString *list = g_string_sized_new(strlen(line) + 1);
+
+	cmd_list_append(list, line);
+	return list;
+}
+
+static inline char *
+cmd_list_first(GString *list)
+{
+	return list->len > 0 ? list->str : NULL;
+}
+
+/**
+ * Returns the line following the specified one, or NULL if it is
+ * the last one.  Call this before passing the line to
+ * command_process(), which inserts null bytes while tokenizing.
+ */
+static inline char *
+cmd_list_next(GString *list, char *line)
+{
+	char *next = line + strlen(line) + 1;
+
+	return next < list->str + list->len ? next : NULL;
+}
+
+static inline void
+free_cmd_list(GString *list)
+{
+	g_string_free(list, true);
 }
 
 void
@@ -126,20 +282,293 @@ client_schedule_expire(void);
 void
 client_deinit_expire(void);
 
+/**
+ * Closes the client if it has expired or timed out.  This is a
+ * #GFunc for client_list_foreach().
+ */
+void
+client_check_expired(gpointer data, gpointer user_data);
+
+void
+client_idle_global_init(void);
+
+void
+client_idle_global_finish(void);
+
+/**
+ * Initializes the idle state of a new client.  Must be called in
+ * the thread which owns the client.
+ */
+void
+client_idle_init(struct client *client);
+
+/**
+ * Cancels "idle" mode and a delayed response, before the client is
+ * freed.
+ */
+void
+client_idle_deinit(struct client *client);
+
+/**
+ * Delivers idle events to the waiting clients of a group.  Must be
+ * called in the thread which owns the group.
+ */
+void
+client_idle_group_dispatch(struct client_idle_group *group, unsigned flags);
+
+/**
+ * Checks for pending events after "idle" was executed by the main
+ * thread on behalf of an I/O thread (see client_idle_wait()).  Must
+ * be called in the I/O thread.
+ */
+void
+client_idle_check(struct client *client);
+
+/**
+ * Leaves "idle" mode on the client's request ("noidle"): sends the
+ * pending events (or an empty response).
+ */
+void
+client_idle_leave(struct client *client);
+
 enum command_return
 client_read(struct client *client);
 
+/**
+ * Processes all complete lines in the input buffer, until a command
+ * has been submitted to a query worker.
+ */
+enum command_return
+client_process_input(struct client *client);
+
 enum command_return
 client_process_line(struct client *client, char *line);
 
+enum command_return
+client_process_command_list(struct client *client, bool list_ok,
+			    GString *list);
+
+void
+client_page_pool_init(void);
+
+void
+client_page_pool_deinit(void);
+
+/**
+ * Frees the client's deferred output.
+ */
+void
+client_deferred_clear(struct client *client);
+
 void
 client_write_deferred(struct client *client);
 
+/**
+ * Frees the compact format state (see client_compact.c).
+ */
+void
+client_record_deinit(struct client *client);
+
 void
 client_write_output(struct client *client);
 
+/**
+ * Sends a buffer to the client, or appends it to the deferred
+ * buffers.  Must be called in the thread which owns the client.
+ */
+void
+client_write_buffer(struct client *client, const char *data, size_t length);
+
+/**
+ * Installs an I/O watch on the client's socket in the main context
+ * of the thread which owns the client.
+ *
+ * @return the source id
+ */
+guint
+client_add_watch(struct client *client, GIOCondition condition,
+		 GIOFunc func);
+
+/**
+ * Removes the client's I/O watch, if any.
+ */
+void
+client_remove_watch(struct client *client);
+
 gboolean
 client_in_event(GIOChannel *source, GIOCondition condition,
 		gpointer data);
 
+/**
+ * Installs the I/O watch which fits the client's state: write
+ * deferred output, or else read input unless a query is being
+ * executed.  The client must not have a watch.
+ */
+void
+client_schedule_io(struct client *client);
+
+/**
+ * Processes the input which was received while the client was busy,
+ * and schedules I/O.  The client must not have a watch.  This may
+ * close the client.
+ */
+void
+client_resume(struct client *client);
+
+void
+client_query_global_init(void);
+
+void
+client_query_global_finish(void);
+
+/**
+ * Submits commands to a query worker thread, if all of them are
+ * read-only database commands (see command_is_db_query()).
+ *
+ * @param list_ok -1 for a single command, otherwise the
+ * #cmd_list_OK value of the command list
+ * @param list the command lines; ownership is transferred to the
+ * query if it was submitted
+ * @return true if the commands were submitted
+ */
+bool
+client_query_submit(struct client *client, int list_ok, GString *list);
+
+/**
+ * Called by client_write_output(): if the current thread is the
+ * client's query worker, hands the data over to the thread which
+ * owns the client.
+ *
+ * @return true if the data was consumed
+ */
+bool
+client_query_output(struct client *client, const char *data, size_t length);
+
+/**
+ * Called by the thread which owns the client after deferred output
+ * has been sent to the socket: lets the query worker produce more
+ * output.
+ */
+void
+client_query_drained(struct client *client);
+
+/**
+ * Cancels the client's query (if any): the worker discards the
+ * remaining output, and the client is closed when it finishes.
+ */
+void
+client_query_cancel(struct client *client);
+
+/**
+ * Delivers the output and completion messages of the query workers
+ * from the queue, in the thread which owns their clients.
+ */
+void
+client_query_deliver(GAsyncQueue *queue);
+
+/**
+ * Frees the messages in the queue without delivering them; the
+ * queries which have finished are detached from their clients.
+ */
+void
+client_query_discard(GAsyncQueue *queue);
+
+void
+client_thread_global_init(void);
+
+/**
+ * Stops the I/O threads.  Afterwards, the main thread owns all
+ * clients; client_thread_global_finish() closes them.
+ */
+void
+client_thread_global_stop(void);
+
+void
+client_thread_global_finish(void);
+
+/**
+ * Chooses the I/O thread for a new client.
+ *
+ * @return the least busy thread, or NULL if there are no I/O threads
+ */
+struct client_thread *
+client_thread_select(void);
+
+/**
+ * Returns the number of clients owned by I/O threads.
+ */
+unsigned
+client_thread_num_clients(void);
+
+/**
+ * Returns the main context of the specified I/O thread, or NULL
+ * (the default context) if thread is NULL.
+ */
+GMainContext *
+client_thread_context(const struct client_thread *thread);
+
+/**
+ * Hands a new client over to its I/O thread (#client.thread), which
+ * adds it to its client list and starts reading.  Must be called in
+ * the main thread.
+ */
+void
+client_thread_add(struct client *client);
+
+/**
+ * Removes a client from its I/O thread's client list.
+ */
+void
+client_thread_remove(struct client *client);
+
+/**
+ * Schedules an "expired" check in the client's I/O thread.  May be
+ * called in any thread.
+ */
+void
+client_thread_schedule_expire(struct client_thread *thread);
+
+/**
+ * Delivers idle flags to the clients of all I/O threads.  Must be
+ * called in the main thread.
+ */
+void
+client_thread_idle_add(unsigned flags);
+
+struct client_idle_group *
+client_thread_idle_group(struct client_thread *thread);
+
+/**
+ * Called by a query worker: passes a message to the I/O thread,
+ * which delivers it with client_query_deliver().
+ */
+void
+client_thread_push_query_output(struct client_thread *thread,
+				gpointer output);
+
+/**
+ * Called by an I/O thread: prepares the execution of commands which
+ * are not thread safe (see command_is_thread_safe()) by the main
+ * thread.  The commands are handed over by client_thread_dispatch()
+ * after the I/O thread has removed its watch.
+ *
+ * @param list_ok -1 for a single command, otherwise the
+ * #cmd_list_OK value of the command list
+ * @param list the command lines; ownership is transferred to the
+ * call if it was submitted
+ * @return true if the commands were submitted, false if the I/O
+ * thread shall execute them itself (or if the client is owned by
+ * the main thread)
+ */
+bool
+client_thread_submit(struct client *client, int list_ok, GString *list);
+
+/**
+ * Passes the call prepared by client_thread_submit() to the main
+ * thread.  From now on, the I/O thread must not touch the client
+ * until the main thread hands it back.
+ */
+void
+client_thread_dispatch(struct client *client);
+
 #endif
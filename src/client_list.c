@@ -22,6 +22,7 @@
 
 #include <assert.h>
 
+/** the clients owned by the main thread (see client_thread.c) */
 static GList *clients;
 static unsigned num_clients;
 
@@ -34,7 +35,8 @@ client_list_is_empty(void)
 bool
 client_list_is_full(void)
 {
-	return num_clients >= client_max_connections;
+	return num_clients + client_thread_num_clients() >=
+		client_max_connections;
 }
 
 struct client *
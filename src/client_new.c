@@ -96,48 +96,63 @@ void client_new(int fd, const struct sockaddr *sa, size_t sa_length, int uid)
 	/* we prefer to do buffering */
 	g_io_channel_set_buffered(client->channel, false);
 
-	client->source_id = g_io_add_watch(client->channel,
-					   G_IO_IN|G_IO_ERR|G_IO_HUP,
-					   client_in_event, client);
-
 	client->input = fifo_buffer_new(4096);
 
 	client->permission = getDefaultPermissions();
 	client->uid = uid;
 
+	client->compact = false;
+	client->recording = false;
+	client->record = NULL;
+	client->record_strings = NULL;
+
 	client->last_activity = g_timer_new();
 
 	client->cmd_list = NULL;
 	client->cmd_list_OK = -1;
-	client->cmd_list_size = 0;
 
-	client->deferred_send = g_queue_new();
+	client->deferred_head = client->deferred_tail = NULL;
 	client->deferred_bytes = 0;
 	client->num = next_client_num++;
 
 	client->send_buf_used = 0;
 
-	(void)send(fd, GREETING, sizeof(GREETING) - 1, 0);
+	client->query = NULL;
+	client->call = NULL;
 
-	client_list_add(client);
+	(void)send(fd, GREETING, sizeof(GREETING) - 1, 0);
 
 	remote = sockaddr_to_string(sa, sa_length, NULL);
 	g_log(G_LOG_DOMAIN, LOG_LEVEL_SECURE,
 	      "[%u] opened from %s", client->num, remote);
 	g_free(remote);
-}
 
-static void
-deferred_buffer_free(gpointer data, G_GNUC_UNUSED gpointer user_data)
-{
-	struct deferred_buffer *buffer = data;
-	g_free(buffer);
+	client->thread = client_thread_select();
+	if (client->thread != NULL)
+		/* the I/O thread installs the watch; from now on,
+		   this thread must not touch the client */
+		client_thread_add(client);
+	else {
+		client_idle_init(client);
+		client->source_id = client_add_watch(client,
+						     G_IO_IN|G_IO_ERR|G_IO_HUP,
+						     client_in_event);
+		client_list_add(client);
+	}
 }
 
 void
 client_close(struct client *client)
 {
-	client_list_remove(client);
+	assert(client->query == NULL);
+	assert(client->call == NULL);
+
+	client_idle_deinit(client);
+
+	if (client->thread != NULL)
+		client_thread_remove(client);
+	else
+		client_list_remove(client);
 
 	client_set_expired(client);
 
@@ -148,8 +163,8 @@ client_close(struct client *client)
 		client->cmd_list = NULL;
 	}
 
-	g_queue_foreach(client->deferred_send, deferred_buffer_free, NULL);
-	g_queue_free(client->deferred_send);
+	client_deferred_clear(client);
+	client_record_deinit(client);
 
 	fifo_buffer_free(client->input);
 
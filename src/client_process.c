@@ -20,20 +20,57 @@
 #include "config.h"
 #include "client_internal.h"
 
+#include <assert.h>
 #include <string.h>
 
 #define CLIENT_LIST_MODE_BEGIN "command_list_begin"
 #define CLIENT_LIST_OK_MODE_BEGIN "command_list_ok_begin"
 #define CLIENT_LIST_MODE_END "command_list_end"
 
-static enum command_return
-client_process_command_list(struct client *client, bool list_ok, GSList *list)
+enum {
+	/**
+	 * A command list buffer which has grown larger than this is
+	 * freed after use, instead of being kept for the next command
+	 * list.
+	 */
+	CMD_LIST_KEEP_MAX = 64 * 1024,
+};
+
+static void
+client_begin_command_list(struct client *client, int list_ok)
+{
+	client->cmd_list_OK = list_ok;
+
+	if (client->cmd_list == NULL)
+		client->cmd_list = g_string_sized_new(1024);
+
+	assert(client->cmd_list->len == 0);
+}
+
+static void
+client_end_command_list(struct client *client)
+{
+	if (client->cmd_list != NULL) {
+		if (client->cmd_list->allocated_len > CMD_LIST_KEEP_MAX) {
+			free_cmd_list(client->cmd_list);
+			client->cmd_list = NULL;
+		} else
+			g_string_truncate(client->cmd_list, 0);
+	}
+
+	client->cmd_list_OK = -1;
+}
+
+enum command_return
+client_process_command_list(struct client *client, bool list_ok,
+			    GString *list)
 {
 	enum command_return ret = COMMAND_RETURN_OK;
 	unsigned num = 0;
 
-	for (GSList *cur = list; cur != NULL; cur = g_slist_next(cur)) {
-		char *cmd = cur->data;
+	for (char *cmd = cmd_list_first(list), *next; cmd != NULL;
+	     cmd = next) {
+		next = cmd_list_next(list, cmd);
 
 		g_debug("command_process_list: process command \"%s\"",
 			cmd);
@@ -48,6 +85,29 @@ client_process_command_list(struct client *client, bool list_ok, GSList *list)
 	return ret;
 }
 
+/**
+ * Submits a single command to a query worker (see
+ * client_query_submit()), or from an I/O thread to the main thread
+ * (see client_thread_submit()).
+ */
+static bool
+client_submit_line(struct client *client, const char *line)
+{
+	GString *list;
+
+	if (!command_is_db_query(line) &&
+	    (client->thread == NULL || command_is_thread_safe(line)))
+		return false;
+
+	list = cmd_list_new_single(line);
+	if (client_query_submit(client, -1, list) ||
+	    client_thread_submit(client, -1, list))
+		return true;
+
+	free_cmd_list(list);
+	return false;
+}
+
 enum command_return
 client_process_line(struct client *client, char *line)
 {
@@ -55,9 +115,9 @@ client_process_line(struct client *client, char *line)
 
 	if (strcmp(line, "noidle") == 0) {
 		if (client->idle_waiting) {
-			/* send empty idle response and leave idle mode */
-			client->idle_waiting = false;
-			command_success(client);
+			/* send the idle response now and leave idle
+			   mode */
+			client_idle_leave(client);
 			client_write_output(client);
 		}
 
@@ -79,14 +139,22 @@ client_process_line(struct client *client, char *line)
 			g_debug("[%u] process command list",
 				client->num);
 
-			/* for scalability reasons, we have prepended
-			   each new command; now we have to reverse it
-			   to restore the correct order */
-			client->cmd_list = g_slist_reverse(client->cmd_list);
+			if (client_query_submit(client, client->cmd_list_OK,
+						client->cmd_list) ||
+			    client_thread_submit(client, client->cmd_list_OK,
+						 client->cmd_list)) {
+				/* the query worker or the main thread
+				   owns the list now */
+				client->cmd_list = NULL;
+				client->cmd_list_OK = -1;
+				return COMMAND_RETURN_OK;
+			}
 
+			client_lock_db(client);
 			ret = client_process_command_list(client,
 							  client->cmd_list_OK,
 							  client->cmd_list);
+			client_unlock_db(client);
 			g_debug("[%u] process command "
 				"list returned %i", client->num, ret);
 
@@ -98,36 +166,37 @@ client_process_line(struct client *client, char *line)
 				command_success(client);
 
 			client_write_output(client);
-			free_cmd_list(client->cmd_list);
-			client->cmd_list = NULL;
-			client->cmd_list_OK = -1;
+			client_end_command_list(client);
 		} else {
-			size_t len = strlen(line) + 1;
-			client->cmd_list_size += len;
-			if (client->cmd_list_size >
-			    client_max_command_list_size) {
+			size_t size = client->cmd_list->len +
+				strlen(line) + 1;
+			if (size > client_max_command_list_size) {
 				g_warning("[%u] command list size (%lu) "
 					  "is larger than the max (%lu)",
 					  client->num,
-					  (unsigned long)client->cmd_list_size,
+					  (unsigned long)size,
 					  (unsigned long)client_max_command_list_size);
 				return COMMAND_RETURN_CLOSE;
 			}
 
-			new_cmd_list_ptr(client, line);
+			cmd_list_append(client->cmd_list, line);
 			ret = COMMAND_RETURN_OK;
 		}
 	} else {
 		if (strcmp(line, CLIENT_LIST_MODE_BEGIN) == 0) {
-			client->cmd_list_OK = 0;
+			client_begin_command_list(client, 0);
 			ret = COMMAND_RETURN_OK;
 		} else if (strcmp(line, CLIENT_LIST_OK_MODE_BEGIN) == 0) {
-			client->cmd_list_OK = 1;
+			client_begin_command_list(client, 1);
+			ret = COMMAND_RETURN_OK;
+		} else if (client_submit_line(client, line)) {
 			ret = COMMAND_RETURN_OK;
 		} else {
 			g_debug("[%u] process command \"%s\"",
 				client->num, line);
+			client_lock_db(client);
 			ret = command_process(client, 0, line);
+			client_unlock_db(client);
 			g_debug("[%u] command returned %i",
 				client->num, ret);
 
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Executes read-only database commands in a pool of worker threads,
+ * so a large "find" or "listallinfo" does not stall the main loop.
+ * The worker holds the database read lock while it runs the
+ * commands; its output is sent in chunks to the thread which owns
+ * the client (the main thread or a client I/O thread, see
+ * client_thread.c), which writes it to the client like any other
+ * command output.
+ *
+ * The worker produces output only as fast as the client reads it:
+ * it blocks while the output which has not been sent to the socket
+ * yet exceeds #query_output_max.  This bounds the memory used per
+ * client, regardless of the size of the result.  The database lock
+ * cannot be released while waiting, because the command being
+ * executed holds pointers into the database; therefore a client
+ * which stops reading delays the update thread until the query is
+ * cancelled after #client_timeout seconds.
+ */
+
+#include "config.h"
+#include "client_internal.h"
+#include "database.h"
+#include "event_pipe.h"
+#include "conf.h"
+
+#include <assert.h>
+#include <string.h>
+
+enum {
+	DEFAULT_QUERY_THREADS = 2,
+
+	/**
+	 * The maximum amount of output which may be pending for one
+	 * client before the query worker waits for the socket.
+	 */
+	QUERY_OUTPUT_MAX = 256 * 1024,
+};
+
+struct client_query {
+	struct client *client;
+
+	/** the command lines, see cmd_list_append() */
+	GString *commands;
+
+	/** -1 for a single command, else the command list mode */
+	int list_ok;
+
+	/** the worker thread which executes this query */
+	GThread *thread;
+
+	/** the return value of the last command */
+	enum command_return ret;
+
+	/**
+	 * The number of bytes pushed to #query_outputs which were
+	 * not delivered yet.  Protected by #query_mutex.
+	 */
+	size_t queued;
+
+	/**
+	 * The client's #deferred_bytes, as last seen by the main
+	 * thread.  Protected by #query_mutex.
+	 */
+	size_t deferred;
+
+	/**
+	 * Set when the client has expired, or when it didn't read
+	 * for too long: the remaining output is discarded.
+	 * Protected by #query_mutex.
+	 */
+	bool cancelled;
+};
+
+/**
+ * A message from a worker thread to the thread which owns the
+ * client.
+ */
+struct query_output {
+	struct client *client;
+
+	/**
+	 * The query which has finished, or NULL if this is a chunk
+	 * of output.
+	 */
+	struct client_query *done;
+
+	size_t size;
+	char data[sizeof(long)];
+};
+
+static GThreadPool *query_pool;
+
+/**
+ * Output and completion messages from the workers for clients owned
+ * by the main thread, in the order they were produced.  Each I/O
+ * thread has its own queue.
+ */
+static GAsyncQueue *query_outputs;
+
+/**
+ * Protects the flow control attributes of all #client_query
+ * objects.
+ */
+static GMutex *query_mutex;
+
+/**
+ * Broadcast when a client's pending output shrinks or when a query
+ * is cancelled.
+ */
+static GCond *query_cond;
+
+static size_t query_output_max;
+
+/**
+ * Set by client_query_global_finish(): all queries are cancelled.
+ * Protected by #query_mutex.
+ */
+static bool query_shutdown;
+
+static void
+client_query_free(struct client_query *query)
+{
+	free_cmd_list(query->commands);
+	g_free(query);
+}
+
+static void
+client_query_push(struct client *client, struct client_query *done,
+		  const char *data, size_t length)
+{
+	struct query_output *output =
+		g_malloc(sizeof(*output) - sizeof(output->data) + length);
+
+	output->client = client;
+	output->done = done;
+	output->size = length;
+	memcpy(output->data, data, length);
+
+	if (client->thread != NULL)
+		client_thread_push_query_output(client->thread, output);
+	else {
+		g_async_queue_push(query_outputs, output);
+		event_pipe_emit(PIPE_EVENT_QUERY);
+	}
+}
+
+/**
+ * Waits until the client has room for more output.
+ *
+ * @return false if the query was cancelled
+ */
+static bool
+client_query_wait(struct client_query *query, size_t length)
+{
+	GTimeVal timeout;
+	bool cancelled;
+
+	g_get_current_time(&timeout);
+	g_time_val_add(&timeout, client_timeout * G_USEC_PER_SEC);
+
+	g_mutex_lock(query_mutex);
+
+	if (query_shutdown)
+		query->cancelled = true;
+
+	while (!query->cancelled && !query_shutdown &&
+	       query->queued + query->deferred >= query_output_max) {
+		if (!g_cond_timed_wait(query_cond, query_mutex, &timeout)) {
+			/* we hold the database lock; don't let a
+			   client which doesn't read block the
+			   update thread forever */
+			g_warning("[%u] query output stalled",
+				  query->client->num);
+			query->cancelled = true;
+		}
+	}
+
+	cancelled = query->cancelled || query_shutdown;
+	if (!cancelled)
+		query->queued += length;
+
+	g_mutex_unlock(query_mutex);
+
+	return !cancelled;
+}
+
+bool
+client_query_output(struct client *client, const char *data, size_t length)
+{
+	struct client_query *query = client->query;
+
+	if (query == NULL || query->thread != g_thread_self())
+		return false;
+
+	if (client_query_wait(query, length))
+		client_query_push(client, NULL, data, length);
+
+	return true;
+}
+
+/**
+ * Updates the flow control state after output was delivered to the
+ * client or sent to the socket, and wakes up the worker.
+ */
+static void
+client_query_update(struct client_query *query, size_t delivered)
+{
+	g_mutex_lock(query_mutex);
+	assert(query->queued >= delivered);
+	query->queued -= delivered;
+	query->deferred = query->client->deferred_bytes;
+	g_cond_broadcast(query_cond);
+	g_mutex_unlock(query_mutex);
+}
+
+void
+client_query_drained(struct client *client)
+{
+	if (client->query != NULL)
+		client_query_update(client->query, 0);
+}
+
+void
+client_query_cancel(struct client *client)
+{
+	struct client_query *query = client->query;
+
+	if (query == NULL)
+		return;
+
+	g_mutex_lock(query_mutex);
+	query->cancelled = true;
+	g_cond_broadcast(query_cond);
+	g_mutex_unlock(query_mutex);
+}
+
+static void
+client_query_run(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	struct client_query *query = data;
+	struct client *client = query->client;
+	enum command_return ret;
+
+	query->thread = g_thread_self();
+
+	db_lock_read();
+
+	if (query->list_ok < 0) {
+		g_debug("[%u] process query \"%s\"", client->num,
+			query->commands->str);
+		ret = command_process(client, 0, query->commands->str);
+	} else {
+		g_debug("[%u] process query list", client->num);
+		ret = client_process_command_list(client, query->list_ok,
+						  query->commands);
+	}
+
+	db_unlock_read();
+
+	g_debug("[%u] query returned %i", client->num, ret);
+
+	if (ret == COMMAND_RETURN_OK && !client_is_expired(client))
+		command_success(client);
+
+	client_write_output(client);
+
+	query->ret = ret;
+	client_query_push(client, query, NULL, 0);
+}
+
+/**
+ * Called in the thread which owns the client when a query has
+ * finished.
+ */
+static void
+client_query_finish(struct client *client, struct client_query *query)
+{
+	enum command_return ret = query->ret;
+	bool cancelled = query->cancelled;
+
+	assert(client->query == query);
+
+	client->query = NULL;
+	client_query_free(query);
+
+	if (ret == COMMAND_RETURN_CLOSE || cancelled ||
+	    client_is_expired(client)) {
+		client_close(client);
+		return;
+	}
+
+	g_timer_start(client->last_activity);
+
+	/* if there is a watch, it is writing deferred output, and
+	   client_out_event() resumes when that is done */
+	if (client->source_id == 0)
+		client_resume(client);
+}
+
+void
+client_query_deliver(GAsyncQueue *queue)
+{
+	struct query_output *output;
+
+	while ((output = g_async_queue_try_pop(queue)) != NULL) {
+		struct client *client = output->client;
+
+		if (output->done != NULL)
+			client_query_finish(client, output->done);
+		else {
+			if (!client_is_expired(client))
+				client_write_buffer(client, output->data,
+						    output->size);
+
+			if (client->source_id == 0 &&
+			    !client_is_expired(client))
+				client_schedule_io(client);
+
+			client_query_update(client->query, output->size);
+		}
+
+		g_free(output);
+	}
+}
+
+void
+client_query_discard(GAsyncQueue *queue)
+{
+	struct query_output *output;
+
+	while ((output = g_async_queue_try_pop(queue)) != NULL) {
+		if (output->done != NULL) {
+			assert(output->client->query == output->done);
+
+			output->client->query = NULL;
+			client_query_free(output->done);
+		}
+
+		g_free(output);
+	}
+}
+
+static void
+client_query_event(void)
+{
+	client_query_deliver(query_outputs);
+}
+
+void
+client_query_global_init(void)
+{
+	unsigned num_threads = config_get_unsigned(CONF_QUERY_THREADS,
+						   DEFAULT_QUERY_THREADS);
+	GError *error = NULL;
+
+	if (num_threads == 0)
+		/* execute all queries in the main thread */
+		return;
+
+	/* stop the worker long before client_defer_output() would
+	   expire the client */
+	query_output_max = MIN(client_max_output_buffer_size / 2,
+			       (size_t)QUERY_OUTPUT_MAX);
+
+	query_mutex = g_mutex_new();
+	query_cond = g_cond_new();
+	query_outputs = g_async_queue_new();
+	query_pool = g_thread_pool_new(client_query_run, NULL,
+				       num_threads, false, &error);
+	if (query_pool == NULL)
+		g_error("Failed to create query thread pool: %s",
+			error->message);
+
+	event_pipe_register(PIPE_EVENT_QUERY, client_query_event);
+}
+
+void
+client_query_global_finish(void)
+{
+	if (query_pool == NULL)
+		return;
+
+	/* wait for all queries; their clients are about to be
+	   closed, so their output is discarded */
+	g_mutex_lock(query_mutex);
+	query_shutdown = true;
+	g_cond_broadcast(query_cond);
+	g_mutex_unlock(query_mutex);
+
+	g_thread_pool_free(query_pool, false, true);
+	query_pool = NULL;
+
+	/* the messages for I/O thread clients are discarded by
+	   client_thread_global_finish() */
+	client_query_discard(query_outputs);
+	g_async_queue_unref(query_outputs);
+	g_cond_free(query_cond);
+	g_mutex_free(query_mutex);
+}
+
+bool
+client_query_submit(struct client *client, int list_ok, GString *list)
+{
+	struct client_query *query;
+
+	assert(client->query == NULL);
+
+	if (query_pool == NULL || list->len == 0)
+		return false;
+
+	for (char *cmd = cmd_list_first(list); cmd != NULL;
+	     cmd = cmd_list_next(list, cmd))
+		if (!command_is_db_query(cmd))
+			return false;
+
+	query = g_new(struct client_query, 1);
+	query->client = client;
+	query->commands = list;
+	query->list_ok = list_ok;
+	query->thread = NULL;
+	query->ret = COMMAND_RETURN_OK;
+	query->queued = 0;
+	query->deferred = client->deferred_bytes;
+	query->cancelled = false;
+
+	client->query = query;
+	g_thread_pool_push(query_pool, query, NULL);
+	return true;
+}
@@ -24,14 +24,22 @@
 #include <assert.h>
 #include <string.h>
 
+/**
+ * Finds the next complete line in the input buffer, and null
+ * terminates it in place.  The caller must consume it with
+ * fifo_buffer_consume() when done.
+ *
+ * @param length_r the number of bytes to consume is returned here
+ */
 static char *
-client_read_line(struct client *client)
+client_read_line(struct client *client, size_t *length_r)
 {
-	const char *p, *newline;
+	char *p, *newline;
 	size_t length;
-	char *line;
 
-	p = fifo_buffer_read(client->input, &length);
+	/* the buffer belongs to this client; the line is parsed (and
+	   tokenized by command_process()) where it is */
+	p = (char *)fifo_buffer_read(client->input, &length);
 	if (p == NULL)
 		return NULL;
 
@@ -39,24 +47,26 @@ client_read_line(struct client *client)
 	if (newline == NULL)
 		return NULL;
 
-	line = g_strndup(p, newline - p);
-	fifo_buffer_consume(client->input, newline - p + 1);
+	*newline = 0;
+	*length_r = newline - p + 1;
 
-	return g_strchomp(line);
+	return g_strchomp(p);
 }
 
-static enum command_return
-client_input_received(struct client *client, size_t bytesRead)
+enum command_return
+client_process_input(struct client *client)
 {
 	char *line;
+	size_t length;
 
-	fifo_buffer_append(client->input, bytesRead);
-
-	/* process all lines */
+	/* process all lines; stop when a query worker or the main
+	   thread takes over, the remaining lines are processed by
+	   client_resume() */
 
-	while ((line = client_read_line(client)) != NULL) {
+	while (!client_is_busy(client) &&
+	       (line = client_read_line(client, &length)) != NULL) {
 		enum command_return ret = client_process_line(client, line);
-		g_free(line);
+		fifo_buffer_consume(client->input, length);
 
 		if (ret == COMMAND_RETURN_KILL ||
 		    ret == COMMAND_RETURN_CLOSE)
@@ -68,6 +78,14 @@ client_input_received(struct client *client, size_t bytesRead)
 	return COMMAND_RETURN_OK;
 }
 
+static enum command_return
+client_input_received(struct client *client, size_t bytesRead)
+{
+	fifo_buffer_append(client->input, bytesRead);
+
+	return client_process_input(client);
+}
+
 enum command_return
 client_read(struct client *client)
 {
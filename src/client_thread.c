@@ -0,0 +1,531 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Optional client I/O threads ("client_threads"): each client is
+ * owned by one of the threads, which runs its own GLib main loop.
+ * It reads the client's input, parses it, executes the commands
+ * which only touch the client (see command_is_thread_safe()), and
+ * flushes the output.  Database queries are passed to the query
+ * workers (see client_query.c), which send their output back to the
+ * I/O thread.  This takes
+ * most of the client traffic off the main loop.
+ *
+ * All other commands are executed by the main thread: the I/O thread
+ * removes its watch and passes the commands (a #client_call) to the
+ * main thread, which executes them, writes the output and hands the
+ * client back.  Meanwhile, the main thread owns the client, and the
+ * I/O thread does not touch it.
+ *
+ * Idle events (see client_idle.c) and "expired" checks are
+ * delivered to the clients by their I/O thread.
+ */
+
+#include "config.h"
+#include "client_internal.h"
+#include "event_pipe.h"
+#include "main.h"
+#include "conf.h"
+
+#include <assert.h>
+
+struct client_thread {
+	GThread *thread;
+
+	GMainContext *context;
+
+	GMainLoop *loop;
+
+	/**
+	 * The clients owned by this thread.  Only this thread
+	 * accesses the list.
+	 */
+	GList *clients;
+
+	/**
+	 * The number of clients owned by this thread, including
+	 * those which are being handed over to it.  Modified
+	 * atomically.
+	 */
+	volatile gint num_clients;
+
+	/** is an "expired" check scheduled?  Modified atomically. */
+	volatile gint expire_scheduled;
+
+	/** protects #idle_flags */
+	GMutex *mutex;
+
+	/** idle flags which were not delivered to the clients yet */
+	unsigned idle_flags;
+
+	/** the idle state of this thread's clients */
+	struct client_idle_group idle_group;
+
+	/**
+	 * Messages from the query workers for this thread's clients,
+	 * see client_query_deliver().
+	 */
+	GAsyncQueue *query_outputs;
+
+	/** is a query output delivery scheduled?  Modified
+	    atomically. */
+	volatile gint query_scheduled;
+};
+
+/**
+ * Commands which are executed by the main thread on behalf of a
+ * client I/O thread.
+ */
+struct client_call {
+	struct client *client;
+
+	/** the command lines, see cmd_list_append() */
+	GString *commands;
+
+	/** -1 for a single command, else the command list mode */
+	int list_ok;
+
+	/** the return value of the last command */
+	enum command_return ret;
+};
+
+static struct client_thread *client_threads;
+static unsigned num_client_threads;
+
+/**
+ * Calls submitted by the I/O threads, to be executed by the main
+ * thread.
+ */
+static GAsyncQueue *client_calls;
+
+static void
+client_call_free(struct client_call *call)
+{
+	free_cmd_list(call->commands);
+	g_free(call);
+}
+
+/**
+ * Schedules a function call in the specified I/O thread.  May be
+ * called in any thread.
+ */
+static void
+client_thread_invoke(struct client_thread *thread, GSourceFunc func,
+		     gpointer data)
+{
+	GSource *source = g_idle_source_new();
+
+	g_source_set_callback(source, func, data, NULL);
+	g_source_attach(source, thread->context);
+	g_source_unref(source);
+}
+
+static gpointer
+client_thread_run(gpointer data)
+{
+	struct client_thread *thread = data;
+
+	g_main_loop_run(thread->loop);
+	return NULL;
+}
+
+static gboolean
+client_thread_quit_event(gpointer data)
+{
+	struct client_thread *thread = data;
+
+	g_main_loop_quit(thread->loop);
+	return false;
+}
+
+struct client_thread *
+client_thread_select(void)
+{
+	struct client_thread *best = NULL;
+	gint best_num = G_MAXINT;
+
+	for (unsigned i = 0; i < num_client_threads; ++i) {
+		struct client_thread *thread = &client_threads[i];
+		gint num = g_atomic_int_get(&thread->num_clients);
+
+		if (num < best_num) {
+			best = thread;
+			best_num = num;
+		}
+	}
+
+	if (best != NULL)
+		g_atomic_int_inc(&best->num_clients);
+
+	return best;
+}
+
+unsigned
+client_thread_num_clients(void)
+{
+	unsigned num = 0;
+
+	for (unsigned i = 0; i < num_client_threads; ++i)
+		num += g_atomic_int_get(&client_threads[i].num_clients);
+
+	return num;
+}
+
+GMainContext *
+client_thread_context(const struct client_thread *thread)
+{
+	return thread != NULL ? thread->context : NULL;
+}
+
+static gboolean
+client_thread_add_event(gpointer data)
+{
+	struct client *client = data;
+	struct client_thread *thread = client->thread;
+
+	thread->clients = g_list_prepend(thread->clients, client);
+	client_idle_init(client);
+	client_schedule_io(client);
+	return false;
+}
+
+void
+client_thread_add(struct client *client)
+{
+	assert(client->thread != NULL);
+	assert(client->source_id == 0);
+
+	client_thread_invoke(client->thread, client_thread_add_event, client);
+}
+
+void
+client_thread_remove(struct client *client)
+{
+	struct client_thread *thread = client->thread;
+
+	assert(thread != NULL);
+
+	thread->clients = g_list_remove(thread->clients, client);
+	g_atomic_int_add(&thread->num_clients, -1);
+}
+
+static gboolean
+client_thread_expire_event(gpointer data)
+{
+	struct client_thread *thread = data;
+
+	g_atomic_int_set(&thread->expire_scheduled, 0);
+	g_list_foreach(thread->clients, client_check_expired, NULL);
+	return false;
+}
+
+void
+client_thread_schedule_expire(struct client_thread *thread)
+{
+	if (g_atomic_int_compare_and_exchange(&thread->expire_scheduled,
+					      0, 1))
+		client_thread_invoke(thread, client_thread_expire_event,
+				     thread);
+}
+
+static gboolean
+client_thread_idle_event(gpointer data)
+{
+	struct client_thread *thread = data;
+	unsigned flags;
+
+	g_mutex_lock(thread->mutex);
+	flags = thread->idle_flags;
+	thread->idle_flags = 0;
+	g_mutex_unlock(thread->mutex);
+
+	client_idle_group_dispatch(&thread->idle_group, flags);
+	return false;
+}
+
+struct client_idle_group *
+client_thread_idle_group(struct client_thread *thread)
+{
+	return &thread->idle_group;
+}
+
+void
+client_thread_idle_add(unsigned flags)
+{
+	assert(flags != 0);
+
+	for (unsigned i = 0; i < num_client_threads; ++i) {
+		struct client_thread *thread = &client_threads[i];
+		bool schedule;
+
+		g_mutex_lock(thread->mutex);
+		schedule = thread->idle_flags == 0;
+		thread->idle_flags |= flags;
+		g_mutex_unlock(thread->mutex);
+
+		if (schedule)
+			client_thread_invoke(thread, client_thread_idle_event,
+					     thread);
+	}
+}
+
+static gboolean
+client_thread_query_event(gpointer data)
+{
+	struct client_thread *thread = data;
+
+	g_atomic_int_set(&thread->query_scheduled, 0);
+	client_query_deliver(thread->query_outputs);
+	return false;
+}
+
+void
+client_thread_push_query_output(struct client_thread *thread,
+				gpointer output)
+{
+	g_async_queue_push(thread->query_outputs, output);
+
+	if (g_atomic_int_compare_and_exchange(&thread->query_scheduled,
+					      0, 1))
+		client_thread_invoke(thread, client_thread_query_event,
+				     thread);
+}
+
+bool
+client_thread_submit(struct client *client, int list_ok, GString *list)
+{
+	struct client_call *call;
+	bool thread_safe = true;
+
+	assert(client->call == NULL);
+
+	if (client->thread == NULL || list->len == 0)
+		return false;
+
+	for (char *cmd = cmd_list_first(list); cmd != NULL;
+	     cmd = cmd_list_next(list, cmd)) {
+		if (!command_is_thread_safe(cmd)) {
+			thread_safe = false;
+			break;
+		}
+	}
+
+	if (thread_safe)
+		return false;
+
+	call = g_new(struct client_call, 1);
+	call->client = client;
+	call->commands = list;
+	call->list_ok = list_ok;
+	call->ret = COMMAND_RETURN_OK;
+
+	client->call = call;
+	return true;
+}
+
+void
+client_thread_dispatch(struct client *client)
+{
+	assert(client->thread != NULL);
+	assert(client->call != NULL);
+	assert(client->source_id == 0);
+
+	g_async_queue_push(client_calls, client->call);
+	event_pipe_emit(PIPE_EVENT_CLIENT);
+}
+
+/**
+ * Called in the I/O thread when the main thread has executed a
+ * call.
+ */
+static gboolean
+client_thread_finish(gpointer data)
+{
+	struct client_call *call = data;
+	struct client *client = call->client;
+	enum command_return ret = call->ret;
+
+	assert(client->call == call);
+	assert(client->source_id == 0);
+
+	client->call = NULL;
+	client_call_free(call);
+
+	if (ret == COMMAND_RETURN_CLOSE || client_is_expired(client)) {
+		client_close(client);
+		return false;
+	}
+
+	if (client->idle_waiting) {
+		/* "idle" was executed by the main thread */
+		client_idle_check(client);
+		client_write_output(client);
+	}
+
+	g_timer_start(client->last_activity);
+	client_resume(client);
+	return false;
+}
+
+/**
+ * Executes a call in the main thread.
+ */
+static void
+client_thread_execute(struct client_call *call)
+{
+	struct client *client = call->client;
+	enum command_return ret;
+
+	if (call->list_ok < 0) {
+		g_debug("[%u] process command \"%s\"", client->num,
+			call->commands->str);
+		ret = command_process(client, 0, call->commands->str);
+	} else {
+		g_debug("[%u] process command list", client->num);
+		ret = client_process_command_list(client, call->list_ok,
+						  call->commands);
+	}
+
+	g_debug("[%u] command returned %i", client->num, ret);
+
+	if (ret == COMMAND_RETURN_KILL) {
+		g_main_loop_quit(main_loop);
+		ret = COMMAND_RETURN_CLOSE;
+	}
+
+	if (ret != COMMAND_RETURN_CLOSE && !client_is_expired(client)) {
+		if (ret == COMMAND_RETURN_OK)
+			command_success(client);
+
+		client_write_output(client);
+	}
+
+	/* hand the client back to its I/O thread */
+	call->ret = ret;
+	client_thread_invoke(client->thread, client_thread_finish, call);
+}
+
+static void
+client_thread_call_event(void)
+{
+	struct client_call *call;
+
+	while ((call = g_async_queue_try_pop(client_calls)) != NULL)
+		client_thread_execute(call);
+}
+
+void
+client_thread_global_init(void)
+{
+	unsigned num_threads = config_get_unsigned(CONF_CLIENT_THREADS, 0);
+	GError *error = NULL;
+
+	if (num_threads == 0)
+		/* the main thread handles all clients */
+		return;
+
+	client_calls = g_async_queue_new();
+	event_pipe_register(PIPE_EVENT_CLIENT, client_thread_call_event);
+
+	client_threads = g_new0(struct client_thread, num_threads);
+
+	for (unsigned i = 0; i < num_threads; ++i) {
+		struct client_thread *thread = &client_threads[i];
+
+		thread->context = g_main_context_new();
+		thread->loop = g_main_loop_new(thread->context, false);
+		thread->mutex = g_mutex_new();
+		thread->query_outputs = g_async_queue_new();
+
+		thread->thread = g_thread_create(client_thread_run, thread,
+						 true, &error);
+		if (thread->thread == NULL)
+			g_error("Failed to spawn client thread: %s",
+				error->message);
+	}
+
+	num_client_threads = num_threads;
+}
+
+void
+client_thread_global_stop(void)
+{
+	for (unsigned i = 0; i < num_client_threads; ++i) {
+		struct client_thread *thread = &client_threads[i];
+
+		if (thread->thread == NULL)
+			continue;
+
+		client_thread_invoke(thread, client_thread_quit_event,
+				     thread);
+		g_thread_join(thread->thread);
+		thread->thread = NULL;
+	}
+}
+
+void
+client_thread_global_finish(void)
+{
+	struct client_call *call;
+
+	if (num_client_threads == 0)
+		return;
+
+	client_thread_global_stop();
+
+	/* now that the I/O threads are gone, the main thread owns
+	   all clients; discard the calls which were not executed
+	   or not handed back, the output of the query workers (which
+	   are gone, too), and close the clients */
+
+	while ((call = g_async_queue_try_pop(client_calls)) != NULL) {
+		assert(call->client->call == call);
+
+		call->client->call = NULL;
+		client_call_free(call);
+	}
+
+	for (unsigned i = 0; i < num_client_threads; ++i) {
+		struct client_thread *thread = &client_threads[i];
+
+		client_query_discard(thread->query_outputs);
+
+		while (thread->clients != NULL) {
+			struct client *client = thread->clients->data;
+
+			if (client->call != NULL) {
+				client_call_free(client->call);
+				client->call = NULL;
+			}
+
+			client_close(client);
+		}
+
+		g_main_loop_unref(thread->loop);
+		g_main_context_unref(thread->context);
+		g_mutex_free(thread->mutex);
+		g_async_queue_unref(thread->query_outputs);
+	}
+
+	g_free(client_threads);
+	client_threads = NULL;
+	num_client_threads = 0;
+
+	g_async_queue_unref(client_calls);
+}
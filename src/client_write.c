@@ -23,24 +23,199 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 
+#ifndef G_OS_WIN32
+#include <sys/uio.h>
+#endif
+
+enum {
+	/**
+	 * The maximum number of unused pages which are kept for
+	 * reuse.
+	 */
+	CLIENT_PAGE_POOL_MAX = 64,
+
+	/**
+	 * The maximum number of pages sent with one writev() call.
+	 */
+	CLIENT_PAGE_IOV_MAX = 16,
+};
+
+/**
+ * Unused pages, linked with #client_page.next.  Protected by
+ * #client_page_mutex, because clients may be owned by different
+ * threads (see client_thread.c).
+ */
+static struct client_page *client_page_pool;
+static unsigned client_page_pool_size;
+static GMutex *client_page_mutex;
+
+void
+client_page_pool_init(void)
+{
+	client_page_mutex = g_mutex_new();
+}
+
+void
+client_page_pool_deinit(void)
+{
+	while (client_page_pool != NULL) {
+		struct client_page *page = client_page_pool;
+
+		client_page_pool = page->next;
+		g_free(page);
+	}
+
+	client_page_pool_size = 0;
+	g_mutex_free(client_page_mutex);
+}
+
+static struct client_page *
+client_page_new(void)
+{
+	struct client_page *page;
+
+	g_mutex_lock(client_page_mutex);
+	page = client_page_pool;
+	if (page != NULL) {
+		client_page_pool = page->next;
+		--client_page_pool_size;
+	}
+	g_mutex_unlock(client_page_mutex);
+
+	if (page == NULL)
+		page = g_new(struct client_page, 1);
+
+	page->next = NULL;
+	page->start = page->end = 0;
+	return page;
+}
+
+static void
+client_page_free(struct client_page *page)
+{
+	g_mutex_lock(client_page_mutex);
+	if (client_page_pool_size < CLIENT_PAGE_POOL_MAX) {
+		page->next = client_page_pool;
+		client_page_pool = page;
+		++client_page_pool_size;
+		page = NULL;
+	}
+	g_mutex_unlock(client_page_mutex);
+
+	g_free(page);
+}
+
+void
+client_deferred_clear(struct client *client)
+{
+	while (client->deferred_head != NULL) {
+		struct client_page *page = client->deferred_head;
+
+		client->deferred_head = page->next;
+		client_page_free(page);
+	}
+
+	client->deferred_tail = NULL;
+	client->deferred_bytes = 0;
+}
+
+/**
+ * Removes data which was sent from the head of the deferred chain.
+ */
+static void
+client_deferred_consume(struct client *client, size_t nbytes)
+{
+	assert(nbytes <= client->deferred_bytes);
+
+	client->deferred_bytes -= nbytes;
+
+	while (nbytes > 0) {
+		struct client_page *page = client->deferred_head;
+		size_t available;
+
+		assert(page != NULL);
+		assert(page->end > page->start);
+
+		available = page->end - page->start;
+		if (nbytes < available) {
+			page->start += nbytes;
+			break;
+		}
+
+		nbytes -= available;
+		client->deferred_head = page->next;
+		if (client->deferred_head == NULL)
+			client->deferred_tail = NULL;
+		client_page_free(page);
+	}
+}
+
+/**
+ * Sends as much of the deferred chain as the socket accepts.
+ *
+ * @param complete_r set to true if the whole chunk which was
+ * attempted was sent, i.e. the socket may accept more
+ * @return the number of bytes sent
+ */
 static size_t
-client_write_deferred_buffer(struct client *client,
-			     const struct deferred_buffer *buffer)
+client_write_deferred_chain(struct client *client, bool *complete_r)
 {
+#ifndef G_OS_WIN32
+	struct iovec iov[CLIENT_PAGE_IOV_MAX];
+	unsigned n = 0;
+	size_t requested = 0;
+	ssize_t nbytes;
+
+	assert(client->channel != NULL);
+
+	for (struct client_page *page = client->deferred_head;
+	     page != NULL && n < G_N_ELEMENTS(iov);
+	     page = page->next, ++n) {
+		iov[n].iov_base = page->data + page->start;
+		iov[n].iov_len = page->end - page->start;
+		requested += iov[n].iov_len;
+	}
+
+	do {
+		nbytes = writev(g_io_channel_unix_get_fd(client->channel),
+				iov, n);
+	} while (nbytes < 0 && errno == EINTR);
+
+	if (nbytes < 0) {
+		int e = errno;
+
+		*complete_r = false;
+
+		if (e == EAGAIN || e == EWOULDBLOCK)
+			return 0;
+
+		/* I/O error */
+		client_set_expired(client);
+		g_warning("failed to flush buffer for %i: %s",
+			  client->num, g_strerror(e));
+		return 0;
+	}
+
+	*complete_r = (size_t)nbytes == requested;
+	return nbytes;
+#else
+	const struct client_page *page = client->deferred_head;
 	GError *error = NULL;
 	GIOStatus status;
 	gsize bytes_written;
 
-	assert(client != NULL);
 	assert(client->channel != NULL);
-	assert(buffer != NULL);
+
+	*complete_r = false;
 
 	status = g_io_channel_write_chars
-		(client->channel, buffer->data, buffer->size,
-		 &bytes_written, &error);
+		(client->channel, page->data + page->start,
+		 page->end - page->start, &bytes_written, &error);
 	switch (status) {
 	case G_IO_STATUS_NORMAL:
+		*complete_r = bytes_written == page->end - page->start;
 		return bytes_written;
 
 	case G_IO_STATUS_AGAIN:
@@ -64,76 +239,78 @@ client_write_deferred_buffer(struct client *client,
 
 	/* unreachable */
 	return 0;
+#endif
 }
 
 void
 client_write_deferred(struct client *client)
 {
-	size_t ret;
-
-	while (!g_queue_is_empty(client->deferred_send)) {
-		struct deferred_buffer *buf =
-			g_queue_peek_head(client->deferred_send);
+	bool complete = true;
 
-		assert(buf->size > 0);
-		assert(buf->size <= client->deferred_bytes);
-
-		ret = client_write_deferred_buffer(client, buf);
-		if (ret == 0)
+	while (complete && client->deferred_head != NULL) {
+		size_t nbytes = client_write_deferred_chain(client,
+							    &complete);
+		if (nbytes == 0)
 			break;
 
-		if (ret < buf->size) {
-			assert(client->deferred_bytes >= (size_t)ret);
-			client->deferred_bytes -= ret;
-			buf->size -= ret;
-			memmove(buf->data, buf->data + ret, buf->size);
-			break;
-		} else {
-			size_t decr = sizeof(*buf) -
-				sizeof(buf->data) + buf->size;
-
-			assert(client->deferred_bytes >= decr);
-			client->deferred_bytes -= decr;
-			g_free(buf);
-			g_queue_pop_head(client->deferred_send);
-		}
-
+		client_deferred_consume(client, nbytes);
 		g_timer_start(client->last_activity);
 	}
 
-	if (g_queue_is_empty(client->deferred_send)) {
+	if (client->deferred_head == NULL) {
 		g_debug("[%u] buffer empty %lu", client->num,
 			(unsigned long)client->deferred_bytes);
 		assert(client->deferred_bytes == 0);
 	}
 }
 
+/**
+ * Appends data to the deferred chain, filling up the last page
+ * before another one is allocated.
+ */
 static void client_defer_output(struct client *client,
 				const void *data, size_t length)
 {
-	size_t alloc;
-	struct deferred_buffer *buf;
+	const char *p = data;
 
 	assert(length > 0);
 
-	alloc = sizeof(*buf) - sizeof(buf->data) + length;
-	client->deferred_bytes += alloc;
-	if (client->deferred_bytes > client_max_output_buffer_size) {
+	if (client->deferred_bytes + length > client_max_output_buffer_size) {
 		g_warning("[%u] output buffer size (%lu) is "
 			  "larger than the max (%lu)",
 			  client->num,
-			  (unsigned long)client->deferred_bytes,
+			  (unsigned long)(client->deferred_bytes + length),
 			  (unsigned long)client_max_output_buffer_size);
 		/* cause client to close */
 		client_set_expired(client);
 		return;
 	}
 
-	buf = g_malloc(alloc);
-	buf->size = length;
-	memcpy(buf->data, data, length);
+	client->deferred_bytes += length;
+
+	while (length > 0) {
+		struct client_page *page = client->deferred_tail;
+		size_t nbytes;
 
-	g_queue_push_tail(client->deferred_send, buf);
+		if (page == NULL || page->end == sizeof(page->data)) {
+			page = client_page_new();
+
+			if (client->deferred_tail != NULL)
+				client->deferred_tail->next = page;
+			else
+				client->deferred_head = page;
+			client->deferred_tail = page;
+		}
+
+		nbytes = sizeof(page->data) - page->end;
+		if (nbytes > length)
+			nbytes = length;
+
+		memcpy(page->data + page->end, p, nbytes);
+		page->end += nbytes;
+		p += nbytes;
+		length -= nbytes;
+	}
 }
 
 static void client_write_direct(struct client *client,
@@ -147,7 +324,7 @@ static void client_write_direct(struct client *client,
 	assert(client->channel != NULL);
 	assert(data != NULL);
 	assert(length > 0);
-	assert(g_queue_is_empty(client->deferred_send));
+	assert(client->deferred_head == NULL);
 
 	status = g_io_channel_write_chars(client->channel, data, length,
 					  &bytes_written, &error);
@@ -176,19 +353,18 @@ static void client_write_direct(struct client *client,
 		client_defer_output(client, data + bytes_written,
 				    length - bytes_written);
 
-	if (!g_queue_is_empty(client->deferred_send))
+	if (client->deferred_head != NULL)
 		g_debug("[%u] buffer created", client->num);
 }
 
 void
-client_write_output(struct client *client)
+client_write_buffer(struct client *client, const char *data, size_t length)
 {
-	if (client_is_expired(client) || !client->send_buf_used)
-		return;
+	assert(!client_is_expired(client));
+	assert(length > 0);
 
-	if (!g_queue_is_empty(client->deferred_send)) {
-		client_defer_output(client, client->send_buf,
-				    client->send_buf_used);
+	if (client->deferred_head != NULL) {
+		client_defer_output(client, data, length);
 
 		if (client_is_expired(client))
 			return;
@@ -196,22 +372,29 @@ client_write_output(struct client *client)
 		/* try to flush the deferred buffers now; the current
 		   server command may take too long to finish, and
 		   meanwhile try to feed output to the client,
-		   otherwise it will time out.  One reason why
-		   deferring is slow might be that currently each
-		   client_write() allocates a new deferred buffer.
-		   This should be optimized after MPD 0.14. */
+		   otherwise it will time out */
 		client_write_deferred(client);
 	} else
-		client_write_direct(client, client->send_buf,
+		client_write_direct(client, data, length);
+}
+
+void
+client_write_output(struct client *client)
+{
+	if (client_is_expired(client) || !client->send_buf_used)
+		return;
+
+	/* a query worker must not touch the socket; it passes the
+	   output to the main thread instead */
+	if (!client_query_output(client, client->send_buf,
+				 client->send_buf_used))
+		client_write_buffer(client, client->send_buf,
 				    client->send_buf_used);
 
 	client->send_buf_used = 0;
 }
 
-/**
- * Write a block of data to the client.
- */
-static void client_write(struct client *client, const char *buffer, size_t buflen)
+void client_write(struct client *client, const char *buffer, size_t buflen)
 {
 	/* if the client is going to be closed, do nothing */
 	if (client_is_expired(client))
@@ -246,16 +429,44 @@ void client_vprintf(struct client *client, const char *fmt, va_list args)
 #ifndef G_OS_WIN32
 	va_list tmp;
 	int length;
+	size_t available;
 	char *buffer;
 
+	if (client_is_expired(client))
+		return;
+
+	/* format directly into the output buffer */
+	available = sizeof(client->send_buf) - client->send_buf_used;
 	va_copy(tmp, args);
-	length = vsnprintf(NULL, 0, fmt, tmp);
+	length = vsnprintf(client->send_buf + client->send_buf_used,
+			   available, fmt, tmp);
 	va_end(tmp);
 
 	if (length <= 0)
 		/* wtf.. */
 		return;
 
+	if ((size_t)length < available) {
+		client->send_buf_used += length;
+		return;
+	}
+
+	if ((size_t)length < sizeof(client->send_buf)) {
+		/* doesn't fit: flush the buffer, and format again at
+		   its beginning */
+		client_write_output(client);
+		if (client_is_expired(client))
+			return;
+
+		assert(client->send_buf_used == 0);
+
+		vsnprintf(client->send_buf, sizeof(client->send_buf),
+			  fmt, args);
+		client->send_buf_used = length;
+		return;
+	}
+
+	/* larger than the whole output buffer */
 	buffer = g_malloc(length + 1);
 	vsnprintf(buffer, length + 1, fmt, args);
 	client_write(client, buffer, length);
@@ -60,6 +60,7 @@
 #include <time.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <string.h>
 
 #define COMMAND_STATUS_STATE            "state"
 #define COMMAND_STATUS_REPEAT           "repeat"
@@ -106,26 +107,55 @@ static const char need_range[] = "need a range";
 static const char check_integer[] = "\"%s\" is not a integer";
 static const char need_integer[] = "need an integer";
 
-static const char *current_command;
-static int command_list_num;
+/**
+ * The state of the command which is currently being processed.  It
+ * is thread-local, because read-only database commands are executed
+ * by the query workers (see client_query.c) while the main thread
+ * processes commands of other clients.
+ */
+struct command_context {
+	const char *current_command;
+	int command_list_num;
+};
+
+static GStaticPrivate command_context_key = G_STATIC_PRIVATE_INIT;
+
+static struct command_context *
+command_context_get(void)
+{
+	struct command_context *context =
+		g_static_private_get(&command_context_key);
+
+	if (context == NULL) {
+		context = g_new0(struct command_context, 1);
+		g_static_private_set(&command_context_key, context, g_free);
+	}
+
+	return context;
+}
 
 void command_success(struct client *client)
 {
 	client_puts(client, "OK\n");
+	client_record_reset(client);
 }
 
 static void command_error_v(struct client *client, enum ack error,
 			    const char *fmt, va_list args)
 {
+	struct command_context *context = command_context_get();
+
 	assert(client != NULL);
-	assert(current_command != NULL);
+	assert(context->current_command != NULL);
 
 	client_printf(client, "ACK [%i@%i] {%s} ",
-		      (int)error, command_list_num, current_command);
+		      (int)error, context->command_list_num,
+		      context->current_command);
 	client_vprintf(client, fmt, args);
 	client_puts(client, "\n");
+	client_record_reset(client);
 
-	current_command = NULL;
+	context->current_command = NULL;
 }
 
 G_GNUC_PRINTF(3, 4) static void command_error(struct client *client, enum ack error,
@@ -902,10 +932,64 @@ handle_playlistid(struct client *client, int argc, char *argv[])
 	return COMMAND_RETURN_OK;
 }
 
+/**
+ * Parses the optional "sort" and "window" argument pairs at the end
+ * of a database query, and removes them from the argument count.
+ *
+ * @param first the index of the first criterion in argv
+ * @param argc_r the number of arguments; this is decreased by the
+ * number of arguments consumed
+ * @return false on error (an error response has been sent)
+ */
+static bool
+parse_query_options(struct client *client, int first,
+		    int *argc_r, char *argv[],
+		    struct db_query_options *options)
+{
+	int argc = *argc_r;
+
+	db_query_options_init(options);
+
+	while (argc - first >= 2 && (argc - first) % 2 == 0) {
+		const char *name = argv[argc - 2], *value = argv[argc - 1];
+
+		if (strcmp(name, "sort") == 0) {
+			bool descending = *value == '-';
+			int type = locate_parse_type(descending
+						     ? value + 1 : value);
+			if (type < 0 || type == LOCATE_TAG_ANY_TYPE) {
+				command_error(client, ACK_ERROR_ARG,
+					      "\"%s\" is not a valid sort type",
+					      value);
+				return false;
+			}
+
+			options->sort = type;
+			options->descending = descending;
+		} else if (strcmp(name, "window") == 0) {
+			if (!check_range(client, &options->window_start,
+					 &options->window_end,
+					 value, "Bad window: %s", value))
+				return false;
+		} else
+			break;
+
+		argc -= 2;
+	}
+
+	*argc_r = argc;
+	return true;
+}
+
 static enum command_return
 handle_find(struct client *client, int argc, char *argv[])
 {
 	int ret;
+	struct db_query_options options;
+
+	if (!parse_query_options(client, 1, &argc, argv, &options))
+		return COMMAND_RETURN_ERROR;
+
 	struct locate_item_list *list =
 		locate_item_list_parse(argv + 1, argc - 1);
 
@@ -917,7 +1001,7 @@ handle_find(struct client *client, int argc, char *argv[])
 		return COMMAND_RETURN_ERROR;
 	}
 
-	ret = findSongsIn(client, NULL, list);
+	ret = findSongsIn(client, NULL, list, &options);
 	if (ret == -1)
 		command_error(client, ACK_ERROR_NO_EXIST,
 			      "directory or file not found");
@@ -931,6 +1015,11 @@ static enum command_return
 handle_findadd(struct client *client, int argc, char *argv[])
 {
     int ret;
+    struct db_query_options options;
+
+    if (!parse_query_options(client, 1, &argc, argv, &options))
+	    return COMMAND_RETURN_ERROR;
+
     struct locate_item_list *list =
 	    locate_item_list_parse(argv + 1, argc - 1);
     if (list == NULL || list->length == 0) {
@@ -941,7 +1030,7 @@ handle_findadd(struct client *client, int argc, char *argv[])
 	    return COMMAND_RETURN_ERROR;
     }
 
-    ret = findAddIn(client, NULL, list);
+    ret = findAddIn(client, NULL, list, &options);
     if (ret == -1)
 	    command_error(client, ACK_ERROR_NO_EXIST,
 			  "directory or file not found");
@@ -955,6 +1044,11 @@ static enum command_return
 handle_search(struct client *client, int argc, char *argv[])
 {
 	int ret;
+	struct db_query_options options;
+
+	if (!parse_query_options(client, 1, &argc, argv, &options))
+		return COMMAND_RETURN_ERROR;
+
 	struct locate_item_list *list =
 		locate_item_list_parse(argv + 1, argc - 1);
 
@@ -966,7 +1060,7 @@ handle_search(struct client *client, int argc, char *argv[])
 		return COMMAND_RETURN_ERROR;
 	}
 
-	ret = searchForSongsIn(client, NULL, list);
+	ret = searchForSongsIn(client, NULL, list, &options);
 	if (ret == -1)
 		command_error(client, ACK_ERROR_NO_EXIST,
 			      "directory or file not found");
@@ -1287,6 +1381,7 @@ static enum command_return
 handle_list(struct client *client, int argc, char *argv[])
 {
 	struct locate_item_list *conditionals;
+	struct db_query_options options;
 	int tagType = locate_parse_type(argv[1]);
 	int ret;
 
@@ -1301,6 +1396,15 @@ handle_list(struct client *client, int argc, char *argv[])
 		return COMMAND_RETURN_ERROR;
 	}
 
+	if (!parse_query_options(client, 2, &argc, argv, &options))
+		return COMMAND_RETURN_ERROR;
+
+	if (options.sort >= 0 && options.sort != tagType) {
+		command_error(client, ACK_ERROR_ARG,
+			      "\"list\" can only be sorted by the listed tag");
+		return COMMAND_RETURN_ERROR;
+	}
+
 	/* for compatibility with < 0.12.0 */
 	if (argc == 3) {
 		if (tagType != TAG_ALBUM) {
@@ -1325,7 +1429,7 @@ handle_list(struct client *client, int argc, char *argv[])
 		}
 	}
 
-	ret = listAllUniqueTags(client, tagType, conditionals);
+	ret = listAllUniqueTags(client, tagType, conditionals, &options);
 
 	locate_item_list_free(conditionals);
 
@@ -1448,6 +1552,18 @@ handle_ping(G_GNUC_UNUSED struct client *client,
 	return COMMAND_RETURN_OK;
 }
 
+static enum command_return
+handle_compact(struct client *client, G_GNUC_UNUSED int argc, char *argv[])
+{
+	bool compact;
+
+	if (!check_bool(client, &compact, argv[1]))
+		return COMMAND_RETURN_ERROR;
+
+	client_set_compact(client, compact);
+	return COMMAND_RETURN_OK;
+}
+
 static enum command_return
 handle_password(struct client *client, G_GNUC_UNUSED int argc, char *argv[])
 {
@@ -1833,6 +1949,7 @@ static const struct command commands[] = {
 	{ "clearerror", PERMISSION_CONTROL, 0, 0, handle_clearerror },
 	{ "close", PERMISSION_NONE, -1, -1, handle_close },
 	{ "commands", PERMISSION_NONE, 0, 0, handle_commands },
+	{ "compact", PERMISSION_NONE, 1, 1, handle_compact },
 	{ "consume", PERMISSION_CONTROL, 1, 1, handle_consume },
 	{ "count", PERMISSION_READ, 2, -1, handle_count },
 	{ "crossfade", PERMISSION_CONTROL, 1, 1, handle_crossfade },
@@ -2034,9 +2151,10 @@ command_checked_lookup(struct client *client, unsigned permission,
 		       int argc, char *argv[])
 {
 	static char unknown[] = "";
+	struct command_context *context = command_context_get();
 	const struct command *cmd;
 
-	current_command = unknown;
+	context->current_command = unknown;
 
 	if (argc == 0)
 		return NULL;
@@ -2049,7 +2167,7 @@ command_checked_lookup(struct client *client, unsigned permission,
 		return NULL;
 	}
 
-	current_command = cmd->cmd;
+	context->current_command = cmd->cmd;
 
 	if (!command_check_request(cmd, client, permission, argc, argv))
 		return NULL;
@@ -2065,14 +2183,15 @@ command_process(struct client *client, unsigned num, char *line)
 	char *argv[COMMAND_ARGV_MAX] = { NULL };
 	const struct command *cmd;
 	enum command_return ret = COMMAND_RETURN_ERROR;
+	struct command_context *context = command_context_get();
 
-	command_list_num = num;
+	context->command_list_num = num;
 
 	/* get the command name (first word on the line) */
 
 	argv[0] = tokenizer_next_word(&line, &error);
 	if (argv[0] == NULL) {
-		current_command = "";
+		context->current_command = "";
 		if (*line == 0)
 			command_error(client, ACK_ERROR_UNKNOWN,
 				      "No command given");
@@ -2081,7 +2200,7 @@ command_process(struct client *client, unsigned num, char *line)
 				      "%s", error->message);
 			g_error_free(error);
 		}
-		current_command = NULL;
+		context->current_command = NULL;
 
 		return COMMAND_RETURN_ERROR;
 	}
@@ -2098,18 +2217,18 @@ command_process(struct client *client, unsigned num, char *line)
 	/* some error checks; we have to set current_command because
 	   command_error() expects it to be set */
 
-	current_command = argv[0];
+	context->current_command = argv[0];
 
 	if (argc >= (int)G_N_ELEMENTS(argv)) {
 		command_error(client, ACK_ERROR_ARG, "Too many arguments");
-		current_command = NULL;
+		context->current_command = NULL;
 		return COMMAND_RETURN_ERROR;
 	}
 
 	if (*line != 0) {
 		command_error(client, ACK_ERROR_ARG,
 			      "%s", error->message);
-		current_command = NULL;
+		context->current_command = NULL;
 		g_error_free(error);
 		return COMMAND_RETURN_ERROR;
 	}
@@ -2121,8 +2240,67 @@ command_process(struct client *client, unsigned num, char *line)
 	if (cmd)
 		ret = cmd->handler(client, argc, argv);
 
-	current_command = NULL;
-	command_list_num = 0;
+	context->current_command = NULL;
+	context->command_list_num = 0;
 
 	return ret;
 }
+
+bool
+command_is_db_query(const char *line)
+{
+	/* these commands only read the database (and the stored
+	   playlist directory) and do not touch any state owned by the
+	   main thread */
+	static const char *const db_query_commands[] = {
+		"count",
+		"find",
+		"list",
+		"listall",
+		"listallinfo",
+		"lsinfo",
+		"search",
+	};
+	size_t length = strcspn(line, " \t");
+
+	for (unsigned i = 0; i < G_N_ELEMENTS(db_query_commands); ++i) {
+		const char *name = db_query_commands[i];
+
+		if (strlen(name) == length &&
+		    memcmp(name, line, length) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+bool
+command_is_thread_safe(const char *line)
+{
+	/* these commands only access the client and static tables,
+	   but no state owned by the main thread */
+	static const char *const client_commands[] = {
+		"close",
+		"commands",
+		"compact",
+		"idle",
+		"notcommands",
+		"password",
+		"ping",
+		"tagtypes",
+	};
+	size_t length = strcspn(line, " \t");
+
+	if (command_is_db_query(line))
+		return true;
+
+	for (unsigned i = 0; i < G_N_ELEMENTS(client_commands); ++i) {
+		const char *name = client_commands[i];
+
+		if (strlen(name) == length &&
+		    memcmp(name, line, length) == 0)
+			return true;
+	}
+
+	return false;
+}
@@ -43,4 +43,21 @@ command_process(struct client *client, unsigned num, char *line);
 
 void command_success(struct client *client);
 
+/**
+ * Does this command line invoke a read-only database command, which
+ * may be executed by a query worker thread?  Only the command name
+ * (the first word) is checked.
+ */
+bool
+command_is_db_query(const char *line);
+
+/**
+ * May this command line be executed by a client I/O thread (see
+ * client_thread.c)?  These are the database queries, and the
+ * commands which only touch the client itself.  All others are
+ * marshalled to the main thread.
+ */
+bool
+command_is_thread_safe(const char *line);
+
 #endif
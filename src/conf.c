@@ -53,6 +53,8 @@ static struct config_entry config_entries[] = {
 	{ .name = CONF_FOLLOW_INSIDE_SYMLINKS, false, false },
 	{ .name = CONF_FOLLOW_OUTSIDE_SYMLINKS, false, false },
 	{ .name = CONF_DB_FILE, false, false },
+	{ .name = CONF_DB_FORMAT, false, false },
+	{ .name = CONF_DB_JOURNAL, false, false },
 	{ .name = CONF_STICKER_FILE, false, false },
 	{ .name = CONF_LOG_FILE, false, false },
 	{ .name = CONF_PID_FILE, false, false },
@@ -77,6 +79,7 @@ static struct config_entry config_entries[] = {
 	{ .name = CONF_SAMPLERATE_CONVERTER, false, false },
 	{ .name = CONF_AUDIO_BUFFER_SIZE, false, false },
 	{ .name = CONF_BUFFER_BEFORE_PLAY, false, false },
+	{ .name = CONF_AUDIO_CHUNK_SIZE, false, false },
 	{ .name = CONF_HTTP_PROXY_HOST, false, false },
 	{ .name = CONF_HTTP_PROXY_PORT, false, false },
 	{ .name = CONF_HTTP_PROXY_USER, false, false },
@@ -96,6 +99,10 @@ static struct config_entry config_entries[] = {
 	{ .name = CONF_PLAYLIST_PLUGIN, true, true },
 	{ .name = CONF_AUTO_UPDATE, false, false },
 	{ .name = CONF_AUTO_UPDATE_DEPTH, false, false },
+	{ .name = CONF_UPDATE_THREADS, false, false },
+	{ .name = CONF_QUERY_THREADS, false, false },
+	{ .name = CONF_CLIENT_THREADS, false, false },
+	{ .name = CONF_IDLE_MIN_INTERVAL, false, false },
 	{ .name = "filter", true, true },
 };
 
@@ -28,6 +28,8 @@
 #define CONF_FOLLOW_INSIDE_SYMLINKS     "follow_inside_symlinks"
 #define CONF_FOLLOW_OUTSIDE_SYMLINKS    "follow_outside_symlinks"
 #define CONF_DB_FILE                    "db_file"
+#define CONF_DB_FORMAT "db_format"
+#define CONF_DB_JOURNAL "db_journal"
 #define CONF_STICKER_FILE "sticker_file"
 #define CONF_LOG_FILE                   "log_file"
 #define CONF_PID_FILE                   "pid_file"
@@ -53,6 +55,7 @@
 #define CONF_SAMPLERATE_CONVERTER       "samplerate_converter"
 #define CONF_AUDIO_BUFFER_SIZE          "audio_buffer_size"
 #define CONF_BUFFER_BEFORE_PLAY         "buffer_before_play"
+#define CONF_AUDIO_CHUNK_SIZE           "audio_chunk_size"
 #define CONF_HTTP_PROXY_HOST            "http_proxy_host"
 #define CONF_HTTP_PROXY_PORT            "http_proxy_port"
 #define CONF_HTTP_PROXY_USER            "http_proxy_user"
@@ -72,6 +75,10 @@
 #define CONF_PLAYLIST_PLUGIN "playlist_plugin"
 #define CONF_AUTO_UPDATE		"auto_update"
 #define CONF_AUTO_UPDATE_DEPTH "auto_update_depth"
+#define CONF_UPDATE_THREADS "update_threads"
+#define CONF_QUERY_THREADS "query_threads"
+#define CONF_CLIENT_THREADS "client_threads"
+#define CONF_IDLE_MIN_INTERVAL "idle_min_interval"
 
 #define DEFAULT_PLAYLIST_MAX_LENGTH (1024*16)
 #define DEFAULT_PLAYLIST_SAVE_ABSOLUTE_PATHS false
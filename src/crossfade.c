@@ -99,7 +99,7 @@ unsigned cross_fade_calc(float duration, float total_time,
 			 char *mixramp_start, char *mixramp_prev_end,
 			 const struct audio_format *af,
 			 const struct audio_format *old_format,
-			 unsigned max_chunks)
+			 size_t chunk_size, unsigned max_chunks)
 {
 	unsigned int chunks = 0;
 	float chunks_f;
@@ -113,7 +113,8 @@ unsigned cross_fade_calc(float duration, float total_time,
 	assert(duration >= 0);
 	assert(audio_format_valid(af));
 
-	chunks_f = (float)audio_format_time_to_size(af) / (float)CHUNK_SIZE;
+	chunks_f = (float)audio_format_time_to_size(af) /
+		(float)music_chunk_fill_size(chunk_size, af);
 
 	if (isnan(mixramp_delay) || !(mixramp_start) || !(mixramp_prev_end)) {
 		chunks = (chunks_f * duration + 0.5);
@@ -20,6 +20,8 @@
 #ifndef MPD_CROSSFADE_H
 #define MPD_CROSSFADE_H
 
+#include <stddef.h>
+
 struct audio_format;
 struct music_chunk;
 
@@ -36,6 +38,7 @@ struct music_chunk;
  * @param mixramp_prev_end the last songs mixramp_end setting
  * @param af the audio format of the new song
  * @param old_format the audio format of the current song
+ * @param chunk_size the capacity of each chunk
  * @param max_chunks the maximum number of chunks
  * @return the number of chunks for crossfading, or 0 if cross fading
  * should be disabled for this song change
@@ -46,6 +49,6 @@ unsigned cross_fade_calc(float duration, float total_time,
 			 char *mixramp_start, char *mixramp_prev_end,
 			 const struct audio_format *af,
 			 const struct audio_format *old_format,
-			 unsigned max_chunks);
+			 size_t chunk_size, unsigned max_chunks);
 
 #endif
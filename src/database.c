@@ -21,6 +21,10 @@
 #include "database.h"
 #include "directory.h"
 #include "directory_save.h"
+#include "db_binary.h"
+#include "db_journal.h"
+#include "tag_index.h"
+#include "conf.h"
 #include "song.h"
 #include "path.h"
 #include "stats.h"
@@ -37,6 +41,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
 
 #undef G_LOG_DOMAIN
 #define G_LOG_DOMAIN "database"
@@ -54,10 +59,24 @@ enum {
 
 static char *database_path;
 
+/**
+ * Save the database in the binary format (see db_binary.h) instead
+ * of the text format?
+ */
+static bool database_binary;
+
 static struct directory *music_root;
 
 static time_t database_mtime;
 
+/**
+ * Protects the #music_root tree against concurrent modification by
+ * the update thread.  The main thread doesn't obtain it; it relies on
+ * the order of operations in the update thread instead (see
+ * delete_song() in update_walk.c).
+ */
+static GStaticRWLock db_rwlock = G_STATIC_RW_LOCK_INIT;
+
 /**
  * The quark used for GError.domain.
  */
@@ -70,10 +89,23 @@ db_quark(void)
 void
 db_init(const char *path)
 {
+	const char *format = config_get_string(CONF_DB_FORMAT, "text");
+
+	if (strcmp(format, "binary") == 0)
+		database_binary = true;
+	else if (strcmp(format, "text") == 0)
+		database_binary = false;
+	else
+		g_error("unrecognized " CONF_DB_FORMAT " setting: %s",
+			format);
+
 	database_path = g_strdup(path);
 
-	if (path != NULL)
+	if (path != NULL) {
 		music_root = directory_new("", NULL);
+		tag_index_init();
+		db_journal_init(path, config_get_bool(CONF_DB_JOURNAL, true));
+	}
 }
 
 void
@@ -81,8 +113,11 @@ db_finish(void)
 {
 	assert((database_path == NULL) == (music_root == NULL));
 
-	if (music_root != NULL)
+	if (music_root != NULL) {
+		db_journal_finish();
+		tag_index_deinit();
 		directory_free(music_root);
+	}
 
 	g_free(database_path);
 }
@@ -92,6 +127,7 @@ db_clear(void)
 {
 	assert(music_root != NULL);
 
+	tag_index_clear();
 	directory_free(music_root);
 	music_root = directory_new("", NULL);
 }
@@ -150,6 +186,30 @@ db_walk(const char *name,
 	return directory_walk(directory, forEachSong, forEachDir, data);
 }
 
+void
+db_lock_read(void)
+{
+	g_static_rw_lock_reader_lock(&db_rwlock);
+}
+
+void
+db_unlock_read(void)
+{
+	g_static_rw_lock_reader_unlock(&db_rwlock);
+}
+
+void
+db_lock_write(void)
+{
+	g_static_rw_lock_writer_lock(&db_rwlock);
+}
+
+void
+db_unlock_write(void)
+{
+	g_static_rw_lock_writer_unlock(&db_rwlock);
+}
+
 bool
 db_check(void)
 {
@@ -214,14 +274,14 @@ db_check(void)
 	return true;
 }
 
-bool
-db_save(void)
+/**
+ * Removes empty directories and sorts the tree after the update
+ * thread has modified it.
+ */
+static void
+db_tidy(void)
 {
-	FILE *fp;
-	struct stat st;
-
-	assert(database_path != NULL);
-	assert(music_root != NULL);
+	db_lock_write();
 
 	g_debug("removing empty directories from DB");
 	directory_prune_empty(music_root);
@@ -230,12 +290,24 @@ db_save(void)
 
 	directory_sort(music_root);
 
-	g_debug("writing DB");
+	db_unlock_write();
+}
 
-	fp = fopen(database_path, "w");
-	if (!fp) {
-		g_warning("unable to write to db file \"%s\": %s",
-			  database_path, strerror(errno));
+/**
+ * Writes the database in the text format.  It is written to a
+ * temporary file first, which is then renamed, so a crash during
+ * saving never destroys the old database.
+ */
+static bool
+db_save_text(const char *path, GError **error_r)
+{
+	char *tmp_path = g_strconcat(path, ".tmp", NULL);
+	FILE *fp = fopen(tmp_path, "w");
+	if (fp == NULL) {
+		g_set_error(error_r, db_quark(), errno,
+			    "Failed to create \"%s\": %s",
+			    tmp_path, g_strerror(errno));
+		g_free(tmp_path);
 		return false;
 	}
 
@@ -252,18 +324,117 @@ db_save(void)
 
 	directory_save(fp, music_root);
 
-	if (ferror(fp)) {
-		g_warning("Failed to write to database file: %s",
-			  strerror(errno));
-		fclose(fp);
+	bool success = !ferror(fp);
+	if (fclose(fp) != 0)
+		success = false;
+
+	if (!success) {
+		g_set_error(error_r, db_quark(), errno,
+			    "Failed to write \"%s\": %s",
+			    tmp_path, g_strerror(errno));
+		unlink(tmp_path);
+		g_free(tmp_path);
 		return false;
 	}
 
-	fclose(fp);
+	if (rename(tmp_path, path) < 0) {
+		g_set_error(error_r, db_quark(), errno,
+			    "Failed to rename \"%s\": %s",
+			    tmp_path, g_strerror(errno));
+		unlink(tmp_path);
+		g_free(tmp_path);
+		return false;
+	}
+
+	g_free(tmp_path);
+	return true;
+}
+
+bool
+db_save(void)
+{
+	GError *error = NULL;
+	struct stat st;
+	bool success;
 
-	if (stat(database_path, &st) == 0)
+	assert(database_path != NULL);
+	assert(music_root != NULL);
+
+	db_tidy();
+
+	g_debug("writing DB");
+
+	success = database_binary
+		? db_binary_save(database_path, music_root, &error)
+		: db_save_text(database_path, &error);
+	if (!success) {
+		g_warning("unable to write to db file \"%s\": %s",
+			  database_path, error->message);
+		g_error_free(error);
+		return false;
+	}
+
+	if (stat(database_path, &st) == 0) {
 		database_mtime = st.st_mtime;
 
+		/* the new database file contains all changes; the
+		   journal is obsolete now */
+		db_journal_reset(st.st_size);
+	}
+
+	return true;
+}
+
+bool
+db_save_changes(void)
+{
+	assert(database_path != NULL);
+	assert(music_root != NULL);
+
+	if (db_exists() && db_journal_pending() && !db_journal_full()) {
+		GError *error = NULL;
+
+		db_tidy();
+
+		g_debug("writing journal");
+
+		if (db_journal_commit(&error)) {
+			database_mtime = time(NULL);
+			return true;
+		}
+
+		g_warning("%s", error->message);
+		g_error_free(error);
+
+		/* fall back to writing the whole database file */
+	}
+
+	return db_save();
+}
+
+/**
+ * Called after the database file has been loaded: replays the
+ * journal and builds the tag index.
+ */
+static bool
+db_load_finish(GError **error_r)
+{
+	struct stat st;
+
+	if (stat(database_path, &st) < 0) {
+		g_set_error(error_r, db_quark(), errno,
+			    "Failed to stat \"%s\": %s",
+			    database_path, g_strerror(errno));
+		return false;
+	}
+
+	if (!db_journal_load(music_root, st.st_size, error_r))
+		return false;
+
+	tag_index_add_directory(music_root);
+	stats_update();
+
+	database_mtime = MAX(st.st_mtime, db_journal_get_mtime());
 	return true;
 }
 
@@ -271,7 +442,6 @@ bool
 db_load(GError **error)
 {
 	FILE *fp = NULL;
-	struct stat st;
 	GString *buffer = g_string_sized_new(1024);
 	char *line;
 	int format = 0;
@@ -282,6 +452,17 @@ db_load(GError **error)
 	assert(database_path != NULL);
 	assert(music_root != NULL);
 
+	if (db_binary_detect(database_path)) {
+		g_string_free(buffer, true);
+
+		g_debug("reading binary DB");
+
+		if (!db_binary_load(database_path, music_root, error))
+			return false;
+
+		return db_load_finish(error);
+	}
+
 	fp = fopen(database_path, "r");
 	if (fp == NULL) {
 		g_set_error(error, db_quark(), errno,
@@ -388,12 +569,7 @@ db_load(GError **error)
 	if (!success)
 		return false;
 
-	stats_update();
-
-	if (stat(database_path, &st) == 0)
-		database_mtime = st.st_mtime;
-
-	return true;
+	return db_load_finish(error);
 }
 
 time_t
@@ -61,12 +61,45 @@ int db_walk(const char *name,
 	    int (*forEachSong)(struct song *, void *),
 	    int (*forEachDir)(struct directory *, void *), void *data);
 
+/**
+ * Obtains a shared lock on the database tree.  Threads other than
+ * the main thread and the update thread (i.e. the query workers, see
+ * client_query.c, and the client I/O threads, see client_thread.c)
+ * must hold it while they traverse the tree.
+ */
+void
+db_lock_read(void);
+
+void
+db_unlock_read(void);
+
+/**
+ * Obtains the exclusive lock on the database tree.  The update
+ * thread holds it while it modifies the tree.  Never call
+ * update_remove_song() or any other function which waits for the
+ * main thread while holding this lock.
+ */
+void
+db_lock_write(void);
+
+void
+db_unlock_write(void);
+
 bool
 db_check(void);
 
 bool
 db_save(void);
 
+/**
+ * Saves the changes made by the update thread.  They are appended to
+ * the journal (see db_journal.h) if possible; the whole database
+ * file is written if there is none yet, if the journal is disabled,
+ * or if it has become too large.
+ */
+bool
+db_save_changes(void);
+
 bool
 db_load(GError **error);
 
@@ -29,10 +29,13 @@
 #include "tag.h"
 #include "strset.h"
 #include "stored_playlist.h"
+#include "tag_index.h"
 
 #include <glib.h>
 
+#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 typedef struct _ListCommandItem {
 	int8_t tagType;
@@ -64,9 +67,74 @@ printSongInDirectory(struct song *song, G_GNUC_UNUSED void *data)
 	return 0;
 }
 
+void
+db_query_options_init(struct db_query_options *options)
+{
+	options->sort = -1;
+	options->descending = false;
+	options->window_start = 0;
+	options->window_end = G_MAXUINT;
+}
+
+static bool
+db_query_options_active(const struct db_query_options *options)
+{
+	return options != NULL &&
+		(options->sort >= 0 || options->window_start > 0 ||
+		 options->window_end != G_MAXUINT);
+}
+
+/**
+ * Sorts the query results as requested by the options, and
+ * determines the window which shall be sent to the client.
+ */
+static void
+db_query_apply(GPtrArray *songs, const struct db_query_options *options,
+	       unsigned *start_r, unsigned *end_r)
+{
+	*start_r = 0;
+	*end_r = songs->len;
+
+	if (options == NULL)
+		return;
+
+	if (options->sort >= 0)
+		tag_index_sort(songs, options->sort == LOCATE_TAG_FILE_TYPE
+			       ? TAG_NUM_OF_ITEM_TYPES
+			       : (enum tag_type)options->sort,
+			       options->descending);
+
+	*start_r = MIN(options->window_start, songs->len);
+	*end_r = MIN(options->window_end, songs->len);
+}
+
+/**
+ * Prints the query results, and frees the array.
+ */
+static void
+db_query_print(struct client *client, GPtrArray *songs,
+	       const struct db_query_options *options)
+{
+	unsigned start, end;
+
+	db_query_apply(songs, options, &start, &end);
+
+	for (unsigned i = start; i < end; ++i)
+		song_print_info(client, g_ptr_array_index(songs, i));
+
+	g_ptr_array_free(songs, true);
+}
+
 struct search_data {
 	struct client *client;
 	const struct locate_item_list *criteria;
+
+	/**
+	 * If not NULL, matching songs are collected in this array
+	 * instead of being printed, because they must be sorted or
+	 * windowed first.
+	 */
+	GPtrArray *songs;
 };
 
 static int
@@ -74,26 +142,47 @@ searchInDirectory(struct song *song, void *_data)
 {
 	struct search_data *data = _data;
 
-	if (locate_song_search(song, data->criteria))
-		song_print_info(data->client, song);
+	if (locate_song_search(song, data->criteria)) {
+		if (data->songs != NULL)
+			g_ptr_array_add(data->songs, song);
+		else
+			song_print_info(data->client, song);
+	}
 
 	return 0;
 }
 
 int
 searchForSongsIn(struct client *client, const char *name,
-		 const struct locate_item_list *criteria)
+		 const struct locate_item_list *criteria,
+		 const struct db_query_options *options)
 {
 	int ret;
 	struct locate_item_list *new_list
 		= locate_item_list_casefold(criteria);
 	struct search_data data;
+	GPtrArray *songs;
+
+	if (name == NULL && (songs = tag_index_search(new_list)) != NULL) {
+		db_query_print(client, songs, options);
+		locate_item_list_free(new_list);
+		return 0;
+	}
 
 	data.client = client;
 	data.criteria = new_list;
+	data.songs = db_query_options_active(options)
+		? g_ptr_array_new() : NULL;
 
 	ret = db_walk(name, searchInDirectory, NULL, &data);
 
+	if (data.songs != NULL) {
+		if (ret == 0)
+			db_query_print(client, data.songs, options);
+		else
+			g_ptr_array_free(data.songs, true);
+	}
+
 	locate_item_list_free(new_list);
 
 	return ret;
@@ -104,22 +193,45 @@ findInDirectory(struct song *song, void *_data)
 {
 	struct search_data *data = _data;
 
-	if (locate_song_match(song, data->criteria))
-		song_print_info(data->client, song);
+	if (locate_song_match(song, data->criteria)) {
+		if (data->songs != NULL)
+			g_ptr_array_add(data->songs, song);
+		else
+			song_print_info(data->client, song);
+	}
 
 	return 0;
 }
 
 int
 findSongsIn(struct client *client, const char *name,
-	    const struct locate_item_list *criteria)
+	    const struct locate_item_list *criteria,
+	    const struct db_query_options *options)
 {
 	struct search_data data;
+	GPtrArray *songs;
+	int ret;
+
+	if (name == NULL && (songs = tag_index_find(criteria)) != NULL) {
+		db_query_print(client, songs, options);
+		return 0;
+	}
 
 	data.client = client;
 	data.criteria = criteria;
+	data.songs = db_query_options_active(options)
+		? g_ptr_array_new() : NULL;
+
+	ret = db_walk(name, findInDirectory, NULL, &data);
 
-	return db_walk(name, findInDirectory, NULL, &data);
+	if (data.songs != NULL) {
+		if (ret == 0)
+			db_query_print(client, data.songs, options);
+		else
+			g_ptr_array_free(data.songs, true);
+	}
+
+	return ret;
 }
 
 static void printSearchStats(struct client *client, SearchStats *stats)
@@ -146,12 +258,24 @@ searchStatsForSongsIn(struct client *client, const char *name,
 		      const struct locate_item_list *criteria)
 {
 	SearchStats stats;
+	GPtrArray *songs;
 	int ret;
 
 	stats.criteria = criteria;
 	stats.numberOfSongs = 0;
 	stats.playTime = 0;
 
+	if (name == NULL && (songs = tag_index_find(criteria)) != NULL) {
+		for (unsigned i = 0; i < songs->len; ++i)
+			stats.playTime +=
+				song_get_duration(g_ptr_array_index(songs, i));
+
+		stats.numberOfSongs = songs->len;
+		g_ptr_array_free(songs, true);
+		printSearchStats(client, &stats);
+		return 0;
+	}
+
 	ret = db_walk(name, searchStatsInDirectory, NULL, &stats);
 	if (ret == 0)
 		printSearchStats(client, &stats);
@@ -204,21 +328,67 @@ findAddInDirectory(struct song *song, void *_data)
 {
 	struct search_data *data = _data;
 
-	if (locate_song_match(song, data->criteria))
+	if (locate_song_match(song, data->criteria)) {
+		if (data->songs != NULL) {
+			g_ptr_array_add(data->songs, song);
+			return 0;
+		}
+
 		return directoryAddSongToPlaylist(song, data);
+	}
 
 	return 0;
 }
 
+/**
+ * Adds the query results to the playlist, and frees the array.
+ */
+static int
+db_query_add(GPtrArray *songs, const struct db_query_options *options)
+{
+	unsigned start, end;
+	int ret = 0;
+
+	db_query_apply(songs, options, &start, &end);
+
+	for (unsigned i = start; i < end; ++i) {
+		if (directoryAddSongToPlaylist(g_ptr_array_index(songs, i),
+					       NULL) < 0) {
+			ret = -1;
+			break;
+		}
+	}
+
+	g_ptr_array_free(songs, true);
+	return ret;
+}
+
 int findAddIn(struct client *client, const char *name,
-	      const struct locate_item_list *criteria)
+	      const struct locate_item_list *criteria,
+	      const struct db_query_options *options)
 {
 	struct search_data data;
+	GPtrArray *songs;
+	int ret;
+
+	if (name == NULL && (songs = tag_index_find(criteria)) != NULL)
+		return db_query_add(songs, options);
 
 	data.client   = client;
 	data.criteria = criteria;
+	data.songs = db_query_options_active(options)
+		? g_ptr_array_new() : NULL;
+
+	ret = db_walk(name, findAddInDirectory, NULL, &data);
 
-	return db_walk(name, findAddInDirectory, NULL, &data);
+	if (data.songs != NULL) {
+		if (ret == 0)
+			ret = db_query_add(data.songs, options);
+		else
+			g_ptr_array_free(data.songs, true);
+	}
+
+	return ret;
 }
 
 static int
@@ -295,8 +465,68 @@ listUniqueTagsInDirectory(struct song *song, void *_data)
 	return 0;
 }
 
+static void
+listUniqueTagsAddValue(const char *value, void *_set)
+{
+	struct strset *set = _set;
+
+	strset_add(set, value);
+}
+
+struct collated_value {
+	const char *value;
+	char *key;
+};
+
+static int
+compare_collated_value(const void *_a, const void *_b)
+{
+	const struct collated_value *a = _a, *b = _b;
+
+	return strcmp(a->key, b->key);
+}
+
+/**
+ * Prints the values collected by listAllUniqueTags(), sorted with
+ * g_utf8_collate() semantics, and only the requested window.
+ */
+static void
+printSortedUniqueTags(struct client *client, int type, struct strset *set,
+		      const struct db_query_options *options)
+{
+	unsigned n = strset_size(set), start, end;
+	struct collated_value *values = g_new(struct collated_value, n);
+	const char *value;
+
+	strset_rewind(set);
+
+	for (unsigned i = 0; (value = strset_next(set)) != NULL; ++i) {
+		assert(i < n);
+
+		values[i].value = value;
+		values[i].key = g_utf8_collate_key(value, -1);
+	}
+
+	qsort(values, n, sizeof(values[0]), compare_collated_value);
+
+	start = MIN(options->window_start, n);
+	end = MIN(options->window_end, n);
+
+	for (unsigned i = start; i < end; ++i) {
+		unsigned j = options->descending ? n - 1 - i : i;
+
+		client_printf(client, "%s: %s\n",
+			      tag_item_names[type], values[j].value);
+	}
+
+	for (unsigned i = 0; i < n; ++i)
+		g_free(values[i].key);
+	g_free(values);
+}
+
 int listAllUniqueTags(struct client *client, int type,
-		      const struct locate_item_list *criteria)
+		      const struct locate_item_list *criteria,
+		      const struct db_query_options *options)
 {
 	int ret;
 	ListCommandItem *item = newListCommandItem(type, criteria);
@@ -304,14 +534,32 @@ int listAllUniqueTags(struct client *client, int type,
 		.client = client,
 		.item = item,
 	};
+	GPtrArray *songs;
 
 	if (type >= 0 && type <= TAG_NUM_OF_ITEM_TYPES) {
 		data.set = strset_new();
 	}
 
-	ret = db_walk(NULL, listUniqueTagsInDirectory, NULL, &data);
-
-	if (type >= 0 && type <= TAG_NUM_OF_ITEM_TYPES) {
+	if (criteria->length == 0 && type >= 0 &&
+	    type < TAG_NUM_OF_ITEM_TYPES &&
+	    tag_index_list(type, listUniqueTagsAddValue, data.set)) {
+		/* all values are known to the index */
+		ret = 0;
+	} else if ((songs = tag_index_find(criteria)) != NULL) {
+		for (unsigned i = 0; i < songs->len; ++i)
+			visitTag(client, data.set,
+				 g_ptr_array_index(songs, i), type);
+
+		g_ptr_array_free(songs, true);
+		ret = 0;
+	} else
+		ret = db_walk(NULL, listUniqueTagsInDirectory, NULL, &data);
+
+	if (type >= 0 && type <= TAG_NUM_OF_ITEM_TYPES &&
+	    db_query_options_active(options)) {
+		printSortedUniqueTags(client, type, data.set, options);
+		strset_free(data.set);
+	} else if (type >= 0 && type <= TAG_NUM_OF_ITEM_TYPES) {
 		const char *value;
 
 		strset_rewind(data.set);
@@ -20,9 +20,36 @@
 #ifndef MPD_DB_UTILS_H
 #define MPD_DB_UTILS_H
 
+#include <stdbool.h>
+
 struct client;
 struct locate_item_list;
 
+/**
+ * Optional parameters for "find", "search", "findadd" and "list":
+ * the order of the results, and the part of the results which is
+ * sent to the client.
+ */
+struct db_query_options {
+	/**
+	 * The tag type to sort by (or #LOCATE_TAG_FILE_TYPE), or -1
+	 * to keep the database order.
+	 */
+	int sort;
+
+	/** sort in descending order? */
+	bool descending;
+
+	/**
+	 * The window of results to send: the first result, and the
+	 * one after the last one (#G_MAXUINT for "all").
+	 */
+	unsigned window_start, window_end;
+};
+
+void
+db_query_options_init(struct db_query_options *options);
+
 int printAllIn(struct client *client, const char *name);
 
 int addAllIn(const char *name);
@@ -33,15 +60,18 @@ int printInfoForAllIn(struct client *client, const char *name);
 
 int
 searchForSongsIn(struct client *client, const char *name,
-		 const struct locate_item_list *criteria);
+		 const struct locate_item_list *criteria,
+		 const struct db_query_options *options);
 
 int
 findSongsIn(struct client *client, const char *name,
-	    const struct locate_item_list *criteria);
+	    const struct locate_item_list *criteria,
+	    const struct db_query_options *options);
 
 int
 findAddIn(struct client *client, const char *name,
-	  const struct locate_item_list *criteria);
+	  const struct locate_item_list *criteria,
+	  const struct db_query_options *options);
 
 int
 searchStatsForSongsIn(struct client *client, const char *name,
@@ -51,6 +81,7 @@ unsigned long sumSongTimesIn(const char *name);
 
 int
 listAllUniqueTags(struct client *client, int type,
-		  const struct locate_item_list *criteria);
+		  const struct locate_item_list *criteria,
+		  const struct db_query_options *options);
 
 #endif
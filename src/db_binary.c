@@ -0,0 +1,892 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "db_binary.h"
+#include "directory.h"
+#include "song.h"
+#include "path.h"
+#include "tag.h"
+#include "tag_internal.h"
+#include "tag_pool.h"
+
+#include <glib.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "database"
+
+static const char db_binary_magic[8] = {
+	'\211', 'M', 'P', 'D', 'D', 'B', '\r', '\n',
+};
+
+enum {
+	/**
+	 * Increment this whenever the layout of one of the records
+	 * changes.
+	 */
+	DB_BINARY_FORMAT = 1,
+
+	/**
+	 * Written in native byte order; a database written on a
+	 * machine with a different byte order is discarded.
+	 */
+	DB_BINARY_BYTE_ORDER = 0x01020304,
+
+	/**
+	 * A string or directory index which refers to nothing.
+	 */
+	DB_BINARY_NONE = 0xffffffff,
+
+	/**
+	 * Flag for db_binary_song.flags: the song has a tag (which
+	 * may be empty).
+	 */
+	DB_BINARY_SONG_TAG = 0x1,
+};
+
+/**
+ * The file header.  All table offsets are relative to the beginning
+ * of the file, and aligned to 8 bytes, so the records can be
+ * accessed directly in the mapped file.
+ */
+struct db_binary_header {
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t format;
+
+	/** bit mask of the tag types which were enabled */
+	uint32_t tag_mask;
+
+	/** string index of the MPD version which wrote the file */
+	uint32_t mpd_version;
+
+	/** string index of the file system charset */
+	uint32_t fs_charset;
+
+	uint32_t num_strings, string_data_size;
+	uint32_t num_items, num_directories, num_songs;
+	uint32_t num_item_refs, num_playlists;
+
+	uint64_t strings, string_data;
+	uint64_t items, directories, songs;
+	uint64_t item_refs, playlists;
+};
+
+/**
+ * A unique tag item.  It is interned in the tag pool once, no
+ * matter how many songs refer to it.
+ */
+struct db_binary_item {
+	uint32_t type;
+	uint32_t value;
+};
+
+/**
+ * A directory.  Directories are stored in pre-order, therefore a
+ * directory's parent always has a smaller index.  The first record
+ * is the music root directory.
+ */
+struct db_binary_directory {
+	uint32_t parent;
+	uint32_t name;
+	int64_t mtime;
+};
+
+struct db_binary_song {
+	uint32_t directory;
+	uint32_t uri;
+	int64_t mtime;
+	uint32_t start_ms, end_ms;
+	int32_t time;
+	uint32_t flags;
+
+	/** a range in the item_refs table */
+	uint32_t first_item, num_items;
+};
+
+struct db_binary_playlist {
+	uint32_t directory;
+	uint32_t name;
+	int64_t mtime;
+};
+
+/**
+ * The quark used for GError.domain.
+ */
+static inline GQuark
+db_binary_quark(void)
+{
+	return g_quark_from_static_string("db_binary");
+}
+
+bool
+db_binary_detect(const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL)
+		return false;
+
+	char magic[sizeof(db_binary_magic)];
+	bool result = fread(magic, sizeof(magic), 1, fp) == 1 &&
+		memcmp(magic, db_binary_magic, sizeof(magic)) == 0;
+	fclose(fp);
+	return result;
+}
+
+static uint32_t
+db_binary_tag_mask(void)
+{
+	uint32_t mask = 0;
+
+	assert(TAG_NUM_OF_ITEM_TYPES <= 32);
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		if (!ignore_tag_items[i])
+			mask |= 1 << i;
+
+	return mask;
+}
+
+/*
+ * Writing
+ *
+ */
+
+struct db_binary_writer {
+	/** maps strings to (index + 1) in #string_offsets */
+	GHashTable *string_map;
+	GArray *string_offsets;
+	GString *string_data;
+
+	/** maps tag_item pointers to (index + 1) in #items */
+	GHashTable *item_map;
+	GArray *items;
+
+	GArray *directories, *songs, *item_refs, *playlists;
+};
+
+static void
+db_binary_writer_init(struct db_binary_writer *w)
+{
+	w->string_map = g_hash_table_new(g_str_hash, g_str_equal);
+	w->string_offsets = g_array_new(false, false, sizeof(uint32_t));
+	w->string_data = g_string_sized_new(65536);
+
+	w->item_map = g_hash_table_new(g_direct_hash, g_direct_equal);
+	w->items = g_array_new(false, false, sizeof(struct db_binary_item));
+
+	w->directories = g_array_new(false, false,
+				     sizeof(struct db_binary_directory));
+	w->songs = g_array_new(false, false, sizeof(struct db_binary_song));
+	w->item_refs = g_array_new(false, false, sizeof(uint32_t));
+	w->playlists = g_array_new(false, false,
+				   sizeof(struct db_binary_playlist));
+}
+
+static void
+db_binary_writer_deinit(struct db_binary_writer *w)
+{
+	g_hash_table_destroy(w->string_map);
+	g_array_free(w->string_offsets, true);
+	g_string_free(w->string_data, true);
+
+	g_hash_table_destroy(w->item_map);
+	g_array_free(w->items, true);
+
+	g_array_free(w->directories, true);
+	g_array_free(w->songs, true);
+	g_array_free(w->item_refs, true);
+	g_array_free(w->playlists, true);
+}
+
+/**
+ * Returns the index of the string in the string table, adding it if
+ * it's not there yet.  The string is not copied; it must remain
+ * valid until the writer is destroyed.
+ */
+static uint32_t
+db_binary_string(struct db_binary_writer *w, const char *s)
+{
+	gpointer value = g_hash_table_lookup(w->string_map, s);
+	if (value != NULL)
+		return GPOINTER_TO_UINT(value) - 1;
+
+	uint32_t offset = w->string_data->len;
+	g_string_append_len(w->string_data, s, strlen(s) + 1);
+	g_array_append_val(w->string_offsets, offset);
+
+	uint32_t index = w->string_offsets->len - 1;
+	g_hash_table_insert(w->string_map, (gpointer)s,
+			    GUINT_TO_POINTER(index + 1));
+	return index;
+}
+
+static uint32_t
+db_binary_item(struct db_binary_writer *w, const struct tag_item *item)
+{
+	gpointer value = g_hash_table_lookup(w->item_map, item);
+	if (value != NULL)
+		return GPOINTER_TO_UINT(value) - 1;
+
+	struct db_binary_item record = {
+		.type = item->type,
+		.value = db_binary_string(w, item->value),
+	};
+	g_array_append_val(w->items, record);
+
+	uint32_t index = w->items->len - 1;
+	g_hash_table_insert(w->item_map, (gpointer)item,
+			    GUINT_TO_POINTER(index + 1));
+	return index;
+}
+
+static void
+db_binary_add_song(struct db_binary_writer *w, uint32_t directory,
+		   const struct song *song)
+{
+	struct db_binary_song record = {
+		.directory = directory,
+		.uri = db_binary_string(w, song->uri),
+		.mtime = song->mtime,
+		.start_ms = song->start_ms,
+		.end_ms = song->end_ms,
+		.first_item = w->item_refs->len,
+	};
+
+	if (song->tag != NULL) {
+		const struct tag *tag = song->tag;
+
+		record.flags = DB_BINARY_SONG_TAG;
+		record.time = tag->time;
+		record.num_items = tag->num_items;
+
+		for (unsigned i = 0; i < tag->num_items; ++i) {
+			uint32_t ref = db_binary_item(w, tag->items[i]);
+			g_array_append_val(w->item_refs, ref);
+		}
+	}
+
+	g_array_append_val(w->songs, record);
+}
+
+static void
+db_binary_add_directory(struct db_binary_writer *w, uint32_t parent,
+			const struct directory *directory)
+{
+	struct db_binary_directory record = {
+		.parent = parent,
+		.name = directory_is_root(directory)
+		? db_binary_string(w, "")
+		: db_binary_string(w, directory_get_name(directory)),
+		.mtime = directory->mtime,
+	};
+
+	uint32_t index = w->directories->len;
+	g_array_append_val(w->directories, record);
+
+	const struct songvec *sv = &directory->songs;
+	for (size_t i = 0; i < sv->nr; ++i)
+		db_binary_add_song(w, index, sv->base[i]);
+
+	for (const struct playlist_metadata *pm = directory->playlists.head;
+	     pm != NULL; pm = pm->next) {
+		struct db_binary_playlist playlist = {
+			.directory = index,
+			.name = db_binary_string(w, pm->name),
+			.mtime = pm->mtime,
+		};
+
+		g_array_append_val(w->playlists, playlist);
+	}
+
+	const struct dirvec *dv = &directory->children;
+	for (size_t i = 0; i < dv->nr; ++i)
+		db_binary_add_directory(w, index, dv->base[i]);
+}
+
+/**
+ * Rounds the file position up to the next multiple of 8 bytes.
+ */
+static uint64_t
+db_binary_align(uint64_t position)
+{
+	return (position + 7) & ~(uint64_t)7;
+}
+
+static bool
+db_binary_write_section(FILE *fp, uint64_t *position_r,
+			const void *data, size_t size)
+{
+	static const char zero[8];
+	uint64_t aligned = db_binary_align(*position_r);
+
+	if (aligned > *position_r &&
+	    fwrite(zero, aligned - *position_r, 1, fp) != 1)
+		return false;
+
+	if (size > 0 && fwrite(data, size, 1, fp) != 1)
+		return false;
+
+	*position_r = aligned + size;
+	return true;
+}
+
+static bool
+db_binary_write(FILE *fp, struct db_binary_writer *w,
+		struct db_binary_header *header)
+{
+	uint64_t position = sizeof(*header);
+
+	header->strings = db_binary_align(position);
+	position = header->strings +
+		w->string_offsets->len * sizeof(uint32_t);
+	header->string_data = db_binary_align(position);
+	position = header->string_data + w->string_data->len;
+	header->items = db_binary_align(position);
+	position = header->items +
+		w->items->len * sizeof(struct db_binary_item);
+	header->directories = db_binary_align(position);
+	position = header->directories +
+		w->directories->len * sizeof(struct db_binary_directory);
+	header->songs = db_binary_align(position);
+	position = header->songs +
+		w->songs->len * sizeof(struct db_binary_song);
+	header->item_refs = db_binary_align(position);
+	position = header->item_refs + w->item_refs->len * sizeof(uint32_t);
+	header->playlists = db_binary_align(position);
+
+	position = 0;
+	return db_binary_write_section(fp, &position,
+				       header, sizeof(*header)) &&
+		db_binary_write_section(fp, &position,
+					w->string_offsets->data,
+					w->string_offsets->len *
+					sizeof(uint32_t)) &&
+		db_binary_write_section(fp, &position,
+					w->string_data->str,
+					w->string_data->len) &&
+		db_binary_write_section(fp, &position, w->items->data,
+					w->items->len *
+					sizeof(struct db_binary_item)) &&
+		db_binary_write_section(fp, &position, w->directories->data,
+					w->directories->len *
+					sizeof(struct db_binary_directory)) &&
+		db_binary_write_section(fp, &position, w->songs->data,
+					w->songs->len *
+					sizeof(struct db_binary_song)) &&
+		db_binary_write_section(fp, &position, w->item_refs->data,
+					w->item_refs->len *
+					sizeof(uint32_t)) &&
+		db_binary_write_section(fp, &position, w->playlists->data,
+					w->playlists->len *
+					sizeof(struct db_binary_playlist));
+}
+
+bool
+db_binary_save(const char *path, const struct directory *root,
+	       GError **error_r)
+{
+	struct db_binary_writer w;
+	struct db_binary_header header;
+	const char *fs_charset = path_get_fs_charset();
+
+	db_binary_writer_init(&w);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, db_binary_magic, sizeof(header.magic));
+	header.byte_order = DB_BINARY_BYTE_ORDER;
+	header.format = DB_BINARY_FORMAT;
+	header.tag_mask = db_binary_tag_mask();
+	header.mpd_version = db_binary_string(&w, VERSION);
+	header.fs_charset = fs_charset != NULL
+		? db_binary_string(&w, fs_charset)
+		: DB_BINARY_NONE;
+
+	db_binary_add_directory(&w, DB_BINARY_NONE, root);
+
+	header.num_strings = w.string_offsets->len;
+	header.string_data_size = w.string_data->len;
+	header.num_items = w.items->len;
+	header.num_directories = w.directories->len;
+	header.num_songs = w.songs->len;
+	header.num_item_refs = w.item_refs->len;
+	header.num_playlists = w.playlists->len;
+
+	char *tmp_path = g_strconcat(path, ".tmp", NULL);
+	FILE *fp = fopen(tmp_path, "wb");
+	if (fp == NULL) {
+		g_set_error(error_r, db_binary_quark(), errno,
+			    "Failed to create \"%s\": %s",
+			    tmp_path, g_strerror(errno));
+		g_free(tmp_path);
+		db_binary_writer_deinit(&w);
+		return false;
+	}
+
+	bool success = db_binary_write(fp, &w, &header);
+	db_binary_writer_deinit(&w);
+
+	if (fclose(fp) != 0)
+		success = false;
+
+	if (!success) {
+		g_set_error(error_r, db_binary_quark(), errno,
+			    "Failed to write \"%s\": %s",
+			    tmp_path, g_strerror(errno));
+		unlink(tmp_path);
+		g_free(tmp_path);
+		return false;
+	}
+
+	if (rename(tmp_path, path) < 0) {
+		g_set_error(error_r, db_binary_quark(), errno,
+			    "Failed to rename \"%s\": %s",
+			    tmp_path, g_strerror(errno));
+		unlink(tmp_path);
+		g_free(tmp_path);
+		return false;
+	}
+
+	g_free(tmp_path);
+	return true;
+}
+
+/*
+ * Loading
+ *
+ */
+
+struct db_binary_reader {
+	const struct db_binary_header *header;
+
+	const uint32_t *strings;
+	const char *string_data;
+	const struct db_binary_item *items;
+	const struct db_binary_directory *directories;
+	const struct db_binary_song *songs;
+	const uint32_t *item_refs;
+	const struct db_binary_playlist *playlists;
+};
+
+/**
+ * Returns a pointer to a table within the file, or NULL if it does
+ * not fit or is not properly aligned.
+ */
+static const void *
+db_binary_table(const char *data, size_t size,
+		uint64_t offset, uint32_t count, size_t record_size)
+{
+	if (offset % 8 != 0 || offset > size ||
+	    count > (size - offset) / record_size)
+		return NULL;
+
+	return data + offset;
+}
+
+static bool
+db_binary_reader_open(struct db_binary_reader *r,
+		      const char *data, size_t size, GError **error_r)
+{
+	const struct db_binary_header *header =
+		(const struct db_binary_header *)data;
+
+	if (size < sizeof(*header) ||
+	    memcmp(header->magic, db_binary_magic,
+		   sizeof(header->magic)) != 0) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Database corrupted");
+		return false;
+	}
+
+	if (header->byte_order != DB_BINARY_BYTE_ORDER ||
+	    header->format != DB_BINARY_FORMAT) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Database format mismatch, "
+			    "discarding database file");
+		return false;
+	}
+
+	r->header = header;
+	r->strings = db_binary_table(data, size, header->strings,
+				     header->num_strings, sizeof(uint32_t));
+	r->string_data = db_binary_table(data, size, header->string_data,
+					 header->string_data_size, 1);
+	r->items = db_binary_table(data, size, header->items,
+				   header->num_items,
+				   sizeof(struct db_binary_item));
+	r->directories = db_binary_table(data, size, header->directories,
+					 header->num_directories,
+					 sizeof(struct db_binary_directory));
+	r->songs = db_binary_table(data, size, header->songs,
+				   header->num_songs,
+				   sizeof(struct db_binary_song));
+	r->item_refs = db_binary_table(data, size, header->item_refs,
+				       header->num_item_refs,
+				       sizeof(uint32_t));
+	r->playlists = db_binary_table(data, size, header->playlists,
+				       header->num_playlists,
+				       sizeof(struct db_binary_playlist));
+
+	if (r->strings == NULL || r->string_data == NULL ||
+	    r->items == NULL || r->directories == NULL ||
+	    r->songs == NULL || r->item_refs == NULL ||
+	    r->playlists == NULL) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Database corrupted");
+		return false;
+	}
+
+	/* all strings must be null-terminated within the string
+	   table; checking the last byte and all offsets once is
+	   enough */
+	if (header->num_strings > 0 &&
+	    (header->string_data_size == 0 ||
+	     r->string_data[header->string_data_size - 1] != 0)) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Database corrupted");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header->num_strings; ++i) {
+		if (r->strings[i] >= header->string_data_size) {
+			g_set_error(error_r, db_binary_quark(), 0,
+				    "Database corrupted");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Returns the string with the specified index, or NULL if the index
+ * is out of range.
+ */
+static const char *
+db_binary_get_string(const struct db_binary_reader *r, uint32_t index)
+{
+	if (index >= r->header->num_strings)
+		return NULL;
+
+	return r->string_data + r->strings[index];
+}
+
+static bool
+db_binary_check_header(const struct db_binary_reader *r, GError **error_r)
+{
+	const char *new_charset, *old_charset;
+
+	if (db_binary_get_string(r, r->header->mpd_version) == NULL) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Database corrupted");
+		return false;
+	}
+
+	new_charset = db_binary_get_string(r, r->header->fs_charset);
+	old_charset = path_get_fs_charset();
+	if (new_charset != NULL && old_charset != NULL &&
+	    strcmp(new_charset, old_charset) != 0) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Existing database has charset "
+			    "\"%s\" instead of \"%s\"; "
+			    "discarding database file",
+			    new_charset, old_charset);
+		return false;
+	}
+
+	if ((db_binary_tag_mask() & ~r->header->tag_mask) != 0) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Tag list mismatch, "
+			    "discarding database file");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Interns all unique tag items in the tag pool.  Items of tag types
+ * which are currently disabled are set to NULL.
+ *
+ * @param items_r returns the item table, or NULL if the database
+ * has no tag items
+ */
+static bool
+db_binary_load_items(const struct db_binary_reader *r,
+		     struct tag_item ***items_r, GError **error_r)
+{
+	uint32_t num_items = r->header->num_items;
+	struct tag_item **items;
+
+	if (num_items == 0) {
+		/* an empty or completely untagged library */
+		*items_r = NULL;
+		return true;
+	}
+
+	items = g_new(struct tag_item *, num_items);
+
+	for (uint32_t i = 0; i < num_items; ++i) {
+		const struct db_binary_item *record = &r->items[i];
+		const char *value = db_binary_get_string(r, record->value);
+
+		if (record->type >= TAG_NUM_OF_ITEM_TYPES || value == NULL) {
+			for (uint32_t j = 0; j < i; ++j)
+				if (items[j] != NULL)
+					tag_pool_put_item(items[j]);
+			g_free(items);
+
+			g_set_error(error_r, db_binary_quark(), 0,
+				    "Database corrupted");
+			return false;
+		}
+
+		items[i] = ignore_tag_items[record->type]
+			? NULL
+			: tag_pool_get_item(record->type,
+					    value, strlen(value));
+	}
+
+	*items_r = items;
+	return true;
+}
+
+/**
+ * Releases the references held by the item table.
+ */
+static void
+db_binary_free_items(struct tag_item **items, uint32_t num_items)
+{
+	for (uint32_t i = 0; i < num_items; ++i)
+		if (items[i] != NULL)
+			tag_pool_put_item(items[i]);
+
+	g_free(items);
+}
+
+/**
+ * Creates the #tag object for a song record.
+ */
+static struct tag *
+db_binary_load_tag(const struct db_binary_reader *r,
+		   struct tag_item *const*items,
+		   const struct db_binary_song *record)
+{
+	struct tag *tag = tag_new();
+	tag->time = record->time;
+
+	if (record->num_items == 0)
+		return tag;
+
+	tag->items = tag_items_new(record->num_items);
+
+	for (uint32_t i = 0; i < record->num_items; ++i) {
+		uint32_t ref = r->item_refs[record->first_item + i];
+		if (items[ref] != NULL)
+			tag->items[tag->num_items++] =
+				tag_pool_dup_item(items[ref]);
+	}
+
+	if (tag->num_items < record->num_items)
+		/* some tag types are ignored */
+		tag->items = tag_items_resize(tag->items, record->num_items,
+					      tag->num_items);
+
+	return tag;
+}
+
+static bool
+db_binary_load_directories(const struct db_binary_reader *r,
+			   struct directory **directories,
+			   struct directory *root, GError **error_r)
+{
+	uint32_t num_directories = r->header->num_directories;
+
+	if (num_directories == 0 ||
+	    r->directories[0].parent != DB_BINARY_NONE) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Database corrupted");
+		return false;
+	}
+
+	directories[0] = root;
+
+	for (uint32_t i = 1; i < num_directories; ++i) {
+		const struct db_binary_directory *record =
+			&r->directories[i];
+		const char *name = db_binary_get_string(r, record->name);
+
+		if (record->parent >= i || name == NULL ||
+		    *name == 0 || strchr(name, '/') != NULL) {
+			g_set_error(error_r, db_binary_quark(), 0,
+				    "Database corrupted");
+			return false;
+		}
+
+		struct directory *parent = directories[record->parent];
+		struct directory *directory;
+
+		if (directory_is_root(parent)) {
+			directory = directory_new(name, parent);
+		} else {
+			char *path = g_strconcat(directory_get_path(parent),
+						 "/", name, NULL);
+			directory = directory_new(path, parent);
+			g_free(path);
+		}
+
+		directory->mtime = record->mtime;
+		dirvec_add(&parent->children, directory);
+		directories[i] = directory;
+	}
+
+	return true;
+}
+
+static bool
+db_binary_load_songs(const struct db_binary_reader *r,
+		     struct directory *const*directories,
+		     struct tag_item *const*items, GError **error_r)
+{
+	const struct db_binary_header *header = r->header;
+
+	for (uint32_t i = 0; i < header->num_songs; ++i) {
+		const struct db_binary_song *record = &r->songs[i];
+		const char *uri = db_binary_get_string(r, record->uri);
+
+		if (record->directory >= header->num_directories ||
+		    uri == NULL || *uri == 0 ||
+		    record->first_item > header->num_item_refs ||
+		    record->num_items >
+		    header->num_item_refs - record->first_item) {
+			g_set_error(error_r, db_binary_quark(), 0,
+				    "Database corrupted");
+			return false;
+		}
+
+		for (uint32_t j = 0; j < record->num_items; ++j) {
+			if (r->item_refs[record->first_item + j] >=
+			    header->num_items) {
+				g_set_error(error_r, db_binary_quark(), 0,
+					    "Database corrupted");
+				return false;
+			}
+		}
+
+		struct directory *directory = directories[record->directory];
+		struct song *song = song_file_new(uri, directory);
+		song->mtime = record->mtime;
+		song->start_ms = record->start_ms;
+		song->end_ms = record->end_ms;
+
+		if (record->flags & DB_BINARY_SONG_TAG)
+			song->tag = db_binary_load_tag(r, items, record);
+
+		songvec_add(&directory->songs, song);
+	}
+
+	return true;
+}
+
+static bool
+db_binary_load_playlists(const struct db_binary_reader *r,
+			 struct directory *const*directories,
+			 GError **error_r)
+{
+	const struct db_binary_header *header = r->header;
+
+	for (uint32_t i = 0; i < header->num_playlists; ++i) {
+		const struct db_binary_playlist *record = &r->playlists[i];
+		const char *name = db_binary_get_string(r, record->name);
+
+		if (record->directory >= header->num_directories ||
+		    name == NULL) {
+			g_set_error(error_r, db_binary_quark(), 0,
+				    "Database corrupted");
+			return false;
+		}
+
+		playlist_vector_add(&directories[record->directory]->playlists,
+				    name, record->mtime);
+	}
+
+	return true;
+}
+
+static bool
+db_binary_load_tree(const struct db_binary_reader *r,
+		    struct directory *root, GError **error_r)
+{
+	struct directory **directories =
+		g_new(struct directory *, MAX(r->header->num_directories, 1));
+	bool success = db_binary_load_directories(r, directories,
+						  root, error_r);
+
+	if (success) {
+		struct tag_item **items;
+
+		success = db_binary_load_items(r, &items, error_r);
+		if (success) {
+			success = db_binary_load_songs(r, directories, items,
+						       error_r);
+			db_binary_free_items(items, r->header->num_items);
+		}
+	}
+
+	success = success &&
+		db_binary_load_playlists(r, directories, error_r);
+
+	g_free(directories);
+	return success;
+}
+
+bool
+db_binary_load(const char *path, struct directory *root, GError **error_r)
+{
+	GError *error = NULL;
+	struct db_binary_reader reader;
+
+	assert(directory_is_empty(root));
+
+	GMappedFile *file = g_mapped_file_new(path, false, &error);
+	if (file == NULL) {
+		g_set_error(error_r, db_binary_quark(), 0,
+			    "Failed to open database file \"%s\": %s",
+			    path, error->message);
+		g_error_free(error);
+		return false;
+	}
+
+	bool success = db_binary_reader_open(&reader,
+					     g_mapped_file_get_contents(file),
+					     g_mapped_file_get_length(file),
+					     error_r) &&
+		db_binary_check_header(&reader, error_r) &&
+		db_binary_load_tree(&reader, root, error_r);
+
+	g_mapped_file_free(file);
+	return success;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A binary, memory mapped database file format.  It contains a
+ * string table, the unique tag items, and fixed-size records for all
+ * directories, songs and playlists.  Loading it requires only one
+ * pass over each table and no text parsing.
+ */
+
+#ifndef MPD_DB_BINARY_H
+#define MPD_DB_BINARY_H
+
+#include <glib.h>
+
+#include <stdbool.h>
+
+struct directory;
+
+/**
+ * Checks whether the specified file is a binary database file, by
+ * looking at its magic.
+ */
+bool
+db_binary_detect(const char *path);
+
+/**
+ * Saves the directory tree to a binary database file.  The file is
+ * written to a temporary file first, which is then renamed, so a
+ * crash during saving never destroys the old database.
+ *
+ * @param path the path of the database file
+ * @param root the music root directory
+ * @param error_r location to store the error occuring, or NULL to
+ * ignore errors
+ * @return true on success
+ */
+bool
+db_binary_save(const char *path, const struct directory *root,
+	       GError **error_r);
+
+/**
+ * Loads a binary database file into the (empty) root directory.
+ * The file is mapped into memory, and the directory tree is rebuilt
+ * from its records.  On failure, the root directory may be partially
+ * filled, and the caller is responsible for clearing it.
+ *
+ * @param path the path of the database file
+ * @param root the music root directory
+ * @param error_r location to store the error occuring, or NULL to
+ * ignore errors
+ * @return true on success
+ */
+bool
+db_binary_load(const char *path, struct directory *root, GError **error_r);
+
+#endif
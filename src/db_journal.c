@@ -0,0 +1,658 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h" /* must be first for large file support */
+#include "db_journal.h"
+#include "directory.h"
+#include "song.h"
+#include "song_save.h"
+#include "playlist_database.h"
+#include "playlist_vector.h"
+#include "text_file.h"
+#include "fd_util.h"
+
+#include <glib.h>
+
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "db_journal"
+
+#define JOURNAL_SUFFIX ".journal"
+#define JOURNAL_FORMAT_PREFIX "journal_format: "
+#define JOURNAL_DIRECTORY "directory_path: "
+#define JOURNAL_MTIME "mtime: "
+#define JOURNAL_DELETE_SONG "delete_song: "
+#define JOURNAL_DELETE_DIRECTORY "delete_directory: "
+#define JOURNAL_DELETE_PLAYLIST "delete_playlist: "
+#define JOURNAL_COMMIT "commit"
+
+enum {
+	JOURNAL_FORMAT = 1,
+
+	/**
+	 * The journal may always grow to this size (in bytes) before
+	 * it is compacted, even if the database file is smaller.
+	 */
+	JOURNAL_MIN_MAX_SIZE = 256 * 1024,
+};
+
+static char *journal_path;
+
+/**
+ * Is the journal enabled in the configuration?
+ */
+static bool journal_enabled;
+
+/**
+ * Does the journal file belong to the current database file?  This
+ * is false until the database has been loaded or saved
+ * successfully; until then, there is nothing to apply changes to.
+ */
+static bool journal_active;
+
+/**
+ * Has the current batch failed, because it has become too large, or
+ * because writing it has failed?
+ */
+static bool journal_failed;
+
+/**
+ * Have changes been recorded since the last commit?
+ */
+static bool journal_pending;
+
+/**
+ * The journal file, while a batch is being recorded.
+ */
+static FILE *journal_file;
+
+/**
+ * The size of the committed part of the journal file.  Anything
+ * behind it belongs to a batch which was not committed, and is
+ * truncated before the next batch is recorded.
+ */
+static off_t journal_size;
+
+/**
+ * When the journal file grows beyond this size, the database file
+ * is written instead.
+ */
+static off_t journal_max_size;
+
+/**
+ * The modification time of the journal file when it was loaded, if
+ * it contained committed batches.
+ */
+static time_t journal_mtime;
+
+/**
+ * The directory selected by the last #JOURNAL_DIRECTORY record in
+ * the current batch, or NULL if none is selected.
+ */
+static const struct directory *journal_directory;
+
+/**
+ * The quark used for GError.domain.
+ */
+static inline GQuark
+db_journal_quark(void)
+{
+	return g_quark_from_static_string("db_journal");
+}
+
+void
+db_journal_init(const char *db_path, bool enabled)
+{
+	assert(journal_path == NULL);
+	assert(db_path != NULL);
+
+	journal_path = g_strconcat(db_path, JOURNAL_SUFFIX, NULL);
+	journal_enabled = enabled;
+	journal_active = false;
+}
+
+static void
+db_journal_close(void)
+{
+	if (journal_file != NULL) {
+		fclose(journal_file);
+		journal_file = NULL;
+	}
+
+	journal_directory = NULL;
+}
+
+void
+db_journal_finish(void)
+{
+	db_journal_close();
+
+	g_free(journal_path);
+	journal_path = NULL;
+}
+
+static void
+db_journal_activate(off_t size, off_t db_size)
+{
+	db_journal_close();
+
+	journal_active = true;
+	journal_failed = false;
+	journal_pending = false;
+	journal_size = size;
+	journal_max_size = MAX(db_size / 4, JOURNAL_MIN_MAX_SIZE);
+	journal_mtime = 0;
+}
+
+void
+db_journal_reset(off_t db_size)
+{
+	db_journal_close();
+
+	if (unlink(journal_path) < 0 && errno != ENOENT)
+		g_warning("Failed to delete %s: %s",
+			  journal_path, g_strerror(errno));
+
+	db_journal_activate(0, db_size);
+}
+
+/*
+ * Recording
+ *
+ */
+
+/**
+ * Opens the journal file for the current batch.
+ */
+static bool
+db_journal_open(void)
+{
+	int fd;
+
+	assert(journal_file == NULL);
+
+	fd = open_cloexec(journal_path, O_WRONLY|O_CREAT, 0666);
+	if (fd < 0) {
+		g_warning("Failed to open %s: %s",
+			  journal_path, g_strerror(errno));
+		return false;
+	}
+
+	/* discard the remains of a batch which was not committed */
+	if (ftruncate(fd, journal_size) < 0 ||
+	    lseek(fd, journal_size, SEEK_SET) < 0) {
+		g_warning("Failed to truncate %s: %s",
+			  journal_path, g_strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	journal_file = fdopen(fd, "w");
+	if (journal_file == NULL) {
+		close(fd);
+		return false;
+	}
+
+	if (journal_size == 0)
+		fprintf(journal_file, JOURNAL_FORMAT_PREFIX "%u\n",
+			JOURNAL_FORMAT);
+
+	journal_directory = NULL;
+	return true;
+}
+
+/**
+ * Prepares recording a change in the specified directory: opens the
+ * journal file if necessary, and selects the directory.
+ *
+ * @return false if the change cannot be recorded; the database file
+ * will be written instead
+ */
+static bool
+db_journal_begin_record(const struct directory *directory)
+{
+	journal_pending = true;
+
+	if (!db_journal_full() && journal_file == NULL &&
+	    !db_journal_open())
+		journal_failed = true;
+
+	if (db_journal_full())
+		return false;
+
+	if (directory != journal_directory) {
+		fprintf(journal_file, JOURNAL_DIRECTORY "%s\n",
+			directory_get_path(directory));
+		journal_directory = directory;
+	}
+
+	return true;
+}
+
+/**
+ * Checks the journal file after a record has been written.  If it
+ * has become too large, recording is stopped, and the database file
+ * will be written instead.
+ */
+static void
+db_journal_end_record(void)
+{
+	assert(journal_file != NULL);
+
+	if (ferror(journal_file)) {
+		g_warning("Failed to write %s: %s",
+			  journal_path, g_strerror(errno));
+		journal_failed = true;
+	} else if (ftello(journal_file) > journal_max_size) {
+		g_debug("journal is full");
+		journal_failed = true;
+	}
+
+	if (journal_failed)
+		db_journal_close();
+}
+
+void
+db_journal_song(const struct song *song)
+{
+	assert(song->parent != NULL);
+
+	if (!db_journal_begin_record(song->parent))
+		return;
+
+	song_save(journal_file, song);
+	db_journal_end_record();
+}
+
+void
+db_journal_delete_song(const struct song *song)
+{
+	assert(song->parent != NULL);
+
+	if (!db_journal_begin_record(song->parent))
+		return;
+
+	fprintf(journal_file, JOURNAL_DELETE_SONG "%s\n", song->uri);
+	db_journal_end_record();
+}
+
+void
+db_journal_delete_directory(const struct directory *directory)
+{
+	assert(directory->parent != NULL);
+
+	if (!db_journal_begin_record(directory->parent))
+		return;
+
+	fprintf(journal_file, JOURNAL_DELETE_DIRECTORY "%s\n",
+		directory_get_name(directory));
+
+	/* the selected directory may be freed and its memory reused,
+	   so select again with the next record */
+	journal_directory = NULL;
+
+	db_journal_end_record();
+}
+
+void
+db_journal_directory_mtime(const struct directory *directory)
+{
+	if (!db_journal_begin_record(directory))
+		return;
+
+	fprintf(journal_file, JOURNAL_MTIME "%lu\n",
+		(unsigned long)directory->mtime);
+	db_journal_end_record();
+}
+
+void
+db_journal_playlist(const struct directory *directory, const char *name,
+		    time_t mtime)
+{
+	if (!db_journal_begin_record(directory))
+		return;
+
+	fprintf(journal_file, PLAYLIST_META_BEGIN "%s\n"
+		"mtime: %li\n"
+		"playlist_end\n",
+		name, (long)mtime);
+	db_journal_end_record();
+}
+
+void
+db_journal_delete_playlist(const struct directory *directory,
+			   const char *name)
+{
+	if (!db_journal_begin_record(directory))
+		return;
+
+	fprintf(journal_file, JOURNAL_DELETE_PLAYLIST "%s\n", name);
+	db_journal_end_record();
+}
+
+bool
+db_journal_pending(void)
+{
+	return journal_pending;
+}
+
+bool
+db_journal_full(void)
+{
+	return !journal_enabled || !journal_active || journal_failed;
+}
+
+bool
+db_journal_commit(GError **error_r)
+{
+	off_t size;
+
+	assert(journal_pending);
+	assert(!db_journal_full());
+	assert(journal_file != NULL);
+
+	fprintf(journal_file, JOURNAL_COMMIT "\n");
+
+	if (fflush(journal_file) != 0 || fsync(fileno(journal_file)) < 0 ||
+	    (size = ftello(journal_file)) < 0) {
+		g_set_error(error_r, db_journal_quark(), errno,
+			    "Failed to write %s: %s",
+			    journal_path, g_strerror(errno));
+		journal_failed = true;
+		db_journal_close();
+		return false;
+	}
+
+	db_journal_close();
+
+	g_debug("committed %lu bytes",
+		(unsigned long)(size - journal_size));
+
+	journal_size = size;
+	journal_pending = false;
+	return true;
+}
+
+/*
+ * Replaying
+ *
+ */
+
+/**
+ * Determines the size of the committed part of the journal file,
+ * i.e. the offset behind the last #JOURNAL_COMMIT line.
+ *
+ * @return the size, or -1 on error
+ */
+static off_t
+db_journal_scan(FILE *fp, GString *buffer, GError **error_r)
+{
+	const char *line;
+	off_t committed = 0;
+
+	line = read_text_line(fp, buffer);
+	if (line == NULL)
+		/* empty file */
+		return 0;
+
+	if (!g_str_has_prefix(line, JOURNAL_FORMAT_PREFIX) ||
+	    atoi(line + sizeof(JOURNAL_FORMAT_PREFIX) - 1) !=
+	    JOURNAL_FORMAT) {
+		g_set_error(error_r, db_journal_quark(), 0,
+			    "Journal format mismatch");
+		return -1;
+	}
+
+	while ((line = read_text_line(fp, buffer)) != NULL)
+		if (strcmp(line, JOURNAL_COMMIT) == 0)
+			committed = ftello(fp);
+
+	return committed;
+}
+
+/**
+ * Looks up a directory by its path, and creates it (and its parents)
+ * if it does not exist.
+ *
+ * @return the directory, or NULL if the path is malformed
+ */
+static struct directory *
+db_journal_make_directory(struct directory *root, const char *path)
+{
+	struct directory *directory = root;
+	const char *p = path;
+
+	while (*p != 0) {
+		const char *slash = strchr(p, '/');
+		size_t length = slash != NULL
+			? (size_t)(slash - path)
+			: strlen(path);
+		char *child_path = g_strndup(path, length);
+		const char *name = child_path + (p - path);
+		struct directory *child;
+
+		if (*name == 0) {
+			g_free(child_path);
+			return NULL;
+		}
+
+		child = directory_get_child(directory, name);
+		if (child == NULL)
+			child = directory_new_child(directory, child_path);
+
+		g_free(child_path);
+		directory = child;
+
+		if (slash == NULL)
+			break;
+
+		p = slash + 1;
+	}
+
+	return directory;
+}
+
+static bool
+db_journal_replay_song(FILE *fp, struct directory *directory,
+		       const char *name, GString *buffer, GError **error_r)
+{
+	struct song *song, *existing;
+
+	song = song_load(fp, directory, name, buffer, error_r);
+	if (song == NULL)
+		return false;
+
+	existing = songvec_find(&directory->songs, song->uri);
+	if (existing != NULL) {
+		songvec_delete(&directory->songs, existing);
+		song_free(existing);
+	}
+
+	songvec_add(&directory->songs, song);
+	return true;
+}
+
+static void
+db_journal_replay_delete_song(struct directory *directory, const char *name)
+{
+	struct song *song = songvec_find(&directory->songs, name);
+	if (song != NULL) {
+		songvec_delete(&directory->songs, song);
+		song_free(song);
+	}
+}
+
+static void
+db_journal_replay_delete_directory(struct directory *directory,
+				   const char *name)
+{
+	struct directory *child = directory_get_child(directory, name);
+	if (child != NULL) {
+		dirvec_delete(&directory->children, child);
+		directory_free(child);
+	}
+}
+
+/**
+ * Applies all records up to the specified offset.
+ */
+static bool
+db_journal_replay(FILE *fp, struct directory *root, off_t committed,
+		  GString *buffer, GError **error_r)
+{
+	struct directory *directory = root;
+	char *line;
+
+	/* skip the header */
+	if (read_text_line(fp, buffer) == NULL) {
+		g_set_error(error_r, db_journal_quark(), 0,
+			    "Unexpected end of file");
+		return false;
+	}
+
+	while (ftello(fp) < committed &&
+	       (line = read_text_line(fp, buffer)) != NULL) {
+		if (g_str_has_prefix(line, JOURNAL_DIRECTORY)) {
+			directory = db_journal_make_directory(root,
+							      line + sizeof(JOURNAL_DIRECTORY) - 1);
+			if (directory == NULL) {
+				g_set_error(error_r, db_journal_quark(), 0,
+					    "Malformed line: %s", line);
+				return false;
+			}
+		} else if (g_str_has_prefix(line, JOURNAL_MTIME)) {
+			directory->mtime =
+				g_ascii_strtoull(line + sizeof(JOURNAL_MTIME) - 1,
+						 NULL, 10);
+		} else if (g_str_has_prefix(line, SONG_BEGIN)) {
+			/* duplicate the name, because song_load()
+			   will overwrite the buffer */
+			char *name = g_strdup(line + sizeof(SONG_BEGIN) - 1);
+			bool success = db_journal_replay_song(fp, directory,
+							      name, buffer,
+							      error_r);
+			g_free(name);
+			if (!success)
+				return false;
+		} else if (g_str_has_prefix(line, PLAYLIST_META_BEGIN)) {
+			char *name = g_strdup(line + sizeof(PLAYLIST_META_BEGIN) - 1);
+			bool success =
+				playlist_metadata_load(fp, &directory->playlists,
+						       name, buffer, error_r);
+			g_free(name);
+			if (!success)
+				return false;
+		} else if (g_str_has_prefix(line, JOURNAL_DELETE_SONG)) {
+			db_journal_replay_delete_song(directory,
+						      line + sizeof(JOURNAL_DELETE_SONG) - 1);
+		} else if (g_str_has_prefix(line, JOURNAL_DELETE_DIRECTORY)) {
+			db_journal_replay_delete_directory(directory,
+							   line + sizeof(JOURNAL_DELETE_DIRECTORY) - 1);
+		} else if (g_str_has_prefix(line, JOURNAL_DELETE_PLAYLIST)) {
+			playlist_vector_remove(&directory->playlists,
+					       line + sizeof(JOURNAL_DELETE_PLAYLIST) - 1);
+		} else if (strcmp(line, JOURNAL_COMMIT) != 0) {
+			g_set_error(error_r, db_journal_quark(), 0,
+				    "Malformed line: %s", line);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+time_t
+db_journal_get_mtime(void)
+{
+	return journal_mtime;
+}
+
+bool
+db_journal_load(struct directory *root, off_t db_size, GError **error_r)
+{
+	FILE *fp;
+	GString *buffer;
+	off_t committed;
+	time_t mtime = 0;
+	bool success;
+
+	assert(journal_path != NULL);
+	assert(journal_file == NULL);
+
+	fp = fopen(journal_path, "r");
+	if (fp == NULL) {
+		if (errno != ENOENT) {
+			g_set_error(error_r, db_journal_quark(), errno,
+				    "Failed to open %s: %s",
+				    journal_path, g_strerror(errno));
+			return false;
+		}
+
+		db_journal_activate(0, db_size);
+		return true;
+	}
+
+	buffer = g_string_sized_new(1024);
+
+	committed = db_journal_scan(fp, buffer, error_r);
+	if (committed < 0) {
+		fclose(fp);
+		g_string_free(buffer, true);
+		return false;
+	}
+
+	if (committed > 0) {
+		struct stat st;
+
+		g_debug("replaying %lu bytes", (unsigned long)committed);
+
+		if (fstat(fileno(fp), &st) == 0)
+			mtime = st.st_mtime;
+
+		rewind(fp);
+		success = db_journal_replay(fp, root, committed,
+					    buffer, error_r);
+	} else
+		success = true;
+
+	fclose(fp);
+	g_string_free(buffer, true);
+
+	if (!success)
+		return false;
+
+	if (committed > 0) {
+		/* the journal may have added directories and songs
+		   in any order, and left empty directories */
+		directory_prune_empty(root);
+		directory_sort(root);
+	}
+
+	db_journal_activate(committed, db_size);
+	journal_mtime = mtime;
+	return true;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The database journal is an append-only text file next to the
+ * database file which records the changes made by the update thread
+ * since the database file was written: songs added, modified and
+ * removed, directories removed, playlists and directory modification
+ * times.  Small updates append one batch to the journal instead of
+ * rewriting the whole database file; db_load() replays the journal
+ * after loading the database file.  When the journal becomes too
+ * large, the update thread writes a new database file ("compaction")
+ * and deletes the journal.
+ *
+ * Each batch ends with a "commit" line, and is flushed to the disk
+ * with fsync().  Batches which were not committed (because MPD
+ * crashed while writing them) are ignored and truncated.  Replaying
+ * a batch is idempotent, so a journal which survives a compaction
+ * (because MPD crashed before deleting it) does no harm.
+ *
+ * The recording functions must only be called by the update thread.
+ */
+
+#ifndef MPD_DB_JOURNAL_H
+#define MPD_DB_JOURNAL_H
+
+#include <glib.h>
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/time.h>
+
+struct directory;
+struct song;
+
+/**
+ * @param db_path the path of the database file; the journal is
+ * stored in the same directory, with the suffix ".journal"
+ * @param enabled false if the journal is disabled; all changes are
+ * then saved by writing the whole database file
+ */
+void
+db_journal_init(const char *db_path, bool enabled);
+
+void
+db_journal_finish(void);
+
+/**
+ * Replays the committed batches of the journal file on the directory
+ * tree which was just loaded from the database file, and enables
+ * recording new changes.  It is not an error if the journal file
+ * does not exist.
+ *
+ * @param db_size the size of the database file; it determines how
+ * large the journal may grow before it is compacted
+ * @param error_r location to store the error occuring, or NULL to
+ * ignore errors
+ * @return true on success
+ */
+bool
+db_journal_load(struct directory *root, off_t db_size, GError **error_r);
+
+/**
+ * Returns the time of the last commit found by db_journal_load(), or
+ * 0 if the journal was empty.
+ */
+time_t
+db_journal_get_mtime(void);
+
+/**
+ * Deletes the journal file, after the whole database has been
+ * written to the database file, and enables recording new changes.
+ */
+void
+db_journal_reset(off_t db_size);
+
+/**
+ * Records a song which was added or modified.
+ */
+void
+db_journal_song(const struct song *song);
+
+/**
+ * Records a song which is about to be removed.
+ */
+void
+db_journal_delete_song(const struct song *song);
+
+/**
+ * Records a directory which is about to be removed, including all of
+ * its contents.
+ */
+void
+db_journal_delete_directory(const struct directory *directory);
+
+/**
+ * Records the new modification time of a directory.
+ */
+void
+db_journal_directory_mtime(const struct directory *directory);
+
+/**
+ * Records a playlist file which was added or modified.
+ */
+void
+db_journal_playlist(const struct directory *directory, const char *name,
+		    time_t mtime);
+
+/**
+ * Records a playlist file which was removed.
+ */
+void
+db_journal_delete_playlist(const struct directory *directory,
+			   const char *name);
+
+/**
+ * Have changes been recorded since the last commit?
+ */
+bool
+db_journal_pending(void);
+
+/**
+ * Must the recorded changes be saved by writing the whole database
+ * file, instead of committing them to the journal?  This is the case
+ * if the journal is disabled, if it has become too large, or if
+ * writing it has failed.
+ */
+bool
+db_journal_full(void);
+
+/**
+ * Commits the recorded changes to the journal file.
+ *
+ * @param error_r location to store the error occuring, or NULL to
+ * ignore errors
+ * @return true on success
+ */
+bool
+db_journal_commit(GError **error_r);
+
+#endif
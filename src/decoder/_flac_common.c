@@ -197,6 +197,52 @@ flac_got_first_frame(struct flac_data *data, const FLAC__FrameHeader *header)
 	return true;
 }
 
+/**
+ * Converts the FLAC samples directly into the music pipe, as long as
+ * decoder_data_begin() allows it.
+ *
+ * @param position_r the number of frames which have been submitted
+ * is returned here
+ */
+static enum decoder_command
+flac_write_direct(struct flac_data *data, const FLAC__Frame *frame,
+		  const FLAC__int32 *const buf[], unsigned bit_rate,
+		  unsigned *position_r)
+{
+	unsigned position = 0;
+
+	while (position < frame->header.blocksize) {
+		enum decoder_command cmd;
+		void *dest;
+		size_t max_length;
+		unsigned end;
+
+		dest = decoder_data_begin(data->decoder, data->input_stream,
+					  bit_rate, &max_length);
+		if (dest == NULL)
+			break;
+
+		end = position + max_length / data->frame_size;
+		if (end > frame->header.blocksize)
+			end = frame->header.blocksize;
+
+		flac_convert(dest, frame->header.channels,
+			     data->audio_format.format, buf,
+			     position, end);
+
+		cmd = decoder_data_end(data->decoder,
+				       (end - position) * data->frame_size);
+		position = end;
+		if (cmd != DECODE_COMMAND_NONE) {
+			*position_r = position;
+			return cmd;
+		}
+	}
+
+	*position_r = position;
+	return decoder_get_command(data->decoder);
+}
+
 FLAC__StreamDecoderWriteStatus
 flac_common_write(struct flac_data *data, const FLAC__Frame * frame,
 		  const FLAC__int32 *const buf[],
@@ -205,26 +251,34 @@ flac_common_write(struct flac_data *data, const FLAC__Frame * frame,
 	enum decoder_command cmd;
 	void *buffer;
 	unsigned bit_rate;
+	unsigned position = 0;
 
 	if (!data->initialized && !flac_got_first_frame(data, &frame->header))
 		return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 
-	size_t buffer_size = frame->header.blocksize * data->frame_size;
-	buffer = pcm_buffer_get(&data->buffer, buffer_size);
-
-	flac_convert(buffer, frame->header.channels,
-		     data->audio_format.format, buf,
-		     0, frame->header.blocksize);
-
 	if (nbytes > 0)
 		bit_rate = nbytes * 8 * frame->header.sample_rate /
 			(1000 * frame->header.blocksize);
 	else
 		bit_rate = 0;
 
-	cmd = decoder_data(data->decoder, data->input_stream,
-			   buffer, buffer_size,
-			   bit_rate);
+	cmd = flac_write_direct(data, frame, buf, bit_rate, &position);
+	if (cmd == DECODE_COMMAND_NONE && position < frame->header.blocksize) {
+		/* the samples need to be converted: copy the rest of
+		   the block via decoder_data() */
+		size_t buffer_size = (frame->header.blocksize - position) *
+			data->frame_size;
+		buffer = pcm_buffer_get(&data->buffer, buffer_size);
+
+		flac_convert(buffer, frame->header.channels,
+			     data->audio_format.format, buf,
+			     position, frame->header.blocksize);
+
+		cmd = decoder_data(data->decoder, data->input_stream,
+				   buffer, buffer_size,
+				   bit_rate);
+	}
+
 	data->next_frame += frame->header.blocksize;
 	switch (cmd) {
 	case DECODE_COMMAND_NONE:
@@ -140,6 +140,45 @@ mpd_ffmpeg_stream_close(struct mpd_ffmpeg_stream *stream)
 	g_free(stream);
 }
 
+/**
+ * Serializes the libavcodec calls which open and close codecs; they
+ * are not thread safe, and the decoder thread and the update_pool
+ * workers (loading tags) may use this plugin at the same time.
+ */
+static GStaticMutex ffmpeg_codec_mutex = G_STATIC_MUTEX_INIT;
+
+static int
+mpd_ffmpeg_find_stream_info(AVFormatContext *format_context)
+{
+	int ret;
+
+	g_static_mutex_lock(&ffmpeg_codec_mutex);
+	ret = av_find_stream_info(format_context);
+	g_static_mutex_unlock(&ffmpeg_codec_mutex);
+
+	return ret;
+}
+
+static int
+mpd_ffmpeg_codec_open(AVCodecContext *codec_context, AVCodec *codec)
+{
+	int ret;
+
+	g_static_mutex_lock(&ffmpeg_codec_mutex);
+	ret = avcodec_open(codec_context, codec);
+	g_static_mutex_unlock(&ffmpeg_codec_mutex);
+
+	return ret;
+}
+
+static void
+mpd_ffmpeg_codec_close(AVCodecContext *codec_context)
+{
+	g_static_mutex_lock(&ffmpeg_codec_mutex);
+	avcodec_close(codec_context);
+	g_static_mutex_unlock(&ffmpeg_codec_mutex);
+}
+
 static bool
 ffmpeg_init(G_GNUC_UNUSED const struct config_param *param)
 {
@@ -231,13 +270,19 @@ static enum sample_format
 ffmpeg_sample_format(G_GNUC_UNUSED const AVCodecContext *codec_context)
 {
 #if LIBAVCODEC_VERSION_INT >= ((51<<16)+(41<<8)+0)
-	int bits = (uint8_t) av_get_bits_per_sample_format(codec_context->sample_fmt);
-
 	/* XXX implement & test other sample formats */
 
-	switch (bits) {
-	case 16:
+	switch (codec_context->sample_fmt) {
+	case SAMPLE_FMT_S16:
 		return SAMPLE_FORMAT_S16;
+
+	case SAMPLE_FMT_FLT:
+		/* pass float samples unmodified, instead of letting
+		   MPD quantize them to 16 bit */
+		return SAMPLE_FORMAT_FLOAT;
+
+	default:
+		break;
 	}
 
 	return SAMPLE_FORMAT_UNDEFINED;
@@ -310,7 +355,7 @@ ffmpeg_decode(struct decoder *decoder, struct input_stream *input)
 		return;
 	}
 
-	if (av_find_stream_info(format_context)<0) {
+	if (mpd_ffmpeg_find_stream_info(format_context)<0) {
 		g_warning("Couldn't find stream info\n");
 		av_close_input_stream(format_context);
 		mpd_ffmpeg_stream_close(stream);
@@ -338,7 +383,7 @@ ffmpeg_decode(struct decoder *decoder, struct input_stream *input)
 		return;
 	}
 
-	if (avcodec_open(codec_context, codec)<0) {
+	if (mpd_ffmpeg_codec_open(codec_context, codec)<0) {
 		g_warning("Could not open codec\n");
 		av_close_input_stream(format_context);
 		mpd_ffmpeg_stream_close(stream);
@@ -353,7 +398,7 @@ ffmpeg_decode(struct decoder *decoder, struct input_stream *input)
 				       codec_context->channels, &error)) {
 		g_warning("%s", error->message);
 		g_error_free(error);
-		avcodec_close(codec_context);
+		mpd_ffmpeg_codec_close(codec_context);
 		av_close_input_stream(format_context);
 		mpd_ffmpeg_stream_close(stream);
 		return;
@@ -393,7 +438,7 @@ ffmpeg_decode(struct decoder *decoder, struct input_stream *input)
 		}
 	} while (cmd != DECODE_COMMAND_STOP);
 
-	avcodec_close(codec_context);
+	mpd_ffmpeg_codec_close(codec_context);
 	av_close_input_stream(format_context);
 	mpd_ffmpeg_stream_close(stream);
 }
@@ -457,7 +502,7 @@ ffmpeg_stream_tag(struct input_stream *is)
 		return NULL;
 	}
 
-	if (av_find_stream_info(f) < 0) {
+	if (mpd_ffmpeg_find_stream_info(f) < 0) {
 		av_close_input_stream(f);
 		mpd_ffmpeg_stream_close(stream);
 		return NULL;
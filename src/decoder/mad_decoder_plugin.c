@@ -966,16 +966,50 @@ mp3_update_timer_next_frame(struct mp3_data *data)
 }
 
 /**
- * Sends the synthesized current frame via decoder_data().
+ * Sends the synthesized current frame to the music pipe, either
+ * directly via decoder_data_begin() or via decoder_data().
  */
 static enum decoder_command
 mp3_send_pcm(struct mp3_data *data, unsigned i, unsigned pcm_length)
 {
+	const unsigned num_channels = MAD_NCHANNELS(&(data->frame).header);
 	unsigned max_samples;
 
+	/* try to synthesize directly into the music pipe */
+
+	while (i < pcm_length) {
+		enum decoder_command cmd;
+		int32_t *dest;
+		size_t max_length;
+		unsigned int num_samples = pcm_length - i;
+
+		dest = decoder_data_begin(data->decoder, data->input_stream,
+					  data->bit_rate / 1000, &max_length);
+		if (dest == NULL) {
+			cmd = decoder_get_command(data->decoder);
+			if (cmd != DECODE_COMMAND_NONE)
+				return cmd;
+
+			/* conversion is needed, use decoder_data() */
+			break;
+		}
+
+		max_samples = max_length / sizeof(*dest) / num_channels;
+		if (num_samples > max_samples)
+			num_samples = max_samples;
+
+		mad_fixed_to_24_buffer(dest, &data->synth,
+				       i, i + num_samples, num_channels);
+		i += num_samples;
+
+		cmd = decoder_data_end(data->decoder, sizeof(*dest) *
+				       num_samples * num_channels);
+		if (cmd != DECODE_COMMAND_NONE)
+			return cmd;
+	}
+
 	max_samples = sizeof(data->output_buffer) /
-		sizeof(data->output_buffer[0]) /
-		MAD_NCHANNELS(&(data->frame).header);
+		sizeof(data->output_buffer[0]) / num_channels;
 
 	while (i < pcm_length) {
 		enum decoder_command cmd;
@@ -987,9 +1021,8 @@ mp3_send_pcm(struct mp3_data *data, unsigned i, unsigned pcm_length)
 
 		mad_fixed_to_24_buffer(data->output_buffer,
 				       &data->synth,
-				       i - num_samples, i,
-				       MAD_NCHANNELS(&(data->frame).header));
-		num_samples *= MAD_NCHANNELS(&(data->frame).header);
+				       i - num_samples, i, num_channels);
+		num_samples *= num_channels;
 
 		cmd = decoder_data(data->decoder, data->input_stream,
 				   data->output_buffer,
@@ -60,6 +60,13 @@ mpd_mpg123_open(mpg123_handle *handle, const char *path_fs,
 	int error;
 	int channels, encoding;
 	long rate;
+	enum sample_format sample_format;
+
+	/* libmpg123 synthesizes floating point samples internally;
+	   ask for them instead of 16 bit integers to avoid the
+	   quantization.  This fails if libmpg123 was built with a
+	   fixed point decoder, and then we get 16 bit samples. */
+	mpg123_param(handle, MPG123_ADD_FLAGS, MPG123_FORCE_FLOAT, 0);
 
 	/* mpg123_open() wants a writable string :-( */
 	path_dup = g_strdup(path_fs);
@@ -81,13 +88,23 @@ mpd_mpg123_open(mpg123_handle *handle, const char *path_fs,
 		return false;
 	}
 
-	if (encoding != MPG123_ENC_SIGNED_16) {
+	switch (encoding) {
+	case MPG123_ENC_SIGNED_16:
+		sample_format = SAMPLE_FORMAT_S16;
+		break;
+
+	case MPG123_ENC_FLOAT_32:
+		sample_format = SAMPLE_FORMAT_FLOAT;
+		break;
+
+	default:
 		/* other formats not yet implemented */
-		g_warning("expected MPG123_ENC_SIGNED_16, got %d", encoding);
+		g_warning("expected MPG123_ENC_SIGNED_16 or "
+			  "MPG123_ENC_FLOAT_32, got %d", encoding);
 		return false;
 	}
 
-	if (!audio_format_init_checked(audio_format, rate, SAMPLE_FORMAT_S16,
+	if (!audio_format_init_checked(audio_format, rate, sample_format,
 				       channels, &gerror)) {
 		g_warning("%s", gerror->message);
 		g_error_free(gerror);
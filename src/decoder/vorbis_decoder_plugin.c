@@ -49,11 +49,13 @@
 #define G_LOG_DOMAIN "vorbis"
 #define OGG_CHUNK_SIZE 4096
 
+#ifdef HAVE_TREMOR
 #if G_BYTE_ORDER == G_BIG_ENDIAN
 #define OGG_DECODE_USE_BIGENDIAN	1
 #else
 #define OGG_DECODE_USE_BIGENDIAN	0
 #endif
+#endif
 
 struct vorbis_input_stream {
 	struct decoder *decoder;
@@ -266,6 +268,25 @@ vorbis_send_comments(struct decoder *decoder, struct input_stream *is,
 	tag_free(tag);
 }
 
+#ifndef HAVE_TREMOR
+/**
+ * Interleaves the per-channel float buffers returned by
+ * ov_read_float() into one buffer.
+ */
+static void
+vorbis_interleave(float *dest, const float *const*src,
+		  unsigned nframes, unsigned channels)
+{
+	for (unsigned c = 0; c < channels; ++c) {
+		const float *s = src[c];
+		float *d = dest + c;
+
+		for (unsigned i = 0; i < nframes; ++i, d += channels)
+			*d = s[i];
+	}
+}
+#endif
+
 /* public */
 static void
 vorbis_stream_decode(struct decoder *decoder,
@@ -279,7 +300,12 @@ vorbis_stream_decode(struct decoder *decoder,
 	int current_section;
 	int prev_section = -1;
 	long ret;
+#ifdef HAVE_TREMOR
 	char chunk[OGG_CHUNK_SIZE];
+#else
+	float chunk[OGG_CHUNK_SIZE / sizeof(float)];
+	float **per_channel;
+#endif
 	long bitRate = 0;
 	long test;
 	const vorbis_info *vi;
@@ -302,7 +328,11 @@ vorbis_stream_decode(struct decoder *decoder,
 	}
 
 	if (!audio_format_init_checked(&audio_format, vi->rate,
+#ifdef HAVE_TREMOR
 				       SAMPLE_FORMAT_S16,
+#else
+				       SAMPLE_FORMAT_FLOAT,
+#endif
 				       vi->channels, &error)) {
 		g_warning("%s", error->message);
 		g_error_free(error);
@@ -324,8 +354,14 @@ vorbis_stream_decode(struct decoder *decoder,
 				decoder_seek_error(decoder);
 		}
 
+#ifdef HAVE_TREMOR
 		ret = ov_read(&vf, chunk, sizeof(chunk),
 			      OGG_DECODE_USE_BIGENDIAN, 2, 1, &current_section);
+#else
+		ret = ov_read_float(&vf, &per_channel,
+				    G_N_ELEMENTS(chunk) / audio_format.channels,
+				    &current_section);
+#endif
 		if (ret == OV_HOLE) /* bad packet */
 			ret = 0;
 		else if (ret <= 0)
@@ -359,6 +395,17 @@ vorbis_stream_decode(struct decoder *decoder,
 			prev_section = current_section;
 		}
 
+#ifndef HAVE_TREMOR
+		/* libvorbis decodes to float natively; ov_read_float()
+		   returns the number of frames in per-channel buffers */
+		if (ret > 0) {
+			vorbis_interleave(chunk,
+					  (const float *const*)per_channel,
+					  ret, audio_format.channels);
+			ret *= audio_format_frame_size(&audio_format);
+		}
+#endif
+
 		if ((test = ov_bitrate_instant(&vf)) > 0)
 			bitRate = test / 1000;
 
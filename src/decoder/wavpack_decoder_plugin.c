@@ -108,19 +108,14 @@ format_samples_int(int bytes_per_sample, void *buffer, uint32_t count)
 }
 
 /*
- * This function converts floating point sample data to 24-bit integer.
+ * No conversion necessary, passes floating point samples as they are.
  */
 static void
-format_samples_float(G_GNUC_UNUSED int bytes_per_sample, void *buffer,
-		     uint32_t count)
+format_samples_nop(G_GNUC_UNUSED int bytes_per_sample,
+		   G_GNUC_UNUSED void *buffer,
+		   G_GNUC_UNUSED uint32_t count)
 {
-	int32_t *dst = buffer;
-	float *src = buffer;
-	assert_static(sizeof(*dst) <= sizeof(*src));
-
-	while (count--) {
-		*dst++ = (int32_t)(*src++ + 0.5f);
-	}
+	/* do nothing */
 }
 
 /**
@@ -130,7 +125,7 @@ static enum sample_format
 wavpack_bits_to_sample_format(bool is_float, int bytes_per_sample)
 {
 	if (is_float)
-		return SAMPLE_FORMAT_S24_P32;
+		return SAMPLE_FORMAT_FLOAT;
 
 	switch (bytes_per_sample) {
 	case 1:
@@ -182,7 +177,7 @@ wavpack_decode(struct decoder *decoder, WavpackContext *wpc, bool can_seek)
 	}
 
 	if ((WavpackGetMode(wpc) & MODE_FLOAT) == MODE_FLOAT) {
-		format_samples = format_samples_float;
+		format_samples = format_samples_nop;
 	} else {
 		format_samples = format_samples_int;
 	}
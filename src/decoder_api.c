@@ -254,6 +254,107 @@ update_stream_tag(struct decoder *decoder, struct input_stream *is)
 	return true;
 }
 
+/**
+ * Submits a new stream tag to the music pipe, if there is one.  The
+ * tag is merged with the last tag received from the decoder plugin.
+ */
+static enum decoder_command
+decoder_send_stream_tag(struct decoder *decoder, struct input_stream *is)
+{
+	enum decoder_command cmd;
+
+	if (!update_stream_tag(decoder, is))
+		return DECODE_COMMAND_NONE;
+
+	if (decoder->decoder_tag != NULL) {
+		/* merge with tag from decoder plugin */
+		struct tag *tag;
+
+		tag = tag_merge(decoder->decoder_tag,
+				decoder->stream_tag);
+		cmd = do_send_tag(decoder, is, tag);
+		tag_free(tag);
+	} else
+		/* send only the stream tag */
+		cmd = do_send_tag(decoder, is, decoder->stream_tag);
+
+	return cmd;
+}
+
+/**
+ * Returns a writable buffer at the end of the current chunk, and
+ * allocates a new chunk if there is none or if the current one is
+ * full.
+ *
+ * @return the buffer, or NULL if a decoder command is pending
+ */
+static void *
+decoder_chunk_write(struct decoder *decoder, struct input_stream *is,
+		    uint16_t kbit_rate, size_t *max_length_r)
+{
+	struct decoder_control *dc = decoder->dc;
+
+	while (true) {
+		struct music_chunk *chunk;
+		void *dest;
+
+		chunk = decoder_get_chunk(decoder, is);
+		if (chunk == NULL) {
+			assert(dc->command != DECODE_COMMAND_NONE);
+			return NULL;
+		}
+
+		dest = music_chunk_write(chunk, &dc->out_audio_format,
+					 decoder->timestamp -
+					 dc->song->start_ms / 1000.0,
+					 kbit_rate, max_length_r);
+		if (dest != NULL) {
+			assert(*max_length_r > 0);
+			return dest;
+		}
+
+		/* the chunk is full, flush it */
+		decoder_flush_chunk(decoder);
+		player_lock_signal();
+	}
+}
+
+/**
+ * Expands the current chunk after data has been written to the
+ * buffer returned by decoder_chunk_write(), flushes it if it is full,
+ * and advances the time stamp.
+ *
+ * @return DECODE_COMMAND_STOP if the end of the song range has been
+ * reached, DECODE_COMMAND_NONE otherwise
+ */
+static enum decoder_command
+decoder_chunk_expand(struct decoder *decoder, size_t nbytes)
+{
+	struct decoder_control *dc = decoder->dc;
+	bool full;
+
+	assert(decoder->chunk != NULL);
+
+	full = music_chunk_expand(decoder->chunk, &dc->out_audio_format,
+				  nbytes);
+	if (full) {
+		/* the chunk is full, flush it */
+		decoder_flush_chunk(decoder);
+		player_lock_signal();
+	}
+
+	decoder->timestamp += (double)nbytes /
+		audio_format_time_to_size(&dc->out_audio_format);
+
+	if (dc->song->end_ms > 0 &&
+	    decoder->timestamp >= dc->song->end_ms / 1000.0)
+		/* the end of this range has been reached:
+		   stop decoding */
+		return DECODE_COMMAND_STOP;
+
+	return DECODE_COMMAND_NONE;
+}
+
 enum decoder_command
 decoder_data(struct decoder *decoder,
 	     struct input_stream *is,
@@ -279,22 +380,9 @@ decoder_data(struct decoder *decoder,
 
 	/* send stream tags */
 
-	if (update_stream_tag(decoder, is)) {
-		if (decoder->decoder_tag != NULL) {
-			/* merge with tag from decoder plugin */
-			struct tag *tag;
-
-			tag = tag_merge(decoder->decoder_tag,
-					decoder->stream_tag);
-			cmd = do_send_tag(decoder, is, tag);
-			tag_free(tag);
-		} else
-			/* send only the stream tag */
-			cmd = do_send_tag(decoder, is, decoder->stream_tag);
-
-		if (cmd != DECODE_COMMAND_NONE)
-			return cmd;
-	}
+	cmd = decoder_send_stream_tag(decoder, is);
+	if (cmd != DECODE_COMMAND_NONE)
+		return cmd;
 
 	if (!audio_format_equals(&dc->in_audio_format, &dc->out_audio_format)) {
 		data = pcm_convert(&decoder->conv_state,
@@ -311,29 +399,12 @@ decoder_data(struct decoder *decoder,
 	}
 
 	while (length > 0) {
-		struct music_chunk *chunk;
 		char *dest;
 		size_t nbytes;
-		bool full;
 
-		chunk = decoder_get_chunk(decoder, is);
-		if (chunk == NULL) {
-			assert(dc->command != DECODE_COMMAND_NONE);
+		dest = decoder_chunk_write(decoder, is, kbit_rate, &nbytes);
+		if (dest == NULL)
 			return dc->command;
-		}
-
-		dest = music_chunk_write(chunk, &dc->out_audio_format,
-					 decoder->timestamp -
-					 dc->song->start_ms / 1000.0,
-					 kbit_rate, &nbytes);
-		if (dest == NULL) {
-			/* the chunk is full, flush it */
-			decoder_flush_chunk(decoder);
-			player_lock_signal();
-			continue;
-		}
-
-		assert(nbytes > 0);
 
 		if (nbytes > length)
 			nbytes = length;
@@ -344,29 +415,63 @@ decoder_data(struct decoder *decoder,
 
 		/* expand the music pipe chunk */
 
-		full = music_chunk_expand(chunk, &dc->out_audio_format, nbytes);
-		if (full) {
-			/* the chunk is full, flush it */
-			decoder_flush_chunk(decoder);
-			player_lock_signal();
-		}
+		cmd = decoder_chunk_expand(decoder, nbytes);
+		if (cmd != DECODE_COMMAND_NONE)
+			return cmd;
 
 		data += nbytes;
 		length -= nbytes;
-
-		decoder->timestamp += (double)nbytes /
-			audio_format_time_to_size(&dc->out_audio_format);
-
-		if (dc->song->end_ms > 0 &&
-		    decoder->timestamp >= dc->song->end_ms / 1000.0)
-			/* the end of this range has been reached:
-			   stop decoding */
-			return DECODE_COMMAND_STOP;
 	}
 
 	return DECODE_COMMAND_NONE;
 }
 
+void *
+decoder_data_begin(struct decoder *decoder, struct input_stream *is,
+		   uint16_t kbit_rate, size_t *max_length_r)
+{
+	struct decoder_control *dc = decoder->dc;
+	enum decoder_command cmd;
+
+	assert(dc->state == DECODE_STATE_DECODE);
+	assert(dc->pipe != NULL);
+	assert(max_length_r != NULL);
+
+	if (!audio_format_equals(&dc->in_audio_format, &dc->out_audio_format))
+		/* the data must be converted; the plugin has to
+		   use decoder_data() */
+		return NULL;
+
+	decoder_lock(dc);
+	cmd = dc->command;
+	decoder_unlock(dc);
+
+	if (cmd == DECODE_COMMAND_STOP || cmd == DECODE_COMMAND_SEEK)
+		return NULL;
+
+	if (decoder_send_stream_tag(decoder, is) != DECODE_COMMAND_NONE)
+		return NULL;
+
+	return decoder_chunk_write(decoder, is, kbit_rate, max_length_r);
+}
+
+enum decoder_command
+decoder_data_end(struct decoder *decoder, size_t length)
+{
+	G_GNUC_UNUSED const struct decoder_control *dc = decoder->dc;
+
+	assert(dc->state == DECODE_STATE_DECODE);
+	assert(decoder->chunk != NULL);
+	assert(audio_format_equals(&dc->in_audio_format,
+				   &dc->out_audio_format));
+	assert(length % audio_format_frame_size(&dc->out_audio_format) == 0);
+
+	if (length == 0)
+		return DECODE_COMMAND_NONE;
+
+	return decoder_chunk_expand(decoder, length);
+}
+
 enum decoder_command
 decoder_tag(G_GNUC_UNUSED struct decoder *decoder, struct input_stream *is,
 	    const struct tag *tag)
@@ -123,14 +123,60 @@ decoder_timestamp(struct decoder *decoder, double t);
  * for the player
  * @param data the source buffer
  * @param length the number of bytes in the buffer
- * @return the current command, or DECODE_COMMAND_NONE if there is no
- * command pending
+ * @return DECODE_COMMAND_STOP or DECODE_COMMAND_SEEK if that command
+ * was pending before or while the data was submitted (the rest of
+ * the data is then discarded); DECODE_COMMAND_STOP if the end of the
+ * song range was reached or the PCM conversion failed;
+ * DECODE_COMMAND_NONE otherwise.  A command which arrives after the
+ * data was submitted is reported by decoder_get_command() or by the
+ * next call.
  */
 enum decoder_command
 decoder_data(struct decoder *decoder, struct input_stream *is,
 	     const void *data, size_t length,
 	     uint16_t kbit_rate);
 
+/**
+ * Returns a buffer inside the music pipe where the decoder plugin may
+ * write decoded PCM data directly, saving the copy done by
+ * decoder_data().  After writing, call decoder_data_end() with the
+ * number of bytes actually written.  No other decoder API function
+ * may be called in between.
+ *
+ * This is only possible if the audio format passed to
+ * decoder_initialized() does not need to be converted.
+ *
+ * @param decoder the decoder object
+ * @param is an input stream which is buffering while we are waiting
+ * for the player
+ * @param kbit_rate the current bit rate of the source file
+ * @param max_length_r the size of the buffer (a multiple of the
+ * frame size) is returned here
+ * @return a writable buffer, or NULL if the plugin must use
+ * decoder_data() instead; in that case, decoder_get_command() tells
+ * whether a command is pending, and if not, the PCM data needs to be
+ * converted
+ */
+void *
+decoder_data_begin(struct decoder *decoder, struct input_stream *is,
+		   uint16_t kbit_rate, size_t *max_length_r);
+
+/**
+ * Finishes a decoder_data_begin() call: commits the specified number
+ * of bytes to the music pipe.
+ *
+ * @param decoder the decoder object
+ * @param length the number of bytes which were written; must be a
+ * multiple of the frame size, and must not be larger than the value
+ * returned by decoder_data_begin()
+ * @return DECODE_COMMAND_STOP if the end of the song range has been
+ * reached, DECODE_COMMAND_NONE otherwise; this does not report
+ * pending commands, use decoder_get_command() to check for SEEK or
+ * STOP
+ */
+enum decoder_command
+decoder_data_end(struct decoder *decoder, size_t length);
+
 /**
  * This function is called by the decoder plugin when it has
  * successfully decoded a tag.
@@ -139,8 +185,8 @@ decoder_data(struct decoder *decoder, struct input_stream *is,
  * @param is an input stream which is buffering while we are waiting
  * for the player
  * @param tag the tag to send
- * @return the current command, or DECODE_COMMAND_NONE if there is no
- * command pending
+ * @return the pending command if it prevented sending the tag,
+ * DECODE_COMMAND_NONE otherwise
  */
 enum decoder_command
 decoder_tag(struct decoder *decoder, struct input_stream *is,
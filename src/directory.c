@@ -28,6 +28,17 @@
 #include <string.h>
 #include <stdlib.h>
 
+/**
+ * The size of the allocation for a directory with the specified path
+ * length.  Directories are allocated with GSlice, just like songs.
+ */
+static inline size_t
+directory_alloc_size(size_t path_length)
+{
+	return sizeof(struct directory) -
+		sizeof(((struct directory *)NULL)->path) + path_length + 1;
+}
+
 struct directory *
 directory_new(const char *path, struct directory *parent)
 {
@@ -37,8 +48,7 @@ directory_new(const char *path, struct directory *parent)
 	assert(path != NULL);
 	assert((*path == 0) == (parent == NULL));
 
-	directory = g_malloc0(sizeof(*directory) -
-			      sizeof(directory->path) + pathlen + 1);
+	directory = g_slice_alloc0(directory_alloc_size(pathlen));
 	directory->parent = parent;
 	memcpy(directory->path, path, pathlen + 1);
 
@@ -60,7 +70,8 @@ directory_free(struct directory *directory)
 
 	dirvec_destroy(&directory->children);
 	songvec_destroy(&directory->songs);
-	g_free(directory);
+	g_slice_free1(directory_alloc_size(strlen(directory->path)),
+		      directory);
 	/* this resets last dir returned */
 	/*directory_get_path(NULL); */
 }
@@ -27,11 +27,30 @@
 #include <string.h>
 #include <stdlib.h>
 
-static GMutex *nr_lock = NULL;
-
-static size_t dv_size(const struct dirvec *dv)
+enum {
+	/**
+	 * The number of mutexes protecting dirvec objects; see
+	 * SONGVEC_NUM_LOCKS.
+	 */
+	DIRVEC_NUM_LOCKS = 32,
+
+	/**
+	 * Dirvecs with at least this number of elements get a hash
+	 * index for dirvec_find().
+	 */
+	DIRVEC_INDEX_MIN = 32,
+};
+
+static GMutex *nr_locks[DIRVEC_NUM_LOCKS];
+
+static GMutex *
+dirvec_lock(const struct dirvec *dv)
 {
-	return dv->nr * sizeof(struct directory *);
+	GMutex *mutex = nr_locks[(GPOINTER_TO_SIZE(dv) / sizeof(void *)) %
+				 DIRVEC_NUM_LOCKS];
+
+	g_mutex_lock(mutex);
+	return mutex;
 }
 
 /* Only used for sorting/searching a dirvec, not general purpose compares */
@@ -44,87 +63,158 @@ static int dirvec_cmp(const void *d1, const void *d2)
 
 void dirvec_init(void)
 {
-	g_assert(nr_lock == NULL);
-	nr_lock = g_mutex_new();
+	for (unsigned i = 0; i < G_N_ELEMENTS(nr_locks); ++i) {
+		g_assert(nr_locks[i] == NULL);
+		nr_locks[i] = g_mutex_new();
+	}
 }
 
 void dirvec_deinit(void)
 {
-	g_assert(nr_lock != NULL);
-	g_mutex_free(nr_lock);
-	nr_lock = NULL;
+	for (unsigned i = 0; i < G_N_ELEMENTS(nr_locks); ++i) {
+		g_assert(nr_locks[i] != NULL);
+		g_mutex_free(nr_locks[i]);
+		nr_locks[i] = NULL;
+	}
+}
+
+/**
+ * Grows the array geometrically; see songvec_reserve().
+ */
+static void
+dirvec_reserve(struct dirvec *dv, size_t nr)
+{
+	size_t capacity;
+
+	if (nr <= dv->capacity)
+		return;
+
+	capacity = dv->capacity > 0 ? dv->capacity : 4;
+	while (capacity < nr)
+		capacity *= 2;
+
+	dv->base = g_realloc(dv->base, capacity * sizeof(dv->base[0]));
+	dv->capacity = capacity;
+}
+
+static void
+dirvec_shrink(struct dirvec *dv)
+{
+	if (dv->nr == 0) {
+		g_free(dv->base);
+		dv->base = NULL;
+		dv->capacity = 0;
+	} else if (dv->capacity >= 16 && dv->nr <= dv->capacity / 4) {
+		dv->capacity /= 2;
+		dv->base = g_realloc(dv->base,
+				     dv->capacity * sizeof(dv->base[0]));
+	}
+}
+
+static void
+dirvec_index_build(struct dirvec *dv)
+{
+	assert(dv->index == NULL);
+
+	dv->index = g_hash_table_new(g_str_hash, g_str_equal);
+	for (size_t i = 0; i < dv->nr; ++i)
+		g_hash_table_replace(dv->index,
+				     (gpointer)directory_get_name(dv->base[i]),
+				     dv->base[i]);
 }
 
 void dirvec_sort(struct dirvec *dv)
 {
-	g_mutex_lock(nr_lock);
+	GMutex *mutex = dirvec_lock(dv);
 	qsort(dv->base, dv->nr, sizeof(struct directory *), dirvec_cmp);
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 }
 
 struct directory *dirvec_find(const struct dirvec *dv, const char *path)
 {
-	char *base;
+	const char *base;
 	int i;
 	struct directory *ret = NULL;
+	GMutex *mutex;
+
+	/* the base name of the path; unlike g_path_get_basename(),
+	   this doesn't allocate memory */
+	base = strrchr(path, '/');
+	base = base != NULL ? base + 1 : path;
 
-	base = g_path_get_basename(path);
+	mutex = dirvec_lock(dv);
+
+	if (dv->index != NULL) {
+		ret = g_hash_table_lookup(dv->index, base);
+		g_mutex_unlock(mutex);
+		return ret;
+	}
 
-	g_mutex_lock(nr_lock);
 	for (i = dv->nr; --i >= 0; )
 		if (!strcmp(directory_get_name(dv->base[i]), base)) {
 			ret = dv->base[i];
 			break;
 		}
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 
-	g_free(base);
 	return ret;
 }
 
 int dirvec_delete(struct dirvec *dv, struct directory *del)
 {
 	size_t i;
+	GMutex *mutex = dirvec_lock(dv);
 
-	g_mutex_lock(nr_lock);
 	for (i = 0; i < dv->nr; ++i) {
 		if (dv->base[i] != del)
 			continue;
 		/* we _don't_ call directory_free() here */
-		if (!--dv->nr) {
-			g_mutex_unlock(nr_lock);
-			g_free(dv->base);
-			dv->base = NULL;
-			return i;
-		} else {
-			memmove(&dv->base[i], &dv->base[i + 1],
-				(dv->nr - i) * sizeof(struct directory *));
-			dv->base = g_realloc(dv->base, dv_size(dv));
+		--dv->nr;
+		memmove(&dv->base[i], &dv->base[i + 1],
+			(dv->nr - i) * sizeof(struct directory *));
+		dirvec_shrink(dv);
+
+		if (dv->index != NULL) {
+			const char *name = directory_get_name(del);
+			if (g_hash_table_lookup(dv->index, name) == del)
+				g_hash_table_remove(dv->index, name);
 		}
 		break;
 	}
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 
 	return i;
 }
 
 void dirvec_add(struct dirvec *dv, struct directory *add)
 {
-	g_mutex_lock(nr_lock);
-	++dv->nr;
-	dv->base = g_realloc(dv->base, dv_size(dv));
-	dv->base[dv->nr - 1] = add;
-	g_mutex_unlock(nr_lock);
+	GMutex *mutex = dirvec_lock(dv);
+
+	dirvec_reserve(dv, dv->nr + 1);
+	dv->base[dv->nr++] = add;
+
+	if (dv->index != NULL)
+		g_hash_table_replace(dv->index,
+				     (gpointer)directory_get_name(add), add);
+	else if (dv->nr >= DIRVEC_INDEX_MIN)
+		dirvec_index_build(dv);
+
+	g_mutex_unlock(mutex);
 }
 
 void dirvec_destroy(struct dirvec *dv)
 {
-	g_mutex_lock(nr_lock);
+	GMutex *mutex = dirvec_lock(dv);
 	dv->nr = 0;
-	g_mutex_unlock(nr_lock);
-	if (dv->base) {
-		g_free(dv->base);
-		dv->base = NULL;
+	g_mutex_unlock(mutex);
+
+	g_free(dv->base);
+	dv->base = NULL;
+	dv->capacity = 0;
+
+	if (dv->index != NULL) {
+		g_hash_table_destroy(dv->index);
+		dv->index = NULL;
 	}
 }
 
@@ -133,21 +223,21 @@ int dirvec_for_each(const struct dirvec *dv,
 {
 	size_t i;
 	size_t prev_nr;
+	GMutex *mutex = dirvec_lock(dv);
 
-	g_mutex_lock(nr_lock);
 	for (i = 0; i < dv->nr; ) {
 		struct directory *dir = dv->base[i];
 
 		assert(dir);
 		prev_nr = dv->nr;
-		g_mutex_unlock(nr_lock);
+		g_mutex_unlock(mutex);
 		if (fn(dir, arg) < 0)
 			return -1;
-		g_mutex_lock(nr_lock); /* dv->nr may change in fn() */
+		g_mutex_lock(mutex); /* dv->nr may change in fn() */
 		if (prev_nr == dv->nr)
 			++i;
 	}
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 
 	return 0;
 }
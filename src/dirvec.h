@@ -20,11 +20,23 @@
 #ifndef MPD_DIRVEC_H
 #define MPD_DIRVEC_H
 
+#include <glib.h>
+
 #include <stddef.h>
 
 struct dirvec {
 	struct directory **base;
 	size_t nr;
+
+	/** the number of elements allocated in #base */
+	size_t capacity;
+
+	/**
+	 * Maps the base name of each directory to the directory
+	 * object, for dirvec_find().  It is created only for large
+	 * vectors, and is NULL otherwise.
+	 */
+	GHashTable *index;
 };
 
 void dirvec_init(void);
@@ -39,12 +51,6 @@ int dirvec_delete(struct dirvec *dv, struct directory *del);
 
 void dirvec_add(struct dirvec *dv, struct directory *add);
 
-static inline void
-dirvec_clear(struct dirvec *dv)
-{
-	dv->nr = 0;
-}
-
 void dirvec_destroy(struct dirvec *dv);
 
 int dirvec_for_each(const struct dirvec *dv,
@@ -167,8 +167,6 @@ flac_encoder_open(struct encoder *_encoder, struct audio_format *audio_format,
 	struct flac_encoder *encoder = (struct flac_encoder *)_encoder;
 	unsigned bits_per_sample;
 
-	encoder->audio_format = *audio_format;
-
 	/* FIXME: flac should support 32bit as well */
 	switch (audio_format->format) {
 	case SAMPLE_FORMAT_S8:
@@ -188,6 +186,8 @@ flac_encoder_open(struct encoder *_encoder, struct audio_format *audio_format,
 		audio_format->format = SAMPLE_FORMAT_S24_P32;
 	}
 
+	encoder->audio_format = *audio_format;
+
 	/* allocate the encoder */
 	encoder->fse = FLAC__stream_encoder_new();
 	if (encoder->fse == NULL) {
@@ -307,6 +307,14 @@ flac_encoder_write(struct encoder *_encoder,
 		   both mpd and libFLAC */
 		buffer = data;
 		break;
+
+	case SAMPLE_FORMAT_S24:
+	case SAMPLE_FORMAT_FLOAT:
+	case SAMPLE_FORMAT_UNDEFINED:
+		/* unreachable: flac_encoder_open() has converted
+		   these to SAMPLE_FORMAT_S24_P32 */
+		assert(false);
+		return false;
 	}
 
 	/* feed samples to encoder */
@@ -212,7 +212,8 @@ vorbis_encoder_open(struct encoder *_encoder,
 	struct vorbis_encoder *encoder = (struct vorbis_encoder *)_encoder;
 	bool ret;
 
-	audio_format->format = SAMPLE_FORMAT_S16;
+	/* libvorbis analyzes floating point samples */
+	audio_format->format = SAMPLE_FORMAT_FLOAT;
 
 	encoder->audio_format = *audio_format;
 
@@ -320,12 +321,12 @@ vorbis_encoder_tag(struct encoder *_encoder, const struct tag *tag,
 }
 
 static void
-pcm16_to_vorbis_buffer(float **dest, const int16_t *src,
-		       unsigned num_frames, unsigned num_channels)
+interleaved_to_vorbis_buffer(float **dest, const float *src,
+			     unsigned num_frames, unsigned num_channels)
 {
 	for (unsigned i = 0; i < num_frames; i++)
 		for (unsigned j = 0; j < num_channels; j++)
-			dest[j][i] = *src++ / 32768.0;
+			dest[j][i] = *src++;
 }
 
 static bool
@@ -338,12 +339,13 @@ vorbis_encoder_write(struct encoder *_encoder,
 
 	num_frames = length / audio_format_frame_size(&encoder->audio_format);
 
-	/* this is for only 16-bit audio */
+	/* this is for only float audio */
 
-	pcm16_to_vorbis_buffer(vorbis_analysis_buffer(&encoder->vd,
-						      num_frames),
-			       (const int16_t *)data,
-			       num_frames, encoder->audio_format.channels);
+	interleaved_to_vorbis_buffer(vorbis_analysis_buffer(&encoder->vd,
+							    num_frames),
+				     (const float *)data,
+				     num_frames,
+				     encoder->audio_format.channels);
 
 	vorbis_analysis_wrote(&encoder->vd, num_frames);
 	vorbis_encoder_blockout(encoder);
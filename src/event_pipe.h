@@ -44,6 +44,12 @@ enum pipe_event {
 	/** a hardware mixer plugin has detected a change */
 	PIPE_EVENT_MIXER,
 
+	/** a database query worker has produced output */
+	PIPE_EVENT_QUERY,
+
+	/** a client I/O thread has submitted commands */
+	PIPE_EVENT_CLIENT,
+
 	PIPE_EVENT_MAX
 };
 
@@ -55,6 +55,9 @@ enum {
 	IDLE_UPDATE = 0x100,
 };
 
+/** the number of idle events, i.e. of names in idle_get_names() */
+#define IDLE_NUM_EVENTS 9
+
 /**
  * Initialize the mutex
  */
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/** \file
+ *
+ * Helpers for the lock-free implementations of #music_pipe and
+ * #music_buffer.
+ */
+
+#ifndef MPD_LOCKFREE_H
+#define MPD_LOCKFREE_H
+
+#include <glib.h>
+
+/**
+ * Use the lock-free implementations of #music_pipe and
+ * #music_buffer?  This is enabled with "--enable-lockfree-pipe";
+ * test programs may override the macro to build both variants.
+ */
+#ifndef MUSIC_PIPE_LOCKFREE
+#ifdef ENABLE_LOCKFREE_PIPE
+#define MUSIC_PIPE_LOCKFREE 1
+#else
+#define MUSIC_PIPE_LOCKFREE 0
+#endif
+#endif
+
+/**
+ * Atomically replaces the pointer, and returns the old value.
+ * GLib 2.12 doesn't have such a primitive, so this is emulated
+ * with a compare-and-exchange loop.
+ */
+static inline gpointer
+lockfree_pointer_exchange(volatile gpointer *p, gpointer value)
+{
+	gpointer old;
+
+	do {
+		old = g_atomic_pointer_get(p);
+	} while (!g_atomic_pointer_compare_and_exchange(p, old, value));
+
+	return old;
+}
+
+#endif
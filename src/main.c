@@ -86,6 +86,9 @@
 enum {
 	DEFAULT_BUFFER_SIZE = 2048,
 	DEFAULT_BUFFER_BEFORE_PLAY = 10,
+
+	/** the maximum value for "audio_chunk_size" [KiB] */
+	MAX_CHUNK_SIZE = 1024,
 };
 
 GThread *main_task;
@@ -218,6 +221,7 @@ initialize_decoder_and_player(void)
 	const struct config_param *param;
 	char *test;
 	size_t buffer_size;
+	size_t chunk_size;
 	float perc;
 	unsigned buffered_chunks;
 	unsigned buffered_before_play;
@@ -233,7 +237,29 @@ initialize_decoder_and_player(void)
 
 	buffer_size *= 1024;
 
-	buffered_chunks = buffer_size / CHUNK_SIZE;
+	param = config_get_param(CONF_AUDIO_CHUNK_SIZE);
+	if (param != NULL) {
+		chunk_size = strtol(param->value, &test, 10);
+		if (*test != '\0' || chunk_size * 1024 < CHUNK_SIZE ||
+		    chunk_size > MAX_CHUNK_SIZE)
+			g_error("chunk size \"%s\" is not between %u and %u, "
+				"line %i\n", param->value,
+				CHUNK_SIZE / 1024, MAX_CHUNK_SIZE,
+				param->line);
+
+		chunk_size *= 1024;
+	} else
+		chunk_size = CHUNK_SIZE;
+
+	/* chunks are always filled to their capacity (see
+	   music_chunk_fill_size()), so the buffer holds
+	   audio_buffer_size bytes of audio, regardless of the chunk
+	   size */
+	buffered_chunks = buffer_size / chunk_size;
+
+	if (buffered_chunks == 0)
+		g_error("buffer size \"%li\" is smaller than the chunk size\n",
+			(long)buffer_size);
 
 	if (buffered_chunks >= 1 << 15)
 		g_error("buffer size \"%li\" is too big\n", (long)buffer_size);
@@ -253,7 +279,7 @@ initialize_decoder_and_player(void)
 	if (buffered_before_play > buffered_chunks)
 		buffered_before_play = buffered_chunks;
 
-	pc_init(buffered_chunks, buffered_before_play);
+	pc_init(buffered_chunks, chunk_size, buffered_before_play);
 }
 
 /**
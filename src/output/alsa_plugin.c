@@ -203,6 +203,9 @@ get_bitformat(enum sample_format sample_format)
 	case SAMPLE_FORMAT_S32:
 		return SND_PCM_FORMAT_S32;
 
+	case SAMPLE_FORMAT_FLOAT:
+		return SND_PCM_FORMAT_FLOAT;
+
 	default:
 		return SND_PCM_FORMAT_UNKNOWN;
 	}
@@ -225,6 +228,8 @@ byteswap_bitformat(snd_pcm_format_t fmt)
 		return SND_PCM_FORMAT_S24_3BE;
 
 	case SND_PCM_FORMAT_S32_BE: return SND_PCM_FORMAT_S32_LE;
+	case SND_PCM_FORMAT_FLOAT_LE: return SND_PCM_FORMAT_FLOAT_BE;
+	case SND_PCM_FORMAT_FLOAT_BE: return SND_PCM_FORMAT_FLOAT_LE;
 	default: return SND_PCM_FORMAT_UNKNOWN;
 	}
 }
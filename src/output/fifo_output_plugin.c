@@ -224,6 +224,10 @@ fifo_output_open(void *data, struct audio_format *audio_format,
 {
 	struct fifo_data *fd = (struct fifo_data *)data;
 
+	if (audio_format->format == SAMPLE_FORMAT_FLOAT)
+		/* FIFO readers expect integer samples */
+		audio_format->format = SAMPLE_FORMAT_S16;
+
 	fd->timer = timer_new(audio_format);
 
 	return true;
@@ -181,9 +181,11 @@ set_audioformat(struct jack_data *jd, struct audio_format *audio_format)
 	else if (audio_format->channels > jd->num_source_ports)
 		audio_format->channels = 2;
 
+	/* JACK uses floating point samples; everything else than 16
+	   and 24 bit gets converted to float by the MPD core */
 	if (audio_format->format != SAMPLE_FORMAT_S16 &&
 	    audio_format->format != SAMPLE_FORMAT_S24_P32)
-		audio_format->format = SAMPLE_FORMAT_S24_P32;
+		audio_format->format = SAMPLE_FORMAT_FLOAT;
 }
 
 static void
@@ -627,6 +629,22 @@ mpd_jack_write_samples_24(struct jack_data *jd, const int32_t *src,
 	}
 }
 
+static void
+mpd_jack_write_samples_float(struct jack_data *jd, const float *src,
+			     unsigned num_samples)
+{
+	jack_default_audio_sample_t sample;
+	unsigned i;
+
+	while (num_samples-- > 0) {
+		for (i = 0; i < jd->audio_format.channels; ++i) {
+			sample = *src++;
+			jack_ringbuffer_write(jd->ringbuffer[i], (void*)&sample,
+					      sizeof(sample));
+		}
+	}
+}
+
 static void
 mpd_jack_write_samples(struct jack_data *jd, const void *src,
 		       unsigned num_samples)
@@ -642,6 +660,11 @@ mpd_jack_write_samples(struct jack_data *jd, const void *src,
 					  num_samples);
 		break;
 
+	case SAMPLE_FORMAT_FLOAT:
+		mpd_jack_write_samples_float(jd, (const float*)src,
+					     num_samples);
+		break;
+
 	default:
 		assert(false);
 	}
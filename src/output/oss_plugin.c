@@ -400,6 +400,9 @@ sample_format_to_oss(enum sample_format format)
 #else
 		return AFMT_QUERY;
 #endif
+
+	case SAMPLE_FORMAT_FLOAT:
+		return AFMT_QUERY;
 	}
 
 	return AFMT_QUERY;
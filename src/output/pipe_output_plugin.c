@@ -64,11 +64,15 @@ pipe_output_finish(void *data)
 }
 
 static bool
-pipe_output_open(void *data, G_GNUC_UNUSED struct audio_format *audio_format,
+pipe_output_open(void *data, struct audio_format *audio_format,
 		 G_GNUC_UNUSED GError **error)
 {
 	struct pipe_output *pd = data;
 
+	if (audio_format->format == SAMPLE_FORMAT_FLOAT)
+		/* the command expects integer samples */
+		audio_format->format = SAMPLE_FORMAT_S16;
+
 	pd->fh = popen(pd->cmd, "w");
 	if (pd->fh == NULL) {
 		g_set_error(error, pipe_output_quark(), errno,
@@ -466,11 +466,18 @@ pulse_output_open(void *data, struct audio_format *audio_format,
 	if (!pulse_output_wait_connection(po, error_r))
 		return false;
 
-	/* MPD doesn't support the other pulseaudio sample formats, so
-	   we just force MPD to send us everything as 16 bit */
-	audio_format->format = SAMPLE_FORMAT_S16;
+	if (audio_format->format == SAMPLE_FORMAT_FLOAT) {
+		/* PulseAudio mixes in floating point, pass it through
+		   without quantization */
+		ss.format = PA_SAMPLE_FLOAT32NE;
+	} else {
+		/* MPD doesn't support the other pulseaudio sample
+		   formats, so we just force MPD to send us everything
+		   as 16 bit */
+		audio_format->format = SAMPLE_FORMAT_S16;
+		ss.format = PA_SAMPLE_S16NE;
+	}
 
-	ss.format = PA_SAMPLE_S16NE;
 	ss.rate = audio_format->sample_rate;
 	ss.channels = audio_format->channels;
 
@@ -100,6 +100,7 @@ win32_output_open(void *data, struct audio_format *audio_format,
 	case SAMPLE_FORMAT_S24:
 	case SAMPLE_FORMAT_S24_P32:
 	case SAMPLE_FORMAT_S32:
+	case SAMPLE_FORMAT_FLOAT:
 	case SAMPLE_FORMAT_UNDEFINED:
 		/* we havn't tested formats other than S16 */
 		audio_format->format = SAMPLE_FORMAT_S16;
@@ -21,6 +21,7 @@
 #include "output_all.h"
 #include "output_internal.h"
 #include "output_control.h"
+#include "output_group.h"
 #include "chunk.h"
 #include "conf.h"
 #include "pipe.h"
@@ -98,6 +99,35 @@ audio_output_config_count(void)
 	return nr;
 }
 
+/**
+ * Clears the "group_key" of all outputs which don't share their
+ * filter configuration with any other output; there is no point in
+ * creating an #output_group for them.
+ */
+static void
+audio_output_all_init_groups(void)
+{
+	output_group_global_init();
+
+	for (unsigned i = 0; i < num_audio_outputs; ++i) {
+		struct audio_output *ao = &audio_outputs[i];
+		bool shared = false;
+
+		if (ao->group_key == NULL)
+			continue;
+
+		for (unsigned j = 0; j < num_audio_outputs && !shared; ++j)
+			shared = j != i && audio_outputs[j].group_key != NULL &&
+				strcmp(ao->group_key,
+				       audio_outputs[j].group_key) == 0;
+
+		if (!shared) {
+			g_free(ao->group_key);
+			ao->group_key = NULL;
+		}
+	}
+}
+
 void
 audio_output_all_init(void)
 {
@@ -136,6 +166,8 @@ audio_output_all_init(void)
 			}
 		}
 	}
+
+	audio_output_all_init_groups();
 }
 
 void
@@ -151,6 +183,8 @@ audio_output_all_finish(void)
 	audio_outputs = NULL;
 	num_audio_outputs = 0;
 
+	output_group_global_finish();
+
 	notify_deinit(&audio_output_client_notify);
 }
 
@@ -422,6 +456,17 @@ clear_tail_chunk(G_GNUC_UNUSED const struct music_chunk *chunk, bool *locked)
 	}
 }
 
+/**
+ * Clears the music pipe, and frees the shared filter results of all
+ * chunks.  All audio outputs must have stopped using the pipe.
+ */
+static void
+audio_output_all_clear_pipe(void)
+{
+	output_group_forget_all();
+	music_pipe_clear(g_mp, g_music_buffer);
+}
+
 unsigned
 audio_output_all_check(void)
 {
@@ -463,7 +508,9 @@ audio_output_all_check(void)
 				if (locked[i])
 					g_mutex_unlock(audio_outputs[i].mutex);
 
-		/* return the chunk to the buffer */
+		/* free the shared filter results and return the
+		   chunk to the buffer */
+		output_group_forget(shifted);
 		music_buffer_return(g_music_buffer, shifted);
 	}
 
@@ -523,7 +570,7 @@ audio_output_all_cancel(void)
 	/* clear the music pipe and return all chunks to the buffer */
 
 	if (g_mp != NULL)
-		music_pipe_clear(g_mp, g_music_buffer);
+		audio_output_all_clear_pipe();
 
 	/* the audio outputs are now waiting for a signal, to
 	   synchronize the cleared music pipe */
@@ -546,7 +593,7 @@ audio_output_all_close(void)
 	if (g_mp != NULL) {
 		assert(g_music_buffer != NULL);
 
-		music_pipe_clear(g_mp, g_music_buffer);
+		audio_output_all_clear_pipe();
 		music_pipe_free(g_mp);
 		g_mp = NULL;
 	}
@@ -569,7 +616,7 @@ audio_output_all_release(void)
 	if (g_mp != NULL) {
 		assert(g_music_buffer != NULL);
 
-		music_pipe_clear(g_mp, g_music_buffer);
+		audio_output_all_clear_pipe();
 		music_pipe_free(g_mp);
 		g_mp = NULL;
 	}
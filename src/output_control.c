@@ -309,4 +309,6 @@ void audio_output_finish(struct audio_output *ao)
 	filter_free(ao->filter);
 
 	pcm_buffer_deinit(&ao->cross_fade_buffer);
+
+	g_free(ao->group_key);
 }
@@ -40,6 +40,16 @@ bool
 audio_output_init(struct audio_output *ao, const struct config_param *param,
 		  GError **error_r);
 
+/**
+ * Creates the filter chain of an audio output with the replay gain
+ * filters, the normalization filter and the configured "filters".
+ * The software mixer's volume filter and the "convert" filter are
+ * not added here.
+ */
+void
+audio_output_init_filters(struct audio_output *ao,
+			  const struct config_param *param);
+
 /**
  * Enables the device.
  */
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "output_group.h"
+#include "output_internal.h"
+#include "output_control.h"
+#include "output_thread.h"
+#include "chunk.h"
+#include "filter_plugin.h"
+#include "filter_registry.h"
+#include "filter/chain_filter_plugin.h"
+#include "filter/convert_filter_plugin.h"
+
+#include <assert.h>
+#include <string.h>
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "output"
+
+struct output_group_result {
+	size_t length;
+
+	char data[];
+};
+
+struct output_group {
+	/**
+	 * A copy of the members' audio_output.group_key.
+	 */
+	char *key;
+
+	/**
+	 * The number of outputs which have joined this group.
+	 * Protected by #output_groups_mutex.
+	 */
+	unsigned refcount;
+
+	/**
+	 * This mutex protects #filters and #results.
+	 */
+	GMutex *mutex;
+
+	/**
+	 * The filters of this group.  Only the filter attributes, the
+	 * audio formats and the names (for log messages) of this
+	 * object are used.
+	 */
+	struct audio_output filters;
+
+	/**
+	 * Maps #music_chunk pointers to #output_group_result objects.
+	 */
+	GHashTable *results;
+};
+
+/**
+ * The list of all #output_group objects.
+ */
+static GSList *output_groups;
+
+/**
+ * This mutex protects #output_groups and output_group.refcount.
+ */
+static GMutex *output_groups_mutex;
+
+void
+output_group_global_init(void)
+{
+	output_groups_mutex = g_mutex_new();
+}
+
+void
+output_group_global_finish(void)
+{
+	assert(output_groups == NULL);
+
+	g_mutex_free(output_groups_mutex);
+}
+
+static void
+output_group_free_filters(struct audio_output *filters)
+{
+	if (filters->replay_gain_filter != NULL)
+		filter_free(filters->replay_gain_filter);
+
+	if (filters->other_replay_gain_filter != NULL)
+		filter_free(filters->other_replay_gain_filter);
+
+	filter_free(filters->filter);
+
+	pcm_buffer_deinit(&filters->cross_fade_buffer);
+}
+
+static struct output_group *
+output_group_new(const struct audio_output *ao, GError **error_r)
+{
+	struct output_group *group = g_new0(struct output_group, 1);
+	struct audio_output *filters = &group->filters;
+
+	filters->name = ao->name;
+	filters->plugin = ao->plugin;
+	filters->in_audio_format = ao->in_audio_format;
+	filters->out_audio_format = ao->out_audio_format;
+
+	pcm_buffer_init(&filters->cross_fade_buffer);
+
+	audio_output_init_filters(filters, ao->config);
+
+	filters->convert_filter = filter_new(&convert_filter_plugin,
+					     NULL, NULL);
+	assert(filters->convert_filter != NULL);
+
+	filter_chain_append(filters->filter, filters->convert_filter);
+
+	if (audio_output_filter_open(filters, &filters->in_audio_format,
+				     error_r) == NULL) {
+		output_group_free_filters(filters);
+		g_free(group);
+		return NULL;
+	}
+
+	convert_filter_set(filters->convert_filter,
+			   &filters->out_audio_format);
+
+	group->key = g_strdup(ao->group_key);
+	group->refcount = 1;
+	group->mutex = g_mutex_new();
+	group->results = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+					       NULL, g_free);
+
+	g_debug("created filter group for \"%s\"", ao->name);
+
+	return group;
+}
+
+static void
+output_group_free(struct output_group *group)
+{
+	assert(group->refcount == 0);
+
+	audio_output_filter_close(&group->filters);
+	output_group_free_filters(&group->filters);
+
+	g_hash_table_destroy(group->results);
+	g_mutex_free(group->mutex);
+	g_free(group->key);
+	g_free(group);
+}
+
+static bool
+output_group_matches(const struct output_group *group,
+		     const struct audio_output *ao)
+{
+	return strcmp(group->key, ao->group_key) == 0 &&
+		audio_format_equals(&group->filters.in_audio_format,
+				    &ao->in_audio_format) &&
+		audio_format_equals(&group->filters.out_audio_format,
+				    &ao->out_audio_format);
+}
+
+struct output_group *
+output_group_join(const struct audio_output *ao, GError **error_r)
+{
+	struct output_group *group;
+
+	assert(ao->group_key != NULL);
+
+	g_mutex_lock(output_groups_mutex);
+
+	for (GSList *i = output_groups; i != NULL; i = g_slist_next(i)) {
+		group = i->data;
+
+		if (output_group_matches(group, ao)) {
+			++group->refcount;
+			g_mutex_unlock(output_groups_mutex);
+			return group;
+		}
+	}
+
+	group = output_group_new(ao, error_r);
+	if (group != NULL)
+		output_groups = g_slist_prepend(output_groups, group);
+
+	g_mutex_unlock(output_groups_mutex);
+
+	return group;
+}
+
+void
+output_group_leave(struct output_group *group)
+{
+	g_mutex_lock(output_groups_mutex);
+
+	assert(group->refcount > 0);
+
+	if (--group->refcount == 0) {
+		output_groups = g_slist_remove(output_groups, group);
+		output_group_free(group);
+	}
+
+	g_mutex_unlock(output_groups_mutex);
+}
+
+const char *
+output_group_filter_chunk(struct output_group *group,
+			  const struct music_chunk *chunk,
+			  size_t *length_r)
+{
+	struct output_group_result *result;
+
+	if (chunk->length == 0) {
+		/* empty chunk, nothing to do */
+		*length_r = 0;
+		return chunk->data;
+	}
+
+	g_mutex_lock(group->mutex);
+
+	result = g_hash_table_lookup(group->results, chunk);
+	if (result == NULL) {
+		size_t length;
+		const char *data =
+			audio_output_filter_chunk(&group->filters, chunk,
+						  &length);
+		if (data == NULL) {
+			g_mutex_unlock(group->mutex);
+			return NULL;
+		}
+
+		result = g_malloc(sizeof(*result) + length);
+		result->length = length;
+		memcpy(result->data, data, length);
+
+		g_hash_table_insert(group->results, (gpointer)chunk, result);
+	}
+
+	g_mutex_unlock(group->mutex);
+
+	/* the result is not freed before all outputs have finished
+	   playing this chunk, so it may be used without the lock */
+
+	*length_r = result->length;
+	return result->data;
+}
+
+void
+output_group_forget(const struct music_chunk *chunk)
+{
+	g_mutex_lock(output_groups_mutex);
+
+	for (GSList *i = output_groups; i != NULL; i = g_slist_next(i)) {
+		struct output_group *group = i->data;
+
+		g_mutex_lock(group->mutex);
+		g_hash_table_remove(group->results, chunk);
+		g_mutex_unlock(group->mutex);
+	}
+
+	g_mutex_unlock(output_groups_mutex);
+}
+
+void
+output_group_forget_all(void)
+{
+	g_mutex_lock(output_groups_mutex);
+
+	for (GSList *i = output_groups; i != NULL; i = g_slist_next(i)) {
+		struct output_group *group = i->data;
+
+		g_mutex_lock(group->mutex);
+		g_hash_table_remove_all(group->results);
+		g_mutex_unlock(group->mutex);
+	}
+
+	g_mutex_unlock(output_groups_mutex);
+}
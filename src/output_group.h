@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * An output group is a set of audio outputs with the same filter
+ * configuration and the same input and output audio formats.  Their
+ * filters are applied only once per chunk by the group, and the
+ * result is shared (read-only) by all members.
+ */
+
+#ifndef MPD_OUTPUT_GROUP_H
+#define MPD_OUTPUT_GROUP_H
+
+#include <glib.h>
+
+#include <stddef.h>
+
+struct output_group;
+struct audio_output;
+struct music_chunk;
+
+void
+output_group_global_init(void);
+
+void
+output_group_global_finish(void);
+
+/**
+ * Lets an open audio output join the group matching its "group_key"
+ * and its audio formats.  A new group is created if there is none
+ * yet.  This function is called by the output thread.
+ *
+ * @return the group, or NULL on error
+ */
+struct output_group *
+output_group_join(const struct audio_output *ao, GError **error_r);
+
+/**
+ * Leaves a group joined with output_group_join().  The group is
+ * freed after its last member has left.
+ */
+void
+output_group_leave(struct output_group *group);
+
+/**
+ * Returns the filtered data of a chunk.  The first member which
+ * requests a chunk applies the filters, all others get a copy of the
+ * result.
+ *
+ * @param length_r the length of the result is returned here
+ * @return the filtered data (valid until the chunk is forgotten), or
+ * NULL on error
+ */
+const char *
+output_group_filter_chunk(struct output_group *group,
+			  const struct music_chunk *chunk,
+			  size_t *length_r);
+
+/**
+ * Frees the filtered data of a chunk in all groups.  This must be
+ * called before the chunk is returned to the #music_buffer.
+ */
+void
+output_group_forget(const struct music_chunk *chunk);
+
+/**
+ * Frees the filtered data of all chunks in all groups.  This is
+ * called after the music pipe has been cleared.
+ */
+void
+output_group_forget_all(void);
+
+#endif
@@ -125,6 +125,65 @@ audio_output_load_mixer(void *ao, const struct config_param *param,
 	return NULL;
 }
 
+void
+audio_output_init_filters(struct audio_output *ao,
+			  const struct config_param *param)
+{
+	GError *error = NULL;
+
+	/* set up the filter chain */
+
+	ao->filter = filter_chain_new();
+	assert(ao->filter != NULL);
+
+	/* create the replay_gain filter */
+
+	const char *replay_gain_handler =
+		config_get_block_string(param, "replay_gain_handler",
+					"software");
+
+	if (strcmp(replay_gain_handler, "none") != 0) {
+		ao->replay_gain_filter = filter_new(&replay_gain_filter_plugin,
+						    param, NULL);
+		assert(ao->replay_gain_filter != NULL);
+
+		ao->replay_gain_serial = 0;
+
+		ao->other_replay_gain_filter = filter_new(&replay_gain_filter_plugin,
+							  param, NULL);
+		assert(ao->other_replay_gain_filter != NULL);
+
+		ao->other_replay_gain_serial = 0;
+	} else {
+		ao->replay_gain_filter = NULL;
+		ao->other_replay_gain_filter = NULL;
+	}
+
+	/* create the normalization filter (if configured) */
+
+	if (config_get_bool(CONF_VOLUME_NORMALIZATION, false)) {
+		struct filter *normalize_filter =
+			filter_new(&normalize_filter_plugin, NULL, NULL);
+		assert(normalize_filter != NULL);
+
+		filter_chain_append(ao->filter,
+				    autoconvert_filter_new(normalize_filter));
+	}
+
+	filter_chain_parse(ao->filter,
+	                   config_get_block_string(param, AUDIO_FILTERS, ""),
+	                   &error
+	);
+
+	// It's not really fatal - Part of the filter chain has been set up already
+	// and even an empty one will work (if only with unexpected behaviour)
+	if (error != NULL) {
+		g_warning("Failed to initialize filter chain for '%s': %s",
+			  ao->name, error->message);
+		g_error_free(error);
+	}
+}
+
 bool
 audio_output_init(struct audio_output *ao, const struct config_param *param,
 		  GError **error_r)
@@ -193,57 +252,11 @@ audio_output_init(struct audio_output *ao, const struct config_param *param,
 
 	pcm_buffer_init(&ao->cross_fade_buffer);
 
-	/* set up the filter chain */
-
-	ao->filter = filter_chain_new();
-	assert(ao->filter != NULL);
-
-	/* create the replay_gain filter */
-
 	const char *replay_gain_handler =
 		config_get_block_string(param, "replay_gain_handler",
 					"software");
 
-	if (strcmp(replay_gain_handler, "none") != 0) {
-		ao->replay_gain_filter = filter_new(&replay_gain_filter_plugin,
-						    param, NULL);
-		assert(ao->replay_gain_filter != NULL);
-
-		ao->replay_gain_serial = 0;
-
-		ao->other_replay_gain_filter = filter_new(&replay_gain_filter_plugin,
-							  param, NULL);
-		assert(ao->other_replay_gain_filter != NULL);
-
-		ao->other_replay_gain_serial = 0;
-	} else {
-		ao->replay_gain_filter = NULL;
-		ao->other_replay_gain_filter = NULL;
-	}
-
-	/* create the normalization filter (if configured) */
-
-	if (config_get_bool(CONF_VOLUME_NORMALIZATION, false)) {
-		struct filter *normalize_filter =
-			filter_new(&normalize_filter_plugin, NULL, NULL);
-		assert(normalize_filter != NULL);
-
-		filter_chain_append(ao->filter,
-				    autoconvert_filter_new(normalize_filter));
-	}
-
-	filter_chain_parse(ao->filter,
-	                   config_get_block_string(param, AUDIO_FILTERS, ""),
-	                   &error
-	);
-
-	// It's not really fatal - Part of the filter chain has been set up already
-	// and even an empty one will work (if only with unexpected behaviour)
-	if (error != NULL) {
-		g_warning("Failed to initialize filter chain for '%s': %s",
-			  ao->name, error->message);
-		g_error_free(error);
-	}
+	audio_output_init_filters(ao, param);
 
 	ao->thread = NULL;
 	ao->command = AO_COMMAND_NONE;
@@ -287,6 +300,23 @@ audio_output_init(struct audio_output *ao, const struct config_param *param,
 
 	filter_chain_append(ao->filter, ao->convert_filter);
 
+	/* outputs with software volume or with replay gain applied
+	   by the mixer have private filter state; all others may
+	   share their filtered data with other outputs */
+
+	ao->config = param;
+	ao->group = NULL;
+
+	if (audio_output_mixer_type(param) != MIXER_TYPE_SOFTWARE &&
+	    strcmp(replay_gain_handler, "mixer") != 0)
+		ao->group_key =
+			g_strconcat(replay_gain_handler, "|",
+				    config_get_block_string(param,
+							    AUDIO_FILTERS, ""),
+				    NULL);
+	else
+		ao->group_key = NULL;
+
 	/* done */
 
 	return true;
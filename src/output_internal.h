@@ -179,6 +179,30 @@ struct audio_output {
 	 */
 	struct filter *convert_filter;
 
+	/**
+	 * The configuration block of this audio output (may be NULL).
+	 * It is used to create the filters of an #output_group.
+	 */
+	const struct config_param *config;
+
+	/**
+	 * A string describing the filter configuration of this
+	 * output.  Outputs with the same key and the same audio
+	 * formats produce identical data, and may join an
+	 * #output_group.  This is NULL if the filters depend on
+	 * per-output state (e.g. software volume), or if no other
+	 * output has the same key.
+	 */
+	char *group_key;
+
+	/**
+	 * The #output_group this output has joined, or NULL if it
+	 * applies its own filters.  While this is set, the filters of
+	 * this object are closed.  This attribute is only accessed by
+	 * the output thread.
+	 */
+	struct output_group *group;
+
 	/**
 	 * The thread handle, or NULL if the output thread isn't
 	 * running.
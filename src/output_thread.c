@@ -21,6 +21,7 @@
 #include "output_thread.h"
 #include "output_api.h"
 #include "output_internal.h"
+#include "output_group.h"
 #include "chunk.h"
 #include "pipe.h"
 #include "player_control.h"
@@ -89,10 +90,10 @@ ao_disable(struct audio_output *ao)
 	}
 }
 
-static const struct audio_format *
-ao_filter_open(struct audio_output *ao,
-	       struct audio_format *audio_format,
-	       GError **error_r)
+const struct audio_format *
+audio_output_filter_open(struct audio_output *ao,
+			 struct audio_format *audio_format,
+			 GError **error_r)
 {
 	/* the replay_gain filter cannot fail here */
 	if (ao->replay_gain_filter != NULL)
@@ -113,8 +114,8 @@ ao_filter_open(struct audio_output *ao,
 	return af;
 }
 
-static void
-ao_filter_close(struct audio_output *ao)
+void
+audio_output_filter_close(struct audio_output *ao)
 {
 	if (ao->replay_gain_filter != NULL)
 		filter_close(ao->replay_gain_filter);
@@ -124,6 +125,48 @@ ao_filter_close(struct audio_output *ao)
 	filter_close(ao->filter);
 }
 
+/**
+ * Joins the #output_group matching this output's filter
+ * configuration and audio formats.  On success, the output's own
+ * filters are closed, because the group applies them from now on;
+ * they were only opened to determine the output audio format.  On
+ * failure, the output just keeps applying its own filters.
+ */
+static void
+ao_join_group(struct audio_output *ao)
+{
+	GError *error = NULL;
+
+	assert(ao->group == NULL);
+
+	if (ao->group_key == NULL)
+		return;
+
+	ao->group = output_group_join(ao, &error);
+	if (ao->group == NULL) {
+		g_warning("Failed to share filters of \"%s\" [%s]: %s",
+			  ao->name, ao->plugin->name, error->message);
+		g_error_free(error);
+		return;
+	}
+
+	audio_output_filter_close(ao);
+}
+
+/**
+ * Leaves the #output_group, or closes the output's own filters if
+ * it has not joined one.
+ */
+static void
+ao_filter_close(struct audio_output *ao)
+{
+	if (ao->group != NULL) {
+		output_group_leave(ao->group);
+		ao->group = NULL;
+	} else
+		audio_output_filter_close(ao);
+}
+
 static void
 ao_open(struct audio_output *ao)
 {
@@ -145,7 +188,8 @@ ao_open(struct audio_output *ao)
 
 	/* open the filter */
 
-	filter_audio_format = ao_filter_open(ao, &ao->in_audio_format, &error);
+	filter_audio_format = audio_output_filter_open(ao, &ao->in_audio_format,
+						       &error);
 	if (filter_audio_format == NULL) {
 		g_warning("Failed to open filter for \"%s\" [%s]: %s",
 			  ao->name, ao->plugin->name, error->message);
@@ -172,12 +216,13 @@ ao_open(struct audio_output *ao)
 			  ao->name, ao->plugin->name, error->message);
 		g_error_free(error);
 
-		ao_filter_close(ao);
+		audio_output_filter_close(ao);
 		ao->fail_timer = g_timer_new();
 		return;
 	}
 
 	convert_filter_set(ao->convert_filter, &ao->out_audio_format);
+	ao_join_group(ao);
 
 	ao->open = true;
 
@@ -225,7 +270,8 @@ ao_reopen_filter(struct audio_output *ao)
 	GError *error = NULL;
 
 	ao_filter_close(ao);
-	filter_audio_format = ao_filter_open(ao, &ao->in_audio_format, &error);
+	filter_audio_format = audio_output_filter_open(ao, &ao->in_audio_format,
+						       &error);
 	if (filter_audio_format == NULL) {
 		g_warning("Failed to open filter for \"%s\" [%s]: %s",
 			  ao->name, ao->plugin->name, error->message);
@@ -249,6 +295,7 @@ ao_reopen_filter(struct audio_output *ao)
 	}
 
 	convert_filter_set(ao->convert_filter, &ao->out_audio_format);
+	ao_join_group(ao);
 }
 
 static void
@@ -318,9 +365,10 @@ ao_chunk_data(struct audio_output *ao, const struct music_chunk *chunk,
 	return data;
 }
 
-static const char *
-ao_filter_chunk(struct audio_output *ao, const struct music_chunk *chunk,
-		size_t *length_r)
+const char *
+audio_output_filter_chunk(struct audio_output *ao,
+			  const struct music_chunk *chunk,
+			  size_t *length_r)
 {
 	GError *error = NULL;
 
@@ -400,7 +448,9 @@ ao_play_chunk(struct audio_output *ao, const struct music_chunk *chunk)
 	}
 
 	size_t size;
-	const char *data = ao_filter_chunk(ao, chunk, &size);
+	const char *data = ao->group != NULL
+		? output_group_filter_chunk(ao->group, chunk, &size)
+		: audio_output_filter_chunk(ao, chunk, &size);
 	if (data == NULL) {
 		ao_close(ao, false);
 
@@ -20,8 +20,43 @@
 #ifndef MPD_OUTPUT_THREAD_H
 #define MPD_OUTPUT_THREAD_H
 
+#include <glib.h>
+
+#include <stddef.h>
+
 struct audio_output;
+struct audio_format;
+struct music_chunk;
 
 void audio_output_thread_start(struct audio_output *ao);
 
+/**
+ * Opens the filters of an audio output (but not the plugin).
+ *
+ * @return the audio format produced by the filter chain, or NULL on
+ * error
+ */
+const struct audio_format *
+audio_output_filter_open(struct audio_output *ao,
+			 struct audio_format *audio_format,
+			 GError **error_r);
+
+/**
+ * Closes the filters opened by audio_output_filter_open().
+ */
+void
+audio_output_filter_close(struct audio_output *ao);
+
+/**
+ * Applies replay gain, cross-fading and the filter chain of the
+ * audio output to a chunk.
+ *
+ * @param length_r the length of the result is returned here
+ * @return the filtered data (owned by the filters), or NULL on error
+ */
+const char *
+audio_output_filter_chunk(struct audio_output *ao,
+			  const struct music_chunk *chunk,
+			  size_t *length_r);
+
 #endif
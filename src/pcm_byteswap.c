@@ -20,6 +20,7 @@
 #include "config.h"
 #include "pcm_byteswap.h"
 #include "pcm_buffer.h"
+#include "pcm_simd.h"
 
 #include <glib.h>
 
@@ -41,7 +42,9 @@ const int16_t *pcm_byteswap_16(struct pcm_buffer *buffer,
 
 	assert(buf != NULL);
 
-	for (i = 0; i < len / 2; i++)
+	i = pcm_simd_byteswap_16((uint16_t *)buf, (const uint16_t *)src,
+				 len / 2);
+	for (; i < len / 2; i++)
 		buf[i] = swab16(src[i]);
 
 	return buf;
@@ -63,7 +66,9 @@ const int32_t *pcm_byteswap_32(struct pcm_buffer *buffer,
 
 	assert(buf != NULL);
 
-	for (i = 0; i < len / 4; i++)
+	i = pcm_simd_byteswap_32((uint32_t *)buf, (const uint32_t *)src,
+				 len / 4);
+	for (; i < len / 4; i++)
 		buf[i] = swab32(src[i]);
 
 	return buf;
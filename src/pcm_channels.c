@@ -20,6 +20,7 @@
 #include "config.h"
 #include "pcm_channels.h"
 #include "pcm_buffer.h"
+#include "pcm_simd.h"
 
 #include <assert.h>
 
@@ -27,6 +28,11 @@ static void
 pcm_convert_channels_16_1_to_2(int16_t *dest, const int16_t *src,
 			       unsigned num_frames)
 {
+	unsigned n = pcm_simd_channels_16_1_to_2(dest, src, num_frames);
+	dest += n * 2;
+	src += n;
+	num_frames -= n;
+
 	while (num_frames-- > 0) {
 		int16_t value = *src++;
 
@@ -39,6 +45,11 @@ static void
 pcm_convert_channels_16_2_to_1(int16_t *dest, const int16_t *src,
 			       unsigned num_frames)
 {
+	unsigned n = pcm_simd_channels_16_2_to_1(dest, src, num_frames);
+	dest += n;
+	src += n * 2;
+	num_frames -= n;
+
 	while (num_frames-- > 0) {
 		int32_t a = *src++, b = *src++;
 
@@ -98,6 +109,11 @@ static void
 pcm_convert_channels_24_1_to_2(int32_t *dest, const int32_t *src,
 			       unsigned num_frames)
 {
+	unsigned n = pcm_simd_channels_32_1_to_2(dest, src, num_frames);
+	dest += n * 2;
+	src += n;
+	num_frames -= n;
+
 	while (num_frames-- > 0) {
 		int32_t value = *src++;
 
@@ -110,6 +126,11 @@ static void
 pcm_convert_channels_24_2_to_1(int32_t *dest, const int32_t *src,
 			       unsigned num_frames)
 {
+	unsigned n = pcm_simd_channels_24_2_to_1(dest, src, num_frames);
+	dest += n;
+	src += n * 2;
+	num_frames -= n;
+
 	while (num_frames-- > 0) {
 		int32_t a = *src++, b = *src++;
 
@@ -230,3 +251,76 @@ pcm_convert_channels_32(struct pcm_buffer *buffer,
 
 	return dest;
 }
+
+static void
+pcm_convert_channels_float_1_to_2(float *dest, const float *src,
+				  unsigned num_frames)
+{
+	/* duplicating samples does not need to know their format */
+	pcm_convert_channels_24_1_to_2((int32_t *)dest,
+				       (const int32_t *)src, num_frames);
+}
+
+static void
+pcm_convert_channels_float_2_to_1(float *dest, const float *src,
+				  unsigned num_frames)
+{
+	unsigned n = pcm_simd_channels_float_2_to_1(dest, src, num_frames);
+	dest += n;
+	src += n * 2;
+	num_frames -= n;
+
+	while (num_frames-- > 0) {
+		float a = *src++, b = *src++;
+
+		*dest++ = (a + b) / 2;
+	}
+}
+
+static void
+pcm_convert_channels_float_n_to_2(float *dest,
+				  unsigned src_channels, const float *src,
+				  unsigned num_frames)
+{
+	unsigned c;
+
+	assert(src_channels > 0);
+
+	while (num_frames-- > 0) {
+		float sum = 0;
+		float value;
+
+		for (c = 0; c < src_channels; ++c)
+			sum += *src++;
+		value = sum / (float)src_channels;
+
+		/* XXX this is actually only mono ... */
+		*dest++ = value;
+		*dest++ = value;
+	}
+}
+
+const float *
+pcm_convert_channels_float(struct pcm_buffer *buffer,
+			   uint8_t dest_channels,
+			   uint8_t src_channels, const float *src,
+			   size_t src_size, size_t *dest_size_r)
+{
+	unsigned num_frames = src_size / src_channels / sizeof(*src);
+	unsigned dest_size = num_frames * dest_channels * sizeof(*src);
+	float *dest = pcm_buffer_get(buffer, dest_size);
+
+	*dest_size_r = dest_size;
+
+	if (src_channels == 1 && dest_channels == 2)
+		pcm_convert_channels_float_1_to_2(dest, src, num_frames);
+	else if (src_channels == 2 && dest_channels == 1)
+		pcm_convert_channels_float_2_to_1(dest, src, num_frames);
+	else if (dest_channels == 2)
+		pcm_convert_channels_float_n_to_2(dest, src_channels, src,
+						  num_frames);
+	else
+		return NULL;
+
+	return dest;
+}
@@ -261,6 +261,63 @@ pcm_convert_32(struct pcm_convert_state *state,
 	return buf;
 }
 
+static const float *
+pcm_convert_float(struct pcm_convert_state *state,
+		  const struct audio_format *src_format,
+		  const void *src_buffer, size_t src_size,
+		  const struct audio_format *dest_format, size_t *dest_size_r,
+		  GError **error_r)
+{
+	const float *buf;
+	size_t len;
+
+	assert(dest_format->format == SAMPLE_FORMAT_FLOAT);
+
+	buf = pcm_convert_to_float(&state->format_buffer, src_format->format,
+				   src_buffer, src_size, &len);
+	if (buf == NULL) {
+		g_set_error(error_r, pcm_convert_quark(), 0,
+			    "Conversion from %s to float is not implemented",
+			    sample_format_to_string(src_format->format));
+		return NULL;
+	}
+
+	if (src_format->channels != dest_format->channels) {
+		buf = pcm_convert_channels_float(&state->channels_buffer,
+						 dest_format->channels,
+						 src_format->channels,
+						 buf, len, &len);
+		if (buf == NULL) {
+			g_set_error(error_r, pcm_convert_quark(), 0,
+				    "Conversion from %u to %u channels "
+				    "is not implemented",
+				    src_format->channels,
+				    dest_format->channels);
+			return NULL;
+		}
+	}
+
+	if (src_format->sample_rate != dest_format->sample_rate) {
+		buf = pcm_resample_float(&state->resample,
+					 dest_format->channels,
+					 src_format->sample_rate, buf, len,
+					 dest_format->sample_rate, &len,
+					 error_r);
+		if (buf == NULL)
+			return NULL;
+	}
+
+	if (dest_format->reverse_endian) {
+		buf = (const float *)
+			pcm_byteswap_32(&state->byteswap_buffer,
+					(const int32_t *)buf, len);
+		assert(buf != NULL);
+	}
+
+	*dest_size_r = len;
+	return buf;
+}
+
 const void *
 pcm_convert(struct pcm_convert_state *state,
 	    const struct audio_format *src_format,
@@ -294,6 +351,12 @@ pcm_convert(struct pcm_convert_state *state,
 				      dest_format, dest_size_r,
 				      error_r);
 
+	case SAMPLE_FORMAT_FLOAT:
+		return pcm_convert_float(state,
+					 src_format, src, src_size,
+					 dest_format, dest_size_r,
+					 error_r);
+
 	default:
 		g_set_error(error_r, pcm_convert_quark(), 0,
 			    "PCM conversion to %s is not implemented",
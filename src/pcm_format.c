@@ -22,6 +22,11 @@
 #include "pcm_dither.h"
 #include "pcm_buffer.h"
 #include "pcm_pack.h"
+#include "pcm_simd.h"
+
+#include <glib.h>
+
+#include <float.h>
 
 static void
 pcm_convert_8_to_16(int16_t *out, const int8_t *in,
@@ -58,6 +63,45 @@ pcm_convert_24_to_24p32(struct pcm_buffer *buffer, const uint8_t *src,
 	return dest;
 }
 
+/**
+ * Converts a floating point sample to an integer with the specified
+ * number of bits, and clips it to the valid range.  NaN becomes
+ * silence.  Written without branches, so the compiler can vectorize
+ * the loops calling it.
+ */
+static inline int32_t
+pcm_float_to_sample(float sample, unsigned bits)
+{
+	const float factor = (float)(1u << (bits - 1));
+	/* the largest float below "factor"; for 32 bit, "factor - 1"
+	   would be rounded up to "factor" */
+	const float max = bits > 24
+		? factor * (1.0f - FLT_EPSILON / 2)
+		: factor - 1;
+
+	sample *= factor;
+	sample = sample == sample ? sample : 0;
+	sample = sample < max ? sample : max;
+	sample = sample > -factor ? sample : -factor;
+
+	return (int32_t)sample;
+}
+
+static void
+pcm_convert_float_to_bits(int32_t *out, const float *in,
+			  unsigned num_samples, unsigned bits)
+{
+	unsigned n = pcm_simd_convert_float_to_32(out, in, num_samples, bits);
+	out += n;
+	in += n;
+	num_samples -= n;
+
+	while (num_samples > 0) {
+		*out++ = pcm_float_to_sample(*in++, bits);
+		--num_samples;
+	}
+}
+
 const int16_t *
 pcm_convert_to_16(struct pcm_buffer *buffer, struct pcm_dither *dither,
 		  enum sample_format src_format, const void *src,
@@ -117,6 +161,20 @@ pcm_convert_to_16(struct pcm_buffer *buffer, struct pcm_dither *dither,
 				     (const int32_t *)src,
 				     num_samples);
 		return dest;
+
+	case SAMPLE_FORMAT_FLOAT:
+		/* convert to S24_P32 first, to be able to dither */
+		num_samples = src_size / 4;
+		dest32 = pcm_buffer_get(buffer, num_samples * 4);
+		pcm_convert_float_to_bits(dest32, (const float *)src,
+					  num_samples, 24);
+		dest = (int16_t *)dest32;
+
+		/* convert to 16 bit in-place */
+		*dest_size_r = num_samples * sizeof(*dest);
+		pcm_convert_24_to_16(dither, dest, dest32,
+				     num_samples);
+		return dest;
 	}
 
 	return NULL;
@@ -136,6 +194,11 @@ static void
 pcm_convert_16_to_24(int32_t *out, const int16_t *in,
 		     unsigned num_samples)
 {
+	unsigned n = pcm_simd_convert_16_to_32(out, in, num_samples, 8);
+	out += n;
+	in += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		*out++ = *in++ << 8;
 		--num_samples;
@@ -143,9 +206,14 @@ pcm_convert_16_to_24(int32_t *out, const int16_t *in,
 }
 
 static void
-pcm_convert_32_to_24(int32_t *out, const int16_t *in,
+pcm_convert_32_to_24(int32_t *out, const int32_t *in,
 		     unsigned num_samples)
 {
+	unsigned n = pcm_simd_shift_32(out, in, num_samples, -8);
+	out += n;
+	in += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		*out++ = *in++ >> 8;
 		--num_samples;
@@ -197,9 +265,18 @@ pcm_convert_to_24(struct pcm_buffer *buffer,
 		*dest_size_r = num_samples * sizeof(*dest);
 		dest = pcm_buffer_get(buffer, *dest_size_r);
 
-		pcm_convert_32_to_24(dest, (const int16_t *)src,
+		pcm_convert_32_to_24(dest, (const int32_t *)src,
 				     num_samples);
 		return dest;
+
+	case SAMPLE_FORMAT_FLOAT:
+		num_samples = src_size / 4;
+		*dest_size_r = num_samples * sizeof(*dest);
+		dest = pcm_buffer_get(buffer, *dest_size_r);
+
+		pcm_convert_float_to_bits(dest, (const float *)src,
+					  num_samples, 24);
+		return dest;
 	}
 
 	return NULL;
@@ -219,6 +296,11 @@ static void
 pcm_convert_16_to_32(int32_t *out, const int16_t *in,
 		     unsigned num_samples)
 {
+	unsigned n = pcm_simd_convert_16_to_32(out, in, num_samples, 16);
+	out += n;
+	in += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		*out++ = *in++ << 16;
 		--num_samples;
@@ -229,6 +311,11 @@ static void
 pcm_convert_24_to_32(int32_t *out, const int32_t *in,
 		     unsigned num_samples)
 {
+	unsigned n = pcm_simd_shift_32(out, in, num_samples, 8);
+	out += n;
+	in += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		*out++ = *in++ << 8;
 		--num_samples;
@@ -288,6 +375,133 @@ pcm_convert_to_32(struct pcm_buffer *buffer,
 	case SAMPLE_FORMAT_S32:
 		*dest_size_r = src_size;
 		return src;
+
+	case SAMPLE_FORMAT_FLOAT:
+		num_samples = src_size / 4;
+		*dest_size_r = num_samples * sizeof(*dest);
+		dest = pcm_buffer_get(buffer, *dest_size_r);
+
+		pcm_convert_float_to_bits(dest, (const float *)src,
+					  num_samples, 32);
+		return dest;
+	}
+
+	return NULL;
+}
+
+/**
+ * Converts integer samples with the specified number of significant
+ * bits to floating point.
+ */
+static void
+pcm_convert_int_to_float(float *out, const int32_t *in,
+			 unsigned num_samples, unsigned bits)
+{
+	const float factor = 1.0f / (float)(1u << (bits - 1));
+
+	unsigned n = pcm_simd_convert_32_to_float(out, in, num_samples, bits);
+	out += n;
+	in += n;
+	num_samples -= n;
+
+	while (num_samples > 0) {
+		*out++ = *in++ * factor;
+		--num_samples;
+	}
+}
+
+static void
+pcm_convert_8_to_float(float *out, const int8_t *in, unsigned num_samples)
+{
+	const float factor = 1.0f / (1 << 7);
+
+	while (num_samples > 0) {
+		*out++ = *in++ * factor;
+		--num_samples;
+	}
+}
+
+static void
+pcm_convert_16_to_float(float *out, const int16_t *in,
+			unsigned num_samples)
+{
+	const float factor = 1.0f / (1 << 15);
+
+	unsigned n = pcm_simd_convert_16_to_float(out, in, num_samples);
+	out += n;
+	in += n;
+	num_samples -= n;
+
+	while (num_samples > 0) {
+		*out++ = *in++ * factor;
+		--num_samples;
+	}
+}
+
+const float *
+pcm_convert_to_float(struct pcm_buffer *buffer,
+		     enum sample_format src_format, const void *src,
+		     size_t src_size, size_t *dest_size_r)
+{
+	unsigned num_samples;
+	float *dest;
+	int32_t *dest32;
+
+	switch (src_format) {
+	case SAMPLE_FORMAT_UNDEFINED:
+		break;
+
+	case SAMPLE_FORMAT_S8:
+		num_samples = src_size;
+		*dest_size_r = num_samples * sizeof(*dest);
+		dest = pcm_buffer_get(buffer, *dest_size_r);
+
+		pcm_convert_8_to_float(dest, (const int8_t *)src,
+				       num_samples);
+		return dest;
+
+	case SAMPLE_FORMAT_S16:
+		num_samples = src_size / 2;
+		*dest_size_r = num_samples * sizeof(*dest);
+		dest = pcm_buffer_get(buffer, *dest_size_r);
+
+		pcm_convert_16_to_float(dest, (const int16_t *)src,
+					num_samples);
+		return dest;
+
+	case SAMPLE_FORMAT_S24:
+		/* convert to S24_P32 first */
+		num_samples = src_size / 3;
+
+		dest32 = pcm_convert_24_to_24p32(buffer, src, num_samples);
+		dest = (float *)dest32;
+
+		/* convert to float in-place */
+		*dest_size_r = num_samples * sizeof(*dest);
+		pcm_convert_int_to_float(dest, dest32, num_samples, 24);
+		return dest;
+
+	case SAMPLE_FORMAT_S24_P32:
+		num_samples = src_size / 4;
+		*dest_size_r = num_samples * sizeof(*dest);
+		dest = pcm_buffer_get(buffer, *dest_size_r);
+
+		pcm_convert_int_to_float(dest, (const int32_t *)src,
+					 num_samples, 24);
+		return dest;
+
+	case SAMPLE_FORMAT_S32:
+		num_samples = src_size / 4;
+		*dest_size_r = num_samples * sizeof(*dest);
+		dest = pcm_buffer_get(buffer, *dest_size_r);
+
+		pcm_convert_int_to_float(dest, (const int32_t *)src,
+					 num_samples, 32);
+		return dest;
+
+	case SAMPLE_FORMAT_FLOAT:
+		*dest_size_r = src_size;
+		return src;
 	}
 
 	return NULL;
@@ -21,6 +21,7 @@
 #include "pcm_mix.h"
 #include "pcm_volume.h"
 #include "pcm_utils.h"
+#include "pcm_simd.h"
 #include "audio_format.h"
 
 #include <glib.h>
@@ -51,6 +52,12 @@ static void
 pcm_add_vol_16(int16_t *buffer1, const int16_t *buffer2,
 	       unsigned num_samples, int volume1, int volume2)
 {
+	unsigned n = pcm_simd_add_vol_16(buffer1, buffer2, num_samples,
+					 volume1, volume2);
+	buffer1 += n;
+	buffer2 += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		int32_t sample1 = *buffer1;
 		int32_t sample2 = *buffer2++;
@@ -68,6 +75,12 @@ static void
 pcm_add_vol_24(int32_t *buffer1, const int32_t *buffer2,
 	       unsigned num_samples, unsigned volume1, unsigned volume2)
 {
+	unsigned n = pcm_simd_add_vol_24(buffer1, buffer2, num_samples,
+					 volume1, volume2);
+	buffer1 += n;
+	buffer2 += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		int64_t sample1 = *buffer1;
 		int64_t sample2 = *buffer2++;
@@ -85,6 +98,12 @@ static void
 pcm_add_vol_32(int32_t *buffer1, const int32_t *buffer2,
 	       unsigned num_samples, unsigned volume1, unsigned volume2)
 {
+	unsigned n = pcm_simd_add_vol_32(buffer1, buffer2, num_samples,
+					 volume1, volume2);
+	buffer1 += n;
+	buffer2 += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		int64_t sample1 = *buffer1;
 		int64_t sample2 = *buffer2++;
@@ -98,6 +117,25 @@ pcm_add_vol_32(int32_t *buffer1, const int32_t *buffer2,
 	}
 }
 
+static void
+pcm_add_vol_float(float *buffer1, const float *buffer2,
+		  unsigned num_samples, float volume1, float volume2)
+{
+	unsigned n = pcm_simd_add_vol_float(buffer1, buffer2, num_samples,
+					    volume1, volume2);
+	buffer1 += n;
+	buffer2 += n;
+	num_samples -= n;
+
+	while (num_samples > 0) {
+		float sample1 = *buffer1;
+		float sample2 = *buffer2++;
+
+		*buffer1++ = sample1 * volume1 + sample2 * volume2;
+		--num_samples;
+	}
+}
+
 static void
 pcm_add_vol(void *buffer1, const void *buffer2, size_t size,
 	    int vol1, int vol2,
@@ -124,6 +162,12 @@ pcm_add_vol(void *buffer1, const void *buffer2, size_t size,
 			       size / 4, vol1, vol2);
 		break;
 
+	case SAMPLE_FORMAT_FLOAT:
+		pcm_add_vol_float((float *)buffer1, (const float *)buffer2,
+				  size / 4, pcm_volume_to_float(vol1),
+				  pcm_volume_to_float(vol2));
+		break;
+
 	default:
 		g_error("format %s not supported by pcm_add_vol",
 			sample_format_to_string(format->format));
@@ -147,6 +191,11 @@ pcm_add_8(int8_t *buffer1, const int8_t *buffer2, unsigned num_samples)
 static void
 pcm_add_16(int16_t *buffer1, const int16_t *buffer2, unsigned num_samples)
 {
+	unsigned n = pcm_simd_add_16(buffer1, buffer2, num_samples);
+	buffer1 += n;
+	buffer2 += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		int32_t sample1 = *buffer1;
 		int32_t sample2 = *buffer2++;
@@ -186,6 +235,23 @@ pcm_add_32(int32_t *buffer1, const int32_t *buffer2, unsigned num_samples)
 	}
 }
 
+static void
+pcm_add_float(float *buffer1, const float *buffer2, unsigned num_samples)
+{
+	unsigned n = pcm_simd_add_float(buffer1, buffer2, num_samples);
+	buffer1 += n;
+	buffer2 += n;
+	num_samples -= n;
+
+	while (num_samples > 0) {
+		float sample1 = *buffer1;
+		float sample2 = *buffer2++;
+
+		*buffer1++ = sample1 + sample2;
+		--num_samples;
+	}
+}
+
 static void
 pcm_add(void *buffer1, const void *buffer2, size_t size,
 	const struct audio_format *format)
@@ -207,6 +273,11 @@ pcm_add(void *buffer1, const void *buffer2, size_t size,
 		pcm_add_32((int32_t *)buffer1, (const int32_t *)buffer2, size / 4);
 		break;
 
+	case SAMPLE_FORMAT_FLOAT:
+		pcm_add_float((float *)buffer1, (const float *)buffer2,
+			      size / 4);
+		break;
+
 	default:
 		g_error("format %s not supported by pcm_add",
 			sample_format_to_string(format->format));
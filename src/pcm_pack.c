@@ -18,6 +18,7 @@
  */
 
 #include "pcm_pack.h"
+#include "pcm_simd.h"
 
 #include <glib.h>
 
@@ -42,6 +43,11 @@ pcm_pack_24(uint8_t *dest, const int32_t *src, unsigned num_samples,
 	   parameter to the pack_sample() inline function) */
 
 	if (G_LIKELY(!reverse_endian)) {
+		unsigned n = pcm_simd_pack_24(dest, src, num_samples);
+		dest += n * 3;
+		src += n;
+		num_samples -= n;
+
 		while (num_samples-- > 0) {
 			pack_sample(dest, src++, false);
 			dest += 3;
@@ -80,6 +86,11 @@ pcm_unpack_24(int32_t *dest, const uint8_t *src, unsigned num_samples,
 	   parameter to the unpack_sample() inline function) */
 
 	if (G_LIKELY(!reverse_endian)) {
+		unsigned n = pcm_simd_unpack_24(dest, src, num_samples);
+		dest += n;
+		src += n * 3;
+		num_samples -= n;
+
 		while (num_samples-- > 0) {
 			unpack_sample(dest++, src, false);
 			src += 3;
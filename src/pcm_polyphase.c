@@ -0,0 +1,525 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "pcm_polyphase.h"
+#include "pcm_simd.h"
+#include "pcm_utils.h"
+
+#include <glib.h>
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "pcm"
+
+enum {
+	/**
+	 * The maximum number of rows in the coefficient table.  This
+	 * is enough for all common sample rates (44.1 kHz to 48 kHz
+	 * needs 160), and limits the table to a few hundred kB for
+	 * exotic ones.
+	 */
+	PCM_POLYPHASE_MAX_PHASES = 1024,
+};
+
+static const struct {
+	/** stop band attenuation in dB */
+	double attenuation;
+
+	/** the end of the pass band, relative to the Nyquist frequency */
+	double passband;
+} pcm_polyphase_qualities[] = {
+	[PCM_POLYPHASE_FAST] = { 60, 0.80 },
+	[PCM_POLYPHASE_MEDIUM] = { 90, 0.90 },
+	[PCM_POLYPHASE_BEST] = { 120, 0.95 },
+};
+
+/**
+ * The parameters of the prototype filter, see pcm_polyphase_row().
+ */
+struct pcm_polyphase_filter {
+	unsigned taps;
+	unsigned num_phases;
+
+	/** the cutoff frequency, relative to the input Nyquist frequency */
+	double cutoff;
+
+	/** the Kaiser window parameter */
+	double beta, i0_beta;
+};
+
+void
+pcm_polyphase_init(struct pcm_polyphase *p)
+{
+	memset(p, 0, sizeof(*p));
+
+	pcm_buffer_init(&p->planar);
+	pcm_buffer_init(&p->output);
+}
+
+void
+pcm_polyphase_deinit(struct pcm_polyphase *p)
+{
+	g_free(p->coefficients);
+	p->coefficients = NULL;
+	g_free(p->history_buffer);
+	p->history_buffer = NULL;
+
+	pcm_buffer_deinit(&p->planar);
+	pcm_buffer_deinit(&p->output);
+}
+
+static unsigned
+pcm_polyphase_gcd(unsigned a, unsigned b)
+{
+	while (b != 0) {
+		unsigned t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/**
+ * The modified Bessel function of the first kind, order 0.
+ */
+static double
+pcm_polyphase_i0(double x)
+{
+	double sum = 1, term = 1;
+
+	x = x * x / 4;
+	for (unsigned k = 1; term > sum * 1e-21; ++k) {
+		term *= x / ((double)k * k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+/**
+ * Calculates one row of the coefficient table, normalized to a DC
+ * gain of 1.
+ *
+ * The row for the fractional position "phase / num_phases" is
+ * applied to the input frames [i, i + taps), and yields the output
+ * frame at i + taps / 2 - 1 + phase / num_phases.
+ *
+ * @return the sum of the absolute values of the coefficients
+ */
+static double
+pcm_polyphase_row(const struct pcm_polyphase_filter *filter,
+		  unsigned phase, double *row)
+{
+	const double half = filter->taps / 2;
+	const double offset = half - 1 + (double)phase / filter->num_phases;
+	double sum = 0, sum_abs = 0;
+
+	for (unsigned j = 0; j < filter->taps; ++j) {
+		const double x = offset - j, r = x / half;
+		double h;
+
+		if (r <= -1 || r >= 1)
+			h = 0;
+		else {
+			h = x == 0
+				? filter->cutoff
+				: sin(M_PI * filter->cutoff * x) / (M_PI * x);
+			h *= pcm_polyphase_i0(filter->beta * sqrt(1 - r * r))
+				/ filter->i0_beta;
+		}
+
+		row[j] = h;
+		sum += h;
+	}
+
+	for (unsigned j = 0; j < filter->taps; ++j) {
+		row[j] /= sum;
+		sum_abs += fabs(row[j]);
+	}
+
+	return sum_abs;
+}
+
+/**
+ * Converts the coefficients to fixed point.  The number of
+ * fractional bits is chosen so that neither a coefficient nor a dot
+ * product with 16 bit samples can overflow.
+ */
+static void
+pcm_polyphase_build_16(struct pcm_polyphase *p,
+		       const struct pcm_polyphase_filter *filter,
+		       double *row)
+{
+	const unsigned taps = filter->taps;
+	int16_t *coefficients;
+	gint64 *q = g_new(gint64, taps);
+	double max_sum = 0, max_value = 0;
+
+	for (unsigned i = 0; i < filter->num_phases; ++i) {
+		double sum = pcm_polyphase_row(filter, i, row);
+		if (sum > max_sum)
+			max_sum = sum;
+
+		for (unsigned j = 0; j < taps; ++j)
+			if (fabs(row[j]) > max_value)
+				max_value = fabs(row[j]);
+	}
+
+	/* rounding may add up to 1 per coefficient, hence the
+	   "+ taps" */
+	p->shift = 15;
+	while (p->shift > 8 &&
+	       (max_value * (1 << p->shift) + 1 > 32767 ||
+		max_sum * (1 << p->shift) + taps >= 65536))
+		--p->shift;
+
+	/* the low parts are at most 2^(lo_bits-1) each */
+	p->lo_bits = 0;
+	while ((guint64)taps << (15 + p->lo_bits) < ((guint64)1 << 31))
+		++p->lo_bits;
+
+	p->coefficients = coefficients =
+		g_new(int16_t, filter->num_phases * taps * 2);
+
+	for (unsigned i = 0; i < filter->num_phases; ++i) {
+		int16_t *hi = coefficients + i * taps * 2, *lo = hi + taps;
+		const unsigned bits = p->shift + p->lo_bits;
+		gint64 sum = 0;
+		unsigned center = 0;
+
+		pcm_polyphase_row(filter, i, row);
+
+		for (unsigned j = 0; j < taps; ++j) {
+			q[j] = llrint(ldexp(row[j], bits));
+			sum += q[j];
+
+			if (q[j] > q[center])
+				center = j;
+		}
+
+		/* fix the DC gain after rounding */
+		q[center] += ((gint64)1 << bits) - sum;
+
+		for (unsigned j = 0; j < taps; ++j) {
+			hi[j] = p->lo_bits > 0
+				? (q[j] + (1 << (p->lo_bits - 1))) >> p->lo_bits
+				: q[j];
+			lo[j] = q[j] - ((gint64)hi[j] << p->lo_bits);
+		}
+	}
+
+	g_free(q);
+}
+
+static void
+pcm_polyphase_build_float(struct pcm_polyphase *p,
+			  const struct pcm_polyphase_filter *filter,
+			  double *row)
+{
+	float *coefficients;
+
+	p->coefficients = coefficients =
+		g_new(float, filter->num_phases * filter->taps);
+
+	for (unsigned i = 0; i < filter->num_phases; ++i) {
+		float *f = coefficients + i * filter->taps;
+
+		pcm_polyphase_row(filter, i, row);
+
+		for (unsigned j = 0; j < filter->taps; ++j)
+			f[j] = row[j];
+	}
+}
+
+/**
+ * Designs the filter with the Kaiser method: the length follows
+ * from the attenuation and the width of the transition band, which
+ * ends at the Nyquist frequency of the lower sample rate.
+ */
+static void
+pcm_polyphase_build(struct pcm_polyphase *p)
+{
+	const double attenuation =
+		pcm_polyphase_qualities[p->quality].attenuation;
+	const double passband = pcm_polyphase_qualities[p->quality].passband;
+	/* when downsampling, the filter must be narrower (and
+	   longer) by the resampling ratio */
+	const double ratio = p->up < p->down
+		? (double)p->up / p->down : 1.0;
+	const double transition = ratio * (1 - passband) / 2;
+	struct pcm_polyphase_filter filter;
+	double *row;
+
+	filter.taps = ceil((attenuation - 8) /
+			   (2.285 * 2 * M_PI * transition));
+	filter.taps = (filter.taps + 7) & ~7u;
+	filter.num_phases = MIN(p->up, (unsigned)PCM_POLYPHASE_MAX_PHASES);
+	filter.cutoff = ratio * (1 + passband) / 2;
+	filter.beta = 0.1102 * (attenuation - 8.7);
+	filter.i0_beta = pcm_polyphase_i0(filter.beta);
+
+	p->taps = filter.taps;
+	p->num_phases = filter.num_phases;
+
+	row = g_new(double, filter.taps);
+
+	if (p->integer)
+		pcm_polyphase_build_16(p, &filter, row);
+	else
+		pcm_polyphase_build_float(p, &filter, row);
+
+	g_free(row);
+}
+
+void
+pcm_polyphase_setup(struct pcm_polyphase *p,
+		    enum pcm_polyphase_quality quality,
+		    uint8_t channels, unsigned src_rate, unsigned dest_rate,
+		    bool integer)
+{
+	unsigned divisor;
+	size_t sample_size;
+
+	if (p->coefficients != NULL && p->quality == quality &&
+	    p->channels == channels && p->src_rate == src_rate &&
+	    p->dest_rate == dest_rate && p->integer == integer)
+		return;
+
+	g_free(p->coefficients);
+	g_free(p->history_buffer);
+
+	p->quality = quality;
+	p->channels = channels;
+	p->src_rate = src_rate;
+	p->dest_rate = dest_rate;
+	p->integer = integer;
+
+	divisor = pcm_polyphase_gcd(src_rate, dest_rate);
+	p->up = dest_rate / divisor;
+	p->down = src_rate / divisor;
+
+	pcm_polyphase_build(p);
+
+	g_debug("polyphase resampler %u:%u, %u taps, %u phases, %s",
+		p->up, p->down, p->taps, p->num_phases,
+		integer ? "16 bit" : "float");
+
+	sample_size = integer ? sizeof(int16_t) : sizeof(float);
+	p->history_buffer = g_malloc0(channels * p->taps * sample_size);
+
+	/* start with silence, so the first output frame is aligned
+	   with the first input frame */
+	p->history = p->taps / 2 - 1;
+	p->phase = 0;
+	p->skip = 0;
+}
+
+/**
+ * Returns the maximum number of output frames for the specified
+ * number of input frames (history included).
+ */
+static unsigned
+pcm_polyphase_max_frames(const struct pcm_polyphase *p, unsigned length)
+{
+	if (length < p->skip + p->taps)
+		return 0;
+
+	return (uint64_t)(length - p->skip) * p->up / p->down + 1;
+}
+
+static inline unsigned
+pcm_polyphase_phase_row(const struct pcm_polyphase *p, unsigned phase)
+{
+	return p->num_phases == p->up
+		? phase
+		: (uint64_t)phase * p->num_phases / p->up;
+}
+
+/**
+ * Saves the unused input frames for the next call.
+ */
+static void
+pcm_polyphase_finish(struct pcm_polyphase *p, const void *planar,
+		     unsigned length, unsigned index, unsigned phase,
+		     size_t sample_size)
+{
+	p->phase = phase;
+
+	if (index >= length) {
+		p->skip = index - length;
+		p->history = 0;
+		return;
+	}
+
+	p->skip = 0;
+	p->history = length - index;
+	assert(p->history < p->taps);
+
+	for (unsigned c = 0; c < p->channels; ++c)
+		memcpy((char *)p->history_buffer + c * p->taps * sample_size,
+		       (const char *)planar + (c * length + index) * sample_size,
+		       p->history * sample_size);
+}
+
+static inline int32_t
+pcm_polyphase_dot_16(const int16_t *x, const int16_t *h, unsigned n)
+{
+	int32_t sum = 0;
+
+	for (unsigned i = pcm_simd_dot_16(&sum, x, h, n); i < n; ++i)
+		sum += x[i] * h[i];
+
+	return sum;
+}
+
+/**
+ * Applies one row of integer coefficients (see
+ * pcm_polyphase_build_16()).
+ */
+static inline int16_t
+pcm_polyphase_fir_16(const struct pcm_polyphase *p,
+		     const int16_t *x, const int16_t *h)
+{
+	const unsigned bits = p->shift + p->lo_bits;
+	gint64 sum = (gint64)pcm_polyphase_dot_16(x, h, p->taps) << p->lo_bits;
+
+	if (p->lo_bits > 0)
+		sum += pcm_polyphase_dot_16(x, h + p->taps, p->taps);
+
+	sum = (sum + ((gint64)1 << (bits - 1))) >> bits;
+	return pcm_range_64(sum, 16);
+}
+
+static inline float
+pcm_polyphase_dot_float(const float *x, const float *h, unsigned n)
+{
+	float sum = 0;
+
+	for (unsigned i = pcm_simd_dot_float(&sum, x, h, n); i < n; ++i)
+		sum += x[i] * h[i];
+
+	return sum;
+}
+
+const int16_t *
+pcm_polyphase_process_16(struct pcm_polyphase *p,
+			 const int16_t *src, size_t src_size,
+			 size_t *dest_size_r)
+{
+	const unsigned channels = p->channels, taps = p->taps;
+	const unsigned src_frames = src_size / (channels * sizeof(*src));
+	const unsigned length = p->history + src_frames;
+	const int16_t *coefficients = p->coefficients;
+	const int16_t *history = p->history_buffer;
+	int16_t *planar = pcm_buffer_get(&p->planar, length * channels *
+					 sizeof(*planar));
+	int16_t *dest = pcm_buffer_get(&p->output,
+				       pcm_polyphase_max_frames(p, length) *
+				       channels * sizeof(*dest));
+	unsigned index = p->skip, phase = p->phase, num_frames = 0;
+
+	assert(p->integer);
+	assert(src_size % (channels * sizeof(*src)) == 0);
+
+	for (unsigned c = 0; c < channels; ++c) {
+		int16_t *x = planar + c * length;
+
+		memcpy(x, history + c * taps, p->history * sizeof(*x));
+		for (unsigned i = 0; i < src_frames; ++i)
+			x[p->history + i] = src[i * channels + c];
+
+		index = p->skip;
+		phase = p->phase;
+		num_frames = 0;
+
+		while (index + taps <= length) {
+			const int16_t *h = coefficients +
+				pcm_polyphase_phase_row(p, phase) * taps * 2;
+
+			dest[num_frames++ * channels + c] =
+				pcm_polyphase_fir_16(p, x + index, h);
+
+			phase += p->down;
+			index += phase / p->up;
+			phase %= p->up;
+		}
+	}
+
+	pcm_polyphase_finish(p, planar, length, index, phase,
+			     sizeof(*planar));
+
+	*dest_size_r = num_frames * channels * sizeof(*dest);
+	return dest;
+}
+
+const float *
+pcm_polyphase_process_float(struct pcm_polyphase *p,
+			    const float *src, size_t src_size,
+			    size_t *dest_size_r)
+{
+	const unsigned channels = p->channels, taps = p->taps;
+	const unsigned src_frames = src_size / (channels * sizeof(*src));
+	const unsigned length = p->history + src_frames;
+	const float *coefficients = p->coefficients;
+	const float *history = p->history_buffer;
+	float *planar = pcm_buffer_get(&p->planar, length * channels *
+				       sizeof(*planar));
+	float *dest = pcm_buffer_get(&p->output,
+				     pcm_polyphase_max_frames(p, length) *
+				     channels * sizeof(*dest));
+	unsigned index = p->skip, phase = p->phase, num_frames = 0;
+
+	assert(!p->integer);
+	assert(src_size % (channels * sizeof(*src)) == 0);
+
+	for (unsigned c = 0; c < channels; ++c) {
+		float *x = planar + c * length;
+
+		memcpy(x, history + c * taps, p->history * sizeof(*x));
+		for (unsigned i = 0; i < src_frames; ++i)
+			x[p->history + i] = src[i * channels + c];
+
+		index = p->skip;
+		phase = p->phase;
+		num_frames = 0;
+
+		while (index + taps <= length) {
+			const float *h = coefficients +
+				pcm_polyphase_phase_row(p, phase) * taps;
+
+			dest[num_frames++ * channels + c] =
+				pcm_polyphase_dot_float(x + index, h, taps);
+
+			phase += p->down;
+			index += phase / p->up;
+			phase %= p->up;
+		}
+	}
+
+	pcm_polyphase_finish(p, planar, length, index, phase,
+			     sizeof(*planar));
+
+	*dest_size_r = num_frames * channels * sizeof(*dest);
+	return dest;
+}
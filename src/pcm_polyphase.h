@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/** \file
+ *
+ * A polyphase FIR resampler.  The ratio of the sample rates is
+ * reduced to a fraction up/down; the output is the input upsampled
+ * by "up", low-pass filtered and decimated by "down", but only the
+ * filter taps which contribute to an output sample are evaluated.
+ * The filter is a Kaiser windowed sinc, whose length depends on the
+ * selected quality.
+ *
+ * 16 bit samples are filtered with fixed point coefficients, without
+ * floating point operations; everything else is converted to
+ * floating point by the caller.
+ */
+
+#ifndef MPD_PCM_POLYPHASE_H
+#define MPD_PCM_POLYPHASE_H
+
+#include "pcm_buffer.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+enum pcm_polyphase_quality {
+	/**
+	 * 60 dB stop band attenuation, pass band up to 80% of the
+	 * Nyquist frequency.
+	 */
+	PCM_POLYPHASE_FAST,
+
+	/**
+	 * 90 dB stop band attenuation, pass band up to 90% of the
+	 * Nyquist frequency.
+	 */
+	PCM_POLYPHASE_MEDIUM,
+
+	/**
+	 * 120 dB stop band attenuation, pass band up to 95% of the
+	 * Nyquist frequency.
+	 */
+	PCM_POLYPHASE_BEST,
+};
+
+struct pcm_polyphase {
+	unsigned src_rate, dest_rate;
+	uint8_t channels;
+	enum pcm_polyphase_quality quality;
+
+	/**
+	 * Use 16 bit samples and coefficients?
+	 */
+	bool integer;
+
+	/**
+	 * The reduced ratio of the sample rates: #up output frames
+	 * for #down input frames.
+	 */
+	unsigned up, down;
+
+	/**
+	 * The number of rows in the coefficient table.  This equals
+	 * #up, unless #up is too large; in that case, the phase is
+	 * rounded down to the nearest row.
+	 */
+	unsigned num_phases;
+
+	/**
+	 * The number of coefficients per row, a multiple of 8.
+	 */
+	unsigned taps;
+
+	/**
+	 * The integer coefficients are fixed point numbers with
+	 * #shift + #lo_bits fractional bits, split into a "high" and
+	 * a "low" 16 bit part.  Both dot products fit into 32 bits;
+	 * they are combined to 64 bits.
+	 */
+	unsigned shift, lo_bits;
+
+	/**
+	 * #num_phases rows of #taps coefficients (float), or of 2 *
+	 * #taps coefficients (int16_t; the high parts followed by the
+	 * low parts).
+	 */
+	void *coefficients;
+
+	/**
+	 * The position of the next output frame between two input
+	 * frames, in units of 1/#up.
+	 */
+	unsigned phase;
+
+	/**
+	 * The number of input frames to be skipped in the next call.
+	 * This is non-zero only when downsampling.
+	 */
+	unsigned skip;
+
+	/**
+	 * The number of input frames kept from the previous call.
+	 */
+	unsigned history;
+
+	/**
+	 * The tail of the previous input, one row of #taps samples
+	 * per channel.
+	 */
+	void *history_buffer;
+
+	/**
+	 * The input of the current call, history included, one row
+	 * per channel.
+	 */
+	struct pcm_buffer planar;
+
+	struct pcm_buffer output;
+};
+
+void
+pcm_polyphase_init(struct pcm_polyphase *p);
+
+void
+pcm_polyphase_deinit(struct pcm_polyphase *p);
+
+/**
+ * Prepares the resampler for the specified format.  If it differs
+ * from the previous one, the filter is rebuilt and the history is
+ * discarded; otherwise, this is a no-op.
+ *
+ * @param integer true for 16 bit samples, false for floating point
+ */
+void
+pcm_polyphase_setup(struct pcm_polyphase *p,
+		    enum pcm_polyphase_quality quality,
+		    uint8_t channels, unsigned src_rate, unsigned dest_rate,
+		    bool integer);
+
+/**
+ * Resamples 16 bit samples.  pcm_polyphase_setup() must have been
+ * called with integer=true.  The number of output frames varies
+ * from call to call; the filter delay is compensated, but the last
+ * few input frames are held back until the next call.
+ */
+const int16_t *
+pcm_polyphase_process_16(struct pcm_polyphase *p,
+			 const int16_t *src, size_t src_size,
+			 size_t *dest_size_r);
+
+/**
+ * Resamples floating point samples.  pcm_polyphase_setup() must
+ * have been called with integer=false.
+ */
+const float *
+pcm_polyphase_process_float(struct pcm_polyphase *p,
+			    const float *src, size_t src_size,
+			    size_t *dest_size_r);
+
+#endif
@@ -24,14 +24,35 @@
 #include "conf.h"
 #endif
 
+#include <glib.h>
+
 #include <string.h>
 
+bool
+pcm_resample_parse_internal(const char *conf, const char **quality_r)
+{
+	if (g_ascii_strncasecmp(conf, "internal", 8) != 0)
+		return false;
+
+	conf += 8;
+	if (*conf != 0 && !g_ascii_isspace(*conf))
+		/* some other word which begins with "internal" */
+		return false;
+
+	while (g_ascii_isspace(*conf))
+		++conf;
+
+	if (quality_r != NULL)
+		*quality_r = conf;
+	return true;
+}
+
 #ifdef HAVE_LIBSAMPLERATE
 static bool
 pcm_resample_lsr_enabled(void)
 {
-	return strcmp(config_get_string(CONF_SAMPLERATE_CONVERTER, ""),
-		      "internal") != 0;
+	return !pcm_resample_parse_internal
+		(config_get_string(CONF_SAMPLERATE_CONVERTER, ""), NULL);
 }
 #endif
 
@@ -46,6 +67,7 @@ void pcm_resample_init(struct pcm_resample_state *state)
 	}
 #endif
 
+	pcm_polyphase_init(&state->polyphase);
 	pcm_buffer_init(&state->buffer);
 }
 
@@ -59,6 +81,29 @@ void pcm_resample_deinit(struct pcm_resample_state *state)
 		pcm_resample_fallback_deinit(state);
 }
 
+const float *
+pcm_resample_float(struct pcm_resample_state *state,
+		   uint8_t channels,
+		   unsigned src_rate,
+		   const float *src_buffer, size_t src_size,
+		   unsigned dest_rate, size_t *dest_size_r,
+		   GError **error_r)
+{
+#ifdef HAVE_LIBSAMPLERATE
+	if (pcm_resample_lsr_enabled())
+		return pcm_resample_lsr_float(state, channels,
+					      src_rate, src_buffer, src_size,
+					      dest_rate, dest_size_r,
+					      error_r);
+#else
+	(void)error_r;
+#endif
+
+	return pcm_resample_fallback_float(state, channels,
+					   src_rate, src_buffer, src_size,
+					   dest_rate, dest_size_r);
+}
+
 const int16_t *
 pcm_resample_16(struct pcm_resample_state *state,
 		uint8_t channels,
@@ -81,6 +126,30 @@ pcm_resample_16(struct pcm_resample_state *state,
 					dest_rate, dest_size_r);
 }
 
+const int32_t *
+pcm_resample_24(struct pcm_resample_state *state,
+		uint8_t channels,
+		unsigned src_rate, const int32_t *src_buffer, size_t src_size,
+		unsigned dest_rate, size_t *dest_size_r,
+		GError **error_r)
+{
+#ifdef HAVE_LIBSAMPLERATE
+	/* reuse the 32 bit code - libsamplerate doesn't care if the
+	   upper 8 bits are actually used */
+	if (pcm_resample_lsr_enabled())
+		return pcm_resample_lsr_32(state, channels,
+					   src_rate, src_buffer, src_size,
+					   dest_rate, dest_size_r,
+					   error_r);
+#else
+	(void)error_r;
+#endif
+
+	return pcm_resample_fallback_24(state, channels,
+					src_rate, src_buffer, src_size,
+					dest_rate, dest_size_r);
+}
+
 const int32_t *
 pcm_resample_32(struct pcm_resample_state *state,
 		uint8_t channels,
@@ -22,6 +22,7 @@
 
 #include "check.h"
 #include "pcm_buffer.h"
+#include "pcm_polyphase.h"
 
 #include <stdint.h>
 #include <stddef.h>
@@ -51,6 +52,12 @@ struct pcm_resample_state {
 	int error;
 #endif
 
+	/**
+	 * The built-in resampler, used when libsamplerate is not
+	 * available or disabled.
+	 */
+	struct pcm_polyphase polyphase;
+
 	struct pcm_buffer buffer;
 };
 
@@ -65,6 +72,26 @@ void pcm_resample_init(struct pcm_resample_state *state);
  */
 void pcm_resample_deinit(struct pcm_resample_state *state);
 
+/**
+ * Resamples 32 bit float data.
+ *
+ * @param state an initialized pcm_resample_state object
+ * @param channels the number of channels
+ * @param src_rate the source sample rate
+ * @param src the source PCM buffer
+ * @param src_size the size of #src in bytes
+ * @param dest_rate the requested destination sample rate
+ * @param dest_size_r returns the number of bytes of the destination buffer
+ * @return the destination buffer
+ */
+const float *
+pcm_resample_float(struct pcm_resample_state *state,
+		   uint8_t channels,
+		   unsigned src_rate,
+		   const float *src_buffer, size_t src_size,
+		   unsigned dest_rate, size_t *dest_size_r,
+		   GError **error_r);
+
 /**
  * Resamples 16 bit PCM data.
  *
@@ -117,19 +144,12 @@ pcm_resample_32(struct pcm_resample_state *state,
  * @param dest_size_r returns the number of bytes of the destination buffer
  * @return the destination buffer
  */
-static inline const int32_t *
+const int32_t *
 pcm_resample_24(struct pcm_resample_state *state,
 		uint8_t channels,
 		unsigned src_rate,
 		const int32_t *src_buffer, size_t src_size,
 		unsigned dest_rate, size_t *dest_size_r,
-		GError **error_r)
-{
-	/* reuse the 32 bit code - the resampler code doesn't care if
-	   the upper 8 bits are actually used */
-	return pcm_resample_32(state, channels,
-			       src_rate, src_buffer, src_size,
-			       dest_rate, dest_size_r, error_r);
-}
+		GError **error_r);
 
 #endif
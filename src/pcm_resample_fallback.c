@@ -19,16 +19,109 @@
 
 #include "config.h"
 #include "pcm_resample_internal.h"
+#include "pcm_format.h"
+#include "audio_format.h"
+#include "conf.h"
+
+#include <glib.h>
 
 #include <assert.h>
+#include <stdlib.h>
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "pcm"
+
+/**
+ * Parses the "samplerate_converter" setting: "internal", optionally
+ * followed by "fast", "medium" or "best".  The libsamplerate names
+ * and numbers are mapped to the nearest quality, so a configuration
+ * written for libsamplerate keeps working without it.
+ */
+static enum pcm_polyphase_quality
+pcm_resample_fallback_get_quality(void)
+{
+	const char *conf = config_get_string(CONF_SAMPLERATE_CONVERTER,
+					     NULL);
+	const char *quality;
+	char *endptr;
+	long value;
+
+	if (conf == NULL)
+		return PCM_POLYPHASE_MEDIUM;
+
+	if (pcm_resample_parse_internal(conf, &quality)) {
+		if (*quality == 0 || g_ascii_strcasecmp(quality, "medium") == 0)
+			return PCM_POLYPHASE_MEDIUM;
+
+		if (g_ascii_strcasecmp(quality, "best") == 0)
+			return PCM_POLYPHASE_BEST;
+
+		if (g_ascii_strcasecmp(quality, "fast") == 0)
+			return PCM_POLYPHASE_FAST;
+
+		g_warning("unknown samplerate converter \"%s\"", conf);
+		return PCM_POLYPHASE_MEDIUM;
+	}
+
+	/* a libsamplerate setting: map its numbers and names
+	   (e.g. "Best Sinc Interpolator") */
+	value = strtol(conf, &endptr, 10);
+	if (endptr != conf && *endptr == 0)
+		/* SRC_SINC_BEST_QUALITY, SRC_SINC_MEDIUM_QUALITY,
+		   anything else */
+		return value == 0
+			? PCM_POLYPHASE_BEST
+			: (value == 1 ? PCM_POLYPHASE_MEDIUM
+			   : PCM_POLYPHASE_FAST);
+
+	if (*conf == 0 || g_ascii_strncasecmp(conf, "medium", 6) == 0)
+		return PCM_POLYPHASE_MEDIUM;
+
+	if (g_ascii_strncasecmp(conf, "best", 4) == 0)
+		return PCM_POLYPHASE_BEST;
+
+	if (g_ascii_strncasecmp(conf, "fast", 4) == 0)
+		return PCM_POLYPHASE_FAST;
+
+	g_warning("unknown samplerate converter \"%s\"", conf);
+	return PCM_POLYPHASE_MEDIUM;
+}
+
+static enum pcm_polyphase_quality
+pcm_resample_fallback_quality(void)
+{
+	static int quality = -1;
+
+	if (quality < 0)
+		quality = pcm_resample_fallback_get_quality();
+
+	return quality;
+}
 
 void
 pcm_resample_fallback_deinit(struct pcm_resample_state *state)
 {
+	pcm_polyphase_deinit(&state->polyphase);
 	pcm_buffer_deinit(&state->buffer);
 }
 
-/* resampling code blatantly ripped from ESD */
+const float *
+pcm_resample_fallback_float(struct pcm_resample_state *state,
+			    uint8_t channels,
+			    unsigned src_rate,
+			    const float *src_buffer, size_t src_size,
+			    unsigned dest_rate,
+			    size_t *dest_size_r)
+{
+	pcm_polyphase_setup(&state->polyphase,
+			    pcm_resample_fallback_quality(),
+			    channels, src_rate, dest_rate, false);
+
+	return pcm_polyphase_process_float(&state->polyphase,
+					   src_buffer, src_size,
+					   dest_size_r);
+}
+
 const int16_t *
 pcm_resample_fallback_16(struct pcm_resample_state *state,
 			 uint8_t channels,
@@ -37,76 +130,72 @@ pcm_resample_fallback_16(struct pcm_resample_state *state,
 			 unsigned dest_rate,
 			 size_t *dest_size_r)
 {
-	unsigned src_pos, dest_pos = 0;
-	unsigned src_frames = src_size / channels / sizeof(*src_buffer);
-	unsigned dest_frames =
-		(src_frames * dest_rate + src_rate - 1) / src_rate;
-	unsigned dest_samples = dest_frames * channels;
-	size_t dest_size = dest_samples * sizeof(*src_buffer);
-	int16_t *dest_buffer = pcm_buffer_get(&state->buffer, dest_size);
-
-	assert((src_size % (sizeof(*src_buffer) * channels)) == 0);
-
-	switch (channels) {
-	case 1:
-		while (dest_pos < dest_samples) {
-			src_pos = dest_pos * src_rate / dest_rate;
-
-			dest_buffer[dest_pos++] = src_buffer[src_pos];
-		}
-		break;
-	case 2:
-		while (dest_pos < dest_samples) {
-			src_pos = dest_pos * src_rate / dest_rate;
-			src_pos &= ~1;
-
-			dest_buffer[dest_pos++] = src_buffer[src_pos];
-			dest_buffer[dest_pos++] = src_buffer[src_pos + 1];
-		}
-		break;
-	}
+	pcm_polyphase_setup(&state->polyphase,
+			    pcm_resample_fallback_quality(),
+			    channels, src_rate, dest_rate, true);
+
+	return pcm_polyphase_process_16(&state->polyphase,
+					src_buffer, src_size,
+					dest_size_r);
+}
+
+/**
+ * Resamples 24 or 32 bit samples by converting them to floating
+ * point and back.
+ */
+static const int32_t *
+pcm_resample_fallback_wide(struct pcm_resample_state *state,
+			   enum sample_format format,
+			   uint8_t channels,
+			   unsigned src_rate,
+			   const int32_t *src_buffer, size_t src_size,
+			   unsigned dest_rate,
+			   size_t *dest_size_r)
+{
+	const float *buffer;
+	size_t size;
+
+	buffer = pcm_convert_to_float(&state->buffer, format,
+				      src_buffer, src_size, &size);
+	assert(buffer != NULL);
+
+	buffer = pcm_resample_fallback_float(state, channels,
+					     src_rate, buffer, size,
+					     dest_rate, &size);
 
-	*dest_size_r = dest_size;
-	return dest_buffer;
+	/* the input buffer is not needed anymore, and can be reused
+	   for the output */
+	return format == SAMPLE_FORMAT_S24_P32
+		? pcm_convert_to_24(&state->buffer, SAMPLE_FORMAT_FLOAT,
+				    buffer, size, dest_size_r)
+		: pcm_convert_to_32(&state->buffer, SAMPLE_FORMAT_FLOAT,
+				    buffer, size, dest_size_r);
 }
 
 const int32_t *
-pcm_resample_fallback_32(struct pcm_resample_state *state,
+pcm_resample_fallback_24(struct pcm_resample_state *state,
 			 uint8_t channels,
 			 unsigned src_rate,
 			 const int32_t *src_buffer, size_t src_size,
 			 unsigned dest_rate,
 			 size_t *dest_size_r)
 {
-	unsigned src_pos, dest_pos = 0;
-	unsigned src_frames = src_size / channels / sizeof(*src_buffer);
-	unsigned dest_frames =
-		(src_frames * dest_rate + src_rate - 1) / src_rate;
-	unsigned dest_samples = dest_frames * channels;
-	size_t dest_size = dest_samples * sizeof(*src_buffer);
-	int32_t *dest_buffer = pcm_buffer_get(&state->buffer, dest_size);
-
-	assert((src_size % (sizeof(*src_buffer) * channels)) == 0);
-
-	switch (channels) {
-	case 1:
-		while (dest_pos < dest_samples) {
-			src_pos = dest_pos * src_rate / dest_rate;
-
-			dest_buffer[dest_pos++] = src_buffer[src_pos];
-		}
-		break;
-	case 2:
-		while (dest_pos < dest_samples) {
-			src_pos = dest_pos * src_rate / dest_rate;
-			src_pos &= ~1;
-
-			dest_buffer[dest_pos++] = src_buffer[src_pos];
-			dest_buffer[dest_pos++] = src_buffer[src_pos + 1];
-		}
-		break;
-	}
+	return pcm_resample_fallback_wide(state, SAMPLE_FORMAT_S24_P32,
+					  channels, src_rate,
+					  src_buffer, src_size,
+					  dest_rate, dest_size_r);
+}
 
-	*dest_size_r = dest_size;
-	return dest_buffer;
+const int32_t *
+pcm_resample_fallback_32(struct pcm_resample_state *state,
+			 uint8_t channels,
+			 unsigned src_rate,
+			 const int32_t *src_buffer, size_t src_size,
+			 unsigned dest_rate,
+			 size_t *dest_size_r)
+{
+	return pcm_resample_fallback_wide(state, SAMPLE_FORMAT_S32,
+					  channels, src_rate,
+					  src_buffer, src_size,
+					  dest_rate, dest_size_r);
 }
@@ -30,11 +30,32 @@
 #include "check.h"
 #include "pcm_resample.h"
 
+#include <stdbool.h>
+
+/**
+ * Checks whether the "samplerate_converter" setting selects the
+ * internal resampler: the word "internal" (case insensitive),
+ * optionally followed by whitespace and a quality.
+ *
+ * @param quality_r returns the quality part of the setting (may be
+ * empty); may be NULL
+ */
+bool
+pcm_resample_parse_internal(const char *conf, const char **quality_r);
+
 #ifdef HAVE_LIBSAMPLERATE
 
 void
 pcm_resample_lsr_deinit(struct pcm_resample_state *state);
 
+const float *
+pcm_resample_lsr_float(struct pcm_resample_state *state,
+		       uint8_t channels,
+		       unsigned src_rate,
+		       const float *src_buffer, size_t src_size,
+		       unsigned dest_rate, size_t *dest_size_r,
+		       GError **error_r);
+
 const int16_t *
 pcm_resample_lsr_16(struct pcm_resample_state *state,
 		    uint8_t channels,
@@ -57,6 +78,14 @@ pcm_resample_lsr_32(struct pcm_resample_state *state,
 void
 pcm_resample_fallback_deinit(struct pcm_resample_state *state);
 
+const float *
+pcm_resample_fallback_float(struct pcm_resample_state *state,
+			    uint8_t channels,
+			    unsigned src_rate,
+			    const float *src_buffer, size_t src_size,
+			    unsigned dest_rate,
+			    size_t *dest_size_r);
+
 const int16_t *
 pcm_resample_fallback_16(struct pcm_resample_state *state,
 			 uint8_t channels,
@@ -65,12 +94,19 @@ pcm_resample_fallback_16(struct pcm_resample_state *state,
 			 unsigned dest_rate,
 			 size_t *dest_size_r);
 
+const int32_t *
+pcm_resample_fallback_24(struct pcm_resample_state *state,
+			 uint8_t channels,
+			 unsigned src_rate,
+			 const int32_t *src_buffer, size_t src_size,
+			 unsigned dest_rate,
+			 size_t *dest_size_r);
+
 const int32_t *
 pcm_resample_fallback_32(struct pcm_resample_state *state,
 			 uint8_t channels,
 			 unsigned src_rate,
-			 const int32_t *src_buffer,
-			 G_GNUC_UNUSED size_t src_size,
+			 const int32_t *src_buffer, size_t src_size,
 			 unsigned dest_rate,
 			 size_t *dest_size_r);
 
@@ -125,6 +125,57 @@ pcm_resample_set(struct pcm_resample_state *state,
 	return true;
 }
 
+const float *
+pcm_resample_lsr_float(struct pcm_resample_state *state,
+		       uint8_t channels,
+		       unsigned src_rate,
+		       const float *src_buffer, size_t src_size,
+		       unsigned dest_rate, size_t *dest_size_r,
+		       GError **error_r)
+{
+	bool success;
+	SRC_DATA *data = &state->data;
+	size_t data_out_size;
+	int error;
+
+	assert((src_size % (sizeof(*src_buffer) * channels)) == 0);
+
+	success = pcm_resample_set(state, channels, src_rate, dest_rate,
+				   error_r);
+	if (!success)
+		return NULL;
+
+	/* there was an error previously, and nothing has changed */
+	if (state->error) {
+		g_set_error(error_r, libsamplerate_quark(), state->error,
+			    "libsamplerate has failed: %s",
+			    src_strerror(state->error));
+		return NULL;
+	}
+
+	/* libsamplerate works with float samples natively, no need to
+	   copy the input */
+	data->input_frames = src_size / sizeof(*src_buffer) / channels;
+	data->data_in = (float *)(size_t)src_buffer;
+
+	data->output_frames = (src_size * dest_rate + src_rate - 1) / src_rate;
+	data_out_size = data->output_frames * sizeof(float) * channels;
+	data->data_out = pcm_buffer_get(&state->out, data_out_size);
+
+	error = src_process(state->state, data);
+	if (error) {
+		g_set_error(error_r, libsamplerate_quark(), error,
+			    "libsamplerate has failed: %s",
+			    src_strerror(error));
+		state->error = error;
+		return NULL;
+	}
+
+	*dest_size_r = data->output_frames_gen *
+		sizeof(*data->data_out) * channels;
+	return data->data_out;
+}
+
 const int16_t *
 pcm_resample_lsr_16(struct pcm_resample_state *state,
 		    uint8_t channels,
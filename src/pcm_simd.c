@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "pcm_simd.h"
+#include "pcm_simd_internal.h"
+#include "pcm_prng.h"
+
+#include <glib.h>
+
+#include <string.h>
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "pcm"
+
+static const struct pcm_simd_kernels pcm_simd_none = {
+	.name = "none",
+};
+
+/**
+ * All kernel sets compiled into this binary, the preferred ones
+ * first.
+ */
+static const struct pcm_simd_kernels *const pcm_simd_all[] = {
+#ifdef PCM_SIMD_AVX2
+	&pcm_simd_avx2,
+#endif
+#ifdef PCM_SIMD_X86
+	&pcm_simd_sse2,
+#endif
+#ifdef PCM_SIMD_NEON
+	&pcm_simd_neon,
+#endif
+	&pcm_simd_none,
+};
+
+static const struct pcm_simd_kernels *pcm_simd_selected;
+
+/**
+ * The state of the dither PRNG shared by all kernels.  Like the
+ * state in pcm_volume_dither(), it is not protected against
+ * concurrent access; a race only affects the dithering noise.
+ */
+static uint32_t pcm_simd_dither_state;
+
+static bool
+pcm_simd_supported(const struct pcm_simd_kernels *kernels)
+{
+	return kernels->supported == NULL || kernels->supported();
+}
+
+static gpointer
+pcm_simd_detect(G_GNUC_UNUSED gpointer data)
+{
+	for (unsigned i = 0; i < G_N_ELEMENTS(pcm_simd_all); ++i) {
+		const struct pcm_simd_kernels *kernels = pcm_simd_all[i];
+
+		if (pcm_simd_supported(kernels)) {
+			g_debug("using %s kernels", kernels->name);
+			pcm_simd_selected = kernels;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static const struct pcm_simd_kernels *
+pcm_simd_get(void)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	g_once(&once, pcm_simd_detect, NULL);
+	return pcm_simd_selected;
+}
+
+const char *
+pcm_simd_name(void)
+{
+	return pcm_simd_get()->name;
+}
+
+bool
+pcm_simd_select(const char *name)
+{
+	pcm_simd_get();
+
+	for (unsigned i = 0; i < G_N_ELEMENTS(pcm_simd_all); ++i) {
+		const struct pcm_simd_kernels *kernels = pcm_simd_all[i];
+
+		if (strcmp(kernels->name, name) == 0) {
+			if (!pcm_simd_supported(kernels))
+				return false;
+
+			pcm_simd_selected = kernels;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+pcm_simd_dither_begin(uint32_t *lanes, unsigned num_lanes,
+		      uint32_t *mul_r, uint32_t *add_r)
+{
+	unsigned long state = pcm_simd_dither_state;
+	uint32_t mul = 1, add = 0;
+
+	for (unsigned i = 0; i < num_lanes; ++i) {
+		lanes[i] = state = pcm_prng(state);
+
+		/* compose the LCG step with itself: after num_lanes
+		   iterations, x -> mul * x + add advances a lane by
+		   num_lanes steps */
+		mul *= 0x0019660d;
+		add = add * 0x0019660d + 0x3c6ef35f;
+	}
+
+	*mul_r = mul;
+	*add_r = add;
+}
+
+void
+pcm_simd_dither_end(uint32_t state)
+{
+	pcm_simd_dither_state = state;
+}
+
+unsigned
+pcm_simd_volume_16(int16_t *buffer, unsigned num_samples, int volume)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->volume_16 != NULL
+		? kernels->volume_16(buffer, num_samples, volume)
+		: 0;
+}
+
+unsigned
+pcm_simd_volume_24(int32_t *buffer, unsigned num_samples, int volume)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->volume_24 != NULL
+		? kernels->volume_24(buffer, num_samples, volume)
+		: 0;
+}
+
+unsigned
+pcm_simd_volume_32(int32_t *buffer, unsigned num_samples, int volume)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->volume_32 != NULL
+		? kernels->volume_32(buffer, num_samples, volume)
+		: 0;
+}
+
+unsigned
+pcm_simd_add_vol_16(int16_t *buffer1, const int16_t *buffer2,
+		    unsigned num_samples, int volume1, int volume2)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->add_vol_16 != NULL
+		? kernels->add_vol_16(buffer1, buffer2, num_samples,
+				      volume1, volume2)
+		: 0;
+}
+
+unsigned
+pcm_simd_add_vol_24(int32_t *buffer1, const int32_t *buffer2,
+		    unsigned num_samples, int volume1, int volume2)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->add_vol_24 != NULL
+		? kernels->add_vol_24(buffer1, buffer2, num_samples,
+				      volume1, volume2)
+		: 0;
+}
+
+unsigned
+pcm_simd_add_vol_32(int32_t *buffer1, const int32_t *buffer2,
+		    unsigned num_samples, int volume1, int volume2)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->add_vol_32 != NULL
+		? kernels->add_vol_32(buffer1, buffer2, num_samples,
+				      volume1, volume2)
+		: 0;
+}
+
+unsigned
+pcm_simd_add_16(int16_t *buffer1, const int16_t *buffer2,
+		unsigned num_samples)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->add_16 != NULL
+		? kernels->add_16(buffer1, buffer2, num_samples)
+		: 0;
+}
+
+unsigned
+pcm_simd_volume_float(float *buffer, unsigned num_samples, float volume)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->volume_float != NULL
+		? kernels->volume_float(buffer, num_samples, volume)
+		: 0;
+}
+
+unsigned
+pcm_simd_add_vol_float(float *buffer1, const float *buffer2,
+		       unsigned num_samples, float volume1, float volume2)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->add_vol_float != NULL
+		? kernels->add_vol_float(buffer1, buffer2, num_samples,
+					 volume1, volume2)
+		: 0;
+}
+
+unsigned
+pcm_simd_add_float(float *buffer1, const float *buffer2,
+		   unsigned num_samples)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->add_float != NULL
+		? kernels->add_float(buffer1, buffer2, num_samples)
+		: 0;
+}
+
+unsigned
+pcm_simd_convert_16_to_32(int32_t *dest, const int16_t *src,
+			  unsigned num_samples, unsigned shift)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->convert_16_to_32 != NULL
+		? kernels->convert_16_to_32(dest, src, num_samples, shift)
+		: 0;
+}
+
+unsigned
+pcm_simd_shift_32(int32_t *dest, const int32_t *src,
+		  unsigned num_samples, int shift)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->shift_32 != NULL
+		? kernels->shift_32(dest, src, num_samples, shift)
+		: 0;
+}
+
+unsigned
+pcm_simd_convert_16_to_float(float *dest, const int16_t *src,
+			     unsigned num_samples)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->convert_16_to_float != NULL
+		? kernels->convert_16_to_float(dest, src, num_samples)
+		: 0;
+}
+
+unsigned
+pcm_simd_convert_32_to_float(float *dest, const int32_t *src,
+			     unsigned num_samples, unsigned bits)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->convert_32_to_float != NULL
+		? kernels->convert_32_to_float(dest, src, num_samples, bits)
+		: 0;
+}
+
+unsigned
+pcm_simd_convert_float_to_32(int32_t *dest, const float *src,
+			     unsigned num_samples, unsigned bits)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->convert_float_to_32 != NULL
+		? kernels->convert_float_to_32(dest, src, num_samples, bits)
+		: 0;
+}
+
+unsigned
+pcm_simd_pack_24(uint8_t *dest, const int32_t *src, unsigned num_samples)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->pack_24 != NULL
+		? kernels->pack_24(dest, src, num_samples)
+		: 0;
+}
+
+unsigned
+pcm_simd_unpack_24(int32_t *dest, const uint8_t *src, unsigned num_samples)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->unpack_24 != NULL
+		? kernels->unpack_24(dest, src, num_samples)
+		: 0;
+}
+
+unsigned
+pcm_simd_byteswap_16(uint16_t *dest, const uint16_t *src,
+		     unsigned num_samples)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->byteswap_16 != NULL
+		? kernels->byteswap_16(dest, src, num_samples)
+		: 0;
+}
+
+unsigned
+pcm_simd_byteswap_32(uint32_t *dest, const uint32_t *src,
+		     unsigned num_samples)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->byteswap_32 != NULL
+		? kernels->byteswap_32(dest, src, num_samples)
+		: 0;
+}
+
+unsigned
+pcm_simd_channels_16_1_to_2(int16_t *dest, const int16_t *src,
+			    unsigned num_frames)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->channels_16_1_to_2 != NULL
+		? kernels->channels_16_1_to_2(dest, src, num_frames)
+		: 0;
+}
+
+unsigned
+pcm_simd_channels_16_2_to_1(int16_t *dest, const int16_t *src,
+			    unsigned num_frames)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->channels_16_2_to_1 != NULL
+		? kernels->channels_16_2_to_1(dest, src, num_frames)
+		: 0;
+}
+
+unsigned
+pcm_simd_channels_32_1_to_2(int32_t *dest, const int32_t *src,
+			    unsigned num_frames)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->channels_32_1_to_2 != NULL
+		? kernels->channels_32_1_to_2(dest, src, num_frames)
+		: 0;
+}
+
+unsigned
+pcm_simd_channels_24_2_to_1(int32_t *dest, const int32_t *src,
+			    unsigned num_frames)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->channels_24_2_to_1 != NULL
+		? kernels->channels_24_2_to_1(dest, src, num_frames)
+		: 0;
+}
+
+unsigned
+pcm_simd_channels_float_2_to_1(float *dest, const float *src,
+			       unsigned num_frames)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->channels_float_2_to_1 != NULL
+		? kernels->channels_float_2_to_1(dest, src, num_frames)
+		: 0;
+}
+
+unsigned
+pcm_simd_dot_16(int32_t *sum_r, const int16_t *a, const int16_t *b,
+		unsigned n)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->dot_16 != NULL
+		? kernels->dot_16(sum_r, a, b, n)
+		: 0;
+}
+
+unsigned
+pcm_simd_dot_float(float *sum_r, const float *a, const float *b,
+		   unsigned n)
+{
+	const struct pcm_simd_kernels *kernels = pcm_simd_get();
+
+	return kernels->dot_float != NULL
+		? kernels->dot_float(sum_r, a, b, n)
+		: 0;
+}
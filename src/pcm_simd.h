@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/** \file
+ *
+ * Vectorized kernels for the PCM library.  The implementation is
+ * selected at runtime, depending on the features of the CPU; if
+ * configured with --disable-simd, only the scalar functions are
+ * used.
+ *
+ * Each function processes a multiple of the vector width, and
+ * returns the number of samples it has processed; the caller is
+ * responsible for the remaining samples.  A return value of 0 means
+ * there is no suitable kernel.
+ *
+ * The results are identical to those of the scalar functions, except
+ * that the volume dithering values (pcm_volume.c, pcm_mix.c) are
+ * drawn from a different (vectorized) PRNG.  Therefore, the results
+ * of these functions may differ by one.  Floating point kernels
+ * perform the same operations in the same order as the scalar code,
+ * unless the compiler contracts the scalar code to fused
+ * multiply-add instructions.
+ */
+
+#ifndef MPD_PCM_SIMD_H
+#define MPD_PCM_SIMD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Returns the name of the selected kernel set, e.g. "sse2" or
+ * "neon"; "none" means the scalar implementation is used.
+ */
+const char *
+pcm_simd_name(void);
+
+/**
+ * Selects the kernel set by name, overriding CPU detection.  This is
+ * used by the benchmark.
+ *
+ * @return false if there is no such kernel set, or if the CPU does
+ * not support it
+ */
+bool
+pcm_simd_select(const char *name);
+
+unsigned
+pcm_simd_volume_16(int16_t *buffer, unsigned num_samples, int volume);
+
+unsigned
+pcm_simd_volume_24(int32_t *buffer, unsigned num_samples, int volume);
+
+unsigned
+pcm_simd_volume_32(int32_t *buffer, unsigned num_samples, int volume);
+
+unsigned
+pcm_simd_add_vol_16(int16_t *buffer1, const int16_t *buffer2,
+		    unsigned num_samples, int volume1, int volume2);
+
+unsigned
+pcm_simd_add_vol_24(int32_t *buffer1, const int32_t *buffer2,
+		    unsigned num_samples, int volume1, int volume2);
+
+unsigned
+pcm_simd_add_vol_32(int32_t *buffer1, const int32_t *buffer2,
+		    unsigned num_samples, int volume1, int volume2);
+
+unsigned
+pcm_simd_add_16(int16_t *buffer1, const int16_t *buffer2,
+		unsigned num_samples);
+
+unsigned
+pcm_simd_volume_float(float *buffer, unsigned num_samples, float volume);
+
+unsigned
+pcm_simd_add_vol_float(float *buffer1, const float *buffer2,
+		       unsigned num_samples, float volume1, float volume2);
+
+unsigned
+pcm_simd_add_float(float *buffer1, const float *buffer2,
+		   unsigned num_samples);
+
+/**
+ * Converts 16 bit samples to 32 bit, shifting them left by the
+ * specified number of bits (at most 16).
+ */
+unsigned
+pcm_simd_convert_16_to_32(int32_t *dest, const int16_t *src,
+			  unsigned num_samples, unsigned shift);
+
+/**
+ * Shifts 32 bit samples left (positive @shift) or right (negative
+ * @shift, with sign extension).  @dest may be equal to @src.
+ */
+unsigned
+pcm_simd_shift_32(int32_t *dest, const int32_t *src,
+		  unsigned num_samples, int shift);
+
+/**
+ * Converts 16 bit samples to floating point (-1.0 to +1.0).
+ */
+unsigned
+pcm_simd_convert_16_to_float(float *dest, const int16_t *src,
+			     unsigned num_samples);
+
+/**
+ * Converts 32 bit integer samples with @bits significant bits (24 or
+ * 32) to floating point.  @dest may be equal to @src.
+ */
+unsigned
+pcm_simd_convert_32_to_float(float *dest, const int32_t *src,
+			     unsigned num_samples, unsigned bits);
+
+/**
+ * Converts floating point samples to 32 bit integers with @bits
+ * significant bits (24 or 32), clipping them to the valid range.
+ * NaN becomes zero.  @dest may be equal to @src.
+ */
+unsigned
+pcm_simd_convert_float_to_32(int32_t *dest, const float *src,
+			     unsigned num_samples, unsigned bits);
+
+/**
+ * Packs padded 24 bit samples in host byte order, see pcm_pack_24().
+ */
+unsigned
+pcm_simd_pack_24(uint8_t *dest, const int32_t *src, unsigned num_samples);
+
+/**
+ * Unpacks 24 bit samples in host byte order, see pcm_unpack_24().
+ */
+unsigned
+pcm_simd_unpack_24(int32_t *dest, const uint8_t *src, unsigned num_samples);
+
+unsigned
+pcm_simd_byteswap_16(uint16_t *dest, const uint16_t *src,
+		     unsigned num_samples);
+
+unsigned
+pcm_simd_byteswap_32(uint32_t *dest, const uint32_t *src,
+		     unsigned num_samples);
+
+/**
+ * Duplicates mono 16 bit samples to stereo.
+ *
+ * @return the number of frames processed
+ */
+unsigned
+pcm_simd_channels_16_1_to_2(int16_t *dest, const int16_t *src,
+			    unsigned num_frames);
+
+/**
+ * Downmixes stereo 16 bit samples to mono.
+ *
+ * @return the number of frames processed
+ */
+unsigned
+pcm_simd_channels_16_2_to_1(int16_t *dest, const int16_t *src,
+			    unsigned num_frames);
+
+/**
+ * Duplicates mono 24 or 32 bit samples to stereo.
+ *
+ * @return the number of frames processed
+ */
+unsigned
+pcm_simd_channels_32_1_to_2(int32_t *dest, const int32_t *src,
+			    unsigned num_frames);
+
+/**
+ * Downmixes stereo 24 bit samples (S24_P32) to mono.
+ *
+ * @return the number of frames processed
+ */
+unsigned
+pcm_simd_channels_24_2_to_1(int32_t *dest, const int32_t *src,
+			    unsigned num_frames);
+
+/**
+ * Downmixes stereo floating point samples to mono.
+ *
+ * @return the number of frames processed
+ */
+unsigned
+pcm_simd_channels_float_2_to_1(float *dest, const float *src,
+			       unsigned num_frames);
+
+/**
+ * Adds the dot product of two 16 bit vectors to *sum_r.  The caller
+ * must ensure that the result fits into 32 bits.
+ *
+ * @return the number of elements processed
+ */
+unsigned
+pcm_simd_dot_16(int32_t *sum_r, const int16_t *a, const int16_t *b,
+		unsigned n);
+
+/**
+ * Adds the dot product of two floating point vectors to *sum_r.
+ * Unlike the other kernels, this one changes the order of the
+ * additions, and thus the rounding of the result.
+ *
+ * @return the number of elements processed
+ */
+unsigned
+pcm_simd_dot_float(float *sum_r, const float *a, const float *b,
+		   unsigned n);
+
+#endif
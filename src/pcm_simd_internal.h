@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/** \file
+ *
+ * Internal declarations shared by the SIMD kernel implementations.
+ */
+
+#ifndef MPD_PCM_SIMD_INTERNAL_H
+#define MPD_PCM_SIMD_INTERNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A set of kernels for one instruction set.  Each pointer may be NULL
+ * if that operation is not implemented.
+ */
+struct pcm_simd_kernels {
+	const char *name;
+
+	/**
+	 * Checks whether the CPU supports this instruction set.  NULL
+	 * means it is always supported.
+	 */
+	bool (*supported)(void);
+
+	unsigned (*volume_16)(int16_t *buffer, unsigned num_samples,
+			      int volume);
+	unsigned (*volume_24)(int32_t *buffer, unsigned num_samples,
+			      int volume);
+	unsigned (*volume_32)(int32_t *buffer, unsigned num_samples,
+			      int volume);
+
+	unsigned (*add_vol_16)(int16_t *buffer1, const int16_t *buffer2,
+			       unsigned num_samples,
+			       int volume1, int volume2);
+	unsigned (*add_vol_24)(int32_t *buffer1, const int32_t *buffer2,
+			       unsigned num_samples,
+			       int volume1, int volume2);
+	unsigned (*add_vol_32)(int32_t *buffer1, const int32_t *buffer2,
+			       unsigned num_samples,
+			       int volume1, int volume2);
+
+	unsigned (*add_16)(int16_t *buffer1, const int16_t *buffer2,
+			   unsigned num_samples);
+
+	unsigned (*volume_float)(float *buffer, unsigned num_samples,
+				 float volume);
+	unsigned (*add_vol_float)(float *buffer1, const float *buffer2,
+				  unsigned num_samples,
+				  float volume1, float volume2);
+	unsigned (*add_float)(float *buffer1, const float *buffer2,
+			      unsigned num_samples);
+
+	unsigned (*convert_16_to_32)(int32_t *dest, const int16_t *src,
+				     unsigned num_samples, unsigned shift);
+	unsigned (*shift_32)(int32_t *dest, const int32_t *src,
+			     unsigned num_samples, int shift);
+
+	unsigned (*convert_16_to_float)(float *dest, const int16_t *src,
+					unsigned num_samples);
+	unsigned (*convert_32_to_float)(float *dest, const int32_t *src,
+					unsigned num_samples, unsigned bits);
+	unsigned (*convert_float_to_32)(int32_t *dest, const float *src,
+					unsigned num_samples, unsigned bits);
+
+	unsigned (*pack_24)(uint8_t *dest, const int32_t *src,
+			    unsigned num_samples);
+	unsigned (*unpack_24)(int32_t *dest, const uint8_t *src,
+			      unsigned num_samples);
+
+	unsigned (*byteswap_16)(uint16_t *dest, const uint16_t *src,
+				unsigned num_samples);
+	unsigned (*byteswap_32)(uint32_t *dest, const uint32_t *src,
+				unsigned num_samples);
+
+	unsigned (*channels_16_1_to_2)(int16_t *dest, const int16_t *src,
+				       unsigned num_frames);
+	unsigned (*channels_16_2_to_1)(int16_t *dest, const int16_t *src,
+				       unsigned num_frames);
+	unsigned (*channels_32_1_to_2)(int32_t *dest, const int32_t *src,
+				       unsigned num_frames);
+	unsigned (*channels_24_2_to_1)(int32_t *dest, const int32_t *src,
+				       unsigned num_frames);
+	unsigned (*channels_float_2_to_1)(float *dest, const float *src,
+					  unsigned num_frames);
+
+	unsigned (*dot_16)(int32_t *sum_r, const int16_t *a,
+			   const int16_t *b, unsigned n);
+	unsigned (*dot_float)(float *sum_r, const float *a,
+			      const float *b, unsigned n);
+};
+
+#ifdef ENABLE_SIMD
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define PCM_SIMD_X86
+extern const struct pcm_simd_kernels pcm_simd_sse2;
+#if defined(__clang__) || __GNUC__ > 4 || \
+	(__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define PCM_SIMD_AVX2
+extern const struct pcm_simd_kernels pcm_simd_avx2;
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_SIMD_NEON
+extern const struct pcm_simd_kernels pcm_simd_neon;
+#endif
+
+#endif /* ENABLE_SIMD */
+
+/**
+ * Initializes the dither PRNG lanes of a kernel.  The PRNG is the
+ * same LCG as pcm_prng(), but with one state per vector lane; each
+ * lane advances by @num_lanes steps, so all lanes together produce
+ * the continuous pcm_prng() sequence.
+ *
+ * @param lanes an array of @num_lanes PRNG states
+ * @param mul_r returns the multiplier of one vector step
+ * @param add_r returns the increment of one vector step
+ */
+void
+pcm_simd_dither_begin(uint32_t *lanes, unsigned num_lanes,
+		      uint32_t *mul_r, uint32_t *add_r);
+
+/**
+ * Stores the PRNG state after the kernel has finished.
+ *
+ * @param state the state of the last vector lane
+ */
+void
+pcm_simd_dither_end(uint32_t state);
+
+#endif
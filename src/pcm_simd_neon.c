@@ -0,0 +1,660 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * NEON kernels for the PCM library.  NEON is a mandatory
+ * part of AArch64; on 32 bit ARM, these kernels are only built if the
+ * compiler targets NEON (-mfpu=neon), and are then used
+ * unconditionally.
+ */
+
+#include "config.h"
+#include "pcm_simd_internal.h"
+#include "pcm_volume.h"
+
+#ifdef PCM_SIMD_NEON
+
+#include <glib.h>
+
+#include <arm_neon.h>
+#include <float.h>
+
+/**
+ * The kernels require that the volume fits into a signed 16 bit
+ * integer; larger values are left to the scalar functions.
+ */
+#define PCM_SIMD_MAX_VOLUME 0x7fff
+
+/* PCM_VOLUME_1 is 1 << 10 */
+#define PCM_VOLUME_SHIFT 10
+
+/**
+ * Returns the dither values of the current PRNG lanes (see
+ * pcm_volume_dither()) plus the rounding offset, and advances the
+ * PRNG.
+ */
+static inline int32x4_t
+neon_dither(uint32x4_t *state, uint32x4_t mul, uint32x4_t add)
+{
+	const uint32x4_t mask = vdupq_n_u32(511);
+	uint32x4_t r = *state;
+
+	*state = vmlaq_u32(add, r, mul);
+
+	int32x4_t d = vsubq_s32(vreinterpretq_s32_u32(vandq_u32(r, mask)),
+				vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(r, 9),
+								mask)));
+	return vaddq_s32(d, vdupq_n_s32(PCM_VOLUME_1 / 2));
+}
+
+static inline uint32x4_t
+neon_dither_begin(uint32x4_t *mul_r, uint32x4_t *add_r)
+{
+	uint32_t lanes[4], mul, add;
+
+	pcm_simd_dither_begin(lanes, G_N_ELEMENTS(lanes), &mul, &add);
+	*mul_r = vdupq_n_u32(mul);
+	*add_r = vdupq_n_u32(add);
+	return vld1q_u32(lanes);
+}
+
+static inline void
+neon_dither_end(uint32x4_t state)
+{
+	pcm_simd_dither_end(vgetq_lane_u32(state, 3));
+}
+
+/**
+ * Divides by #PCM_VOLUME_1, rounding towards zero like the C
+ * division operator.
+ */
+static inline int32x4_t
+neon_div_volume(int32x4_t x)
+{
+	uint32x4_t sign = vreinterpretq_u32_s32(vshrq_n_s32(x, 31));
+	int32x4_t bias = vreinterpretq_s32_u32(vshrq_n_u32(sign,
+							   32 - PCM_VOLUME_SHIFT));
+
+	return vshrq_n_s32(vaddq_s32(x, bias), PCM_VOLUME_SHIFT);
+}
+
+/**
+ * Adds the dither to two 64 bit products, divides by #PCM_VOLUME_1
+ * and saturates the result to 32 bit.
+ */
+static inline int32x2_t
+neon_div_volume_64(int64x2_t x, int32x2_t dither)
+{
+	x = vaddw_s32(x, dither);
+
+	uint64x2_t sign = vreinterpretq_u64_s64(vshrq_n_s64(x, 63));
+	int64x2_t bias = vreinterpretq_s64_u64(vshrq_n_u64(sign,
+							   64 - PCM_VOLUME_SHIFT));
+
+	return vqmovn_s64(vshrq_n_s64(vaddq_s64(x, bias), PCM_VOLUME_SHIFT));
+}
+
+/**
+ * Clamps to the range of a signed integer with the specified number
+ * of bits (see pcm_range()); 32 bit samples have already been
+ * saturated by neon_div_volume_64().
+ */
+static inline int32x4_t
+neon_range(int32x4_t x, unsigned bits)
+{
+	if (bits >= 32)
+		return x;
+
+	return vminq_s32(vmaxq_s32(x, vdupq_n_s32(-1 << (bits - 1))),
+			 vdupq_n_s32((1 << (bits - 1)) - 1));
+}
+
+static unsigned
+neon_volume_16(int16_t *buffer, unsigned num_samples, int volume)
+{
+	if (volume > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~7u;
+	uint32x4_t mul, add, state = neon_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		int16x8_t s = vld1q_s16(buffer + i);
+
+		int32x4_t a = vmull_n_s16(vget_low_s16(s), volume);
+		int32x4_t b = vmull_n_s16(vget_high_s16(s), volume);
+		a = neon_div_volume(vaddq_s32(a, neon_dither(&state, mul, add)));
+		b = neon_div_volume(vaddq_s32(b, neon_dither(&state, mul, add)));
+
+		/* saturation is the same as pcm_range(sample, 16) */
+		vst1q_s16(buffer + i, vcombine_s16(vqmovn_s32(a),
+						   vqmovn_s32(b)));
+	}
+
+	neon_dither_end(state);
+	return n;
+}
+
+static unsigned
+neon_add_vol_16(int16_t *buffer1, const int16_t *buffer2,
+		unsigned num_samples, int volume1, int volume2)
+{
+	if (volume1 > PCM_SIMD_MAX_VOLUME || volume2 > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~7u;
+	uint32x4_t mul, add, state = neon_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		int16x8_t s1 = vld1q_s16(buffer1 + i);
+		int16x8_t s2 = vld1q_s16(buffer2 + i);
+
+		/* sample1 * volume1 + sample2 * volume2 */
+		int32x4_t a = vmull_n_s16(vget_low_s16(s1), volume1);
+		int32x4_t b = vmull_n_s16(vget_high_s16(s1), volume1);
+		a = vmlal_n_s16(a, vget_low_s16(s2), volume2);
+		b = vmlal_n_s16(b, vget_high_s16(s2), volume2);
+
+		a = neon_div_volume(vaddq_s32(a, neon_dither(&state, mul, add)));
+		b = neon_div_volume(vaddq_s32(b, neon_dither(&state, mul, add)));
+
+		vst1q_s16(buffer1 + i, vcombine_s16(vqmovn_s32(a),
+						    vqmovn_s32(b)));
+	}
+
+	neon_dither_end(state);
+	return n;
+}
+
+static unsigned
+neon_add_16(int16_t *buffer1, const int16_t *buffer2, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8)
+		vst1q_s16(buffer1 + i, vqaddq_s16(vld1q_s16(buffer1 + i),
+						  vld1q_s16(buffer2 + i)));
+
+	return n;
+}
+
+static inline unsigned
+neon_volume_wide(int32_t *buffer, unsigned num_samples, int volume,
+		 unsigned bits)
+{
+	if (volume > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~3u;
+	uint32x4_t mul, add, state = neon_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		int32x4_t s = vld1q_s32(buffer + i);
+		int32x4_t d = neon_dither(&state, mul, add);
+
+		int64x2_t a = vmull_n_s32(vget_low_s32(s), volume);
+		int64x2_t b = vmull_n_s32(vget_high_s32(s), volume);
+
+		int32x4_t r =
+			vcombine_s32(neon_div_volume_64(a, vget_low_s32(d)),
+				     neon_div_volume_64(b, vget_high_s32(d)));
+		vst1q_s32(buffer + i, neon_range(r, bits));
+	}
+
+	neon_dither_end(state);
+	return n;
+}
+
+static unsigned
+neon_volume_24(int32_t *buffer, unsigned num_samples, int volume)
+{
+	return neon_volume_wide(buffer, num_samples, volume, 24);
+}
+
+static unsigned
+neon_volume_32(int32_t *buffer, unsigned num_samples, int volume)
+{
+	return neon_volume_wide(buffer, num_samples, volume, 32);
+}
+
+static inline unsigned
+neon_add_vol_wide(int32_t *buffer1, const int32_t *buffer2,
+		  unsigned num_samples, int volume1, int volume2,
+		  unsigned bits)
+{
+	if (volume1 > PCM_SIMD_MAX_VOLUME || volume2 > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~3u;
+	uint32x4_t mul, add, state = neon_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		int32x4_t s1 = vld1q_s32(buffer1 + i);
+		int32x4_t s2 = vld1q_s32(buffer2 + i);
+		int32x4_t d = neon_dither(&state, mul, add);
+
+		int64x2_t a = vmull_n_s32(vget_low_s32(s1), volume1);
+		int64x2_t b = vmull_n_s32(vget_high_s32(s1), volume1);
+		a = vmlal_n_s32(a, vget_low_s32(s2), volume2);
+		b = vmlal_n_s32(b, vget_high_s32(s2), volume2);
+
+		int32x4_t r =
+			vcombine_s32(neon_div_volume_64(a, vget_low_s32(d)),
+				     neon_div_volume_64(b, vget_high_s32(d)));
+		vst1q_s32(buffer1 + i, neon_range(r, bits));
+	}
+
+	neon_dither_end(state);
+	return n;
+}
+
+static unsigned
+neon_add_vol_24(int32_t *buffer1, const int32_t *buffer2,
+		unsigned num_samples, int volume1, int volume2)
+{
+	return neon_add_vol_wide(buffer1, buffer2, num_samples,
+				 volume1, volume2, 24);
+}
+
+static unsigned
+neon_add_vol_32(int32_t *buffer1, const int32_t *buffer2,
+		unsigned num_samples, int volume1, int volume2)
+{
+	return neon_add_vol_wide(buffer1, buffer2, num_samples,
+				 volume1, volume2, 32);
+}
+
+static unsigned
+neon_convert_16_to_32(int32_t *dest, const int16_t *src,
+		      unsigned num_samples, unsigned shift)
+{
+	const unsigned n = num_samples & ~7u;
+	const int32x4_t count = vdupq_n_s32(shift);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		int16x8_t s = vld1q_s16(src + i);
+
+		vst1q_s32(dest + i,
+			  vshlq_s32(vmovl_s16(vget_low_s16(s)), count));
+		vst1q_s32(dest + i + 4,
+			  vshlq_s32(vmovl_s16(vget_high_s16(s)), count));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_shift_32(int32_t *dest, const int32_t *src,
+	      unsigned num_samples, int shift)
+{
+	const unsigned n = num_samples & ~3u;
+
+	/* a negative count is an arithmetic right shift */
+	const int32x4_t count = vdupq_n_s32(shift);
+
+	for (unsigned i = 0; i < n; i += 4)
+		vst1q_s32(dest + i, vshlq_s32(vld1q_s32(src + i), count));
+
+	return n;
+}
+
+static unsigned
+neon_pack_24(uint8_t *dest, const int32_t *src, unsigned num_samples)
+{
+	if (G_BYTE_ORDER != G_LITTLE_ENDIAN)
+		return 0;
+
+	const unsigned n = num_samples & ~15u;
+
+	for (unsigned i = 0; i < n; i += 16) {
+		/* de-interleave the four bytes of each sample, and
+		   store only the lower three */
+		uint8x16x4_t s = vld4q_u8((const uint8_t *)(src + i));
+		uint8x16x3_t d = { { s.val[0], s.val[1], s.val[2] } };
+
+		vst3q_u8(dest + i * 3, d);
+	}
+
+	return n;
+}
+
+static unsigned
+neon_unpack_24(int32_t *dest, const uint8_t *src, unsigned num_samples)
+{
+	if (G_BYTE_ORDER != G_LITTLE_ENDIAN)
+		return 0;
+
+	const unsigned n = num_samples & ~15u;
+
+	for (unsigned i = 0; i < n; i += 16) {
+		uint8x16x3_t s = vld3q_u8(src + i * 3);
+
+		/* the fourth byte is the sign extension of the
+		   third */
+		uint8x16_t sign =
+			vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(s.val[2]),
+						       7));
+		uint8x16x4_t d = { { s.val[0], s.val[1], s.val[2], sign } };
+
+		vst4q_u8((uint8_t *)(dest + i), d);
+	}
+
+	return n;
+}
+
+static unsigned
+neon_byteswap_16(uint16_t *dest, const uint16_t *src, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8) {
+		uint8x16_t s = vreinterpretq_u8_u16(vld1q_u16(src + i));
+
+		vst1q_u16(dest + i, vreinterpretq_u16_u8(vrev16q_u8(s)));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_byteswap_32(uint32_t *dest, const uint32_t *src, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		uint8x16_t s = vreinterpretq_u8_u32(vld1q_u32(src + i));
+
+		vst1q_u32(dest + i, vreinterpretq_u32_u8(vrev32q_u8(s)));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_channels_16_1_to_2(int16_t *dest, const int16_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8) {
+		int16x8_t s = vld1q_s16(src + i);
+		int16x8x2_t d = { { s, s } };
+
+		vst2q_s16(dest + i * 2, d);
+	}
+
+	return n;
+}
+
+/**
+ * Divides by two, rounding towards zero like the C division
+ * operator.
+ */
+static inline int32x4_t
+neon_div_2(int32x4_t x)
+{
+	int32x4_t bias = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(x),
+							   31));
+
+	return vshrq_n_s32(vaddq_s32(x, bias), 1);
+}
+
+static unsigned
+neon_channels_16_2_to_1(int16_t *dest, const int16_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8) {
+		int16x8x2_t s = vld2q_s16(src + i * 2);
+
+		int32x4_t a = vaddl_s16(vget_low_s16(s.val[0]),
+					vget_low_s16(s.val[1]));
+		int32x4_t b = vaddl_s16(vget_high_s16(s.val[0]),
+					vget_high_s16(s.val[1]));
+
+		vst1q_s16(dest + i, vcombine_s16(vmovn_s32(neon_div_2(a)),
+						 vmovn_s32(neon_div_2(b))));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_channels_32_1_to_2(int32_t *dest, const int32_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		int32x4_t s = vld1q_s32(src + i);
+		int32x4x2_t d = { { s, s } };
+
+		vst2q_s32(dest + i * 2, d);
+	}
+
+	return n;
+}
+
+static unsigned
+neon_channels_24_2_to_1(int32_t *dest, const int32_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		int32x4x2_t s = vld2q_s32(src + i * 2);
+
+		vst1q_s32(dest + i, neon_div_2(vaddq_s32(s.val[0], s.val[1])));
+	}
+
+	return n;
+}
+
+/*
+ * Floating point kernels.  Note that 32 bit ARM NEON flushes
+ * denormals to zero, so tiny values may differ from the scalar
+ * (VFP) result there.
+ */
+
+static unsigned
+neon_volume_float(float *buffer, unsigned num_samples, float volume)
+{
+	const unsigned n = num_samples & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4)
+		vst1q_f32(buffer + i, vmulq_n_f32(vld1q_f32(buffer + i),
+						  volume));
+
+	return n;
+}
+
+static unsigned
+neon_add_vol_float(float *buffer1, const float *buffer2,
+		   unsigned num_samples, float volume1, float volume2)
+{
+	const unsigned n = num_samples & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		float32x4_t a = vmulq_n_f32(vld1q_f32(buffer1 + i), volume1);
+		float32x4_t b = vmulq_n_f32(vld1q_f32(buffer2 + i), volume2);
+
+		vst1q_f32(buffer1 + i, vaddq_f32(a, b));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_add_float(float *buffer1, const float *buffer2, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4)
+		vst1q_f32(buffer1 + i, vaddq_f32(vld1q_f32(buffer1 + i),
+						 vld1q_f32(buffer2 + i)));
+
+	return n;
+}
+
+static unsigned
+neon_convert_16_to_float(float *dest, const int16_t *src,
+			 unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+	const float factor = 1.0f / (1 << 15);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		int16x8_t s = vld1q_s16(src + i);
+		float32x4_t a = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+		float32x4_t b = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+
+		vst1q_f32(dest + i, vmulq_n_f32(a, factor));
+		vst1q_f32(dest + i + 4, vmulq_n_f32(b, factor));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_convert_32_to_float(float *dest, const int32_t *src,
+			 unsigned num_samples, unsigned bits)
+{
+	const unsigned n = num_samples & ~3u;
+	const float factor = 1.0f / (float)(1u << (bits - 1));
+
+	for (unsigned i = 0; i < n; i += 4)
+		vst1q_f32(dest + i,
+			  vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)),
+				      factor));
+
+	return n;
+}
+
+static unsigned
+neon_convert_float_to_32(int32_t *dest, const float *src,
+			 unsigned num_samples, unsigned bits)
+{
+	const unsigned n = num_samples & ~3u;
+	const float f = (float)(1u << (bits - 1));
+	const float32x4_t max = vdupq_n_f32(bits > 24
+					    ? f * (1.0f - FLT_EPSILON / 2)
+					    : f - 1);
+	const float32x4_t min = vdupq_n_f32(-f);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		float32x4_t s = vmulq_n_f32(vld1q_f32(src + i), f);
+
+		/* NaN compares unequal to itself; replace it with
+		   zero, then clip */
+		s = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(s),
+						    vceqq_f32(s, s)));
+		s = vmaxq_f32(vminq_f32(s, max), min);
+
+		vst1q_s32(dest + i, vcvtq_s32_f32(s));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_channels_float_2_to_1(float *dest, const float *src,
+			   unsigned num_frames)
+{
+	const unsigned n = num_frames & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		float32x4x2_t s = vld2q_f32(src + i * 2);
+
+		vst1q_f32(dest + i,
+			  vmulq_n_f32(vaddq_f32(s.val[0], s.val[1]), 0.5f));
+	}
+
+	return n;
+}
+
+static unsigned
+neon_dot_16(int32_t *sum_r, const int16_t *a, const int16_t *b, unsigned n)
+{
+	const unsigned m = n & ~7u;
+	int32x4_t sum = vdupq_n_s32(0);
+	int32x2_t sum2;
+
+	for (unsigned i = 0; i < m; i += 8) {
+		int16x8_t x = vld1q_s16(a + i), y = vld1q_s16(b + i);
+
+		sum = vmlal_s16(sum, vget_low_s16(x), vget_low_s16(y));
+		sum = vmlal_s16(sum, vget_high_s16(x), vget_high_s16(y));
+	}
+
+	sum2 = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+	*sum_r += vget_lane_s32(vpadd_s32(sum2, sum2), 0);
+	return m;
+}
+
+static unsigned
+neon_dot_float(float *sum_r, const float *a, const float *b, unsigned n)
+{
+	const unsigned m = n & ~7u;
+	float32x4_t sum1 = vdupq_n_f32(0), sum2 = vdupq_n_f32(0);
+	float32x2_t sum;
+
+	for (unsigned i = 0; i < m; i += 8) {
+		sum1 = vmlaq_f32(sum1, vld1q_f32(a + i), vld1q_f32(b + i));
+		sum2 = vmlaq_f32(sum2, vld1q_f32(a + i + 4),
+				 vld1q_f32(b + i + 4));
+	}
+
+	sum1 = vaddq_f32(sum1, sum2);
+	sum = vadd_f32(vget_low_f32(sum1), vget_high_f32(sum1));
+	*sum_r += vget_lane_f32(vpadd_f32(sum, sum), 0);
+	return m;
+}
+
+const struct pcm_simd_kernels pcm_simd_neon = {
+	.name = "neon",
+	.volume_16 = neon_volume_16,
+	.volume_24 = neon_volume_24,
+	.volume_32 = neon_volume_32,
+	.add_vol_16 = neon_add_vol_16,
+	.add_vol_24 = neon_add_vol_24,
+	.add_vol_32 = neon_add_vol_32,
+	.add_16 = neon_add_16,
+	.volume_float = neon_volume_float,
+	.add_vol_float = neon_add_vol_float,
+	.add_float = neon_add_float,
+	.convert_16_to_32 = neon_convert_16_to_32,
+	.shift_32 = neon_shift_32,
+	.convert_16_to_float = neon_convert_16_to_float,
+	.convert_32_to_float = neon_convert_32_to_float,
+	.convert_float_to_32 = neon_convert_float_to_32,
+	.pack_24 = neon_pack_24,
+	.unpack_24 = neon_unpack_24,
+	.byteswap_16 = neon_byteswap_16,
+	.byteswap_32 = neon_byteswap_32,
+	.channels_16_1_to_2 = neon_channels_16_1_to_2,
+	.channels_16_2_to_1 = neon_channels_16_2_to_1,
+	.channels_32_1_to_2 = neon_channels_32_1_to_2,
+	.channels_24_2_to_1 = neon_channels_24_2_to_1,
+	.channels_float_2_to_1 = neon_channels_float_2_to_1,
+	.dot_16 = neon_dot_16,
+	.dot_float = neon_dot_float,
+};
+
+#endif /* PCM_SIMD_NEON */
@@ -0,0 +1,1152 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * SSE2 and AVX2 kernels for the PCM library.  SSE2 is always
+ * available on x86_64; the AVX2 functions are compiled with a
+ * "target" attribute, and are only selected after a runtime check.
+ *
+ * The 16 bit kernels use 32 bit integer arithmetic, just like the
+ * scalar functions.  The 24 and 32 bit kernels (AVX2 only) calculate
+ * with doubles, which represent all intermediate values exactly; the
+ * truncating conversion has the same rounding as the C division.
+ */
+
+#include "config.h"
+#include "pcm_simd_internal.h"
+#include "pcm_volume.h"
+
+#ifdef PCM_SIMD_X86
+
+#include <glib.h>
+
+#include <emmintrin.h>
+#include <float.h>
+
+#ifdef PCM_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+/**
+ * The kernels require that the volume fits into a signed 16 bit
+ * integer; larger values are left to the scalar functions.
+ */
+#define PCM_SIMD_MAX_VOLUME 0x7fff
+
+/* PCM_VOLUME_1 is 1 << 10 */
+#define PCM_VOLUME_SHIFT 10
+
+/*
+ * SSE2
+ *
+ */
+
+static inline __m128i
+sse2_mullo_epi32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+				    _mm_srli_epi64(b, 32));
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08),
+				  _mm_shuffle_epi32(odd, 0x08));
+}
+
+/**
+ * Returns the dither values of the current PRNG lanes (see
+ * pcm_volume_dither()) plus the rounding offset, and advances the
+ * PRNG.
+ */
+static inline __m128i
+sse2_dither(__m128i *state, __m128i mul, __m128i add)
+{
+	const __m128i mask = _mm_set1_epi32(511);
+	__m128i r = *state;
+
+	*state = _mm_add_epi32(sse2_mullo_epi32(r, mul), add);
+
+	return _mm_add_epi32(_mm_sub_epi32(_mm_and_si128(r, mask),
+					   _mm_and_si128(_mm_srli_epi32(r, 9),
+							 mask)),
+			     _mm_set1_epi32(PCM_VOLUME_1 / 2));
+}
+
+/**
+ * Divides by #PCM_VOLUME_1, rounding towards zero like the C
+ * division operator.
+ */
+static inline __m128i
+sse2_div_volume(__m128i x)
+{
+	__m128i bias = _mm_srli_epi32(_mm_srai_epi32(x, 31),
+				      32 - PCM_VOLUME_SHIFT);
+
+	return _mm_srai_epi32(_mm_add_epi32(x, bias), PCM_VOLUME_SHIFT);
+}
+
+static inline __m128i
+sse2_dither_begin(__m128i *mul_r, __m128i *add_r)
+{
+	uint32_t lanes[4], mul, add;
+
+	pcm_simd_dither_begin(lanes, G_N_ELEMENTS(lanes), &mul, &add);
+	*mul_r = _mm_set1_epi32(mul);
+	*add_r = _mm_set1_epi32(add);
+	return _mm_loadu_si128((const __m128i *)lanes);
+}
+
+static inline void
+sse2_dither_end(__m128i state)
+{
+	pcm_simd_dither_end(_mm_cvtsi128_si32(_mm_shuffle_epi32(state,
+								0xff)));
+}
+
+static unsigned
+sse2_volume_16(int16_t *buffer, unsigned num_samples, int volume)
+{
+	if (volume > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~7u;
+	const __m128i v = _mm_set1_epi16(volume);
+	__m128i mul, add, state = sse2_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i *p = (__m128i *)(buffer + i);
+		__m128i s = _mm_loadu_si128(p);
+		__m128i lo = _mm_mullo_epi16(s, v);
+		__m128i hi = _mm_mulhi_epi16(s, v);
+
+		__m128i a = _mm_unpacklo_epi16(lo, hi);
+		__m128i b = _mm_unpackhi_epi16(lo, hi);
+		a = sse2_div_volume(_mm_add_epi32(a, sse2_dither(&state,
+								 mul, add)));
+		b = sse2_div_volume(_mm_add_epi32(b, sse2_dither(&state,
+								 mul, add)));
+
+		/* saturation is the same as pcm_range(sample, 16) */
+		_mm_storeu_si128(p, _mm_packs_epi32(a, b));
+	}
+
+	sse2_dither_end(state);
+	return n;
+}
+
+static unsigned
+sse2_add_vol_16(int16_t *buffer1, const int16_t *buffer2,
+		unsigned num_samples, int volume1, int volume2)
+{
+	if (volume1 > PCM_SIMD_MAX_VOLUME || volume2 > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~7u;
+	const __m128i v = _mm_set1_epi32((volume2 << 16) |
+					 (volume1 & 0xffff));
+	__m128i mul, add, state = sse2_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i *p = (__m128i *)(buffer1 + i);
+		__m128i s1 = _mm_loadu_si128(p);
+		__m128i s2 = _mm_loadu_si128((const __m128i *)(buffer2 + i));
+
+		/* sample1 * volume1 + sample2 * volume2 */
+		__m128i a = _mm_madd_epi16(_mm_unpacklo_epi16(s1, s2), v);
+		__m128i b = _mm_madd_epi16(_mm_unpackhi_epi16(s1, s2), v);
+		a = sse2_div_volume(_mm_add_epi32(a, sse2_dither(&state,
+								 mul, add)));
+		b = sse2_div_volume(_mm_add_epi32(b, sse2_dither(&state,
+								 mul, add)));
+
+		_mm_storeu_si128(p, _mm_packs_epi32(a, b));
+	}
+
+	sse2_dither_end(state);
+	return n;
+}
+
+static unsigned
+sse2_add_16(int16_t *buffer1, const int16_t *buffer2, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i *p = (__m128i *)(buffer1 + i);
+		__m128i s2 = _mm_loadu_si128((const __m128i *)(buffer2 + i));
+
+		_mm_storeu_si128(p, _mm_adds_epi16(_mm_loadu_si128(p), s2));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_convert_16_to_32(int32_t *dest, const int16_t *src,
+		      unsigned num_samples, unsigned shift)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i count = _mm_cvtsi32_si128(16 - shift);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		/* move each sample to the upper half of a 32 bit
+		   word, then shift it back with sign extension */
+		__m128i a = _mm_sra_epi32(_mm_unpacklo_epi16(zero, s), count);
+		__m128i b = _mm_sra_epi32(_mm_unpackhi_epi16(zero, s), count);
+
+		_mm_storeu_si128((__m128i *)(dest + i), a);
+		_mm_storeu_si128((__m128i *)(dest + i + 4), b);
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_shift_32(int32_t *dest, const int32_t *src,
+	      unsigned num_samples, int shift)
+{
+	const unsigned n = num_samples & ~3u;
+	const __m128i count = _mm_cvtsi32_si128(shift >= 0 ? shift : -shift);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		s = shift >= 0
+			? _mm_sll_epi32(s, count)
+			: _mm_sra_epi32(s, count);
+		_mm_storeu_si128((__m128i *)(dest + i), s);
+	}
+
+	return n;
+}
+
+static inline __m128i
+sse2_byteswap_16(__m128i x)
+{
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+static unsigned
+sse2_byteswap_16_kernel(uint16_t *dest, const uint16_t *src,
+			unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm_storeu_si128((__m128i *)(dest + i), sse2_byteswap_16(s));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_byteswap_32(uint32_t *dest, const uint32_t *src, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		/* swap the bytes of each 16 bit word, then swap the
+		   words */
+		s = sse2_byteswap_16(s);
+		s = _mm_shufflelo_epi16(s, 0xb1);
+		s = _mm_shufflehi_epi16(s, 0xb1);
+		_mm_storeu_si128((__m128i *)(dest + i), s);
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_channels_16_1_to_2(int16_t *dest, const int16_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm_storeu_si128((__m128i *)(dest + i * 2),
+				 _mm_unpacklo_epi16(s, s));
+		_mm_storeu_si128((__m128i *)(dest + i * 2 + 8),
+				 _mm_unpackhi_epi16(s, s));
+	}
+
+	return n;
+}
+
+/**
+ * Divides by two, rounding towards zero like the C division
+ * operator.
+ */
+static inline __m128i
+sse2_div_2(__m128i x)
+{
+	return _mm_srai_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 31)), 1);
+}
+
+static unsigned
+sse2_channels_16_2_to_1(int16_t *dest, const int16_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~7u;
+	const __m128i one = _mm_set1_epi16(1);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(src + i * 2));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + i * 2 + 8));
+
+		/* left + right as 32 bit integers */
+		a = sse2_div_2(_mm_madd_epi16(a, one));
+		b = sse2_div_2(_mm_madd_epi16(b, one));
+
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(a, b));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_channels_32_1_to_2(int32_t *dest, const int32_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm_storeu_si128((__m128i *)(dest + i * 2),
+				 _mm_unpacklo_epi32(s, s));
+		_mm_storeu_si128((__m128i *)(dest + i * 2 + 4),
+				 _mm_unpackhi_epi32(s, s));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_channels_24_2_to_1(int32_t *dest, const int32_t *src,
+			unsigned num_frames)
+{
+	const unsigned n = num_frames & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128 a = _mm_loadu_ps((const float *)(src + i * 2));
+		__m128 b = _mm_loadu_ps((const float *)(src + i * 2 + 4));
+
+		/* separate the left and right channels */
+		__m128i left = _mm_castps_si128(_mm_shuffle_ps(a, b, 0x88));
+		__m128i right = _mm_castps_si128(_mm_shuffle_ps(a, b, 0xdd));
+
+		_mm_storeu_si128((__m128i *)(dest + i),
+				 sse2_div_2(_mm_add_epi32(left, right)));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_volume_float(float *buffer, unsigned num_samples, float volume)
+{
+	const unsigned n = num_samples & ~3u;
+	const __m128 v = _mm_set1_ps(volume);
+
+	for (unsigned i = 0; i < n; i += 4)
+		_mm_storeu_ps(buffer + i,
+			      _mm_mul_ps(_mm_loadu_ps(buffer + i), v));
+
+	return n;
+}
+
+static unsigned
+sse2_add_vol_float(float *buffer1, const float *buffer2,
+		   unsigned num_samples, float volume1, float volume2)
+{
+	const unsigned n = num_samples & ~3u;
+	const __m128 v1 = _mm_set1_ps(volume1);
+	const __m128 v2 = _mm_set1_ps(volume2);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(buffer1 + i), v1);
+		__m128 b = _mm_mul_ps(_mm_loadu_ps(buffer2 + i), v2);
+
+		_mm_storeu_ps(buffer1 + i, _mm_add_ps(a, b));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_add_float(float *buffer1, const float *buffer2, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~3u;
+
+	for (unsigned i = 0; i < n; i += 4)
+		_mm_storeu_ps(buffer1 + i,
+			      _mm_add_ps(_mm_loadu_ps(buffer1 + i),
+					 _mm_loadu_ps(buffer2 + i)));
+
+	return n;
+}
+
+static unsigned
+sse2_convert_16_to_float(float *dest, const int16_t *src,
+			 unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 factor = _mm_set1_ps(1.0f / (1 << 15));
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(zero, s), 16);
+		__m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(zero, s), 16);
+
+		_mm_storeu_ps(dest + i,
+			      _mm_mul_ps(_mm_cvtepi32_ps(a), factor));
+		_mm_storeu_ps(dest + i + 4,
+			      _mm_mul_ps(_mm_cvtepi32_ps(b), factor));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_convert_32_to_float(float *dest, const int32_t *src,
+			 unsigned num_samples, unsigned bits)
+{
+	const unsigned n = num_samples & ~3u;
+	const __m128 factor = _mm_set1_ps(1.0f / (float)(1u << (bits - 1)));
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm_storeu_ps(dest + i,
+			      _mm_mul_ps(_mm_cvtepi32_ps(s), factor));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_convert_float_to_32(int32_t *dest, const float *src,
+			 unsigned num_samples, unsigned bits)
+{
+	const unsigned n = num_samples & ~3u;
+	const float f = (float)(1u << (bits - 1));
+	const __m128 factor = _mm_set1_ps(f);
+	const __m128 max = _mm_set1_ps(bits > 24
+				       ? f * (1.0f - FLT_EPSILON / 2)
+				       : f - 1);
+	const __m128 min = _mm_set1_ps(-f);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128 s = _mm_mul_ps(_mm_loadu_ps(src + i), factor);
+
+		/* NaN compares unequal to itself; replace it with
+		   zero, then clip */
+		s = _mm_and_ps(s, _mm_cmpeq_ps(s, s));
+		s = _mm_max_ps(_mm_min_ps(s, max), min);
+
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_cvttps_epi32(s));
+	}
+
+	return n;
+}
+
+static unsigned
+sse2_channels_float_2_to_1(float *dest, const float *src,
+			   unsigned num_frames)
+{
+	const unsigned n = num_frames & ~3u;
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128 a = _mm_loadu_ps(src + i * 2);
+		__m128 b = _mm_loadu_ps(src + i * 2 + 4);
+		__m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+		_mm_storeu_ps(dest + i,
+			      _mm_mul_ps(_mm_add_ps(left, right), half));
+	}
+
+	return n;
+}
+
+static inline int32_t
+sse2_hsum_epi32(__m128i x)
+{
+	x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+	x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(x);
+}
+
+static inline float
+sse2_hsum_ps(__m128 x)
+{
+	x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+	x = _mm_add_ss(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(x);
+}
+
+static unsigned
+sse2_dot_16(int32_t *sum_r, const int16_t *a, const int16_t *b, unsigned n)
+{
+	const unsigned m = n & ~7u;
+	__m128i sum = _mm_setzero_si128();
+
+	for (unsigned i = 0; i < m; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(x, y));
+	}
+
+	*sum_r += sse2_hsum_epi32(sum);
+	return m;
+}
+
+static unsigned
+sse2_dot_float(float *sum_r, const float *a, const float *b, unsigned n)
+{
+	const unsigned m = n & ~7u;
+	__m128 sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps();
+
+	/* two accumulators hide the latency of the additions */
+	for (unsigned i = 0; i < m; i += 8) {
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i),
+						   _mm_loadu_ps(b + i)));
+		sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+						   _mm_loadu_ps(b + i + 4)));
+	}
+
+	*sum_r += sse2_hsum_ps(_mm_add_ps(sum1, sum2));
+	return m;
+}
+
+const struct pcm_simd_kernels pcm_simd_sse2 = {
+	.name = "sse2",
+	.volume_16 = sse2_volume_16,
+	.add_vol_16 = sse2_add_vol_16,
+	.add_16 = sse2_add_16,
+	.volume_float = sse2_volume_float,
+	.add_vol_float = sse2_add_vol_float,
+	.add_float = sse2_add_float,
+	.convert_16_to_32 = sse2_convert_16_to_32,
+	.shift_32 = sse2_shift_32,
+	.convert_16_to_float = sse2_convert_16_to_float,
+	.convert_32_to_float = sse2_convert_32_to_float,
+	.convert_float_to_32 = sse2_convert_float_to_32,
+	.byteswap_16 = sse2_byteswap_16_kernel,
+	.byteswap_32 = sse2_byteswap_32,
+	.channels_16_1_to_2 = sse2_channels_16_1_to_2,
+	.channels_16_2_to_1 = sse2_channels_16_2_to_1,
+	.channels_32_1_to_2 = sse2_channels_32_1_to_2,
+	.channels_24_2_to_1 = sse2_channels_24_2_to_1,
+	.channels_float_2_to_1 = sse2_channels_float_2_to_1,
+	.dot_16 = sse2_dot_16,
+	.dot_float = sse2_dot_float,
+};
+
+#ifdef PCM_SIMD_AVX2
+
+/*
+ * AVX2
+ *
+ */
+
+#define AVX2 __attribute__((target("avx2")))
+
+static AVX2 inline __m256i
+avx2_dither(__m256i *state, __m256i mul, __m256i add)
+{
+	const __m256i mask = _mm256_set1_epi32(511);
+	__m256i r = *state;
+
+	*state = _mm256_add_epi32(_mm256_mullo_epi32(r, mul), add);
+
+	return _mm256_add_epi32(_mm256_sub_epi32(_mm256_and_si256(r, mask),
+						 _mm256_and_si256(_mm256_srli_epi32(r, 9),
+								  mask)),
+				_mm256_set1_epi32(PCM_VOLUME_1 / 2));
+}
+
+static AVX2 inline __m256i
+avx2_div_volume(__m256i x)
+{
+	__m256i bias = _mm256_srli_epi32(_mm256_srai_epi32(x, 31),
+					 32 - PCM_VOLUME_SHIFT);
+
+	return _mm256_srai_epi32(_mm256_add_epi32(x, bias),
+				 PCM_VOLUME_SHIFT);
+}
+
+static AVX2 inline __m256i
+avx2_dither_begin(__m256i *mul_r, __m256i *add_r)
+{
+	uint32_t lanes[8], mul, add;
+
+	pcm_simd_dither_begin(lanes, G_N_ELEMENTS(lanes), &mul, &add);
+	*mul_r = _mm256_set1_epi32(mul);
+	*add_r = _mm256_set1_epi32(add);
+	return _mm256_loadu_si256((const __m256i *)lanes);
+}
+
+static AVX2 inline void
+avx2_dither_end(__m256i state)
+{
+	pcm_simd_dither_end(_mm256_extract_epi32(state, 7));
+}
+
+static AVX2 unsigned
+avx2_volume_16(int16_t *buffer, unsigned num_samples, int volume)
+{
+	if (volume > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~15u;
+	const __m256i v = _mm256_set1_epi16(volume);
+	__m256i mul, add, state = avx2_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 16) {
+		__m256i *p = (__m256i *)(buffer + i);
+		__m256i s = _mm256_loadu_si256(p);
+		__m256i lo = _mm256_mullo_epi16(s, v);
+		__m256i hi = _mm256_mulhi_epi16(s, v);
+
+		/* unpack and pack both work within 128 bit lanes, so
+		   the sample order is preserved */
+		__m256i a = _mm256_unpacklo_epi16(lo, hi);
+		__m256i b = _mm256_unpackhi_epi16(lo, hi);
+		a = avx2_div_volume(_mm256_add_epi32(a, avx2_dither(&state,
+								    mul, add)));
+		b = avx2_div_volume(_mm256_add_epi32(b, avx2_dither(&state,
+								    mul, add)));
+
+		_mm256_storeu_si256(p, _mm256_packs_epi32(a, b));
+	}
+
+	avx2_dither_end(state);
+	return n;
+}
+
+static AVX2 unsigned
+avx2_add_vol_16(int16_t *buffer1, const int16_t *buffer2,
+		unsigned num_samples, int volume1, int volume2)
+{
+	if (volume1 > PCM_SIMD_MAX_VOLUME || volume2 > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~15u;
+	const __m256i v = _mm256_set1_epi32((volume2 << 16) |
+					    (volume1 & 0xffff));
+	__m256i mul, add, state = avx2_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 16) {
+		__m256i *p = (__m256i *)(buffer1 + i);
+		__m256i s1 = _mm256_loadu_si256(p);
+		__m256i s2 = _mm256_loadu_si256((const __m256i *)(buffer2 + i));
+
+		__m256i a = _mm256_madd_epi16(_mm256_unpacklo_epi16(s1, s2), v);
+		__m256i b = _mm256_madd_epi16(_mm256_unpackhi_epi16(s1, s2), v);
+		a = avx2_div_volume(_mm256_add_epi32(a, avx2_dither(&state,
+								    mul, add)));
+		b = avx2_div_volume(_mm256_add_epi32(b, avx2_dither(&state,
+								    mul, add)));
+
+		_mm256_storeu_si256(p, _mm256_packs_epi32(a, b));
+	}
+
+	avx2_dither_end(state);
+	return n;
+}
+
+static AVX2 unsigned
+avx2_add_16(int16_t *buffer1, const int16_t *buffer2, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~15u;
+
+	for (unsigned i = 0; i < n; i += 16) {
+		__m256i *p = (__m256i *)(buffer1 + i);
+		__m256i s2 = _mm256_loadu_si256((const __m256i *)(buffer2 + i));
+
+		_mm256_storeu_si256(p, _mm256_adds_epi16(_mm256_loadu_si256(p),
+							 s2));
+	}
+
+	return n;
+}
+
+static AVX2 inline __m256d
+avx2_low_pd(__m256i x)
+{
+	return _mm256_cvtepi32_pd(_mm256_castsi256_si128(x));
+}
+
+static AVX2 inline __m256d
+avx2_high_pd(__m256i x)
+{
+	return _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1));
+}
+
+/**
+ * Finishes four samples calculated with doubles: (x + dither) /
+ * #PCM_VOLUME_1, clamped to the range [min, max].
+ */
+static AVX2 inline __m128i
+avx2_scale_pd(__m256d x, __m256d dither, __m256d min, __m256d max)
+{
+	x = _mm256_mul_pd(_mm256_add_pd(x, dither),
+			  _mm256_set1_pd(1.0 / PCM_VOLUME_1));
+	x = _mm256_min_pd(_mm256_max_pd(x, min), max);
+
+	return _mm256_cvttpd_epi32(x);
+}
+
+static AVX2 inline __m256i
+avx2_combine(__m128i low, __m128i high)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+static AVX2 unsigned
+avx2_volume_wide(int32_t *buffer, unsigned num_samples, int volume,
+		 unsigned bits)
+{
+	if (volume > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~7u;
+	const __m256d v = _mm256_set1_pd(volume);
+	const __m256d min = _mm256_set1_pd(-((int64_t)1 << (bits - 1)));
+	const __m256d max = _mm256_set1_pd(((int64_t)1 << (bits - 1)) - 1);
+	__m256i mul, add, state = avx2_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m256i *p = (__m256i *)(buffer + i);
+		__m256i s = _mm256_loadu_si256(p);
+		__m256i d = avx2_dither(&state, mul, add);
+
+		__m128i a = avx2_scale_pd(_mm256_mul_pd(avx2_low_pd(s), v),
+					  avx2_low_pd(d), min, max);
+		__m128i b = avx2_scale_pd(_mm256_mul_pd(avx2_high_pd(s), v),
+					  avx2_high_pd(d), min, max);
+
+		_mm256_storeu_si256(p, avx2_combine(a, b));
+	}
+
+	avx2_dither_end(state);
+	return n;
+}
+
+static AVX2 unsigned
+avx2_volume_24(int32_t *buffer, unsigned num_samples, int volume)
+{
+	return avx2_volume_wide(buffer, num_samples, volume, 24);
+}
+
+static AVX2 unsigned
+avx2_volume_32(int32_t *buffer, unsigned num_samples, int volume)
+{
+	return avx2_volume_wide(buffer, num_samples, volume, 32);
+}
+
+static AVX2 unsigned
+avx2_add_vol_wide(int32_t *buffer1, const int32_t *buffer2,
+		  unsigned num_samples, int volume1, int volume2,
+		  unsigned bits)
+{
+	if (volume1 > PCM_SIMD_MAX_VOLUME || volume2 > PCM_SIMD_MAX_VOLUME)
+		return 0;
+
+	const unsigned n = num_samples & ~7u;
+	const __m256d v1 = _mm256_set1_pd(volume1);
+	const __m256d v2 = _mm256_set1_pd(volume2);
+	const __m256d min = _mm256_set1_pd(-((int64_t)1 << (bits - 1)));
+	const __m256d max = _mm256_set1_pd(((int64_t)1 << (bits - 1)) - 1);
+	__m256i mul, add, state = avx2_dither_begin(&mul, &add);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m256i *p = (__m256i *)(buffer1 + i);
+		__m256i s1 = _mm256_loadu_si256(p);
+		__m256i s2 = _mm256_loadu_si256((const __m256i *)(buffer2 + i));
+		__m256i d = avx2_dither(&state, mul, add);
+
+		/* sample1 * volume1 + sample2 * volume2 */
+		__m256d x = _mm256_add_pd(_mm256_mul_pd(avx2_low_pd(s1), v1),
+					  _mm256_mul_pd(avx2_low_pd(s2), v2));
+		__m256d y = _mm256_add_pd(_mm256_mul_pd(avx2_high_pd(s1), v1),
+					  _mm256_mul_pd(avx2_high_pd(s2), v2));
+
+		__m128i a = avx2_scale_pd(x, avx2_low_pd(d), min, max);
+		__m128i b = avx2_scale_pd(y, avx2_high_pd(d), min, max);
+
+		_mm256_storeu_si256(p, avx2_combine(a, b));
+	}
+
+	avx2_dither_end(state);
+	return n;
+}
+
+static AVX2 unsigned
+avx2_add_vol_24(int32_t *buffer1, const int32_t *buffer2,
+		unsigned num_samples, int volume1, int volume2)
+{
+	return avx2_add_vol_wide(buffer1, buffer2, num_samples,
+				 volume1, volume2, 24);
+}
+
+static AVX2 unsigned
+avx2_add_vol_32(int32_t *buffer1, const int32_t *buffer2,
+		unsigned num_samples, int volume1, int volume2)
+{
+	return avx2_add_vol_wide(buffer1, buffer2, num_samples,
+				 volume1, volume2, 32);
+}
+
+static AVX2 unsigned
+avx2_convert_16_to_32(int32_t *dest, const int16_t *src,
+		      unsigned num_samples, unsigned shift)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m128i count = _mm_cvtsi32_si128(shift);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_sll_epi32(_mm256_cvtepi16_epi32(s),
+						     count));
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_shift_32(int32_t *dest, const int32_t *src,
+	      unsigned num_samples, int shift)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m128i count = _mm_cvtsi32_si128(shift >= 0 ? shift : -shift);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+
+		s = shift >= 0
+			? _mm256_sll_epi32(s, count)
+			: _mm256_sra_epi32(s, count);
+		_mm256_storeu_si256((__m256i *)(dest + i), s);
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_byteswap_16(uint16_t *dest, const uint16_t *src, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~15u;
+	const __m256i mask =
+		_mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+				 9, 8, 11, 10, 13, 12, 15, 14,
+				 1, 0, 3, 2, 5, 4, 7, 6,
+				 9, 8, 11, 10, 13, 12, 15, 14);
+
+	for (unsigned i = 0; i < n; i += 16) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_shuffle_epi8(s, mask));
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_byteswap_32(uint32_t *dest, const uint32_t *src, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m256i mask =
+		_mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+				 11, 10, 9, 8, 15, 14, 13, 12,
+				 3, 2, 1, 0, 7, 6, 5, 4,
+				 11, 10, 9, 8, 15, 14, 13, 12);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_shuffle_epi8(s, mask));
+	}
+
+	return n;
+}
+
+/*
+ * The 24 bit pack and unpack kernels process four samples (twelve
+ * packed bytes) per step, but load or store 16 bytes.  The loop stops
+ * early enough so the excess bytes are within the buffer; they are
+ * overwritten by the next step.
+ */
+
+static AVX2 unsigned
+avx2_pack_24(uint8_t *dest, const int32_t *src, unsigned num_samples)
+{
+	const unsigned n = num_samples >= 6 ? (num_samples - 2) & ~3u : 0;
+	const __m128i mask =
+		_mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+			      10, 12, 13, 14, -1, -1, -1, -1);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+
+		_mm_storeu_si128((__m128i *)(dest + i * 3),
+				 _mm_shuffle_epi8(s, mask));
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_unpack_24(int32_t *dest, const uint8_t *src, unsigned num_samples)
+{
+	const unsigned n = num_samples >= 6 ? (num_samples - 2) & ~3u : 0;
+	const __m128i mask =
+		_mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+			      -1, 6, 7, 8, -1, 9, 10, 11);
+
+	for (unsigned i = 0; i < n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i * 3));
+
+		/* move the three bytes to the upper part of each 32
+		   bit word, then shift back with sign extension */
+		s = _mm_srai_epi32(_mm_shuffle_epi8(s, mask), 8);
+		_mm_storeu_si128((__m128i *)(dest + i), s);
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_volume_float(float *buffer, unsigned num_samples, float volume)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m256 v = _mm256_set1_ps(volume);
+
+	for (unsigned i = 0; i < n; i += 8)
+		_mm256_storeu_ps(buffer + i,
+				 _mm256_mul_ps(_mm256_loadu_ps(buffer + i), v));
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_add_vol_float(float *buffer1, const float *buffer2,
+		   unsigned num_samples, float volume1, float volume2)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m256 v1 = _mm256_set1_ps(volume1);
+	const __m256 v2 = _mm256_set1_ps(volume2);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m256 a = _mm256_mul_ps(_mm256_loadu_ps(buffer1 + i), v1);
+		__m256 b = _mm256_mul_ps(_mm256_loadu_ps(buffer2 + i), v2);
+
+		_mm256_storeu_ps(buffer1 + i, _mm256_add_ps(a, b));
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_add_float(float *buffer1, const float *buffer2, unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+
+	for (unsigned i = 0; i < n; i += 8)
+		_mm256_storeu_ps(buffer1 + i,
+				 _mm256_add_ps(_mm256_loadu_ps(buffer1 + i),
+					       _mm256_loadu_ps(buffer2 + i)));
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_convert_16_to_float(float *dest, const int16_t *src,
+			 unsigned num_samples)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m256 factor = _mm256_set1_ps(1.0f / (1 << 15));
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m256 f = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s));
+
+		_mm256_storeu_ps(dest + i, _mm256_mul_ps(f, factor));
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_convert_32_to_float(float *dest, const int32_t *src,
+			 unsigned num_samples, unsigned bits)
+{
+	const unsigned n = num_samples & ~7u;
+	const __m256 factor =
+		_mm256_set1_ps(1.0f / (float)(1u << (bits - 1)));
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+
+		_mm256_storeu_ps(dest + i,
+				 _mm256_mul_ps(_mm256_cvtepi32_ps(s), factor));
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_convert_float_to_32(int32_t *dest, const float *src,
+			 unsigned num_samples, unsigned bits)
+{
+	const unsigned n = num_samples & ~7u;
+	const float f = (float)(1u << (bits - 1));
+	const __m256 factor = _mm256_set1_ps(f);
+	const __m256 max = _mm256_set1_ps(bits > 24
+					  ? f * (1.0f - FLT_EPSILON / 2)
+					  : f - 1);
+	const __m256 min = _mm256_set1_ps(-f);
+
+	for (unsigned i = 0; i < n; i += 8) {
+		__m256 s = _mm256_mul_ps(_mm256_loadu_ps(src + i), factor);
+
+		s = _mm256_and_ps(s, _mm256_cmp_ps(s, s, _CMP_EQ_OQ));
+		s = _mm256_max_ps(_mm256_min_ps(s, max), min);
+
+		_mm256_storeu_si256((__m256i *)(dest + i),
+				    _mm256_cvttps_epi32(s));
+	}
+
+	return n;
+}
+
+static AVX2 unsigned
+avx2_dot_16(int32_t *sum_r, const int16_t *a, const int16_t *b, unsigned n)
+{
+	const unsigned m = n & ~15u;
+	__m256i sum = _mm256_setzero_si256();
+	__m128i sum128;
+
+	for (unsigned i = 0; i < m; i += 16) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, y));
+	}
+
+	sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+			       _mm256_extracti128_si256(sum, 1));
+
+	if (n - m >= 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + m));
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + m));
+
+		sum128 = _mm_add_epi32(sum128, _mm_madd_epi16(x, y));
+	}
+
+	*sum_r += sse2_hsum_epi32(sum128);
+	return n & ~7u;
+}
+
+static AVX2 unsigned
+avx2_dot_float(float *sum_r, const float *a, const float *b, unsigned n)
+{
+	const unsigned m = n & ~15u;
+	__m256 sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps();
+	__m128 sum128;
+
+	for (unsigned i = 0; i < m; i += 16) {
+		sum1 = _mm256_add_ps(sum1,
+				     _mm256_mul_ps(_mm256_loadu_ps(a + i),
+						   _mm256_loadu_ps(b + i)));
+		sum2 = _mm256_add_ps(sum2,
+				     _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+						   _mm256_loadu_ps(b + i + 8)));
+	}
+
+	if (n - m >= 8)
+		sum1 = _mm256_add_ps(sum1,
+				     _mm256_mul_ps(_mm256_loadu_ps(a + m),
+						   _mm256_loadu_ps(b + m)));
+
+	sum1 = _mm256_add_ps(sum1, sum2);
+	sum128 = _mm_add_ps(_mm256_castps256_ps128(sum1),
+			    _mm256_extractf128_ps(sum1, 1));
+
+	*sum_r += sse2_hsum_ps(sum128);
+	return n & ~7u;
+}
+
+static bool
+avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+const struct pcm_simd_kernels pcm_simd_avx2 = {
+	.name = "avx2",
+	.supported = avx2_supported,
+	.volume_16 = avx2_volume_16,
+	.volume_24 = avx2_volume_24,
+	.volume_32 = avx2_volume_32,
+	.add_vol_16 = avx2_add_vol_16,
+	.add_vol_24 = avx2_add_vol_24,
+	.add_vol_32 = avx2_add_vol_32,
+	.add_16 = avx2_add_16,
+	.volume_float = avx2_volume_float,
+	.add_vol_float = avx2_add_vol_float,
+	.add_float = avx2_add_float,
+	.convert_16_to_32 = avx2_convert_16_to_32,
+	.shift_32 = avx2_shift_32,
+	.convert_16_to_float = avx2_convert_16_to_float,
+	.convert_32_to_float = avx2_convert_32_to_float,
+	.convert_float_to_32 = avx2_convert_float_to_32,
+	.pack_24 = avx2_pack_24,
+	.unpack_24 = avx2_unpack_24,
+	.byteswap_16 = avx2_byteswap_16,
+	.byteswap_32 = avx2_byteswap_32,
+	.channels_16_1_to_2 = sse2_channels_16_1_to_2,
+	.channels_16_2_to_1 = sse2_channels_16_2_to_1,
+	.channels_32_1_to_2 = sse2_channels_32_1_to_2,
+	.channels_24_2_to_1 = sse2_channels_24_2_to_1,
+	.channels_float_2_to_1 = sse2_channels_float_2_to_1,
+	.dot_16 = avx2_dot_16,
+	.dot_float = avx2_dot_float,
+};
+
+#endif /* PCM_SIMD_AVX2 */
+
+#endif /* PCM_SIMD_X86 */
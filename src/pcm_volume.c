@@ -20,6 +20,7 @@
 #include "config.h"
 #include "pcm_volume.h"
 #include "pcm_utils.h"
+#include "pcm_simd.h"
 #include "audio_format.h"
 
 #include <glib.h>
@@ -48,6 +49,10 @@ pcm_volume_change_8(int8_t *buffer, unsigned num_samples, int volume)
 static void
 pcm_volume_change_16(int16_t *buffer, unsigned num_samples, int volume)
 {
+	unsigned n = pcm_simd_volume_16(buffer, num_samples, volume);
+	buffer += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 		int32_t sample = *buffer;
 
@@ -94,6 +99,10 @@ pcm_volume_sample_24(int32_t sample, int32_t volume, G_GNUC_UNUSED int32_t dithe
 static void
 pcm_volume_change_24(int32_t *buffer, unsigned num_samples, int volume)
 {
+	unsigned n = pcm_simd_volume_24(buffer, num_samples, volume);
+	buffer += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 #ifdef __i386__
 		/* assembly version for i386 */
@@ -117,6 +126,10 @@ pcm_volume_change_24(int32_t *buffer, unsigned num_samples, int volume)
 static void
 pcm_volume_change_32(int32_t *buffer, unsigned num_samples, int volume)
 {
+	unsigned n = pcm_simd_volume_32(buffer, num_samples, volume);
+	buffer += n;
+	num_samples -= n;
+
 	while (num_samples > 0) {
 #ifdef __i386__
 		/* assembly version for i386 */
@@ -137,6 +150,19 @@ pcm_volume_change_32(int32_t *buffer, unsigned num_samples, int volume)
 	}
 }
 
+static void
+pcm_volume_change_float(float *buffer, unsigned num_samples, float volume)
+{
+	unsigned n = pcm_simd_volume_float(buffer, num_samples, volume);
+	buffer += n;
+	num_samples -= n;
+
+	while (num_samples > 0) {
+		*buffer++ *= volume;
+		--num_samples;
+	}
+}
+
 bool
 pcm_volume(void *buffer, int length,
 	   const struct audio_format *format,
@@ -170,6 +196,11 @@ pcm_volume(void *buffer, int length,
 				     volume);
 		return true;
 
+	case SAMPLE_FORMAT_FLOAT:
+		pcm_volume_change_float((float *)buffer, length / 4,
+					pcm_volume_to_float(volume));
+		return true;
+
 	default:
 		return false;
 	}
@@ -21,6 +21,7 @@
 #include "pipe.h"
 #include "buffer.h"
 #include "chunk.h"
+#include "lockfree.h"
 
 #include <glib.h>
 
@@ -30,6 +31,19 @@ struct music_pipe {
 	/** the first chunk */
 	struct music_chunk *head;
 
+#if MUSIC_PIPE_LOCKFREE
+	/**
+	 * The last chunk, or NULL if the pipe is empty.  Both #head
+	 * and #tail are only accessed with atomic operations.  This
+	 * implementation allows only one thread to call
+	 * music_pipe_push() and one thread to call
+	 * music_pipe_shift() at a time.
+	 */
+	struct music_chunk *tail;
+
+	/** the current number of chunks */
+	volatile gint size;
+#else
 	/** a pointer to the tail of the chunk */
 	struct music_chunk **tail_r;
 
@@ -38,21 +52,55 @@ struct music_pipe {
 
 	/** a mutex which protects #head and #tail_r */
 	GMutex *mutex;
+#endif
 
 #ifndef NDEBUG
+	/**
+	 * The audio format of the chunks in this pipe.  This is not
+	 * tracked by the lock-free implementation, because it cannot
+	 * be updated consistently with #size.
+	 */
 	struct audio_format audio_format;
 #endif
 };
 
+#if MUSIC_PIPE_LOCKFREE
+
+static inline struct music_chunk *
+chunk_pointer_get(struct music_chunk *const*p)
+{
+	return g_atomic_pointer_get((volatile gpointer *)p);
+}
+
+static inline void
+chunk_pointer_set(struct music_chunk **p, struct music_chunk *value)
+{
+	g_atomic_pointer_set((volatile gpointer *)p, value);
+}
+
+static inline bool
+chunk_pointer_cas(struct music_chunk **p,
+		  struct music_chunk *old_value, struct music_chunk *new_value)
+{
+	return g_atomic_pointer_compare_and_exchange((volatile gpointer *)p,
+						     old_value, new_value);
+}
+
+#endif
+
 struct music_pipe *
 music_pipe_new(void)
 {
 	struct music_pipe *mp = g_new(struct music_pipe, 1);
 
 	mp->head = NULL;
+#if MUSIC_PIPE_LOCKFREE
+	mp->tail = NULL;
+#else
 	mp->tail_r = &mp->head;
-	mp->size = 0;
 	mp->mutex = g_mutex_new();
+#endif
+	mp->size = 0;
 
 #ifndef NDEBUG
 	audio_format_clear(&mp->audio_format);
@@ -65,9 +113,14 @@ void
 music_pipe_free(struct music_pipe *mp)
 {
 	assert(mp->head == NULL);
+
+#if MUSIC_PIPE_LOCKFREE
+	assert(mp->tail == NULL);
+#else
 	assert(mp->tail_r == &mp->head);
 
 	g_mutex_free(mp->mutex);
+#endif
 	g_free(mp);
 }
 
@@ -88,6 +141,14 @@ bool
 music_pipe_contains(const struct music_pipe *mp,
 		    const struct music_chunk *chunk)
 {
+#if MUSIC_PIPE_LOCKFREE
+	/* chunks are only removed by the caller's thread, so
+	   walking the list is safe while another thread appends */
+	for (const struct music_chunk *i = chunk_pointer_get(&mp->head);
+	     i != NULL; i = chunk_pointer_get(&i->next))
+		if (i == chunk)
+			return true;
+#else
 	g_mutex_lock(mp->mutex);
 
 	for (const struct music_chunk *i = mp->head;
@@ -99,6 +160,7 @@ music_pipe_contains(const struct music_pipe *mp,
 	}
 
 	g_mutex_unlock(mp->mutex);
+#endif
 
 	return false;
 }
@@ -108,9 +170,58 @@ music_pipe_contains(const struct music_pipe *mp,
 const struct music_chunk *
 music_pipe_peek(const struct music_pipe *mp)
 {
+#if MUSIC_PIPE_LOCKFREE
+	return chunk_pointer_get(&mp->head);
+#else
 	return mp->head;
+#endif
+}
+
+#if MUSIC_PIPE_LOCKFREE
+
+struct music_chunk *
+music_pipe_shift(struct music_pipe *mp)
+{
+	struct music_chunk *chunk, *next;
+
+	chunk = chunk_pointer_get(&mp->head);
+	if (chunk == NULL)
+		return NULL;
+
+	assert(!music_chunk_is_empty(chunk));
+
+	next = chunk_pointer_get(&chunk->next);
+	if (next == NULL) {
+		if (chunk_pointer_cas(&mp->tail, chunk, NULL)) {
+			/* this was the last chunk; if
+			   music_pipe_push() has already installed
+			   a new head, leave it alone */
+			chunk_pointer_cas(&mp->head, chunk, NULL);
+			goto shifted;
+		}
+
+		/* music_pipe_push() has already replaced the tail,
+		   but has not linked the new chunk yet; this is a
+		   matter of a few instructions */
+		while ((next = chunk_pointer_get(&chunk->next)) == NULL)
+			g_thread_yield();
+	}
+
+	chunk_pointer_set(&mp->head, next);
+
+ shifted:
+	g_atomic_int_add(&mp->size, -1);
+
+#ifndef NDEBUG
+	/* poison the "next" reference */
+	chunk->next = (void*)0x01010101;
+#endif
+
+	return chunk;
 }
 
+#else
+
 struct music_chunk *
 music_pipe_shift(struct music_pipe *mp)
 {
@@ -149,6 +260,8 @@ music_pipe_shift(struct music_pipe *mp)
 	return chunk;
 }
 
+#endif
+
 void
 music_pipe_clear(struct music_pipe *mp, struct music_buffer *buffer)
 {
@@ -164,6 +277,21 @@ music_pipe_push(struct music_pipe *mp, struct music_chunk *chunk)
 	assert(!music_chunk_is_empty(chunk));
 	assert(chunk->length == 0 || audio_format_valid(&chunk->audio_format));
 
+#if MUSIC_PIPE_LOCKFREE
+	struct music_chunk *prev;
+
+	chunk->next = NULL;
+
+	prev = lockfree_pointer_exchange((volatile gpointer *)&mp->tail,
+					 chunk);
+	if (prev == NULL)
+		/* the pipe was empty */
+		chunk_pointer_set(&mp->head, chunk);
+	else
+		chunk_pointer_set(&prev->next, chunk);
+
+	g_atomic_int_inc(&mp->size);
+#else
 	g_mutex_lock(mp->mutex);
 
 	assert(mp->size > 0 || !audio_format_defined(&mp->audio_format));
@@ -182,10 +310,15 @@ music_pipe_push(struct music_pipe *mp, struct music_chunk *chunk)
 	++mp->size;
 
 	g_mutex_unlock(mp->mutex);
+#endif
 }
 
 unsigned
 music_pipe_size(const struct music_pipe *mp)
 {
+#if MUSIC_PIPE_LOCKFREE
+	return g_atomic_int_get(&mp->size);
+#else
 	return mp->size;
+#endif
 }
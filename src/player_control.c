@@ -37,9 +37,11 @@ struct player_control pc;
 static void
 pc_enqueue_song_locked(struct song *song);
 
-void pc_init(unsigned buffer_chunks, unsigned int buffered_before_play)
+void pc_init(unsigned buffer_chunks, size_t chunk_size,
+	     unsigned int buffered_before_play)
 {
 	pc.buffer_chunks = buffer_chunks;
+	pc.chunk_size = chunk_size;
 	pc.buffered_before_play = buffered_before_play;
 
 	pc.mutex = g_mutex_new();
@@ -84,6 +84,9 @@ struct player_status {
 struct player_control {
 	unsigned buffer_chunks;
 
+	/** the capacity of each chunk, see "audio_chunk_size" */
+	size_t chunk_size;
+
 	unsigned int buffered_before_play;
 
 	/** the handle of the player thread, or NULL if the player
@@ -118,7 +121,8 @@ struct player_control {
 
 extern struct player_control pc;
 
-void pc_init(unsigned buffer_chunks, unsigned buffered_before_play);
+void pc_init(unsigned buffer_chunks, size_t chunk_size,
+	     unsigned buffered_before_play);
 
 void pc_deinit(void);
 
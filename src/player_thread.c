@@ -341,11 +341,10 @@ static bool
 player_send_silence(struct player *player)
 {
 	struct music_chunk *chunk;
-	size_t frame_size =
-		audio_format_frame_size(&player->play_audio_format);
-	/* this formula ensures that we don't send
+	/* music_chunk_fill_size() ensures that we don't send
 	   partial frames */
-	unsigned num_frames = sizeof(chunk->data) / frame_size;
+	size_t length = music_chunk_fill_size(pc.chunk_size,
+					      &player->play_audio_format);
 
 	assert(audio_format_defined(&player->play_audio_format));
 
@@ -360,7 +359,7 @@ player_send_silence(struct player *player)
 #endif
 
 	chunk->times = -1.0; /* undefined time stamp */
-	chunk->length = num_frames * frame_size;
+	chunk->length = length;
 	memset(chunk->data, 0, chunk->length);
 
 	if (!audio_output_all_play(chunk)) {
@@ -901,6 +900,7 @@ static void do_play(struct decoder_control *dc)
 						dc->mixramp_prev_end,
 						&dc->out_audio_format,
 						&player.play_audio_format,
+						pc.chunk_size,
 						music_buffer_size(player_buffer) -
 						pc.buffered_before_play);
 			if (player.cross_fade_chunks > 0) {
@@ -987,7 +987,7 @@ static gpointer player_task(G_GNUC_UNUSED gpointer arg)
 	dc_init(&dc);
 	decoder_thread_start(&dc);
 
-	player_buffer = music_buffer_new(pc.buffer_chunks);
+	player_buffer = music_buffer_new(pc.buffer_chunks, pc.chunk_size);
 
 	player_lock();
 
@@ -1025,7 +1025,7 @@ static gpointer player_task(G_GNUC_UNUSED gpointer arg)
 			   music_chunk objects by freeing the
 			   music_buffer */
 			music_buffer_free(player_buffer);
-			player_buffer = music_buffer_new(pc.buffer_chunks);
+			player_buffer = music_buffer_new(pc.buffer_chunks, pc.chunk_size);
 #endif
 
 			break;
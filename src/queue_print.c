@@ -38,9 +38,18 @@ static void
 queue_print_song_info(struct client *client, const struct queue *queue,
 		      unsigned position)
 {
-	song_print_info(client, queue_get(queue, position));
-	client_printf(client, "Pos: %u\nId: %u\n",
-		      position, queue_position_to_id(queue, position));
+	char buffer[16];
+
+	client_record_begin(client);
+	song_print_fields(client, queue_get(queue, position));
+
+	g_snprintf(buffer, sizeof(buffer), "%u", position);
+	client_record_field(client, "Pos", buffer, false);
+	g_snprintf(buffer, sizeof(buffer), "%u",
+		   queue_position_to_id(queue, position));
+	client_record_field(client, "Id", buffer, false);
+
+	client_record_end(client);
 }
 
 void
@@ -27,6 +27,19 @@
 
 #include <assert.h>
 
+/**
+ * The size of the allocation for a song with the specified URI
+ * length.  Songs are allocated with GSlice, because there are many
+ * of them in the database, and malloc() overhead per song would be
+ * significant.
+ */
+static inline size_t
+song_alloc_size(size_t uri_length)
+{
+	return sizeof(struct song) - sizeof(((struct song *)NULL)->uri) +
+		uri_length + 1;
+}
+
 static struct song *
 song_alloc(const char *uri, struct directory *parent)
 {
@@ -36,7 +49,7 @@ song_alloc(const char *uri, struct directory *parent)
 	assert(uri);
 	uri_length = strlen(uri);
 	assert(uri_length);
-	song = g_malloc(sizeof(*song) - sizeof(song->uri) + uri_length + 1);
+	song = g_slice_alloc(song_alloc_size(uri_length));
 
 	song->tag = NULL;
 	memcpy(song->uri, uri, uri_length + 1);
@@ -66,7 +79,7 @@ song_free(struct song *song)
 {
 	if (song->tag)
 		tag_free(song->tag);
-	g_free(song);
+	g_slice_free1(song_alloc_size(strlen(song->uri)), song);
 }
 
 char *
@@ -31,8 +31,16 @@ void
 song_print_uri(struct client *client, struct song *song)
 {
 	if (song_in_database(song) && !directory_is_root(song->parent)) {
-		client_printf(client, "%s%s/%s\n", SONG_FILE,
-			      directory_get_path(song->parent), song->uri);
+		if (client_is_recording(client)) {
+			char *uri = g_strconcat(directory_get_path(song->parent),
+						"/", song->uri, NULL);
+
+			client_record_field(client, "file", uri, false);
+			g_free(uri);
+		} else
+			client_printf(client, "%s%s/%s\n", SONG_FILE,
+				      directory_get_path(song->parent),
+				      song->uri);
 	} else {
 		char *allocated;
 		const char *uri;
@@ -41,28 +49,34 @@ song_print_uri(struct client *client, struct song *song)
 		if (uri == NULL)
 			uri = song->uri;
 
-		client_printf(client, "%s%s\n", SONG_FILE,
-			      map_to_relative_path(uri));
+		client_record_field(client, "file",
+				    map_to_relative_path(uri), false);
 
 		g_free(allocated);
 	}
 }
 
 void
-song_print_info(struct client *client, struct song *song)
+song_print_fields(struct client *client, struct song *song)
 {
 	song_print_uri(client, song);
 
-	if (song->end_ms > 0)
-		client_printf(client, "Range: %u.%03u-%u.%03u\n",
-			      song->start_ms / 1000,
-			      song->start_ms % 1000,
-			      song->end_ms / 1000,
-			      song->end_ms % 1000);
-	else if (song->start_ms > 0)
-		client_printf(client, "Range: %u.%03u-\n",
-			      song->start_ms / 1000,
-			      song->start_ms % 1000);
+	if (song->end_ms > 0 || song->start_ms > 0) {
+		char range[64];
+
+		if (song->end_ms > 0)
+			g_snprintf(range, sizeof(range), "%u.%03u-%u.%03u",
+				   song->start_ms / 1000,
+				   song->start_ms % 1000,
+				   song->end_ms / 1000,
+				   song->end_ms % 1000);
+		else
+			g_snprintf(range, sizeof(range), "%u.%03u-",
+				   song->start_ms / 1000,
+				   song->start_ms % 1000);
+
+		client_record_field(client, "Range", range, false);
+	}
 
 	if (song->mtime > 0) {
 #ifndef G_OS_WIN32
@@ -86,8 +100,8 @@ song_print_info(struct client *client, struct song *song)
 				 "%FT%TZ",
 #endif
 				 tm2);
-			client_printf(client, "Last-Modified: %s\n",
-				      timestamp);
+			client_record_field(client, "Last-Modified",
+					    timestamp, false);
 		}
 	}
 
@@ -95,6 +109,14 @@ song_print_info(struct client *client, struct song *song)
 		tag_print(client, song->tag);
 }
 
+void
+song_print_info(struct client *client, struct song *song)
+{
+	client_record_begin(client);
+	song_print_fields(client, song);
+	client_record_end(client);
+}
+
 static int
 song_print_info_x(struct song *song, void *data)
 {
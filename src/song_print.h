@@ -24,9 +24,20 @@ struct client;
 struct song;
 struct songvec;
 
+/**
+ * Sends all information about the song, as one record (see
+ * client_record_begin()).
+ */
 void
 song_print_info(struct client *client, struct song *song);
 
+/**
+ * Sends all information about the song, without starting a record.
+ * This allows the caller to add more fields to the record.
+ */
+void
+song_print_fields(struct client *client, struct song *song);
+
 void
 songvec_print(struct client *client, const struct songvec *sv);
 
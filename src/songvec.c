@@ -28,7 +28,33 @@
 #include <string.h>
 #include <stdlib.h>
 
-static GMutex *nr_lock = NULL;
+enum {
+	/**
+	 * The number of mutexes protecting songvec objects.  Each
+	 * songvec uses one of them, selected by its address, so the
+	 * update thread and readers working in different directories
+	 * rarely contend.
+	 */
+	SONGVEC_NUM_LOCKS = 32,
+
+	/**
+	 * Songvecs with at least this number of elements get a hash
+	 * index for songvec_find().
+	 */
+	SONGVEC_INDEX_MIN = 32,
+};
+
+static GMutex *nr_locks[SONGVEC_NUM_LOCKS];
+
+static GMutex *
+songvec_lock(const struct songvec *sv)
+{
+	GMutex *mutex = nr_locks[(GPOINTER_TO_SIZE(sv) / sizeof(void *)) %
+				 SONGVEC_NUM_LOCKS];
+
+	g_mutex_lock(mutex);
+	return mutex;
+}
 
 static const char *
 tag_get_value_checked(const struct tag *tag, enum tag_type type)
@@ -114,29 +140,76 @@ static int songvec_cmp(const void *s1, const void *s2)
 	return g_utf8_collate(a->uri, b->uri);
 }
 
-static size_t sv_size(const struct songvec *sv)
+void songvec_init(void)
 {
-	return sv->nr * sizeof(struct song *);
+	for (unsigned i = 0; i < G_N_ELEMENTS(nr_locks); ++i) {
+		g_assert(nr_locks[i] == NULL);
+		nr_locks[i] = g_mutex_new();
+	}
 }
 
-void songvec_init(void)
+void songvec_deinit(void)
 {
-	g_assert(nr_lock == NULL);
-	nr_lock = g_mutex_new();
+	for (unsigned i = 0; i < G_N_ELEMENTS(nr_locks); ++i) {
+		g_assert(nr_locks[i] != NULL);
+		g_mutex_free(nr_locks[i]);
+		nr_locks[i] = NULL;
+	}
 }
 
-void songvec_deinit(void)
+/**
+ * Grows the array geometrically, so adding n songs costs O(n)
+ * reallocations in total instead of one per song.
+ */
+static void
+songvec_reserve(struct songvec *sv, size_t nr)
+{
+	size_t capacity;
+
+	if (nr <= sv->capacity)
+		return;
+
+	capacity = sv->capacity > 0 ? sv->capacity : 4;
+	while (capacity < nr)
+		capacity *= 2;
+
+	sv->base = g_realloc(sv->base, capacity * sizeof(sv->base[0]));
+	sv->capacity = capacity;
+}
+
+/**
+ * Releases memory after many songs were deleted.
+ */
+static void
+songvec_shrink(struct songvec *sv)
 {
-	g_assert(nr_lock != NULL);
-	g_mutex_free(nr_lock);
-	nr_lock = NULL;
+	if (sv->nr == 0) {
+		g_free(sv->base);
+		sv->base = NULL;
+		sv->capacity = 0;
+	} else if (sv->capacity >= 16 && sv->nr <= sv->capacity / 4) {
+		sv->capacity /= 2;
+		sv->base = g_realloc(sv->base,
+				     sv->capacity * sizeof(sv->base[0]));
+	}
+}
+
+static void
+songvec_index_build(struct songvec *sv)
+{
+	assert(sv->index == NULL);
+
+	sv->index = g_hash_table_new(g_str_hash, g_str_equal);
+	for (size_t i = 0; i < sv->nr; ++i)
+		g_hash_table_replace(sv->index, sv->base[i]->uri,
+				    sv->base[i]);
 }
 
 void songvec_sort(struct songvec *sv)
 {
-	g_mutex_lock(nr_lock);
+	GMutex *mutex = songvec_lock(sv);
 	qsort(sv->base, sv->nr, sizeof(struct song *), songvec_cmp);
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 }
 
 struct song *
@@ -144,15 +217,21 @@ songvec_find(const struct songvec *sv, const char *uri)
 {
 	int i;
 	struct song *ret = NULL;
+	GMutex *mutex = songvec_lock(sv);
+
+	if (sv->index != NULL) {
+		ret = g_hash_table_lookup(sv->index, uri);
+		g_mutex_unlock(mutex);
+		return ret;
+	}
 
-	g_mutex_lock(nr_lock);
 	for (i = sv->nr; --i >= 0; ) {
 		if (strcmp(sv->base[i]->uri, uri))
 			continue;
 		ret = sv->base[i];
 		break;
 	}
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 	return ret;
 }
 
@@ -160,24 +239,27 @@ int
 songvec_delete(struct songvec *sv, const struct song *del)
 {
 	size_t i;
+	GMutex *mutex = songvec_lock(sv);
 
-	g_mutex_lock(nr_lock);
-	for (i = 0; i < sv->nr; ++i) {
+	/* search backwards: songs which were just added are the most
+	   likely ones to be deleted again (see update_merge_job()) */
+	for (i = sv->nr; i-- > 0;) {
 		if (sv->base[i] != del)
 			continue;
 		/* we _don't_ call song_free() here */
-		if (!--sv->nr) {
-			g_free(sv->base);
-			sv->base = NULL;
-		} else {
-			memmove(&sv->base[i], &sv->base[i + 1],
-				(sv->nr - i) * sizeof(struct song *));
-			sv->base = g_realloc(sv->base, sv_size(sv));
-		}
-		g_mutex_unlock(nr_lock);
+		--sv->nr;
+		memmove(&sv->base[i], &sv->base[i + 1],
+			(sv->nr - i) * sizeof(struct song *));
+		songvec_shrink(sv);
+
+		if (sv->index != NULL &&
+		    g_hash_table_lookup(sv->index, del->uri) == del)
+			g_hash_table_remove(sv->index, del->uri);
+
+		g_mutex_unlock(mutex);
 		return i;
 	}
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 
 	return -1; /* not found */
 }
@@ -185,21 +267,33 @@ songvec_delete(struct songvec *sv, const struct song *del)
 void
 songvec_add(struct songvec *sv, struct song *add)
 {
-	g_mutex_lock(nr_lock);
-	++sv->nr;
-	sv->base = g_realloc(sv->base, sv_size(sv));
-	sv->base[sv->nr - 1] = add;
-	g_mutex_unlock(nr_lock);
+	GMutex *mutex = songvec_lock(sv);
+
+	songvec_reserve(sv, sv->nr + 1);
+	sv->base[sv->nr++] = add;
+
+	if (sv->index != NULL)
+		g_hash_table_replace(sv->index, add->uri, add);
+	else if (sv->nr >= SONGVEC_INDEX_MIN)
+		songvec_index_build(sv);
+
+	g_mutex_unlock(mutex);
 }
 
 void songvec_destroy(struct songvec *sv)
 {
-	g_mutex_lock(nr_lock);
+	GMutex *mutex = songvec_lock(sv);
 	sv->nr = 0;
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 
 	g_free(sv->base);
 	sv->base = NULL;
+	sv->capacity = 0;
+
+	if (sv->index != NULL) {
+		g_hash_table_destroy(sv->index);
+		sv->index = NULL;
+	}
 }
 
 int
@@ -208,8 +302,8 @@ songvec_for_each(const struct songvec *sv,
 {
 	size_t i;
 	size_t prev_nr;
+	GMutex *mutex = songvec_lock(sv);
 
-	g_mutex_lock(nr_lock);
 	for (i = 0; i < sv->nr; ) {
 		struct song *song = sv->base[i];
 
@@ -217,14 +311,14 @@ songvec_for_each(const struct songvec *sv,
 		assert(*song->uri);
 
 		prev_nr = sv->nr;
-		g_mutex_unlock(nr_lock); /* fn() may block */
+		g_mutex_unlock(mutex); /* fn() may block */
 		if (fn(song, arg) < 0)
 			return -1;
-		g_mutex_lock(nr_lock); /* sv->nr may change in fn() */
+		g_mutex_lock(mutex); /* sv->nr may change in fn() */
 		if (prev_nr == sv->nr)
 			++i;
 	}
-	g_mutex_unlock(nr_lock);
+	g_mutex_unlock(mutex);
 
 	return 0;
 }
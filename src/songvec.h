@@ -20,11 +20,23 @@
 #ifndef MPD_SONGVEC_H
 #define MPD_SONGVEC_H
 
+#include <glib.h>
+
 #include <stddef.h>
 
 struct songvec {
 	struct song **base;
 	size_t nr;
+
+	/** the number of elements allocated in #base */
+	size_t capacity;
+
+	/**
+	 * Maps the base name of each song to the song object, for
+	 * songvec_find().  It is created only for large vectors, and
+	 * is NULL otherwise.
+	 */
+	GHashTable *index;
 };
 
 void songvec_init(void);
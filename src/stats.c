@@ -20,11 +20,9 @@
 #include "config.h"
 #include "stats.h"
 #include "database.h"
-#include "tag.h"
-#include "song.h"
+#include "tag_index.h"
 #include "client.h"
 #include "player_control.h"
-#include "strset.h"
 
 struct stats stats;
 
@@ -38,66 +36,23 @@ void stats_global_finish(void)
 	g_timer_destroy(stats.timer);
 }
 
-struct visit_data {
-	struct strset *artists;
-	struct strset *albums;
-};
-
-static void
-visit_tag(struct visit_data *data, const struct tag *tag)
-{
-	if (tag->time > 0)
-		stats.song_duration += tag->time;
-
-	for (unsigned i = 0; i < tag->num_items; ++i) {
-		const struct tag_item *item = tag->items[i];
-
-		switch (item->type) {
-		case TAG_ARTIST:
-			strset_add(data->artists, item->value);
-			break;
-
-		case TAG_ALBUM:
-			strset_add(data->albums, item->value);
-			break;
-
-		default:
-			break;
-		}
-	}
-}
-
-static int
-stats_collect_song(struct song *song, void *_data)
-{
-	struct visit_data *data = _data;
-
-	++stats.song_count;
-
-	if (song->tag != NULL)
-		visit_tag(data, song->tag);
-
-	return 0;
-}
-
 void stats_update(void)
 {
-	struct visit_data data;
-
-	stats.song_count = 0;
-	stats.song_duration = 0;
-	stats.artist_count = 0;
-
-	data.artists = strset_new();
-	data.albums = strset_new();
-
-	db_walk(NULL, stats_collect_song, NULL, &data);
-
-	stats.artist_count = strset_size(data.artists);
-	stats.album_count = strset_size(data.albums);
+	struct tag_index_stats index_stats;
+
+	if (!tag_index_get_stats(&index_stats)) {
+		/* no database */
+		stats.song_count = 0;
+		stats.song_duration = 0;
+		stats.artist_count = 0;
+		stats.album_count = 0;
+		return;
+	}
 
-	strset_free(data.artists);
-	strset_free(data.albums);
+	stats.song_count = index_stats.song_count;
+	stats.song_duration = index_stats.song_duration;
+	stats.artist_count = index_stats.artist_count;
+	stats.album_count = index_stats.album_count;
 }
 
 int stats_print(struct client *client)
@@ -102,6 +102,35 @@ static size_t items_size(const struct tag *tag)
 	return tag->num_items * sizeof(struct tag_item *);
 }
 
+struct tag_item **
+tag_items_new(unsigned n)
+{
+	assert(n > 0);
+
+	return g_slice_alloc(n * sizeof(struct tag_item *));
+}
+
+struct tag_item **
+tag_items_resize(struct tag_item **items, unsigned old_n, unsigned new_n)
+{
+	struct tag_item **p = new_n > 0 ? tag_items_new(new_n) : NULL;
+
+	if (p != NULL && old_n > 0)
+		memcpy(p, items, MIN(old_n, new_n) * sizeof(p[0]));
+
+	tag_items_free(items, old_n);
+	return p;
+}
+
+void
+tag_items_free(struct tag_item **items, unsigned n)
+{
+	assert((items == NULL) == (n == 0));
+
+	if (items != NULL)
+		g_slice_free1(n * sizeof(struct tag_item *), items);
+}
+
 void tag_lib_init(void)
 {
 	const char *value;
@@ -154,7 +183,7 @@ void tag_lib_init(void)
 
 struct tag *tag_new(void)
 {
-	struct tag *ret = g_new(struct tag, 1);
+	struct tag *ret = g_slice_new(struct tag);
 	ret->items = NULL;
 	ret->time = -1;
 	ret->num_items = 0;
@@ -166,21 +195,15 @@ static void tag_delete_item(struct tag *tag, unsigned idx)
 	assert(idx < tag->num_items);
 	tag->num_items--;
 
-	g_mutex_lock(tag_pool_lock);
 	tag_pool_put_item(tag->items[idx]);
-	g_mutex_unlock(tag_pool_lock);
 
 	if (tag->num_items - idx > 0) {
 		memmove(tag->items + idx, tag->items + idx + 1,
 			(tag->num_items - idx) * sizeof(tag->items[0]));
 	}
 
-	if (tag->num_items > 0) {
-		tag->items = g_realloc(tag->items, items_size(tag));
-	} else {
-		g_free(tag->items);
-		tag->items = NULL;
-	}
+	tag->items = tag_items_resize(tag->items, tag->num_items + 1,
+				      tag->num_items);
 }
 
 void tag_clear_items_by_type(struct tag *tag, enum tag_type type)
@@ -200,10 +223,8 @@ void tag_free(struct tag *tag)
 
 	assert(tag != NULL);
 
-	g_mutex_lock(tag_pool_lock);
 	for (i = tag->num_items; --i >= 0; )
 		tag_pool_put_item(tag->items[i]);
-	g_mutex_unlock(tag_pool_lock);
 
 	if (tag->items == bulk.items) {
 #ifndef NDEBUG
@@ -211,9 +232,9 @@ void tag_free(struct tag *tag)
 		bulk.busy = false;
 #endif
 	} else
-		g_free(tag->items);
+		tag_items_free(tag->items, tag->num_items);
 
-	g_free(tag);
+	g_slice_free(struct tag, tag);
 }
 
 struct tag *tag_dup(const struct tag *tag)
@@ -226,12 +247,10 @@ struct tag *tag_dup(const struct tag *tag)
 	ret = tag_new();
 	ret->time = tag->time;
 	ret->num_items = tag->num_items;
-	ret->items = ret->num_items > 0 ? g_malloc(items_size(tag)) : NULL;
+	ret->items = ret->num_items > 0 ? tag_items_new(ret->num_items) : NULL;
 
-	g_mutex_lock(tag_pool_lock);
 	for (unsigned i = 0; i < tag->num_items; i++)
 		ret->items[i] = tag_pool_dup_item(tag->items[i]);
-	g_mutex_unlock(tag_pool_lock);
 
 	return ret;
 }
@@ -250,9 +269,7 @@ tag_merge(const struct tag *base, const struct tag *add)
 	ret = tag_new();
 	ret->time = add->time > 0 ? add->time : base->time;
 	ret->num_items = base->num_items + add->num_items;
-	ret->items = ret->num_items > 0 ? g_malloc(items_size(ret)) : NULL;
-
-	g_mutex_lock(tag_pool_lock);
+	ret->items = ret->num_items > 0 ? tag_items_new(ret->num_items) : NULL;
 
 	/* copy all items from "add" */
 
@@ -267,16 +284,14 @@ tag_merge(const struct tag *base, const struct tag *add)
 		if (!tag_has_type(add, base->items[i]->type))
 			ret->items[n++] = tag_pool_dup_item(base->items[i]);
 
-	g_mutex_unlock(tag_pool_lock);
-
 	assert(n <= ret->num_items);
 
 	if (n < ret->num_items) {
 		/* some tags were not copied - shrink ret->items */
 		assert(n > 0);
 
+		ret->items = tag_items_resize(ret->items, ret->num_items, n);
 		ret->num_items = n;
-		ret->items = g_realloc(ret->items, items_size(ret));
 	}
 
 	return ret;
@@ -403,7 +418,7 @@ void tag_end_add(struct tag *tag)
 		if (tag->num_items > 0) {
 			/* copy the tag items from the bulk list over
 			   to a new list (which fits exactly) */
-			tag->items = g_malloc(items_size(tag));
+			tag->items = tag_items_new(tag->num_items);
 			memcpy(tag->items, bulk.items, items_size(tag));
 		} else
 			tag->items = NULL;
@@ -489,19 +504,18 @@ tag_add_item_internal(struct tag *tag, enum tag_type type,
 
 	if (tag->items != bulk.items)
 		/* bulk mode disabled */
-		tag->items = g_realloc(tag->items, items_size(tag));
+		tag->items = tag_items_resize(tag->items, tag->num_items - 1,
+					      tag->num_items);
 	else if (tag->num_items >= BULK_MAX) {
 		/* bulk list already full - switch back to non-bulk */
 		assert(bulk.busy);
 
-		tag->items = g_malloc(items_size(tag));
+		tag->items = tag_items_new(tag->num_items);
 		memcpy(tag->items, bulk.items,
 		       items_size(tag) - sizeof(struct tag_item *));
 	}
 
-	g_mutex_lock(tag_pool_lock);
 	tag->items[i] = tag_pool_get_item(type, value, len);
-	g_mutex_unlock(tag_pool_lock);
 
 	g_free(p);
 }
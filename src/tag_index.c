@@ -0,0 +1,1158 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "tag_index.h"
+#include "locate.h"
+#include "database.h"
+#include "directory.h"
+#include "song.h"
+#include "tag.h"
+
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "tag_index"
+
+enum {
+	/**
+	 * The length of the substrings in the n-gram index.
+	 */
+	GRAM_LENGTH = 3,
+
+	/**
+	 * Rebuild the n-gram index when there are more than this
+	 * many dead values, and more dead values than live ones.
+	 */
+	GRAM_MAX_DEAD = 4096,
+};
+
+/**
+ * One distinct tag value and the songs which have it.
+ */
+struct tag_value {
+	enum tag_type type;
+
+	/**
+	 * Set when the last song with this value has been removed.
+	 * The object lives on until the n-gram index is rebuilt,
+	 * because the n-gram index still refers to it.
+	 */
+	bool dead;
+
+	char *value;
+
+	/**
+	 * The value converted with g_utf8_casefold(), for "search".
+	 */
+	char *folded;
+
+	/**
+	 * The value converted with g_utf8_collate_key(), for sorting
+	 * query results.  It is calculated when it is first needed.
+	 */
+	char *collate_key;
+
+	/**
+	 * The set of songs which have this value.
+	 */
+	GHashTable *songs;
+};
+
+struct tag_index {
+	/**
+	 * Protects all attributes.  The index is modified by the
+	 * update thread and queried by the main thread.
+	 */
+	GMutex *mutex;
+
+	/**
+	 * Maps all indexed songs to their URI, converted with
+	 * g_utf8_casefold().
+	 */
+	GHashTable *songs;
+
+	/**
+	 * For each tag type, this maps tag values to #tag_value
+	 * objects.
+	 */
+	GHashTable *values[TAG_NUM_OF_ITEM_TYPES];
+
+	/**
+	 * Maps each substring of #GRAM_LENGTH bytes to a GPtrArray of
+	 * all #tag_value objects whose folded value contains it.
+	 */
+	GHashTable *grams;
+
+	/**
+	 * Dead #tag_value objects which are still referenced by
+	 * #grams.
+	 */
+	GPtrArray *dead;
+
+	/**
+	 * The number of live #tag_value objects.
+	 */
+	unsigned num_values;
+
+	/**
+	 * The number of indexed songs which have a tag.
+	 */
+	unsigned num_tagged;
+
+	/**
+	 * For each tag type, the number of indexed songs which have
+	 * at least one item of this type.
+	 */
+	unsigned num_with_type[TAG_NUM_OF_ITEM_TYPES];
+
+	/**
+	 * The sum of the durations of all indexed songs (in seconds).
+	 */
+	unsigned long song_duration;
+};
+
+/**
+ * The global index; NULL if there is no music database.
+ */
+static struct tag_index *tag_index;
+
+static GHashTable *
+song_set_new(void)
+{
+	return g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+static struct tag_value *
+tag_value_new(enum tag_type type, const char *value)
+{
+	struct tag_value *v = g_new(struct tag_value, 1);
+
+	v->type = type;
+	v->dead = false;
+	v->value = g_strdup(value);
+	v->folded = g_utf8_casefold(value, -1);
+	v->collate_key = NULL;
+	v->songs = song_set_new();
+	return v;
+}
+
+static void
+tag_value_free(struct tag_value *v)
+{
+	g_hash_table_destroy(v->songs);
+	g_free(v->collate_key);
+	g_free(v->folded);
+	g_free(v->value);
+	g_free(v);
+}
+
+static void
+gram_array_free(gpointer array)
+{
+	g_ptr_array_free(array, true);
+}
+
+static inline unsigned
+gram_at(const char *p)
+{
+	return ((unsigned)(unsigned char)p[0] << 16) |
+		((unsigned)(unsigned char)p[1] << 8) |
+		(unsigned)(unsigned char)p[2];
+}
+
+/**
+ * Adds all n-grams of the value to the n-gram index.  The caller
+ * must hold the mutex.
+ */
+static void
+tag_index_add_grams(struct tag_value *v)
+{
+	size_t length = strlen(v->folded);
+
+	for (size_t i = 0; i + GRAM_LENGTH <= length; ++i) {
+		gpointer key = GUINT_TO_POINTER(gram_at(v->folded + i));
+		GPtrArray *array = g_hash_table_lookup(tag_index->grams, key);
+
+		if (array == NULL) {
+			array = g_ptr_array_new();
+			g_hash_table_insert(tag_index->grams, key, array);
+		} else if (g_ptr_array_index(array, array->len - 1) == v)
+			/* this n-gram occurs more than once in the
+			   value */
+			continue;
+
+		g_ptr_array_add(array, v);
+	}
+}
+
+static void
+tag_index_add_value_grams(G_GNUC_UNUSED gpointer key, gpointer value,
+			  G_GNUC_UNUSED gpointer data)
+{
+	tag_index_add_grams(value);
+}
+
+/**
+ * Rebuilds the n-gram index from the live values, and frees the
+ * dead ones.  The caller must hold the mutex.
+ */
+static void
+tag_index_rebuild_grams(void)
+{
+	g_hash_table_destroy(tag_index->grams);
+	tag_index->grams = g_hash_table_new_full(g_direct_hash,
+						 g_direct_equal,
+						 NULL, gram_array_free);
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		g_hash_table_foreach(tag_index->values[i],
+				     tag_index_add_value_grams, NULL);
+
+	for (unsigned i = 0; i < tag_index->dead->len; ++i)
+		tag_value_free(g_ptr_array_index(tag_index->dead, i));
+
+	g_ptr_array_set_size(tag_index->dead, 0);
+}
+
+static void
+tag_index_create_tables(void)
+{
+	tag_index->songs = g_hash_table_new_full(g_direct_hash,
+						 g_direct_equal,
+						 NULL, g_free);
+
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+		tag_index->values[i] =
+			g_hash_table_new(g_str_hash, g_str_equal);
+
+	tag_index->grams = g_hash_table_new_full(g_direct_hash,
+						 g_direct_equal,
+						 NULL, gram_array_free);
+	tag_index->dead = g_ptr_array_new();
+}
+
+static void
+tag_index_free_value(G_GNUC_UNUSED gpointer key, gpointer value,
+		     G_GNUC_UNUSED gpointer data)
+{
+	tag_value_free(value);
+}
+
+static void
+tag_index_destroy_tables(void)
+{
+	for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+		g_hash_table_foreach(tag_index->values[i],
+				     tag_index_free_value, NULL);
+		g_hash_table_destroy(tag_index->values[i]);
+	}
+
+	for (unsigned i = 0; i < tag_index->dead->len; ++i)
+		tag_value_free(g_ptr_array_index(tag_index->dead, i));
+
+	g_ptr_array_free(tag_index->dead, true);
+	g_hash_table_destroy(tag_index->grams);
+	g_hash_table_destroy(tag_index->songs);
+}
+
+void
+tag_index_init(void)
+{
+	assert(tag_index == NULL);
+
+	tag_index = g_new0(struct tag_index, 1);
+	tag_index->mutex = g_mutex_new();
+	tag_index_create_tables();
+}
+
+void
+tag_index_deinit(void)
+{
+	assert(tag_index != NULL);
+
+	tag_index_destroy_tables();
+	g_mutex_free(tag_index->mutex);
+	g_free(tag_index);
+	tag_index = NULL;
+}
+
+void
+tag_index_clear(void)
+{
+	if (tag_index == NULL)
+		return;
+
+	g_mutex_lock(tag_index->mutex);
+
+	tag_index_destroy_tables();
+	tag_index_create_tables();
+
+	tag_index->num_values = 0;
+	tag_index->num_tagged = 0;
+	memset(tag_index->num_with_type, 0,
+	       sizeof(tag_index->num_with_type));
+	tag_index->song_duration = 0;
+
+	g_mutex_unlock(tag_index->mutex);
+}
+
+static int
+tag_index_add_callback(struct song *song, G_GNUC_UNUSED void *data)
+{
+	tag_index_add_song(song);
+	return 0;
+}
+
+void
+tag_index_add_directory(const struct directory *directory)
+{
+	directory_walk((struct directory *)directory,
+		       tag_index_add_callback, NULL, NULL);
+}
+
+void
+tag_index_add_song(struct song *song)
+{
+	const struct tag *tag = song->tag;
+	char *uri, *folded_uri;
+
+	if (tag_index == NULL)
+		return;
+
+	/* fold outside of the lock */
+	uri = song_get_uri(song);
+	folded_uri = g_utf8_casefold(uri, -1);
+	g_free(uri);
+
+	g_mutex_lock(tag_index->mutex);
+
+	if (g_hash_table_lookup(tag_index->songs, song) != NULL) {
+		/* already indexed */
+		g_mutex_unlock(tag_index->mutex);
+		g_free(folded_uri);
+		return;
+	}
+
+	g_hash_table_insert(tag_index->songs, song, folded_uri);
+
+	if (tag != NULL) {
+		bool seen[TAG_NUM_OF_ITEM_TYPES];
+
+		memset(seen, false, sizeof(seen));
+
+		for (unsigned i = 0; i < tag->num_items; ++i) {
+			const struct tag_item *item = tag->items[i];
+			GHashTable *values = tag_index->values[item->type];
+			struct tag_value *v =
+				g_hash_table_lookup(values, item->value);
+
+			if (v == NULL) {
+				v = tag_value_new(item->type, item->value);
+				g_hash_table_insert(values, v->value, v);
+				tag_index_add_grams(v);
+				++tag_index->num_values;
+			}
+
+			g_hash_table_insert(v->songs, song, song);
+			seen[item->type] = true;
+		}
+
+		++tag_index->num_tagged;
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+			if (seen[i])
+				++tag_index->num_with_type[i];
+
+		if (tag->time > 0)
+			tag_index->song_duration += tag->time;
+	}
+
+	g_mutex_unlock(tag_index->mutex);
+}
+
+void
+tag_index_remove_song(struct song *song)
+{
+	const struct tag *tag = song->tag;
+
+	if (tag_index == NULL)
+		return;
+
+	g_mutex_lock(tag_index->mutex);
+
+	if (!g_hash_table_remove(tag_index->songs, song)) {
+		/* not indexed */
+		g_mutex_unlock(tag_index->mutex);
+		return;
+	}
+
+	if (tag != NULL) {
+		bool seen[TAG_NUM_OF_ITEM_TYPES];
+
+		memset(seen, false, sizeof(seen));
+
+		for (unsigned i = 0; i < tag->num_items; ++i) {
+			const struct tag_item *item = tag->items[i];
+			GHashTable *values = tag_index->values[item->type];
+			struct tag_value *v =
+				g_hash_table_lookup(values, item->value);
+
+			if (v == NULL)
+				continue;
+
+			g_hash_table_remove(v->songs, song);
+			if (g_hash_table_size(v->songs) == 0) {
+				g_hash_table_remove(values, item->value);
+				v->dead = true;
+				g_ptr_array_add(tag_index->dead, v);
+				--tag_index->num_values;
+			}
+
+			seen[item->type] = true;
+		}
+
+		assert(tag_index->num_tagged > 0);
+		--tag_index->num_tagged;
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+			if (seen[i])
+				--tag_index->num_with_type[i];
+
+		if (tag->time > 0) {
+			assert(tag_index->song_duration >=
+			       (unsigned long)tag->time);
+			tag_index->song_duration -= tag->time;
+		}
+	}
+
+	if (tag_index->dead->len > GRAM_MAX_DEAD &&
+	    tag_index->dead->len > tag_index->num_values)
+		tag_index_rebuild_grams();
+
+	g_mutex_unlock(tag_index->mutex);
+}
+
+/*
+ * Database order
+ *
+ * Query results must be in the same order as a db_walk(), i.e.
+ * pre-order, with the songs of a directory before its children.
+ * The positions of songs and directories within their parent's
+ * vector are collected lazily, only for the directories which
+ * actually contain results.
+ *
+ */
+
+/**
+ * Returns the position of the song within its directory.
+ *
+ * @param positions a cache which maps songs and directories to their
+ * position plus one
+ */
+static unsigned
+song_position(GHashTable *positions, const struct song *song)
+{
+	gpointer value = g_hash_table_lookup(positions, song);
+	if (value == NULL) {
+		const struct songvec *sv = &song->parent->songs;
+
+		for (size_t i = 0; i < sv->nr; ++i)
+			g_hash_table_insert(positions, sv->base[i],
+					    GUINT_TO_POINTER(i + 1));
+
+		value = g_hash_table_lookup(positions, song);
+		if (value == NULL)
+			return 0;
+	}
+
+	return GPOINTER_TO_UINT(value) - 1;
+}
+
+static unsigned
+directory_position(GHashTable *positions, const struct directory *directory)
+{
+	gpointer value = g_hash_table_lookup(positions, directory);
+	if (value == NULL) {
+		const struct dirvec *dv = &directory->parent->children;
+
+		for (size_t i = 0; i < dv->nr; ++i)
+			g_hash_table_insert(positions, dv->base[i],
+					    GUINT_TO_POINTER(i + 1));
+
+		value = g_hash_table_lookup(positions, directory);
+		if (value == NULL)
+			return 0;
+	}
+
+	return GPOINTER_TO_UINT(value) - 1;
+}
+
+static unsigned
+directory_depth(const struct directory *directory)
+{
+	unsigned depth = 0;
+
+	while (directory->parent != NULL) {
+		directory = directory->parent;
+		++depth;
+	}
+
+	return depth;
+}
+
+static int
+compare_unsigned(unsigned a, unsigned b)
+{
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static gint
+compare_database_order(gconstpointer _a, gconstpointer _b, gpointer data)
+{
+	const struct song *a = *(const struct song *const*)_a;
+	const struct song *b = *(const struct song *const*)_b;
+	GHashTable *positions = data;
+
+	if (a->parent == b->parent)
+		return compare_unsigned(song_position(positions, a),
+					song_position(positions, b));
+
+	const struct directory *da = a->parent, *db = b->parent;
+	unsigned depth_a = directory_depth(da);
+	unsigned depth_b = directory_depth(db);
+
+	for (; depth_a > depth_b; --depth_a) {
+		da = da->parent;
+		if (da == db)
+			/* b is in an ancestor of a's directory; the
+			   songs of a directory come first */
+			return 1;
+	}
+
+	for (; depth_b > depth_a; --depth_b) {
+		db = db->parent;
+		if (db == da)
+			return -1;
+	}
+
+	while (da->parent != db->parent) {
+		da = da->parent;
+		db = db->parent;
+	}
+
+	return compare_unsigned(directory_position(positions, da),
+				directory_position(positions, db));
+}
+
+static void
+sort_database_order(GPtrArray *songs)
+{
+	GHashTable *positions;
+
+	if (songs->len < 2)
+		return;
+
+	positions = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_ptr_array_sort_with_data(songs, compare_database_order, positions);
+	g_hash_table_destroy(positions);
+}
+
+/*
+ * Queries
+ *
+ */
+
+static GHashTable *
+tag_index_posting(enum tag_type type, const char *value)
+{
+	struct tag_value *v =
+		g_hash_table_lookup(tag_index->values[type], value);
+
+	return v != NULL ? v->songs : NULL;
+}
+
+/**
+ * Estimates the number of candidates the index yields for the
+ * criterion.  The caller must hold the mutex.
+ *
+ * @return the number of candidates, or -1 if the index cannot answer
+ * this criterion
+ */
+static int
+tag_index_count_candidates(const struct locate_item *item)
+{
+	const char *needle = item->needle;
+
+	/* an empty needle matches songs which lack the tag; the
+	   index does not know these */
+	if (*needle == 0)
+		return -1;
+
+	if (item->tag < TAG_NUM_OF_ITEM_TYPES) {
+		GHashTable *posting = tag_index_posting(item->tag, needle);
+		return posting != NULL ? (int)g_hash_table_size(posting) : 0;
+	}
+
+	if (item->tag == LOCATE_TAG_FILE_TYPE)
+		return 1;
+
+	if (item->tag == LOCATE_TAG_ANY_TYPE) {
+		unsigned count = 1;
+
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+			GHashTable *posting = tag_index_posting(i, needle);
+			if (posting != NULL)
+				count += g_hash_table_size(posting);
+		}
+
+		return count;
+	}
+
+	return -1;
+}
+
+static void
+collect_song(gpointer key, G_GNUC_UNUSED gpointer value, gpointer data)
+{
+	g_ptr_array_add(data, key);
+}
+
+static void
+collect_song_unique(gpointer key, G_GNUC_UNUSED gpointer value,
+		    gpointer data)
+{
+	g_hash_table_insert(data, key, key);
+}
+
+/**
+ * Adds the candidate songs for the criterion to the array.  The
+ * caller must hold the mutex.
+ */
+static void
+tag_index_collect(const struct locate_item *item, GPtrArray *songs)
+{
+	const char *needle = item->needle;
+
+	if (item->tag < TAG_NUM_OF_ITEM_TYPES) {
+		GHashTable *posting = tag_index_posting(item->tag, needle);
+		if (posting != NULL)
+			g_hash_table_foreach(posting, collect_song, songs);
+	} else if (item->tag == LOCATE_TAG_FILE_TYPE) {
+		struct song *song = db_get_song(needle);
+		if (song != NULL)
+			g_ptr_array_add(songs, song);
+	} else {
+		/* a song may have the value in more than one tag
+		   type; eliminate duplicates */
+		GHashTable *unique = song_set_new();
+		struct song *song = db_get_song(needle);
+
+		assert(item->tag == LOCATE_TAG_ANY_TYPE);
+
+		if (song != NULL)
+			g_hash_table_insert(unique, song, song);
+
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i) {
+			GHashTable *posting = tag_index_posting(i, needle);
+			if (posting != NULL)
+				g_hash_table_foreach(posting,
+						     collect_song_unique,
+						     unique);
+		}
+
+		g_hash_table_foreach(unique, collect_song, songs);
+		g_hash_table_destroy(unique);
+	}
+}
+
+GPtrArray *
+tag_index_find(const struct locate_item_list *criteria)
+{
+	const struct locate_item *best = NULL;
+	int best_count = -1;
+	GPtrArray *songs;
+
+	if (tag_index == NULL)
+		return NULL;
+
+	g_mutex_lock(tag_index->mutex);
+
+	/* start with the criterion which yields the fewest
+	   candidates */
+	for (unsigned i = 0; i < criteria->length; ++i) {
+		int count = tag_index_count_candidates(&criteria->items[i]);
+		if (count >= 0 && (best == NULL || count < best_count)) {
+			best = &criteria->items[i];
+			best_count = count;
+		}
+	}
+
+	if (best == NULL) {
+		g_mutex_unlock(tag_index->mutex);
+		return NULL;
+	}
+
+	songs = g_ptr_array_sized_new(best_count);
+	tag_index_collect(best, songs);
+
+	g_mutex_unlock(tag_index->mutex);
+
+	/* check the remaining criteria */
+	for (unsigned i = songs->len; i-- > 0;)
+		if (!locate_song_match(g_ptr_array_index(songs, i), criteria))
+			g_ptr_array_remove_index_fast(songs, i);
+
+	sort_database_order(songs);
+	return songs;
+}
+
+/*
+ * Substring search
+ *
+ */
+
+/**
+ * Like locate_tag_search(), but uses the folded strings stored in the
+ * index instead of folding each value again.  The caller must hold
+ * the mutex.
+ */
+static bool
+tag_index_song_search(const struct song *song, int type, const char *needle)
+{
+	const struct tag *tag = song->tag;
+	bool visited_types[TAG_NUM_OF_ITEM_TYPES];
+
+	if (type == LOCATE_TAG_FILE_TYPE || type == LOCATE_TAG_ANY_TYPE) {
+		const char *uri = g_hash_table_lookup(tag_index->songs, song);
+
+		if (uri != NULL && strstr(uri, needle) != NULL)
+			return true;
+
+		if (type == LOCATE_TAG_FILE_TYPE)
+			return false;
+	}
+
+	if (tag == NULL)
+		return false;
+
+	memset(visited_types, 0, sizeof(visited_types));
+
+	for (unsigned i = 0; i < tag->num_items; i++) {
+		const struct tag_item *item = tag->items[i];
+		const struct tag_value *v;
+
+		visited_types[item->type] = true;
+		if (type != LOCATE_TAG_ANY_TYPE && item->type != type)
+			continue;
+
+		if (*needle == 0)
+			continue;
+
+		v = g_hash_table_lookup(tag_index->values[item->type],
+					item->value);
+		if (v != NULL && strstr(v->folded, needle) != NULL)
+			return true;
+	}
+
+	/* an empty needle matches songs which lack this tag type,
+	   see locate_tag_search() */
+	return *needle == 0 && type < TAG_NUM_OF_ITEM_TYPES &&
+		!visited_types[type];
+}
+
+static bool
+tag_index_song_search_all(const struct song *song,
+			  const struct locate_item_list *criteria)
+{
+	for (unsigned i = 0; i < criteria->length; i++)
+		if (!tag_index_song_search(song, criteria->items[i].tag,
+					   criteria->items[i].needle))
+			return false;
+
+	return true;
+}
+
+static void
+collect_value_songs(struct tag_value *v, GHashTable *unique)
+{
+	g_hash_table_foreach(v->songs, collect_song_unique, unique);
+}
+
+struct value_scan_data {
+	const char *needle;
+	GHashTable *unique;
+};
+
+static void
+scan_value(G_GNUC_UNUSED gpointer key, gpointer value, gpointer _data)
+{
+	struct tag_value *v = value;
+	struct value_scan_data *data = _data;
+
+	if (strstr(v->folded, data->needle) != NULL)
+		collect_value_songs(v, data->unique);
+}
+
+/**
+ * Adds all songs which have a value of the specified tag type (or
+ * all tag types for #LOCATE_TAG_ANY_TYPE) containing the folded
+ * needle to the set.  The caller must hold the mutex.
+ */
+static void
+tag_index_search_values(int type, const char *needle, GHashTable *unique)
+{
+	size_t length = strlen(needle);
+
+	assert(length > 0);
+
+	if (length >= GRAM_LENGTH) {
+		/* pick the least frequent n-gram of the needle, and
+		   verify each value which contains it */
+		GPtrArray *best = NULL;
+
+		for (size_t i = 0; i + GRAM_LENGTH <= length; ++i) {
+			gpointer key = GUINT_TO_POINTER(gram_at(needle + i));
+			GPtrArray *array =
+				g_hash_table_lookup(tag_index->grams, key);
+
+			if (array == NULL)
+				/* no value contains this n-gram */
+				return;
+
+			if (best == NULL || array->len < best->len)
+				best = array;
+		}
+
+		for (unsigned i = 0; i < best->len; ++i) {
+			struct tag_value *v = g_ptr_array_index(best, i);
+
+			if (!v->dead &&
+			    (type == LOCATE_TAG_ANY_TYPE ||
+			     (int)v->type == type) &&
+			    strstr(v->folded, needle) != NULL)
+				collect_value_songs(v, unique);
+		}
+	} else {
+		/* too short for the n-gram index; scan the distinct
+		   values, which are still much fewer than songs */
+		struct value_scan_data data = {
+			.needle = needle,
+			.unique = unique,
+		};
+
+		for (unsigned i = 0; i < TAG_NUM_OF_ITEM_TYPES; ++i)
+			if (type == LOCATE_TAG_ANY_TYPE || (int)i == type)
+				g_hash_table_foreach(tag_index->values[i],
+						     scan_value, &data);
+	}
+}
+
+static void
+scan_uri(gpointer key, gpointer value, gpointer _data)
+{
+	struct value_scan_data *data = _data;
+
+	if (strstr(value, data->needle) != NULL)
+		g_hash_table_insert(data->unique, key, key);
+}
+
+/**
+ * Rates how well the index can narrow down the candidates for the
+ * criterion.  Zero means it can't.
+ */
+static unsigned
+search_selectivity(const struct locate_item *item)
+{
+	size_t length = strlen(item->needle);
+
+	if (item->tag < TAG_NUM_OF_ITEM_TYPES) {
+		if (length == 0)
+			return 0;
+
+		return length >= GRAM_LENGTH ? 3 : 2;
+	}
+
+	/* URIs must be scanned one by one */
+	return 1;
+}
+
+GPtrArray *
+tag_index_search(const struct locate_item_list *criteria)
+{
+	const struct locate_item *best = NULL;
+	unsigned best_selectivity = 0;
+	GHashTable *unique;
+	GPtrArray *songs;
+
+	if (tag_index == NULL)
+		return NULL;
+
+	for (unsigned i = 0; i < criteria->length; ++i) {
+		const struct locate_item *item = &criteria->items[i];
+		unsigned selectivity = search_selectivity(item);
+
+		if (selectivity > best_selectivity ||
+		    (selectivity == best_selectivity && best != NULL &&
+		     strlen(item->needle) > strlen(best->needle))) {
+			best = item;
+			best_selectivity = selectivity;
+		}
+	}
+
+	g_mutex_lock(tag_index->mutex);
+
+	unique = song_set_new();
+
+	if (best == NULL) {
+		/* no usable criterion: check all songs, but still
+		   without folding anything */
+		g_hash_table_foreach(tag_index->songs,
+				     collect_song_unique, unique);
+	} else {
+		if (best->tag == LOCATE_TAG_FILE_TYPE ||
+		    best->tag == LOCATE_TAG_ANY_TYPE) {
+			struct value_scan_data data = {
+				.needle = best->needle,
+				.unique = unique,
+			};
+
+			g_hash_table_foreach(tag_index->songs,
+					     scan_uri, &data);
+		}
+
+		if (best->tag != LOCATE_TAG_FILE_TYPE && *best->needle != 0)
+			tag_index_search_values(best->tag, best->needle,
+						unique);
+	}
+
+	songs = g_ptr_array_sized_new(g_hash_table_size(unique));
+	g_hash_table_foreach(unique, collect_song, songs);
+	g_hash_table_destroy(unique);
+
+	/* check all criteria; the best one may have yielded songs
+	   which fail the others */
+	for (unsigned i = songs->len; i-- > 0;)
+		if (!tag_index_song_search_all(g_ptr_array_index(songs, i),
+					       criteria))
+			g_ptr_array_remove_index_fast(songs, i);
+
+	g_mutex_unlock(tag_index->mutex);
+
+	sort_database_order(songs);
+	return songs;
+}
+
+/*
+ * Sorting
+ *
+ */
+
+struct sort_entry {
+	struct song *song;
+
+	/**
+	 * The collation key of the song's value; it is owned by a
+	 * #tag_value object, or by the "keys" array of
+	 * tag_index_sort().
+	 */
+	const char *key;
+
+	/**
+	 * The position of the song in the unsorted array, to make the
+	 * sort stable.
+	 */
+	unsigned position;
+};
+
+/**
+ * Returns the collation key of the song's first value of the
+ * specified type.  The caller must hold the mutex (if there is an
+ * index).
+ *
+ * @param keys keys which are not cached by the index are added to
+ * this array, and must be freed by the caller
+ */
+static const char *
+song_collate_key(const struct song *song, enum tag_type type,
+		 GPtrArray *keys)
+{
+	const struct tag *tag = song->tag;
+	char *key;
+
+	if (type == TAG_NUM_OF_ITEM_TYPES) {
+		char *uri = song_get_uri(song);
+		key = g_utf8_collate_key_for_filename(uri, -1);
+		g_free(uri);
+		g_ptr_array_add(keys, key);
+		return key;
+	}
+
+	if (tag == NULL)
+		return "";
+
+	for (unsigned i = 0; i < tag->num_items; ++i) {
+		const struct tag_item *item = tag->items[i];
+		struct tag_value *v;
+
+		if (item->type != type)
+			continue;
+
+		v = tag_index != NULL
+			? g_hash_table_lookup(tag_index->values[type],
+					      item->value)
+			: NULL;
+		if (v != NULL) {
+			if (v->collate_key == NULL)
+				v->collate_key =
+					g_utf8_collate_key(v->value, -1);
+			return v->collate_key;
+		}
+
+		/* not indexed (e.g. a song which is not in the
+		   database) */
+		key = g_utf8_collate_key(item->value, -1);
+		g_ptr_array_add(keys, key);
+		return key;
+	}
+
+	return "";
+}
+
+static int
+compare_sort_entry(const void *_a, const void *_b)
+{
+	const struct sort_entry *a = _a, *b = _b;
+	int result = strcmp(a->key, b->key);
+
+	return result != 0
+		? result
+		: compare_unsigned(a->position, b->position);
+}
+
+static int
+compare_sort_entry_descending(const void *_a, const void *_b)
+{
+	const struct sort_entry *a = _a, *b = _b;
+	int result = strcmp(b->key, a->key);
+
+	return result != 0
+		? result
+		: compare_unsigned(a->position, b->position);
+}
+
+void
+tag_index_sort(GPtrArray *songs, enum tag_type type, bool descending)
+{
+	struct sort_entry *entries;
+	GPtrArray *keys;
+
+	assert(type <= TAG_NUM_OF_ITEM_TYPES);
+
+	if (songs->len < 2)
+		return;
+
+	entries = g_new(struct sort_entry, songs->len);
+	keys = g_ptr_array_new();
+
+	if (tag_index != NULL)
+		g_mutex_lock(tag_index->mutex);
+
+	for (unsigned i = 0; i < songs->len; ++i) {
+		entries[i].song = g_ptr_array_index(songs, i);
+		entries[i].key = song_collate_key(entries[i].song, type, keys);
+		entries[i].position = i;
+	}
+
+	qsort(entries, songs->len, sizeof(entries[0]),
+	      descending
+	      ? compare_sort_entry_descending
+	      : compare_sort_entry);
+
+	if (tag_index != NULL)
+		g_mutex_unlock(tag_index->mutex);
+
+	for (unsigned i = 0; i < songs->len; ++i)
+		g_ptr_array_index(songs, i) = entries[i].song;
+
+	g_free(entries);
+
+	for (unsigned i = 0; i < keys->len; ++i)
+		g_free(g_ptr_array_index(keys, i));
+	g_ptr_array_free(keys, true);
+}
+
+bool
+tag_index_get_stats(struct tag_index_stats *stats)
+{
+	if (tag_index == NULL)
+		return false;
+
+	g_mutex_lock(tag_index->mutex);
+
+	stats->song_count = g_hash_table_size(tag_index->songs);
+	stats->song_duration = tag_index->song_duration;
+	stats->artist_count = g_hash_table_size(tag_index->values[TAG_ARTIST]);
+	stats->album_count = g_hash_table_size(tag_index->values[TAG_ALBUM]);
+
+	g_mutex_unlock(tag_index->mutex);
+
+	return true;
+}
+
+struct tag_index_list_data {
+	void (*callback)(const char *value, void *ctx);
+	void *ctx;
+};
+
+static void
+tag_index_list_value(gpointer key, G_GNUC_UNUSED gpointer value,
+		     gpointer _data)
+{
+	struct tag_index_list_data *data = _data;
+
+	data->callback(key, data->ctx);
+}
+
+bool
+tag_index_list(enum tag_type type,
+	       void (*callback)(const char *value, void *ctx), void *ctx)
+{
+	struct tag_index_list_data data = {
+		.callback = callback,
+		.ctx = ctx,
+	};
+
+	assert(type < TAG_NUM_OF_ITEM_TYPES);
+
+	if (tag_index == NULL)
+		return false;
+
+	g_mutex_lock(tag_index->mutex);
+
+	g_hash_table_foreach(tag_index->values[type],
+			     tag_index_list_value, &data);
+
+	if (tag_index->num_with_type[type] < tag_index->num_tagged)
+		callback("", ctx);
+
+	g_mutex_unlock(tag_index->mutex);
+
+	return true;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * An inverted index which maps tag values to the songs which have
+ * them.  It answers exact-match queries ("find", "count", "list")
+ * and substring queries ("search") without walking the whole
+ * directory tree.
+ */
+
+#ifndef MPD_TAG_INDEX_H
+#define MPD_TAG_INDEX_H
+
+#include "tag.h"
+
+#include <glib.h>
+
+#include <stdbool.h>
+
+struct song;
+struct directory;
+struct locate_item_list;
+
+void
+tag_index_init(void);
+
+void
+tag_index_deinit(void);
+
+/**
+ * Removes all songs from the index.
+ */
+void
+tag_index_clear(void);
+
+/**
+ * Adds all songs in the directory and its children to the index.
+ */
+void
+tag_index_add_directory(const struct directory *directory);
+
+/**
+ * Adds a song to the index.  Call this after the song has been added
+ * to the database, and after its tag has been replaced.
+ */
+void
+tag_index_add_song(struct song *song);
+
+/**
+ * Removes a song from the index.  Call this before the song is
+ * removed from the database or its tag is modified.  It is harmless
+ * to call this for a song which is not in the index.
+ */
+void
+tag_index_remove_song(struct song *song);
+
+/**
+ * Looks up all songs which match the criteria, just like
+ * locate_song_match().  The cost depends on the number of songs
+ * having the rarest of the specified values, not on the size of the
+ * database.
+ *
+ * @return a new array of songs in database order (free with
+ * g_ptr_array_free()), or NULL if the index cannot answer the query
+ * and the caller has to walk the database
+ */
+GPtrArray *
+tag_index_find(const struct locate_item_list *criteria);
+
+/**
+ * Looks up all songs which match the criteria, just like
+ * locate_song_search().  The needles must already be folded with
+ * locate_item_list_casefold().  Tag values and URIs are folded once
+ * when they are added to the index, and substrings of tag values are
+ * looked up in an n-gram index.
+ *
+ * @return a new array of songs in database order (free with
+ * g_ptr_array_free()), or NULL if there is no index
+ */
+GPtrArray *
+tag_index_search(const struct locate_item_list *criteria);
+
+/**
+ * Sorts songs by the value of the specified tag type, like
+ * g_utf8_collate() would.  The collation keys of indexed values are
+ * calculated only once, and cached.  Songs which lack the tag come
+ * first; songs with equal values keep their order.
+ *
+ * @param songs an array of songs; the caller must hold the database
+ * read lock
+ * @param type the tag type, or #TAG_NUM_OF_ITEM_TYPES to sort by URI
+ * @param descending true to sort in descending order
+ */
+void
+tag_index_sort(GPtrArray *songs, enum tag_type type, bool descending);
+
+/**
+ * Library statistics for the "stats" command.  They are maintained
+ * while songs are added to and removed from the index, so obtaining
+ * them does not walk the database.
+ */
+struct tag_index_stats {
+	/** the number of indexed songs */
+	unsigned song_count;
+
+	/** the sum of all known song durations (in seconds) */
+	unsigned long song_duration;
+
+	/** the number of distinct artist names */
+	unsigned artist_count;
+
+	/** the number of distinct album names */
+	unsigned album_count;
+};
+
+/**
+ * Obtains the library statistics.
+ *
+ * @return false if the index is not available
+ */
+bool
+tag_index_get_stats(struct tag_index_stats *stats);
+
+/**
+ * Invokes the callback for every distinct value of the specified tag
+ * type.  If at least one song lacks this tag type, the callback is
+ * also invoked with an empty string.
+ *
+ * @return false if the index is not available
+ */
+bool
+tag_index_list(enum tag_type type,
+	       void (*callback)(const char *value, void *ctx), void *ctx);
+
+#endif
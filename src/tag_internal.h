@@ -22,6 +22,28 @@
 
 #include <stdbool.h>
 
+struct tag_item;
+
 extern bool ignore_tag_items[TAG_NUM_OF_ITEM_TYPES];
 
+/**
+ * Allocates an array for #tag.items.  These arrays come from the
+ * GSlice allocator, which has no per-block overhead, and must be
+ * freed with tag_items_free(), passing the number of elements.
+ *
+ * @param n the number of elements, must be positive
+ */
+struct tag_item **
+tag_items_new(unsigned n);
+
+/**
+ * Reallocates a #tag.items array.  Either number may be zero, in
+ * which case the respective array is NULL.
+ */
+struct tag_item **
+tag_items_resize(struct tag_item **items, unsigned old_n, unsigned new_n);
+
+void
+tag_items_free(struct tag_item **items, unsigned n);
+
 #endif
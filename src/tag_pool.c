@@ -21,18 +21,54 @@
 #include "tag_pool.h"
 
 #include <assert.h>
+#include <string.h>
 
-GMutex *tag_pool_lock = NULL;
+/*
+ * The tag pool interns tag items: all songs with the same artist
+ * share one #tag_item object.  It is split into shards, each with
+ * its own mutex and its own resizable hash table, so threads
+ * creating tags (the update pool, decoders) rarely contend.  The
+ * shard is selected by the upper bits of the hash, the bucket by the
+ * lower bits.
+ */
 
-#define NUM_SLOTS 4096
+enum {
+	/** the number of shards; must be a power of two */
+	TAG_POOL_NUM_SHARDS = 64,
+
+	/** the initial number of buckets per shard */
+	TAG_POOL_MIN_BUCKETS = 64,
+};
 
 struct slot {
 	struct slot *next;
-	unsigned char ref;
+
+	/** the hash of the item, so it need not be calculated again */
+	unsigned hash;
+
+	/**
+	 * The reference counter.  It is only decremented with the
+	 * shard's mutex held, but tag_pool_dup_item() increments it
+	 * atomically without the mutex.
+	 */
+	volatile gint ref;
+
 	struct tag_item item;
-} mpd_packed;
+};
+
+struct shard {
+	GMutex *mutex;
+
+	struct slot **buckets;
 
-static struct slot *slots[NUM_SLOTS];
+	/** the number of buckets, a power of two */
+	unsigned num_buckets;
+
+	/** the number of slots in this shard */
+	unsigned num_slots;
+};
+
+static struct shard shards[TAG_POOL_NUM_SHARDS];
 
 static inline unsigned
 calc_hash_n(enum tag_type type, const char *p, size_t length)
@@ -44,20 +80,26 @@ calc_hash_n(enum tag_type type, const char *p, size_t length)
 	while (length-- > 0)
 		hash = (hash << 5) + hash + *p++;
 
-	return hash ^ type;
+	/* mix the bits, because the shard is selected by the upper
+	   bits, and the lower bits of this hash are weak */
+	hash ^= type;
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	hash ^= hash >> 16;
+
+	return hash;
 }
 
-static inline unsigned
-calc_hash(enum tag_type type, const char *p)
+static inline struct shard *
+hash_to_shard(unsigned hash)
 {
-	unsigned hash = 5381;
-
-	assert(p != NULL);
-
-	while (*p != 0)
-		hash = (hash << 5) + hash + *p++;
+	return &shards[(hash >> 24) & (TAG_POOL_NUM_SHARDS - 1)];
+}
 
-	return hash ^ type;
+static inline struct slot **
+shard_bucket(struct shard *shard, unsigned hash)
+{
+	return &shard->buckets[hash & (shard->num_buckets - 1)];
 }
 
 static inline struct slot *
@@ -66,14 +108,21 @@ tag_item_to_slot(struct tag_item *item)
 	return (struct slot*)(((char*)item) - offsetof(struct slot, item));
 }
 
-static struct slot *slot_alloc(struct slot *next,
-			       enum tag_type type,
-			       const char *value, int length)
+static inline size_t
+slot_size(size_t length)
+{
+	return sizeof(struct slot) - sizeof(((struct slot *)NULL)->item.value) +
+		length + 1;
+}
+
+static struct slot *
+slot_alloc(unsigned hash, enum tag_type type,
+	   const char *value, size_t length)
 {
 	struct slot *slot;
 
-	slot = g_malloc(sizeof(*slot) - sizeof(slot->item.value) + length + 1);
-	slot->next = next;
+	slot = g_slice_alloc(slot_size(length));
+	slot->hash = hash;
 	slot->ref = 1;
 	slot->item.type = type;
 	memcpy(slot->item.value, value, length);
@@ -81,38 +130,96 @@ static struct slot *slot_alloc(struct slot *next,
 	return slot;
 }
 
+static void
+slot_free(struct slot *slot)
+{
+	g_slice_free1(slot_size(strlen(slot->item.value)), slot);
+}
+
+/**
+ * Doubles the number of buckets.  The caller must hold the shard's
+ * mutex.
+ */
+static void
+shard_grow(struct shard *shard)
+{
+	unsigned old_num_buckets = shard->num_buckets;
+	struct slot **old_buckets = shard->buckets;
+
+	shard->num_buckets *= 2;
+	shard->buckets = g_new0(struct slot *, shard->num_buckets);
+
+	for (unsigned i = 0; i < old_num_buckets; ++i) {
+		struct slot *slot = old_buckets[i], *next;
+
+		for (; slot != NULL; slot = next) {
+			struct slot **slot_p = shard_bucket(shard, slot->hash);
+
+			next = slot->next;
+			slot->next = *slot_p;
+			*slot_p = slot;
+		}
+	}
+
+	g_free(old_buckets);
+}
+
 void tag_pool_init(void)
 {
-	g_assert(tag_pool_lock == NULL);
-	tag_pool_lock = g_mutex_new();
+	for (unsigned i = 0; i < TAG_POOL_NUM_SHARDS; ++i) {
+		struct shard *shard = &shards[i];
+
+		g_assert(shard->mutex == NULL);
+		shard->mutex = g_mutex_new();
+		shard->num_buckets = TAG_POOL_MIN_BUCKETS;
+		shard->buckets = g_new0(struct slot *, shard->num_buckets);
+		shard->num_slots = 0;
+	}
 }
 
 void tag_pool_deinit(void)
 {
-	g_assert(tag_pool_lock != NULL);
-	g_mutex_free(tag_pool_lock);
-	tag_pool_lock = NULL;
+	for (unsigned i = 0; i < TAG_POOL_NUM_SHARDS; ++i) {
+		struct shard *shard = &shards[i];
+
+		g_assert(shard->mutex != NULL);
+		g_mutex_free(shard->mutex);
+		shard->mutex = NULL;
+		g_free(shard->buckets);
+		shard->buckets = NULL;
+	}
 }
 
 struct tag_item *
 tag_pool_get_item(enum tag_type type, const char *value, size_t length)
 {
+	unsigned hash = calc_hash_n(type, value, length);
+	struct shard *shard = hash_to_shard(hash);
 	struct slot **slot_p, *slot;
 
-	slot_p = &slots[calc_hash_n(type, value, length) % NUM_SLOTS];
+	g_mutex_lock(shard->mutex);
+
+	slot_p = shard_bucket(shard, hash);
 	for (slot = *slot_p; slot != NULL; slot = slot->next) {
-		if (slot->item.type == type &&
+		if (slot->hash == hash &&
+		    slot->item.type == type &&
 		    length == strlen(slot->item.value) &&
-		    memcmp(value, slot->item.value, length) == 0 &&
-		    slot->ref < 0xff) {
+		    memcmp(value, slot->item.value, length) == 0) {
 			assert(slot->ref > 0);
-			++slot->ref;
+			g_atomic_int_inc(&slot->ref);
+			g_mutex_unlock(shard->mutex);
 			return &slot->item;
 		}
 	}
 
-	slot = slot_alloc(*slot_p, type, value, length);
+	slot = slot_alloc(hash, type, value, length);
+	slot->next = *slot_p;
 	*slot_p = slot;
+
+	if (++shard->num_slots > shard->num_buckets * 2)
+		shard_grow(shard);
+
+	g_mutex_unlock(shard->mutex);
 	return &slot->item;
 }
 
@@ -120,42 +227,66 @@ struct tag_item *tag_pool_dup_item(struct tag_item *item)
 {
 	struct slot *slot = tag_item_to_slot(item);
 
+	/* the caller owns a reference, so the slot cannot be freed
+	   concurrently, and no lock is needed */
 	assert(slot->ref > 0);
+	g_atomic_int_inc(&slot->ref);
 
-	if (slot->ref < 0xff) {
-		++slot->ref;
-		return item;
-	} else {
-		/* the reference counter overflows above 0xff;
-		   duplicate the item, and start with 1 */
-		size_t length = strlen(item->value);
-		struct slot **slot_p =
-			&slots[calc_hash_n(item->type, item->value,
-					   length) % NUM_SLOTS];
-		slot = slot_alloc(*slot_p, item->type,
-				  item->value, strlen(item->value));
-		*slot_p = slot;
-		return &slot->item;
-	}
+	return item;
 }
 
 void tag_pool_put_item(struct tag_item *item)
 {
-	struct slot **slot_p, *slot;
+	struct slot *slot = tag_item_to_slot(item);
+	struct shard *shard = hash_to_shard(slot->hash);
+	struct slot **slot_p;
 
-	slot = tag_item_to_slot(item);
-	assert(slot->ref > 0);
-	--slot->ref;
+	g_mutex_lock(shard->mutex);
 
-	if (slot->ref > 0)
+	assert(slot->ref > 0);
+	if (!g_atomic_int_dec_and_test(&slot->ref)) {
+		g_mutex_unlock(shard->mutex);
 		return;
+	}
 
-	for (slot_p = &slots[calc_hash(item->type, item->value) % NUM_SLOTS];
+	for (slot_p = shard_bucket(shard, slot->hash);
 	     *slot_p != slot;
 	     slot_p = &(*slot_p)->next) {
 		assert(*slot_p != NULL);
 	}
 
 	*slot_p = slot->next;
-	g_free(slot);
+	--shard->num_slots;
+
+	g_mutex_unlock(shard->mutex);
+
+	slot_free(slot);
+}
+
+void
+tag_pool_stats(unsigned *num_items_r, size_t *size_r)
+{
+	unsigned num_items = 0;
+	size_t size = sizeof(shards);
+
+	for (unsigned i = 0; i < TAG_POOL_NUM_SHARDS; ++i) {
+		struct shard *shard = &shards[i];
+
+		g_mutex_lock(shard->mutex);
+
+		size += shard->num_buckets * sizeof(shard->buckets[0]);
+
+		for (unsigned j = 0; j < shard->num_buckets; ++j) {
+			for (const struct slot *slot = shard->buckets[j];
+			     slot != NULL; slot = slot->next) {
+				++num_items;
+				size += slot_size(strlen(slot->item.value));
+			}
+		}
+
+		g_mutex_unlock(shard->mutex);
+	}
+
+	*num_items_r = num_items;
+	*size_r = size;
 }
@@ -24,8 +24,6 @@
 
 #include <glib.h>
 
-extern GMutex *tag_pool_lock;
-
 struct tag_item;
 
 void tag_pool_init(void);
@@ -39,4 +37,12 @@ struct tag_item *tag_pool_dup_item(struct tag_item *item);
 
 void tag_pool_put_item(struct tag_item *item);
 
+/**
+ * Determines the number of distinct items in the pool, and the
+ * memory occupied by the pool (not counting allocator overhead).
+ * Meant for diagnostics and benchmarks.
+ */
+void
+tag_pool_stats(unsigned *num_items_r, size_t *size_r);
+
 #endif
@@ -37,12 +37,15 @@ void tag_print_types(struct client *client)
 
 void tag_print(struct client *client, const struct tag *tag)
 {
-	if (tag->time >= 0)
-		client_printf(client, SONG_TIME "%i\n", tag->time);
+	if (tag->time >= 0) {
+		char time[16];
 
-	for (unsigned i = 0; i < tag->num_items; i++) {
-		client_printf(client, "%s: %s\n",
-			      tag_item_names[tag->items[i]->type],
-			      tag->items[i]->value);
+		g_snprintf(time, sizeof(time), "%i", tag->time);
+		client_record_field(client, "Time", time, true);
 	}
+
+	for (unsigned i = 0; i < tag->num_items; i++)
+		client_record_field(client,
+				    tag_item_names[tag->items[i]->type],
+				    tag->items[i]->value, true);
 }
@@ -21,6 +21,7 @@
 #include "update_internal.h"
 #include "update.h"
 #include "database.h"
+#include "db_journal.h"
 #include "mapper.h"
 #include "playlist.h"
 #include "event_pipe.h"
@@ -67,8 +68,8 @@ static void * update_task(void *_path)
 
 	modified = update_walk(path, discard);
 
-	if (modified || !db_exists())
-		db_save();
+	if (modified || !db_exists() || db_journal_pending())
+		db_save_changes();
 
 	if (path != NULL && *path != 0)
 		g_debug("finished: %s", path);
@@ -162,10 +163,12 @@ void update_global_init(void)
 
 	update_remove_global_init();
 	update_walk_global_init();
+	update_pool_global_init();
 }
 
 void update_global_finish(void)
 {
+	update_pool_global_finish();
 	update_walk_global_finish();
 	update_remove_global_finish();
 }
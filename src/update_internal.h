@@ -47,6 +47,67 @@ update_walk_global_finish(void);
 bool
 update_walk(const char *path, bool discard);
 
+/**
+ * A song whose tag is being loaded by the update_pool.
+ */
+struct update_job {
+	/**
+	 * A new song object, not yet in the database.
+	 */
+	struct song *song;
+
+	/**
+	 * The song in the database which is being updated, or NULL
+	 * if #song is new.
+	 */
+	struct song *existing;
+
+	/**
+	 * The return value of song_file_update().
+	 */
+	bool success;
+};
+
+void
+update_pool_global_init(void);
+
+void
+update_pool_global_finish(void);
+
+/**
+ * Is the pool enabled, i.e. is "update_threads" larger than 1?
+ */
+bool
+update_pool_enabled(void);
+
+/**
+ * Returns true if the caller should collect finished jobs before
+ * submitting more.
+ */
+bool
+update_pool_full(void);
+
+/**
+ * Loads the tag of a song in a worker thread.
+ *
+ * @param song the song object to be loaded; it must not be in the
+ * database
+ * @param existing the song in the database which will be replaced,
+ * or NULL
+ */
+void
+update_pool_push(struct song *song, struct song *existing);
+
+/**
+ * Returns the next finished job, which must be freed with g_free().
+ *
+ * @param wait if true, wait until a job is finished, unless there
+ * are no pending jobs
+ * @return the job, or NULL if there is none
+ */
+struct update_job *
+update_pool_pop(bool wait);
+
 void
 update_remove_global_init(void);
 
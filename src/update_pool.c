@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * A pool of worker threads which load the tags of songs while the
+ * update thread walks the directory tree.  Only the update thread
+ * modifies the database; the workers operate on detached song
+ * objects, which are handed back by update_pool_pop().
+ *
+ */
+
+#include "config.h" /* must be first for large file support */
+#include "update_internal.h"
+#include "song.h"
+#include "conf.h"
+
+#include <glib.h>
+
+#include <assert.h>
+
+enum {
+	DEFAULT_UPDATE_THREADS = 4,
+
+	/**
+	 * The maximum number of jobs per thread which have not been
+	 * collected yet.  update_pool_full() returns true beyond
+	 * that, to bound the memory used by a fast walker.
+	 */
+	UPDATE_POOL_JOBS_PER_THREAD = 64,
+};
+
+static GThreadPool *update_pool;
+
+/**
+ * Finished jobs, waiting to be merged by the update thread.
+ */
+static GAsyncQueue *update_pool_finished;
+
+/**
+ * The number of jobs which were pushed but not popped yet.  Only
+ * accessed by the update thread.
+ */
+static unsigned update_pool_pending;
+
+static unsigned update_pool_max_pending;
+
+static void
+update_pool_run(gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+	struct update_job *job = data;
+
+	job->success = song_file_update(job->song);
+
+	g_async_queue_push(update_pool_finished, job);
+}
+
+void
+update_pool_global_init(void)
+{
+	unsigned num_threads = config_get_positive(CONF_UPDATE_THREADS,
+						   DEFAULT_UPDATE_THREADS);
+	GError *error = NULL;
+
+	if (num_threads <= 1)
+		/* load the tags in the update thread */
+		return;
+
+	update_pool_finished = g_async_queue_new();
+	update_pool = g_thread_pool_new(update_pool_run, NULL,
+					num_threads, false, &error);
+	if (update_pool == NULL)
+		g_error("Failed to create update thread pool: %s",
+			error->message);
+
+	update_pool_max_pending = num_threads * UPDATE_POOL_JOBS_PER_THREAD;
+
+	g_debug("loading tags with %u threads", num_threads);
+}
+
+void
+update_pool_global_finish(void)
+{
+	if (update_pool == NULL)
+		return;
+
+	assert(update_pool_pending == 0);
+
+	g_thread_pool_free(update_pool, false, true);
+	g_async_queue_unref(update_pool_finished);
+}
+
+bool
+update_pool_enabled(void)
+{
+	return update_pool != NULL;
+}
+
+bool
+update_pool_full(void)
+{
+	return update_pool_pending >= update_pool_max_pending;
+}
+
+void
+update_pool_push(struct song *song, struct song *existing)
+{
+	struct update_job *job = g_new(struct update_job, 1);
+
+	assert(update_pool != NULL);
+	assert(song->parent != NULL);
+	assert(existing == NULL || existing->parent == song->parent);
+
+	job->song = song;
+	job->existing = existing;
+	job->success = false;
+
+	++update_pool_pending;
+	g_thread_pool_push(update_pool, job, NULL);
+}
+
+struct update_job *
+update_pool_pop(bool wait)
+{
+	struct update_job *job;
+
+	if (update_pool_pending == 0)
+		return NULL;
+
+	job = wait
+		? g_async_queue_pop(update_pool_finished)
+		: g_async_queue_try_pop(update_pool_finished);
+	if (job != NULL)
+		--update_pool_pending;
+
+	return job;
+}
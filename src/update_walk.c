@@ -20,6 +20,7 @@
 #include "config.h" /* must be first for large file support */
 #include "update_internal.h"
 #include "database.h"
+#include "db_journal.h"
 #include "exclude.h"
 #include "directory.h"
 #include "song.h"
@@ -29,6 +30,7 @@
 #include "decoder_list.h"
 #include "decoder_plugin.h"
 #include "playlist_list.h"
+#include "tag_index.h"
 #include "conf.h"
 
 #ifdef ENABLE_ARCHIVE
@@ -93,7 +95,12 @@ static void
 delete_song(struct directory *dir, struct song *del)
 {
 	/* first, prevent traversers in main task from getting this */
+	db_lock_write();
+	tag_index_remove_song(del);
 	songvec_delete(&dir->songs, del);
+	db_unlock_write();
+
+	db_journal_delete_song(del);
 
 	/* now take it out of the playlist (in the main_task) */
 	update_remove_song(del);
@@ -111,6 +118,83 @@ delete_each_song(struct song *song, G_GNUC_UNUSED void *data)
 	return 0;
 }
 
+/**
+ * Applies the result of an update_pool job to the database.
+ */
+static void
+update_merge_job(struct update_job *job)
+{
+	struct song *song = job->song, *existing = job->existing;
+	struct directory *directory = song->parent;
+
+	if (existing == NULL) {
+		if (job->success) {
+			db_lock_write();
+			songvec_add(&directory->songs, song);
+			tag_index_add_song(song);
+			db_unlock_write();
+			db_journal_song(song);
+			modified = true;
+			g_message("added %s/%s",
+				  directory_get_path(directory), song->uri);
+		} else {
+			g_debug("ignoring unrecognized file %s/%s",
+				directory_get_path(directory), song->uri);
+			song_free(song);
+		}
+	} else {
+		if (job->success) {
+			/* move the new tag to the song in the
+			   database; the old one is freed with the
+			   temporary song object */
+			struct tag *tag = existing->tag;
+			db_lock_write();
+			tag_index_remove_song(existing);
+			existing->tag = song->tag;
+			existing->mtime = song->mtime;
+			song->tag = tag;
+			tag_index_add_song(existing);
+			db_unlock_write();
+			db_journal_song(existing);
+		} else {
+			g_debug("deleting unrecognized file %s/%s",
+				directory_get_path(directory), song->uri);
+			delete_song(directory, existing);
+		}
+
+		song_free(song);
+		modified = true;
+	}
+
+	g_free(job);
+}
+
+/**
+ * Merges the jobs finished by the update_pool.
+ *
+ * @param wait if true, wait for all pending jobs
+ */
+static void
+update_merge(bool wait)
+{
+	struct update_job *job;
+
+	while ((job = update_pool_pop(wait)) != NULL)
+		update_merge_job(job);
+}
+
+/**
+ * Loads the song's tag in the update_pool.
+ */
+static void
+update_submit(struct song *song, struct song *existing)
+{
+	while (update_pool_full())
+		update_merge_job(update_pool_pop(true));
+
+	update_pool_push(song, existing);
+}
+
 static void
 delete_directory(struct directory *directory);
 
@@ -139,9 +223,17 @@ delete_directory(struct directory *directory)
 {
 	assert(directory->parent != NULL);
 
+	/* pending jobs may refer to songs in this directory */
+	update_merge(true);
+
 	clear_directory(directory);
 
+	db_journal_delete_directory(directory);
+
+	db_lock_write();
 	dirvec_delete(&directory->parent->children, directory);
+	db_unlock_write();
+
 	directory_free(directory);
 }
 
@@ -161,7 +253,12 @@ delete_name_in(struct directory *parent, const char *name)
 		modified = true;
 	}
 
-	playlist_vector_remove(&parent->playlists, name);
+	db_lock_write();
+	bool found = playlist_vector_remove(&parent->playlists, name);
+	db_unlock_write();
+
+	if (found)
+		db_journal_delete_playlist(parent, name);
 }
 
 /* passed to songvec_for_each */
@@ -283,8 +380,13 @@ removeDeletedFromDirectory(struct directory *directory)
 	     pm != NULL;) {
 		const struct playlist_metadata *next = pm->next;
 
-		if (!directory_child_is_regular(directory, pm->name))
+		if (!directory_child_is_regular(directory, pm->name)) {
+			db_journal_delete_playlist(directory, pm->name);
+
+			db_lock_write();
 			playlist_vector_remove(&directory->playlists, pm->name);
+			db_unlock_write();
+		}
 
 		pm = next;
 	}
@@ -372,7 +474,9 @@ make_subdir(struct directory *parent, const char *name)
 			name = path = g_strconcat(directory_get_path(parent),
 						  "/", name, NULL);
 
+		db_lock_write();
 		directory = directory_new_child(parent, name);
+		db_unlock_write();
 		g_free(path);
 	}
 
@@ -406,9 +510,17 @@ update_archive_tree(struct directory *directory, char *name)
 		//add file
 		song = songvec_find(&directory->songs, name);
 		if (song == NULL) {
+			/* not submitted to the update pool: its
+			   workers load regular files, and loading a
+			   song inside an archive doesn't do any I/O
+			   anyway */
 			song = song_file_load(name, directory);
 			if (song != NULL) {
+				db_lock_write();
 				songvec_add(&directory->songs, song);
+				tag_index_add_song(song);
+				db_unlock_write();
+				db_journal_song(song);
 				modified = true;
 				g_message("added %s/%s",
 					  directory_get_path(directory), name);
@@ -466,6 +578,7 @@ update_archive_file(struct directory *parent, const char *name,
 	}
 
 	directory->mtime = st->st_mtime;
+	db_journal_directory_mtime(directory);
 
 	archive_file_scan_reset(file);
 
@@ -512,6 +625,7 @@ update_container_file(	struct directory* directory,
 	contdir = make_subdir(directory, name);
 	contdir->mtime = st->st_mtime;
 	contdir->device = DEVICE_CONTAINER;
+	db_journal_directory_mtime(contdir);
 
 	while ((vtrack = plugin->container_scan(pathname, ++tnum)) != NULL)
 	{
@@ -526,7 +640,11 @@ update_container_file(	struct directory* directory,
 		song->tag = plugin->tag_dup(child_path_fs);
 		g_free(child_path_fs);
 
+		db_lock_write();
 		songvec_add(&contdir->songs, song);
+		tag_index_add_song(song);
+		db_unlock_write();
+		db_journal_song(song);
 
 		modified = true;
 
@@ -576,6 +694,12 @@ update_regular_file(struct directory *directory,
 		}
 
 		if (song == NULL) {
+			if (update_pool_enabled()) {
+				update_submit(song_file_new(name, directory),
+					      NULL);
+				return;
+			}
+
 			song = song_file_load(name, directory);
 			if (song == NULL) {
 				g_debug("ignoring unrecognized file %s/%s",
@@ -583,20 +707,33 @@ update_regular_file(struct directory *directory,
 				return;
 			}
 
+			db_lock_write();
 			songvec_add(&directory->songs, song);
+			tag_index_add_song(song);
+			db_unlock_write();
+			db_journal_song(song);
 			modified = true;
 			g_message("added %s/%s",
 				  directory_get_path(directory), name);
 		} else if (st->st_mtime != song->mtime || walk_discard) {
 			g_message("updating %s/%s",
 				  directory_get_path(directory), name);
-			if (!song_file_update(song)) {
-				g_debug("deleting unrecognized file %s/%s",
-					directory_get_path(directory), name);
-				delete_song(directory, song);
+
+			if (update_pool_enabled()) {
+				update_submit(song_file_new(name, directory),
+					      song);
+				return;
 			}
 
-			modified = true;
+			/* load the new tag into a temporary song object,
+			   because query workers may be reading the
+			   existing one; update_merge_job() swaps them
+			   while holding the database lock */
+			struct update_job *job = g_new(struct update_job, 1);
+			job->song = song_file_new(name, directory);
+			job->existing = song;
+			job->success = song_file_update(job->song);
+			update_merge_job(job);
 		}
 #ifdef ENABLE_ARCHIVE
 	} else if ((archive = archive_plugin_from_suffix(suffix))) {
@@ -604,7 +741,16 @@ update_regular_file(struct directory *directory,
 #endif
 
 	} else if (playlist_suffix_supported(suffix)) {
-		playlist_vector_add(&directory->playlists, name, st->st_mtime);
+		const struct playlist_metadata *pm =
+			playlist_vector_find(&directory->playlists, name);
+		if (pm == NULL || pm->mtime != st->st_mtime) {
+			db_lock_write();
+			playlist_vector_update_or_add(&directory->playlists,
+						      name, st->st_mtime);
+			db_unlock_write();
+
+			db_journal_playlist(directory, name, st->st_mtime);
+		}
 	}
 }
 
@@ -767,13 +913,18 @@ updateDirectory(struct directory *directory, const struct stat *st)
 			delete_name_in(directory, utf8);
 
 		g_free(utf8);
+
+		update_merge(false);
 	}
 
 	exclude_list_free(exclude_list);
 
 	closedir(dir);
 
-	directory->mtime = st->st_mtime;
+	if (directory->mtime != st->st_mtime) {
+		directory->mtime = st->st_mtime;
+		db_journal_directory_mtime(directory);
+	}
 
 	return true;
 }
@@ -806,7 +957,9 @@ directory_make_child_checked(struct directory *parent, const char *path)
 
 	g_free(base);
 
+	db_lock_write();
 	directory = directory_new_child(parent, path);
+	db_unlock_write();
 	directory_set_stat(directory, &st);
 	return directory;
 }
@@ -870,5 +1023,7 @@ update_walk(const char *path, bool discard)
 			updateDirectory(directory, &st);
 	}
 
+	update_merge(true);
+
 	return modified;
 }
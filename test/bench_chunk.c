@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the cost of moving one second of audio
+ * through the music pipe, for several chunk sizes (see
+ * "audio_chunk_size"): the decoder part fills chunks with
+ * music_chunk_write(), the player part moves them through a
+ * music_pipe, and the output part applies software volume to each
+ * chunk before returning it to the music_buffer.
+ *
+ */
+
+#include "config.h"
+#include "chunk.h"
+#include "buffer.h"
+#include "pipe.h"
+#include "pcm_volume.h"
+#include "audio_parser.h"
+#include "audio_format.h"
+
+#include <glib.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	/** the number of seconds of audio to process per chunk size */
+	BENCH_SECONDS = 10,
+};
+
+static const size_t chunk_sizes[] = {
+	4096, 16384, 65536, 262144, 1048576,
+};
+
+/**
+ * Moves the specified number of bytes through a pipe.
+ *
+ * @return the number of chunks which were used
+ */
+static unsigned long
+bench_run(const struct audio_format *audio_format, size_t chunk_size,
+	  const char *src, size_t src_size, guint64 total)
+{
+	struct music_buffer *buffer = music_buffer_new(4, chunk_size);
+	struct music_pipe *mp = music_pipe_new();
+	unsigned long num_chunks = 0;
+
+	while (total > 0) {
+		struct music_chunk *chunk = music_buffer_allocate(buffer);
+		bool full = false;
+
+		assert(chunk != NULL);
+
+		/* decoder */
+
+		while (!full && total > 0) {
+			size_t nbytes;
+			void *dest = music_chunk_write(chunk, audio_format,
+						       0, 0, &nbytes);
+			assert(dest != NULL);
+
+			if (nbytes > src_size)
+				nbytes = src_size;
+			if (nbytes > total)
+				nbytes = total;
+
+			memcpy(dest, src, nbytes);
+			full = music_chunk_expand(chunk, audio_format, nbytes);
+			total -= nbytes;
+		}
+
+		music_pipe_push(mp, chunk);
+
+		/* player and output */
+
+		chunk = music_pipe_shift(mp);
+		assert(chunk != NULL);
+
+		pcm_volume(chunk->data, chunk->length, audio_format,
+			   PCM_VOLUME_1 / 2);
+
+		music_buffer_return(buffer, chunk);
+		++num_chunks;
+	}
+
+	music_pipe_free(mp);
+	music_buffer_free(buffer);
+
+	return num_chunks;
+}
+
+int main(int argc, char **argv)
+{
+	GError *error = NULL;
+	struct audio_format audio_format;
+	guint64 total;
+	char *src;
+	size_t src_size;
+	GTimer *timer;
+
+	if (argc > 2) {
+		g_printerr("Usage: bench_chunk [FORMAT]\n");
+		return 1;
+	}
+
+	if (argc > 1) {
+		if (!audio_format_parse(&audio_format, argv[1],
+					false, &error)) {
+			g_printerr("Failed to parse audio format: %s\n",
+				   error->message);
+			return 1;
+		}
+	} else
+		audio_format_init(&audio_format, 192000,
+				  SAMPLE_FORMAT_S32, 8);
+
+	total = (guint64)audio_format_time_to_size(&audio_format) *
+		BENCH_SECONDS;
+
+	/* the source buffer is one decoder block of random samples;
+	   its size is not a multiple of any chunk size */
+	src_size = audio_format_frame_size(&audio_format) * 1152;
+	src = g_malloc(src_size);
+	for (size_t i = 0; i < src_size; ++i)
+		src[i] = g_random_int();
+
+	timer = g_timer_new();
+
+	g_print("chunk size  chunks/s  ms/s  us/chunk\n");
+
+	for (unsigned i = 0; i < G_N_ELEMENTS(chunk_sizes); ++i) {
+		size_t chunk_size = chunk_sizes[i];
+		unsigned long num_chunks;
+		double elapsed;
+
+		if (chunk_size < audio_format_frame_size(&audio_format))
+			continue;
+
+		g_timer_start(timer);
+		num_chunks = bench_run(&audio_format, chunk_size,
+				       src, src_size, total);
+		elapsed = g_timer_elapsed(timer, NULL);
+
+		g_print("%10lu  %8.0f  %4.1f  %8.2f\n",
+			(unsigned long)chunk_size,
+			(double)num_chunks / BENCH_SECONDS,
+			elapsed * 1000 / BENCH_SECONDS,
+			elapsed * 1000000 / num_chunks);
+	}
+
+	g_timer_destroy(timer);
+	g_free(src);
+
+	return 0;
+}
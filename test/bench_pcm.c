@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program compares the scalar implementations of pcm_volume()
+ * and pcm_mix() with the SIMD kernels supported by this CPU.  It
+ * reports the throughput in samples per second, and fails if a
+ * kernel's result differs from the scalar one by more than the
+ * dithering tolerance.
+ *
+ */
+
+#include "config.h"
+#include "pcm_volume.h"
+#include "pcm_mix.h"
+#include "pcm_simd.h"
+#include "audio_format.h"
+
+#include <glib.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	/** the number of samples in each buffer */
+	BENCH_SAMPLES = 65536,
+
+	/** the number of times each operation is repeated */
+	BENCH_ITERATIONS = 200,
+};
+
+static const char *const kernel_names[] = {
+	"none", "sse2", "avx2", "neon",
+};
+
+static const enum sample_format formats[] = {
+	SAMPLE_FORMAT_S16, SAMPLE_FORMAT_S24_P32, SAMPLE_FORMAT_S32,
+	SAMPLE_FORMAT_FLOAT,
+};
+
+enum bench_operation {
+	BENCH_VOLUME,
+	BENCH_MIX,
+	BENCH_ADD,
+};
+
+static const char *const operation_names[] = {
+	"volume", "mix", "add",
+};
+
+static size_t
+sample_size(enum sample_format format)
+{
+	return format == SAMPLE_FORMAT_S16 ? 2 : 4;
+}
+
+static void
+fill_random(void *buffer, enum sample_format format)
+{
+	for (unsigned i = 0; i < BENCH_SAMPLES; ++i) {
+		guint32 r = g_random_int();
+
+		switch (format) {
+		case SAMPLE_FORMAT_S16:
+			((int16_t *)buffer)[i] = r;
+			break;
+
+		case SAMPLE_FORMAT_S24_P32:
+			/* sign-extend the low 24 bits */
+			((int32_t *)buffer)[i] = (int32_t)(r << 8) >> 8;
+			break;
+
+		case SAMPLE_FORMAT_FLOAT:
+			((float *)buffer)[i] = (float)(int32_t)r / 2147483648.0f;
+			break;
+
+		default:
+			((int32_t *)buffer)[i] = r;
+			break;
+		}
+	}
+}
+
+static void
+run_operation(enum bench_operation operation, void *dest, const void *src,
+	      const struct audio_format *audio_format)
+{
+	const size_t size = BENCH_SAMPLES * sample_size(audio_format->format);
+
+	switch (operation) {
+	case BENCH_VOLUME:
+		pcm_volume(dest, size, audio_format, PCM_VOLUME_1 * 7 / 10);
+		break;
+
+	case BENCH_MIX:
+		pcm_mix(dest, src, size, audio_format, 0.3);
+		break;
+
+	case BENCH_ADD:
+		pcm_mix(dest, src, size, audio_format, NAN);
+		break;
+	}
+}
+
+/**
+ * Returns the largest difference between two sample buffers.  Float
+ * samples are compared by their bit patterns, i.e. the result is
+ * the distance in units in the last place.
+ */
+static gint64
+max_difference(const void *a, const void *b, enum sample_format format)
+{
+	gint64 max = 0;
+
+	for (unsigned i = 0; i < BENCH_SAMPLES; ++i) {
+		gint64 x, y;
+
+		if (format == SAMPLE_FORMAT_S16) {
+			x = ((const int16_t *)a)[i];
+			y = ((const int16_t *)b)[i];
+		} else {
+			x = ((const int32_t *)a)[i];
+			y = ((const int32_t *)b)[i];
+		}
+
+		if (x - y > max)
+			max = x - y;
+		if (y - x > max)
+			max = y - x;
+	}
+
+	return max;
+}
+
+/**
+ * Benchmarks one operation with the currently selected kernels.
+ *
+ * @return false if the result does not match the scalar result
+ */
+static bool
+bench_operation(enum bench_operation operation,
+		const struct audio_format *audio_format,
+		const void *src1, const void *src2, GTimer *timer)
+{
+	const size_t size = BENCH_SAMPLES * sample_size(audio_format->format);
+	const char *kernels = pcm_simd_name();
+	void *dest = g_malloc(size), *expected = g_malloc(size);
+	gint64 difference;
+	double elapsed;
+
+	/* calculate the scalar result */
+
+	pcm_simd_select("none");
+	memcpy(expected, src1, size);
+	run_operation(operation, expected, src2, audio_format);
+	pcm_simd_select(kernels);
+
+	memcpy(dest, src1, size);
+	run_operation(operation, dest, src2, audio_format);
+	difference = max_difference(dest, expected, audio_format->format);
+
+	g_timer_start(timer);
+	for (unsigned i = 0; i < BENCH_ITERATIONS; ++i)
+		run_operation(operation, dest, src2, audio_format);
+	elapsed = g_timer_elapsed(timer, NULL);
+
+	g_print("%-5s %-7s %-6s %8.1f  %s\n",
+		kernels, sample_format_to_string(audio_format->format),
+		operation_names[operation],
+		BENCH_SAMPLES * (double)BENCH_ITERATIONS / elapsed / 1e6,
+		difference == 0 ? "exact"
+		: (difference == 1 && operation != BENCH_ADD ? "dither"
+		   : "MISMATCH"));
+
+	g_free(dest);
+	g_free(expected);
+
+	return difference == 0 ||
+		(difference == 1 && operation != BENCH_ADD);
+}
+
+int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv)
+{
+	struct audio_format audio_format;
+	GTimer *timer = g_timer_new();
+	bool success = true;
+
+	g_print("kernels format  op     Msamples/s  result\n");
+
+	for (unsigned i = 0; i < G_N_ELEMENTS(kernel_names); ++i) {
+		if (!pcm_simd_select(kernel_names[i]))
+			continue;
+
+		for (unsigned j = 0; j < G_N_ELEMENTS(formats); ++j) {
+			const size_t size =
+				BENCH_SAMPLES * sample_size(formats[j]);
+			void *src1 = g_malloc(size), *src2 = g_malloc(size);
+
+			audio_format_init(&audio_format, 44100, formats[j], 2);
+			fill_random(src1, formats[j]);
+			fill_random(src2, formats[j]);
+
+			for (unsigned k = 0; k < G_N_ELEMENTS(operation_names);
+			     ++k)
+				success = bench_operation(k, &audio_format,
+							  src1, src2, timer) &&
+					success;
+
+			g_free(src1);
+			g_free(src2);
+		}
+	}
+
+	g_timer_destroy(timer);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
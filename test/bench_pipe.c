@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the throughput of the music_pipe and
+ * music_buffer libraries: one thread allocates chunks and pushes
+ * them into a pipe, another thread shifts them and returns them to
+ * the buffer.  It is built twice, for the mutex and the lock-free
+ * implementation (see MUSIC_PIPE_LOCKFREE).
+ *
+ */
+
+#include "config.h"
+#include "pipe.h"
+#include "buffer.h"
+#include "chunk.h"
+#include "lockfree.h"
+
+#include <glib.h>
+
+#include <stdlib.h>
+
+static struct music_buffer *buffer;
+static struct music_pipe *mp;
+static unsigned long num_chunks = 1000000;
+
+static gpointer
+producer_thread(G_GNUC_UNUSED gpointer data)
+{
+	for (unsigned long i = 0; i < num_chunks; ++i) {
+		struct music_chunk *chunk;
+
+		while ((chunk = music_buffer_allocate(buffer)) == NULL)
+			g_thread_yield();
+
+		chunk->length = CHUNK_SIZE;
+		music_pipe_push(mp, chunk);
+	}
+
+	return NULL;
+}
+
+static gpointer
+consumer_thread(G_GNUC_UNUSED gpointer data)
+{
+	for (unsigned long i = 0; i < num_chunks; ++i) {
+		struct music_chunk *chunk;
+
+		while ((chunk = music_pipe_shift(mp)) == NULL)
+			g_thread_yield();
+
+		music_buffer_return(buffer, chunk);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned buffer_chunks = 64;
+	GThread *producer, *consumer;
+	GTimer *timer;
+	GError *error = NULL;
+	double elapsed;
+
+	if (argc > 3) {
+		g_printerr("Usage: bench_pipe [NUM_CHUNKS [BUFFER_CHUNKS]]\n");
+		return 1;
+	}
+
+	if (argc > 1)
+		num_chunks = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		buffer_chunks = strtoul(argv[2], NULL, 10);
+
+	if (num_chunks == 0 || buffer_chunks == 0) {
+		g_printerr("Invalid number of chunks\n");
+		return 1;
+	}
+
+	g_thread_init(NULL);
+
+	buffer = music_buffer_new(buffer_chunks, CHUNK_SIZE);
+	mp = music_pipe_new();
+
+	timer = g_timer_new();
+
+	producer = g_thread_create(producer_thread, NULL, true, &error);
+	if (producer == NULL) {
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return 2;
+	}
+
+	consumer = g_thread_create(consumer_thread, NULL, true, &error);
+	if (consumer == NULL) {
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return 2;
+	}
+
+	g_thread_join(producer);
+	g_thread_join(consumer);
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+
+	music_pipe_free(mp);
+	music_buffer_free(buffer);
+
+	g_print("%s: %lu chunks in %.3f s, %.0f chunks/s\n",
+		MUSIC_PIPE_LOCKFREE ? "lock-free" : "mutex",
+		num_chunks, elapsed, num_chunks / elapsed);
+
+	return 0;
+}
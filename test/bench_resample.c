@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the built-in polyphase resampler
+ * (pcm_polyphase.c): the throughput and the THD+N of a sine wave
+ * for each quality, sample path and SIMD kernel set supported by
+ * this CPU.  It fails if a kernel's result differs from the scalar
+ * one (beyond float rounding).
+ *
+ */
+
+#include "config.h"
+#include "pcm_polyphase.h"
+#include "pcm_simd.h"
+
+#include <glib.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	BENCH_CHANNELS = 2,
+
+	/** the length of the signal used to measure the throughput */
+	BENCH_SECONDS = 10,
+
+	/** the input is passed to the resampler in chunks */
+	BENCH_CHUNK_FRAMES = 4096,
+};
+
+static const char *const kernel_names[] = {
+	"none", "sse2", "avx2", "neon",
+};
+
+static const char *const quality_names[] = {
+	[PCM_POLYPHASE_FAST] = "fast",
+	[PCM_POLYPHASE_MEDIUM] = "medium",
+	[PCM_POLYPHASE_BEST] = "best",
+};
+
+static const struct {
+	unsigned src_rate, dest_rate;
+} rates[] = {
+	{ 44100, 48000 },
+	{ 48000, 44100 },
+	{ 44100, 96000 },
+};
+
+static size_t
+frame_size(bool integer)
+{
+	return BENCH_CHANNELS * (integer ? sizeof(int16_t) : sizeof(float));
+}
+
+/**
+ * Generates a sine wave at -3 dB on all channels.
+ */
+static void *
+generate_sine(bool integer, unsigned rate, double frequency,
+	      unsigned num_frames)
+{
+	void *buffer = g_malloc(num_frames * frame_size(integer));
+
+	for (unsigned i = 0; i < num_frames; ++i) {
+		double value = M_SQRT1_2 * sin(2 * M_PI * frequency * i / rate);
+
+		for (unsigned c = 0; c < BENCH_CHANNELS; ++c) {
+			unsigned j = i * BENCH_CHANNELS + c;
+
+			if (integer)
+				((int16_t *)buffer)[j] = lrint(value * 32767);
+			else
+				((float *)buffer)[j] = value;
+		}
+	}
+
+	return buffer;
+}
+
+/**
+ * Resamples the whole signal, chunk by chunk.
+ *
+ * @return the output buffer, to be freed with g_free()
+ */
+static void *
+resample(struct pcm_polyphase *p, bool integer,
+	 const void *src, unsigned num_frames, unsigned *num_frames_r)
+{
+	const size_t size = frame_size(integer);
+	const unsigned max_frames = (uint64_t)num_frames * p->up / p->down +
+		num_frames / BENCH_CHUNK_FRAMES + 2;
+	char *dest = g_malloc(max_frames * size);
+	size_t dest_length = 0;
+
+	for (unsigned i = 0; i < num_frames; i += BENCH_CHUNK_FRAMES) {
+		const char *chunk = (const char *)src + i * size;
+		const size_t chunk_size =
+			MIN(BENCH_CHUNK_FRAMES, num_frames - i) * size;
+		const void *out;
+		size_t out_size;
+
+		out = integer
+			? (const void *)pcm_polyphase_process_16(p,
+								 (const int16_t *)chunk,
+								 chunk_size,
+								 &out_size)
+			: (const void *)pcm_polyphase_process_float(p,
+								    (const float *)chunk,
+								    chunk_size,
+								    &out_size);
+
+		g_assert(dest_length + out_size <= max_frames * size);
+		memcpy(dest + dest_length, out, out_size);
+		dest_length += out_size;
+	}
+
+	*num_frames_r = dest_length / size;
+	return dest;
+}
+
+static double
+sample_value(bool integer, const void *buffer, unsigned frame)
+{
+	return integer
+		? ((const int16_t *)buffer)[frame * BENCH_CHANNELS] / 32767.0
+		: ((const float *)buffer)[frame * BENCH_CHANNELS];
+}
+
+/**
+ * Fits a sine wave of the specified frequency (plus DC) to the first
+ * channel, and returns the energy of the residual relative to the
+ * sine in dB.
+ */
+static double
+thd_n(bool integer, const void *buffer, unsigned first, unsigned end,
+      unsigned rate, double frequency)
+{
+	const double omega = 2 * M_PI * frequency / rate;
+	double m[3][4] = { { 0 } };
+	double a, b, c, noise = 0, signal = 0;
+
+	/* the normal equations of the least squares fit */
+	for (unsigned i = first; i < end; ++i) {
+		const double basis[3] = { sin(omega * i), cos(omega * i), 1 };
+		const double y = sample_value(integer, buffer, i);
+
+		for (unsigned j = 0; j < 3; ++j) {
+			for (unsigned k = 0; k < 3; ++k)
+				m[j][k] += basis[j] * basis[k];
+			m[j][3] += basis[j] * y;
+		}
+	}
+
+	/* Gaussian elimination; the matrix is positive definite, so
+	   no pivoting is needed */
+	for (unsigned j = 0; j < 3; ++j)
+		for (unsigned k = j + 1; k < 3; ++k) {
+			const double factor = m[k][j] / m[j][j];
+			for (unsigned l = j; l < 4; ++l)
+				m[k][l] -= factor * m[j][l];
+		}
+
+	c = m[2][3] / m[2][2];
+	b = (m[1][3] - m[1][2] * c) / m[1][1];
+	a = (m[0][3] - m[0][1] * b - m[0][2] * c) / m[0][0];
+
+	for (unsigned i = first; i < end; ++i) {
+		const double fit = a * sin(omega * i) + b * cos(omega * i);
+		const double error = sample_value(integer, buffer, i) - fit - c;
+
+		signal += fit * fit;
+		noise += error * error;
+	}
+
+	return 10 * log10(noise / signal);
+}
+
+/**
+ * Returns the largest difference between two sample buffers, in
+ * units of 1/32767 for 16 bit samples.
+ */
+static double
+max_difference(bool integer, const void *a, const void *b,
+	       unsigned num_frames)
+{
+	double max = 0;
+
+	for (unsigned i = 0; i < num_frames * BENCH_CHANNELS; ++i) {
+		double d = integer
+			? ((const int16_t *)a)[i] - ((const int16_t *)b)[i]
+			: ((const float *)a)[i] - ((const float *)b)[i];
+
+		if (fabs(d) > max)
+			max = fabs(d);
+	}
+
+	return max;
+}
+
+/**
+ * Resamples a high frequency sine wave with the selected kernels
+ * and with the scalar code, and measures its THD+N.
+ *
+ * @return false if the results do not match
+ */
+static bool
+check_kernels(enum pcm_polyphase_quality quality, bool integer,
+	      unsigned src_rate, unsigned dest_rate, double *thd_r)
+{
+	const double frequency = 15000;
+	const char *kernels = pcm_simd_name();
+	const unsigned num_frames = src_rate * 2;
+	void *src = generate_sine(integer, src_rate, frequency, num_frames);
+	struct pcm_polyphase p;
+	void *dest, *expected;
+	unsigned dest_frames, expected_frames;
+	double difference;
+
+	pcm_polyphase_init(&p);
+	pcm_polyphase_setup(&p, quality, BENCH_CHANNELS,
+			    src_rate, dest_rate, integer);
+	dest = resample(&p, integer, src, num_frames, &dest_frames);
+	*thd_r = thd_n(integer, dest, p.taps, dest_frames,
+		       dest_rate, frequency);
+	pcm_polyphase_deinit(&p);
+
+	pcm_simd_select("none");
+	pcm_polyphase_init(&p);
+	pcm_polyphase_setup(&p, quality, BENCH_CHANNELS,
+			    src_rate, dest_rate, integer);
+	expected = resample(&p, integer, src, num_frames, &expected_frames);
+	pcm_polyphase_deinit(&p);
+	pcm_simd_select(kernels);
+
+	difference = dest_frames == expected_frames
+		? max_difference(integer, dest, expected, dest_frames)
+		: INFINITY;
+
+	g_free(src);
+	g_free(dest);
+	g_free(expected);
+
+	return integer ? difference == 0 : difference <= 1e-5;
+}
+
+static bool
+bench(enum pcm_polyphase_quality quality, bool integer,
+      unsigned src_rate, unsigned dest_rate, GTimer *timer)
+{
+	const double frequency = 1000;
+	const unsigned num_frames = src_rate * BENCH_SECONDS;
+	void *src = generate_sine(integer, src_rate, frequency, num_frames);
+	struct pcm_polyphase p;
+	void *dest;
+	unsigned dest_frames;
+	double elapsed, thd_1k, thd_15k;
+	bool success;
+
+	pcm_polyphase_init(&p);
+	pcm_polyphase_setup(&p, quality, BENCH_CHANNELS,
+			    src_rate, dest_rate, integer);
+
+	g_timer_start(timer);
+	dest = resample(&p, integer, src, num_frames, &dest_frames);
+	elapsed = g_timer_elapsed(timer, NULL);
+
+	thd_1k = thd_n(integer, dest, p.taps, dest_frames,
+		       dest_rate, frequency);
+	success = check_kernels(quality, integer, src_rate, dest_rate,
+				&thd_15k);
+
+	g_print("%-5s %-6s %-5s %5u:%-5u %4u %9.2f %7.0f %8.1f %8.1f  %s\n",
+		pcm_simd_name(), quality_names[quality],
+		integer ? "s16" : "float", src_rate, dest_rate, p.taps,
+		num_frames / elapsed / 1e6, BENCH_SECONDS / elapsed,
+		thd_1k, thd_15k, success ? "ok" : "MISMATCH");
+
+	pcm_polyphase_deinit(&p);
+	g_free(src);
+	g_free(dest);
+
+	return success;
+}
+
+int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv)
+{
+	GTimer *timer = g_timer_new();
+	bool success = true;
+
+	g_print("kernels quality path  rate      taps  Mframes/s realtime"
+		"  THD+N 1k  THD+N 15k  result\n");
+
+	for (unsigned i = 0; i < G_N_ELEMENTS(kernel_names); ++i) {
+		if (!pcm_simd_select(kernel_names[i]))
+			continue;
+
+		for (unsigned j = 0; j < G_N_ELEMENTS(quality_names); ++j)
+			for (unsigned k = 0; k < G_N_ELEMENTS(rates); ++k)
+				for (unsigned integer = 0; integer < 2;
+				     ++integer)
+					success = bench(j, !integer,
+							rates[k].src_rate,
+							rates[k].dest_rate,
+							timer) && success;
+	}
+
+	g_timer_destroy(timer);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the songvec and dirvec libraries with one
+ * huge directory: it adds songs and sub directories, looks up each
+ * of them by name (like the database update and "lsinfo" do), and
+ * deletes them again.
+ *
+ */
+
+#include "config.h"
+#include "directory.h"
+#include "songvec.h"
+#include "dirvec.h"
+#include "song.h"
+
+#include <glib.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double
+bench_lap(GTimer *timer)
+{
+	double elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_start(timer);
+	return elapsed;
+}
+
+static void
+bench_print(const char *what, unsigned long n, double elapsed)
+{
+	g_print("%-16s %lu in %.3f s, %.0f/s\n",
+		what, n, elapsed, n / elapsed);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long num_entries = 100000;
+	struct directory *root;
+	struct song **songs;
+	GTimer *timer;
+	char name[32];
+
+	if (argc > 2) {
+		g_printerr("Usage: bench_songvec [NUM_ENTRIES]\n");
+		return 1;
+	}
+
+	if (argc > 1)
+		num_entries = strtoul(argv[1], NULL, 10);
+
+	if (num_entries == 0) {
+		g_printerr("Invalid number of entries\n");
+		return 1;
+	}
+
+	g_thread_init(NULL);
+	dirvec_init();
+	songvec_init();
+
+	root = directory_new("", NULL);
+	songs = g_new(struct song *, num_entries);
+
+	timer = g_timer_new();
+
+	for (unsigned long i = 0; i < num_entries; ++i) {
+		snprintf(name, sizeof(name), "song%08lu.ogg", i);
+		songs[i] = song_file_new(name, root);
+		songvec_add(&root->songs, songs[i]);
+	}
+
+	bench_print("songvec_add", num_entries, bench_lap(timer));
+
+	for (unsigned long i = 0; i < num_entries; ++i) {
+		snprintf(name, sizeof(name), "song%08lu.ogg", i);
+		if (songvec_find(&root->songs, name) != songs[i])
+			g_error("song %s not found", name);
+	}
+
+	bench_print("songvec_find", num_entries, bench_lap(timer));
+
+	for (unsigned long i = 0; i < num_entries; ++i) {
+		snprintf(name, sizeof(name), "dir%08lu", i);
+		directory_new_child(root, name);
+	}
+
+	bench_print("dirvec_add", num_entries, bench_lap(timer));
+
+	for (unsigned long i = 0; i < num_entries; ++i) {
+		snprintf(name, sizeof(name), "dir%08lu", i);
+		if (directory_get_child(root, name) == NULL)
+			g_error("directory %s not found", name);
+	}
+
+	bench_print("dirvec_find", num_entries, bench_lap(timer));
+
+	/* delete from the end, which costs no memmove(); this
+	   measures the search and shrinking the array */
+	for (unsigned long i = num_entries; i-- > 0;) {
+		songvec_delete(&root->songs, songs[i]);
+		song_free(songs[i]);
+	}
+
+	bench_print("songvec_delete", num_entries, bench_lap(timer));
+
+	assert(root->songs.nr == 0);
+
+	directory_free(root);
+	g_free(songs);
+	g_timer_destroy(timer);
+
+	songvec_deinit();
+	dirvec_deinit();
+
+	return 0;
+}
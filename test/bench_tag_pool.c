@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2003-2010 The Music Player Daemon Project
+ * http://www.musicpd.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * This program measures the tag pool with a synthetic music
+ * collection: a few thousand artists with a skewed (Zipf-like)
+ * distribution, several albums per artist, a handful of genres and
+ * dates, and one unique title per song.  It interns all items of
+ * all songs (like the database update and the database loader do),
+ * duplicates them (like tag_dup()), and releases them again, first
+ * in one thread, then concurrently in several threads.
+ *
+ */
+
+#include "config.h"
+#include "tag_pool.h"
+#include "tag_internal.h"
+
+#include <glib.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	ITEMS_PER_SONG = 7,
+};
+
+struct bench_item {
+	enum tag_type type;
+	unsigned length;
+	char value[64];
+};
+
+struct bench_job {
+	const struct bench_item *items;
+	struct tag_item **interned, **duplicated;
+	unsigned long num_items;
+};
+
+static double
+bench_lap(GTimer *timer)
+{
+	double elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_start(timer);
+	return elapsed;
+}
+
+static void
+bench_print(const char *what, unsigned long n, double elapsed)
+{
+	g_print("%-16s %lu in %.3f s, %.0f/s\n",
+		what, n, elapsed, n / elapsed);
+}
+
+/**
+ * Picks a number in the range [0, n) with a roughly Zipf-like
+ * distribution: small numbers are a lot more likely.
+ */
+static unsigned
+zipf_random(GRand *rand, unsigned n)
+{
+	double x = g_rand_double(rand);
+	return (unsigned)(n * x * x * x) % n;
+}
+
+static void
+bench_item_set(struct bench_item *item, enum tag_type type,
+	       const char *value)
+{
+	item->type = type;
+	item->length = strlen(value);
+	g_strlcpy(item->value, value, sizeof(item->value));
+}
+
+static struct bench_item *
+bench_corpus(unsigned long num_songs)
+{
+	static const char *const genres[] = {
+		"Rock", "Pop", "Jazz", "Classical", "Electronic",
+		"Hip-Hop", "Metal", "Folk", "Blues", "Soundtrack",
+	};
+	unsigned num_artists = num_songs / 40 + 1;
+	struct bench_item *items =
+		g_new(struct bench_item, num_songs * ITEMS_PER_SONG);
+	GRand *rand = g_rand_new_with_seed(42);
+	char buffer[64];
+
+	for (unsigned long i = 0; i < num_songs; ++i) {
+		struct bench_item *item = &items[i * ITEMS_PER_SONG];
+		unsigned artist = zipf_random(rand, num_artists);
+		unsigned album = g_rand_int_range(rand, 0, 8);
+
+		snprintf(buffer, sizeof(buffer), "Artist %u", artist);
+		bench_item_set(item++, TAG_ARTIST, buffer);
+		bench_item_set(item++, TAG_ALBUM_ARTIST, buffer);
+
+		snprintf(buffer, sizeof(buffer), "Album %u of Artist %u",
+			 album, artist);
+		bench_item_set(item++, TAG_ALBUM, buffer);
+
+		snprintf(buffer, sizeof(buffer), "Title of Song %lu", i);
+		bench_item_set(item++, TAG_TITLE, buffer);
+
+		snprintf(buffer, sizeof(buffer), "%u",
+			 g_rand_int_range(rand, 1, 16));
+		bench_item_set(item++, TAG_TRACK, buffer);
+
+		snprintf(buffer, sizeof(buffer), "%u",
+			 1960 + (artist + album) % 50);
+		bench_item_set(item++, TAG_DATE, buffer);
+
+		bench_item_set(item++, TAG_GENRE,
+			       genres[zipf_random(rand, G_N_ELEMENTS(genres))]);
+	}
+
+	g_rand_free(rand);
+	return items;
+}
+
+static void
+bench_get(const struct bench_job *job)
+{
+	for (unsigned long i = 0; i < job->num_items; ++i)
+		job->interned[i] = tag_pool_get_item(job->items[i].type,
+						     job->items[i].value,
+						     job->items[i].length);
+}
+
+static void
+bench_dup(const struct bench_job *job)
+{
+	for (unsigned long i = 0; i < job->num_items; ++i)
+		job->duplicated[i] = tag_pool_dup_item(job->interned[i]);
+}
+
+static void
+bench_put(const struct bench_job *job)
+{
+	for (unsigned long i = 0; i < job->num_items; ++i) {
+		tag_pool_put_item(job->interned[i]);
+		tag_pool_put_item(job->duplicated[i]);
+	}
+}
+
+static gpointer
+bench_thread(gpointer data)
+{
+	const struct bench_job *job = data;
+
+	bench_get(job);
+	bench_dup(job);
+	bench_put(job);
+	return NULL;
+}
+
+static void
+bench_stats(unsigned long num_items, const struct bench_item *items)
+{
+	unsigned num_pooled;
+	size_t pool_size, plain_size = 0;
+
+	tag_pool_stats(&num_pooled, &pool_size);
+
+	for (unsigned long i = 0; i < num_items; ++i)
+		plain_size += sizeof(struct tag_item) + items[i].length + 1;
+
+	g_print("%-16s %u distinct of %lu, %lu kB (unpooled %lu kB)\n",
+		"pool", num_pooled, num_items,
+		(unsigned long)(pool_size / 1024),
+		(unsigned long)(plain_size / 1024));
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long num_songs = 400000, num_items;
+	unsigned num_threads = 4;
+	struct bench_item *items;
+	struct bench_job job;
+	GThread **threads;
+	GTimer *timer;
+
+	if (argc > 3) {
+		g_printerr("Usage: bench_tag_pool [NUM_SONGS [NUM_THREADS]]\n");
+		return 1;
+	}
+
+	if (argc > 1)
+		num_songs = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		num_threads = strtoul(argv[2], NULL, 10);
+
+	if (num_songs == 0 || num_threads == 0) {
+		g_printerr("Invalid argument\n");
+		return 1;
+	}
+
+	g_thread_init(NULL);
+	tag_pool_init();
+
+	num_items = num_songs * ITEMS_PER_SONG;
+	items = bench_corpus(num_songs);
+	job.items = items;
+	job.interned = g_new(struct tag_item *, num_items);
+	job.duplicated = g_new(struct tag_item *, num_items);
+	job.num_items = num_items;
+
+	timer = g_timer_new();
+
+	bench_get(&job);
+	bench_print("get", num_items, bench_lap(timer));
+
+	bench_stats(num_items, items);
+	g_timer_start(timer);
+
+	bench_dup(&job);
+	bench_print("dup", num_items, bench_lap(timer));
+
+	bench_put(&job);
+	bench_print("put", num_items * 2, bench_lap(timer));
+
+	/* the same work, split among several threads */
+
+	threads = g_new(GThread *, num_threads);
+	struct bench_job *jobs = g_new(struct bench_job, num_threads);
+	unsigned long chunk = (num_songs + num_threads - 1) / num_threads
+		* ITEMS_PER_SONG;
+
+	for (unsigned i = 0; i < num_threads; ++i) {
+		unsigned long start = MIN(i * chunk, num_items);
+
+		jobs[i].items = items + start;
+		jobs[i].interned = job.interned + start;
+		jobs[i].duplicated = job.duplicated + start;
+		jobs[i].num_items = MIN(chunk, num_items - start);
+		threads[i] = g_thread_create(bench_thread, &jobs[i],
+					     true, NULL);
+	}
+
+	for (unsigned i = 0; i < num_threads; ++i)
+		g_thread_join(threads[i]);
+
+	bench_print("threaded", num_items * 4, bench_lap(timer));
+
+	g_free(jobs);
+	g_free(threads);
+	g_timer_destroy(timer);
+	g_free(job.duplicated);
+	g_free(job.interned);
+	g_free(items);
+	tag_pool_deinit();
+	return 0;
+}
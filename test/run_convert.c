@@ -21,12 +21,17 @@
  * This program is a command line interface to MPD's PCM conversion
  * library (pcm_convert.c).
  *
+ * With "--benchmark", it measures the throughput of conversion paths
+ * with each SIMD kernel set supported by this CPU (see pcm_simd.h),
+ * and verifies that all kernel sets produce the same output.
+ *
  */
 
 #include "config.h"
 #include "audio_parser.h"
 #include "audio_format.h"
 #include "pcm_convert.h"
+#include "pcm_simd.h"
 #include "conf.h"
 #include "fifo_buffer.h"
 #include "stdbin.h"
@@ -35,6 +40,8 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 static void
@@ -53,6 +60,171 @@ config_get_string(G_GNUC_UNUSED const char *name, const char *default_value)
 	return default_value;
 }
 
+enum {
+	/** the size of the benchmark input buffer */
+	BENCH_INPUT_SIZE = 4 * 1024 * 1024,
+
+	/** the number of times each conversion is repeated */
+	BENCH_ITERATIONS = 50,
+};
+
+static const char *const bench_kernels[] = {
+	"none", "sse2", "avx2", "neon",
+};
+
+/**
+ * The conversion paths which are measured by default.
+ */
+static const struct {
+	const char *in, *out;
+	bool reverse_endian;
+} bench_paths[] = {
+	{ "44100:16:2", "44100:24:2", false },
+	{ "44100:16:2", "44100:32:2", false },
+	{ "44100:24_3:2", "44100:24:2", false },
+	{ "44100:24:2", "44100:24_3:2", false },
+	{ "44100:24_3:2", "44100:24:2", true },
+	{ "44100:32:2", "44100:24:2", false },
+	{ "44100:24:2", "44100:32:2", false },
+	{ "44100:16:2", "44100:16:2", true },
+	{ "44100:16:1", "44100:16:2", false },
+	{ "44100:16:2", "44100:16:1", false },
+	{ "44100:24:1", "44100:24:2", false },
+	{ "44100:24:2", "44100:24:1", false },
+	{ "44100:16:2", "44100:f:2", false },
+	{ "44100:24:2", "44100:f:2", false },
+	{ "44100:f:2", "44100:16:2", false },
+	{ "44100:f:2", "44100:24:2", false },
+	{ "44100:f:1", "44100:f:2", false },
+	{ "44100:f:2", "44100:f:1", false },
+};
+
+/**
+ * Converts the input buffer repeatedly with the current kernel set.
+ *
+ * @param first_r returns a copy of the first conversion's output
+ * @return the throughput in MB/s of input data, or a negative value
+ * on error
+ */
+static double
+bench_convert(const struct audio_format *in_audio_format,
+	      const struct audio_format *out_audio_format,
+	      const void *src, size_t src_size,
+	      void **first_r, size_t *first_size_r, GTimer *timer)
+{
+	GError *error = NULL;
+	struct pcm_convert_state state;
+	const void *output;
+	size_t length;
+
+	pcm_convert_init(&state);
+
+	output = pcm_convert(&state, in_audio_format, src, src_size,
+			     out_audio_format, &length, &error);
+	if (output == NULL) {
+		g_printerr("Failed to convert: %s\n", error->message);
+		g_error_free(error);
+		pcm_convert_deinit(&state);
+		return -1;
+	}
+
+	*first_r = g_memdup(output, length);
+	*first_size_r = length;
+
+	g_timer_start(timer);
+	for (unsigned i = 0; i < BENCH_ITERATIONS; ++i)
+		pcm_convert(&state, in_audio_format, src, src_size,
+			    out_audio_format, &length, NULL);
+	double elapsed = g_timer_elapsed(timer, NULL);
+
+	pcm_convert_deinit(&state);
+
+	return (double)src_size * BENCH_ITERATIONS / elapsed / 1e6;
+}
+
+static bool
+bench_path(const char *in, const char *out, bool reverse_endian,
+	   GTimer *timer)
+{
+	GError *error = NULL;
+	struct audio_format in_audio_format, out_audio_format;
+	void *expected = NULL;
+	size_t expected_size = 0;
+	bool success = true;
+
+	if (!audio_format_parse(&in_audio_format, in, false, &error) ||
+	    !audio_format_parse(&out_audio_format, out, false, &error)) {
+		g_printerr("Failed to parse audio format: %s\n",
+			   error->message);
+		g_error_free(error);
+		return false;
+	}
+
+	out_audio_format.reverse_endian = reverse_endian;
+
+	size_t src_size = BENCH_INPUT_SIZE -
+		BENCH_INPUT_SIZE % audio_format_frame_size(&in_audio_format);
+	char *src = g_malloc(src_size);
+	for (size_t i = 0; i < src_size; ++i)
+		src[i] = g_random_int();
+
+	for (unsigned i = 0; i < G_N_ELEMENTS(bench_kernels); ++i) {
+		void *output;
+		size_t output_size;
+
+		if (!pcm_simd_select(bench_kernels[i]))
+			continue;
+
+		double mbps = bench_convert(&in_audio_format,
+					    &out_audio_format,
+					    src, src_size,
+					    &output, &output_size, timer);
+		if (mbps < 0) {
+			success = false;
+			break;
+		}
+
+		bool match = true;
+		if (expected == NULL) {
+			expected = output;
+			expected_size = output_size;
+		} else {
+			match = output_size == expected_size &&
+				memcmp(output, expected, output_size) == 0;
+			g_free(output);
+			success = success && match;
+		}
+
+		g_print("%-12s -> %-12s%s %-5s %8.1f MB/s%s\n",
+			in, out, reverse_endian ? " (swapped)" : "          ",
+			bench_kernels[i], mbps,
+			match ? "" : "  MISMATCH");
+	}
+
+	g_free(expected);
+	g_free(src);
+	return success;
+}
+
+static int
+run_benchmark(int argc, char **argv)
+{
+	GTimer *timer = g_timer_new();
+	bool success = true;
+
+	if (argc == 2)
+		success = bench_path(argv[0], argv[1], false, timer);
+	else
+		for (unsigned i = 0; i < G_N_ELEMENTS(bench_paths); ++i)
+			success = bench_path(bench_paths[i].in,
+					     bench_paths[i].out,
+					     bench_paths[i].reverse_endian,
+					     timer) && success;
+
+	g_timer_destroy(timer);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char **argv)
 {
 	GError *error = NULL;
@@ -62,13 +234,18 @@ int main(int argc, char **argv)
 	ssize_t nbytes;
 	size_t length;
 
+	g_log_set_default_handler(my_log_func, NULL);
+
+	if (argc >= 2 && strcmp(argv[1], "--benchmark") == 0 &&
+	    (argc == 2 || argc == 4))
+		return run_benchmark(argc - 2, argv + 2);
+
 	if (argc != 3) {
-		g_printerr("Usage: run_convert IN_FORMAT OUT_FORMAT <IN >OUT\n");
+		g_printerr("Usage: run_convert IN_FORMAT OUT_FORMAT <IN >OUT\n"
+			   "       run_convert --benchmark [IN_FORMAT OUT_FORMAT]\n");
 		return 1;
 	}
 
-	g_log_set_default_handler(my_log_func, NULL);
-
 	if (!audio_format_parse(&in_audio_format, argv[1],
 				false, &error)) {
 		g_printerr("Failed to parse audio format: %s\n",